@@ -43,6 +43,26 @@ typedef enum
   CLUTTER_ACTOR_TRAVERSE_BREADTH_FIRST = 1L<<1
 } ClutterActorTraverseFlags;
 
+/*< private >
+ * ClutterLayoutStats:
+ * @n_allocate: number of ClutterActorClass.allocate() calls
+ * @n_get_preferred_width: number of ClutterActorClass.get_preferred_width()
+ *   calls that were not answered from the size request cache
+ * @n_get_preferred_height: number of ClutterActorClass.get_preferred_height()
+ *   calls that were not answered from the size request cache
+ * @n_pruned_relayouts: number of actors reallocated without reallocating
+ *   their parent, because their size request didn't change
+ *
+ * Counts the layout work done during a frame.
+ */
+typedef struct _ClutterLayoutStats
+{
+  unsigned int n_allocate;
+  unsigned int n_get_preferred_width;
+  unsigned int n_get_preferred_height;
+  unsigned int n_pruned_relayouts;
+} ClutterLayoutStats;
+
 /*< private >
  * ClutterActorTraverseVisitFlags:
  * CLUTTER_ACTOR_TRAVERSE_VISIT_CONTINUE: Continue traversing as
@@ -273,6 +293,19 @@ gboolean clutter_actor_get_redraw_clip (ClutterActor       *self,
                                         ClutterPaintVolume *dst_old_pv,
                                         ClutterPaintVolume *dst_new_pv);
 
+void clutter_actor_update_pointer (ClutterActor *self);
+
+int clutter_actor_get_animatable_n_components (ClutterActor *self,
+                                               GParamSpec   *pspec);
+
+void clutter_actor_set_animatable_components (ClutterActor *self,
+                                              GParamSpec   *pspec,
+                                              const double *components);
+
+gboolean clutter_actor_finish_deferred_relayout (ClutterActor *self);
+
+void clutter_actor_allocate_deferred (ClutterActor *self);
+
 void clutter_actor_attach_grab (ClutterActor *actor,
                                 ClutterGrab  *grab);
 void clutter_actor_detach_grab (ClutterActor *actor,
@@ -670,6 +670,15 @@ typedef enum
  * will ask for 3 different preferred size in each allocation cycle */
 #define N_CACHED_SIZE_REQUESTS 3
 
+/* The size requests an actor had answered when its relayout got
+ * deferred; see clutter_actor_real_queue_relayout()
+ */
+typedef struct _DeferredRelayout
+{
+  SizeRequest width_requests[N_CACHED_SIZE_REQUESTS];
+  SizeRequest height_requests[N_CACHED_SIZE_REQUESTS];
+} DeferredRelayout;
+
 struct _ClutterActorPrivate
 {
   /* request mode */
@@ -688,6 +697,13 @@ struct _ClutterActorPrivate
    */
   ClutterActorBox allocation;
 
+  /* the box last passed to clutter_actor_allocate(), before applying
+   * constraints, alignment and margins
+   */
+  ClutterActorBox requested_allocation;
+
+  DeferredRelayout *deferred_relayout;
+
   /* clip, in actor coordinates */
   graphene_rect_t clip;
 
@@ -817,6 +833,14 @@ struct _ClutterActorPrivate
   guint needs_height_request        : 1;
   /* cached allocation is invalid (request has changed, probably) */
   guint needs_allocation            : 1;
+  /* the cached requests may not be all the parent has seen, e.g. because
+   * one was overwritten since the last relayout
+   */
+  guint size_request_evicted        : 1;
+  /* the parent layout depends on something other than our size
+   * request that changed, e.g. the fixed position
+   */
+  guint needs_parent_relayout       : 1;
   guint show_on_set_parent          : 1;
   guint has_clip                    : 1;
   guint clip_to_allocation          : 1;
@@ -1051,6 +1075,8 @@ static void on_layout_manager_changed (ClutterLayoutManager *manager,
 
 static inline void clutter_actor_queue_compute_expand (ClutterActor *self);
 
+static void clutter_actor_queue_parent_relayout (ClutterActor *self);
+
 static inline void clutter_actor_set_margin_internal (ClutterActor *self,
                                                       gfloat        margin,
                                                       GParamSpec   *pspec);
@@ -1553,7 +1579,7 @@ clutter_actor_real_map (ClutterActor *self)
       priv->needs_height_request = FALSE;
       priv->needs_allocation = FALSE;
 
-      clutter_actor_queue_relayout (self);
+      clutter_actor_queue_parent_relayout (self);
     }
 
   /* notify on parent mapped before potentially mapping
@@ -2559,6 +2585,9 @@ clutter_actor_set_allocation_internal (ClutterActor           *self,
   priv->needs_height_request = FALSE;
   priv->needs_allocation = FALSE;
 
+  if (priv->deferred_relayout == NULL)
+    priv->needs_parent_relayout = FALSE;
+
   if (origin_changed || size_changed)
     {
       CLUTTER_NOTE (LAYOUT, "Allocation for '%s' changed",
@@ -2694,24 +2723,120 @@ clutter_actor_needs_relayout (ClutterActor *self)
           priv->needs_allocation);
 }
 
-static void
-clutter_actor_real_queue_relayout (ClutterActor *self)
+static inline void
+clutter_actor_invalidate_size_requests (ClutterActor *self)
 {
   ClutterActorPrivate *priv = self->priv;
 
-  /* no point in queueing a redraw on a destroyed actor */
-  if (CLUTTER_ACTOR_IN_DESTRUCTION (self))
-    return;
-
   priv->needs_width_request  = TRUE;
   priv->needs_height_request = TRUE;
-  priv->needs_allocation     = TRUE;
+  priv->size_request_evicted = FALSE;
 
   /* reset the cached size requests */
   memset (priv->width_requests, 0,
           N_CACHED_SIZE_REQUESTS * sizeof (SizeRequest));
   memset (priv->height_requests, 0,
           N_CACHED_SIZE_REQUESTS * sizeof (SizeRequest));
+}
+
+/* Whether the parent of @self can be left alone until we know whether
+ * the size request of @self changed
+ */
+static gboolean
+clutter_actor_can_defer_relayout (ClutterActor *self)
+{
+  ClutterActorPrivate *priv = self->priv;
+
+  if (priv->parent == NULL ||
+      CLUTTER_ACTOR_IS_TOPLEVEL (self) ||
+      !CLUTTER_ACTOR_IS_MAPPED (self))
+    return FALSE;
+
+  if (priv->parent->flags & CLUTTER_ACTOR_NO_LAYOUT)
+    return FALSE;
+
+  /* Nothing to save if the parent is getting allocated anyway */
+  if (priv->parent->priv->needs_allocation)
+    return FALSE;
+
+  /* We only know what the parent saw if it was allocated after the
+   * last size request changes and all requests are still cached
+   */
+  if (priv->needs_allocation ||
+      priv->needs_parent_relayout ||
+      priv->size_request_evicted)
+    return FALSE;
+
+  /* Constraints may depend on other actors */
+  if (priv->constraints != NULL &&
+      _clutter_meta_group_peek_metas (priv->constraints) != NULL)
+    return FALSE;
+
+  /* The content size isn't cached */
+  if (priv->request_mode == CLUTTER_REQUEST_CONTENT_SIZE)
+    return FALSE;
+
+  return TRUE;
+}
+
+static void
+clutter_actor_defer_relayout (ClutterActor *self)
+{
+  ClutterActorPrivate *priv = self->priv;
+  ClutterActor *stage = _clutter_actor_get_stage_internal (self);
+  ClutterActor *iter;
+
+  if (stage == NULL)
+    return;
+
+  priv->deferred_relayout = g_new (DeferredRelayout, 1);
+  memcpy (priv->deferred_relayout->width_requests, priv->width_requests,
+          N_CACHED_SIZE_REQUESTS * sizeof (SizeRequest));
+  memcpy (priv->deferred_relayout->height_requests, priv->height_requests,
+          N_CACHED_SIZE_REQUESTS * sizeof (SizeRequest));
+
+  /* Anyone asking the ancestors for their size before the next layout
+   * pass must not get values that are based on our old size request.
+   * What their parents saw is lost that way, so they can't defer their
+   * own relayouts until the next regular one.
+   */
+  for (iter = priv->parent; iter != NULL; iter = iter->priv->parent)
+    {
+      if (iter->priv->needs_width_request &&
+          iter->priv->needs_height_request &&
+          iter->priv->size_request_evicted)
+        break;
+
+      clutter_actor_invalidate_size_requests (iter);
+      iter->priv->size_request_evicted = TRUE;
+    }
+
+  clutter_stage_queue_actor_deferred_relayout (CLUTTER_STAGE (stage), self);
+}
+
+static void
+clutter_actor_real_queue_relayout (ClutterActor *self)
+{
+  ClutterActorPrivate *priv = self->priv;
+
+  /* no point in queueing a redraw on a destroyed actor */
+  if (CLUTTER_ACTOR_IN_DESTRUCTION (self))
+    return;
+
+  if (clutter_actor_can_defer_relayout (self))
+    clutter_actor_defer_relayout (self);
+
+  clutter_actor_invalidate_size_requests (self);
+  priv->needs_allocation = TRUE;
+
+  /* The parent only needs a relayout if our size request changed, which
+   * is checked by clutter_actor_finish_deferred_relayout() before the
+   * next layout pass.
+   */
+  if (priv->deferred_relayout != NULL)
+    return;
+
+  priv->needs_parent_relayout = FALSE;
 
   /* We may need to go all the way up the hierarchy */
   if (priv->parent != NULL)
@@ -5611,6 +5736,7 @@ clutter_actor_finalize (GObject *object)
   /* No new grabs should have happened after unmapping */
   g_assert (priv->grabs == NULL);
   g_free (priv->name);
+  g_free (priv->deferred_relayout);
 
   g_free (priv->debug_name);
 
@@ -8249,6 +8375,17 @@ clutter_actor_queue_relayout (ClutterActor *self)
   clutter_actor_queue_redraw (self);
 }
 
+/* Queues a relayout of @self that always reaches the parent, for changes
+ * the parent layout depends on without affecting the size request
+ */
+static void
+clutter_actor_queue_parent_relayout (ClutterActor *self)
+{
+  self->priv->needs_parent_relayout = TRUE;
+
+  clutter_actor_queue_relayout (self);
+}
+
 /**
  * clutter_actor_get_preferred_size:
  * @self: a #ClutterActor
@@ -8619,6 +8756,135 @@ clutter_actor_update_preferred_size_for_constraints (ClutterActor *self,
     }
 }
 
+static ClutterLayoutStats *
+clutter_actor_get_layout_stats (ClutterActor *self)
+{
+  ClutterActor *stage;
+
+  stage = _clutter_actor_get_stage_internal (self);
+  if (!stage)
+    return NULL;
+
+  return clutter_stage_get_pending_layout_stats (CLUTTER_STAGE (stage));
+}
+
+/* Computes the width request of @self for @for_height, which has already
+ * been adjusted for the margin, and stores it in @size_request
+ */
+static void
+clutter_actor_update_width_request (ClutterActor *self,
+                                    float         for_height,
+                                    SizeRequest  *size_request)
+{
+  ClutterActorPrivate *priv = self->priv;
+  const ClutterLayoutInfo *info;
+  ClutterActorClass *klass;
+  ClutterLayoutStats *stats;
+  float minimum_width, natural_width;
+
+  info = _clutter_actor_get_layout_info_or_defaults (self);
+
+  minimum_width = natural_width = 0;
+
+  CLUTTER_NOTE (LAYOUT, "Width request for %.2f px", for_height);
+
+  klass = CLUTTER_ACTOR_GET_CLASS (self);
+  klass->get_preferred_width (self, for_height,
+                              &minimum_width,
+                              &natural_width);
+  stats = clutter_actor_get_layout_stats (self);
+  if (stats)
+    stats->n_get_preferred_width++;
+
+  /* adjust for constraints */
+  clutter_actor_update_preferred_size_for_constraints (self,
+                                                       CLUTTER_ORIENTATION_HORIZONTAL,
+                                                       for_height,
+                                                       &minimum_width,
+                                                       &natural_width);
+
+  /* adjust for the margin */
+  minimum_width += (info->margin.left + info->margin.right);
+  natural_width += (info->margin.left + info->margin.right);
+
+  /* Due to accumulated float errors, it's better not to warn
+   * on this, but just fix it.
+   */
+  if (natural_width < minimum_width)
+    natural_width = minimum_width;
+
+  /* A relayout can only be deferred if the parent's view of our
+   * size request is still entirely in the cache
+   */
+  if (size_request->age > 0)
+    priv->size_request_evicted = TRUE;
+
+  size_request->min_size = minimum_width;
+  size_request->natural_size = natural_width;
+  size_request->for_size = for_height;
+  size_request->age = priv->cached_width_age;
+
+  priv->cached_width_age += 1;
+  priv->needs_width_request = FALSE;
+}
+
+/* Computes the height request of @self for @for_width, which has already
+ * been adjusted for the margin, and stores it in @size_request
+ */
+static void
+clutter_actor_update_height_request (ClutterActor *self,
+                                     float         for_width,
+                                     SizeRequest  *size_request)
+{
+  ClutterActorPrivate *priv = self->priv;
+  const ClutterLayoutInfo *info;
+  ClutterActorClass *klass;
+  ClutterLayoutStats *stats;
+  float minimum_height, natural_height;
+
+  info = _clutter_actor_get_layout_info_or_defaults (self);
+
+  minimum_height = natural_height = 0;
+
+  CLUTTER_NOTE (LAYOUT, "Height request for %.2f px", for_width);
+
+  klass = CLUTTER_ACTOR_GET_CLASS (self);
+  klass->get_preferred_height (self, for_width,
+                               &minimum_height,
+                               &natural_height);
+  stats = clutter_actor_get_layout_stats (self);
+  if (stats)
+    stats->n_get_preferred_height++;
+
+  /* adjust for constraints */
+  clutter_actor_update_preferred_size_for_constraints (self,
+                                                       CLUTTER_ORIENTATION_VERTICAL,
+                                                       for_width,
+                                                       &minimum_height,
+                                                       &natural_height);
+
+  /* adjust for margin */
+  minimum_height += (info->margin.top + info->margin.bottom);
+  natural_height += (info->margin.top + info->margin.bottom);
+
+  /* Due to accumulated float errors, it's better not to warn
+   * on this, but just fix it.
+   */
+  if (natural_height < minimum_height)
+    natural_height = minimum_height;
+
+  if (size_request->age > 0)
+    priv->size_request_evicted = TRUE;
+
+  size_request->min_size = minimum_height;
+  size_request->natural_size = natural_height;
+  size_request->for_size = for_width;
+  size_request->age = priv->cached_height_age;
+
+  priv->cached_height_age += 1;
+  priv->needs_height_request = FALSE;
+}
+
 /**
  * clutter_actor_get_preferred_width:
  * @self: A #ClutterActor
@@ -8716,11 +8982,6 @@ clutter_actor_get_preferred_width (ClutterActor *self,
 
   if (!found_in_cache)
     {
-      gfloat minimum_width, natural_width;
-      ClutterActorClass *klass;
-
-      minimum_width = natural_width = 0;
-
       /* adjust for the margin */
       if (for_height >= 0)
         {
@@ -8729,37 +8990,8 @@ clutter_actor_get_preferred_width (ClutterActor *self,
             for_height = 0;
         }
 
-      CLUTTER_NOTE (LAYOUT, "Width request for %.2f px", for_height);
-
-      klass = CLUTTER_ACTOR_GET_CLASS (self);
-      klass->get_preferred_width (self, for_height,
-                                  &minimum_width,
-                                  &natural_width);
-
-      /* adjust for constraints */
-      clutter_actor_update_preferred_size_for_constraints (self,
-                                                           CLUTTER_ORIENTATION_HORIZONTAL,
-                                                           for_height,
-                                                           &minimum_width,
-                                                           &natural_width);
-
-      /* adjust for the margin */
-      minimum_width += (info->margin.left + info->margin.right);
-      natural_width += (info->margin.left + info->margin.right);
-
-      /* Due to accumulated float errors, it's better not to warn
-       * on this, but just fix it.
-       */
-      if (natural_width < minimum_width)
-	natural_width = minimum_width;
-
-      cached_size_request->min_size = minimum_width;
-      cached_size_request->natural_size = natural_width;
-      cached_size_request->for_size = for_height;
-      cached_size_request->age = priv->cached_width_age;
-
-      priv->cached_width_age += 1;
-      priv->needs_width_request = FALSE;
+      clutter_actor_update_width_request (self, for_height,
+                                          cached_size_request);
     }
 
   if (!priv->min_width_set)
@@ -8880,13 +9112,6 @@ clutter_actor_get_preferred_height (ClutterActor *self,
 
   if (!found_in_cache)
     {
-      gfloat minimum_height, natural_height;
-      ClutterActorClass *klass;
-
-      minimum_height = natural_height = 0;
-
-      CLUTTER_NOTE (LAYOUT, "Height request for %.2f px", for_width);
-
       /* adjust for margin */
       if (for_width >= 0)
         {
@@ -8895,35 +9120,8 @@ clutter_actor_get_preferred_height (ClutterActor *self,
             for_width = 0;
         }
 
-      klass = CLUTTER_ACTOR_GET_CLASS (self);
-      klass->get_preferred_height (self, for_width,
-                                   &minimum_height,
-                                   &natural_height);
-
-      /* adjust for constraints */
-      clutter_actor_update_preferred_size_for_constraints (self,
-                                                           CLUTTER_ORIENTATION_VERTICAL,
-                                                           for_width,
-                                                           &minimum_height,
-                                                           &natural_height);
-
-      /* adjust for margin */
-      minimum_height += (info->margin.top + info->margin.bottom);
-      natural_height += (info->margin.top + info->margin.bottom);
-
-      /* Due to accumulated float errors, it's better not to warn
-       * on this, but just fix it.
-       */
-      if (natural_height < minimum_height)
-	natural_height = minimum_height;
-
-      cached_size_request->min_size = minimum_height;
-      cached_size_request->natural_size = natural_height;
-      cached_size_request->for_size = for_width;
-      cached_size_request->age = priv->cached_height_age;
-
-      priv->cached_height_age += 1;
-      priv->needs_height_request = FALSE;
+      clutter_actor_update_height_request (self, for_width,
+                                           cached_size_request);
     }
 
   if (!priv->min_height_set)
@@ -9163,6 +9361,7 @@ clutter_actor_allocate_internal (ClutterActor           *self,
                                  const ClutterActorBox  *allocation)
 {
   ClutterActorClass *klass;
+  ClutterLayoutStats *stats;
 
   CLUTTER_SET_PRIVATE_FLAGS (self, CLUTTER_IN_RELAYOUT);
 
@@ -9171,6 +9370,9 @@ clutter_actor_allocate_internal (ClutterActor           *self,
 
   klass = CLUTTER_ACTOR_GET_CLASS (self);
   klass->allocate (self, allocation);
+  stats = clutter_actor_get_layout_stats (self);
+  if (stats)
+    stats->n_allocate++;
 
   CLUTTER_UNSET_PRIVATE_FLAGS (self, CLUTTER_IN_RELAYOUT);
 
@@ -9251,6 +9453,8 @@ clutter_actor_allocate (ClutterActor          *self,
                     !isnan (real_allocation.y1) &&
                     !isnan (real_allocation.y2));
 
+  priv->requested_allocation = *box;
+
   /* constraints are allowed to modify the allocation only here; we do
    * this prior to all the other checks so that we can bail out if the
    * allocation did not change
@@ -9306,6 +9510,127 @@ clutter_actor_allocate (ClutterActor          *self,
     clutter_actor_allocate_internal (self, &priv->allocation);
 }
 
+static gboolean
+clutter_actor_size_requests_changed (ClutterActor       *self,
+                                     ClutterOrientation  orientation,
+                                     const SizeRequest  *old_requests)
+{
+  ClutterActorPrivate *priv = self->priv;
+  SizeRequest *requests;
+  int i;
+
+  if (orientation == CLUTTER_ORIENTATION_HORIZONTAL)
+    requests = priv->width_requests;
+  else
+    requests = priv->height_requests;
+
+  for (i = 0; i < N_CACHED_SIZE_REQUESTS; i++)
+    {
+      const SizeRequest *old_request = &old_requests[i];
+      SizeRequest *size_request;
+
+      if (old_request->age == 0)
+        continue;
+
+      if (!_clutter_actor_get_cached_size_request (old_request->for_size,
+                                                   requests,
+                                                   &size_request))
+        {
+          if (orientation == CLUTTER_ORIENTATION_HORIZONTAL)
+            clutter_actor_update_width_request (self,
+                                                old_request->for_size,
+                                                size_request);
+          else
+            clutter_actor_update_height_request (self,
+                                                 old_request->for_size,
+                                                 size_request);
+        }
+
+      if (size_request->min_size != old_request->min_size ||
+          size_request->natural_size != old_request->natural_size)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/*
+ * clutter_actor_finish_deferred_relayout:
+ * @self: a #ClutterActor
+ *
+ * Decides whether the relayout of @self that was deferred by
+ * clutter_actor_queue_relayout() has to involve the parent: if the size
+ * request of @self changed, or the parent layout depends on some other
+ * changed state, the relayout is propagated to the parent as usual.
+ *
+ * Returns: %TRUE if @self can be reallocated in place using
+ *   clutter_actor_allocate_deferred(), %FALSE otherwise
+ */
+gboolean
+clutter_actor_finish_deferred_relayout (ClutterActor *self)
+{
+  ClutterActorPrivate *priv = self->priv;
+  g_autofree DeferredRelayout *deferred_relayout = NULL;
+
+  deferred_relayout = g_steal_pointer (&priv->deferred_relayout);
+  if (deferred_relayout == NULL)
+    return FALSE;
+
+  if (CLUTTER_ACTOR_IN_DESTRUCTION (self) || priv->parent == NULL)
+    return FALSE;
+
+  if (!priv->needs_parent_relayout &&
+      !clutter_actor_size_requests_changed (self,
+                                            CLUTTER_ORIENTATION_HORIZONTAL,
+                                            deferred_relayout->width_requests) &&
+      !clutter_actor_size_requests_changed (self,
+                                            CLUTTER_ORIENTATION_VERTICAL,
+                                            deferred_relayout->height_requests))
+    return TRUE;
+
+  CLUTTER_NOTE (LAYOUT, "Size request of '%s' changed, relayouting parent",
+                _clutter_actor_get_debug_name (self));
+
+  priv->needs_parent_relayout = FALSE;
+
+  if (priv->parent->flags & CLUTTER_ACTOR_NO_LAYOUT)
+    clutter_actor_queue_shallow_relayout (self);
+  else
+    _clutter_actor_queue_only_relayout (priv->parent);
+
+  return FALSE;
+}
+
+/*
+ * clutter_actor_allocate_deferred:
+ * @self: a #ClutterActor
+ *
+ * Allocates @self using the box its parent allocated it last, after
+ * clutter_actor_finish_deferred_relayout() found that the parent
+ * layout didn't change.
+ */
+void
+clutter_actor_allocate_deferred (ClutterActor *self)
+{
+  ClutterActorPrivate *priv = self->priv;
+  ClutterLayoutStats *stats;
+
+  /* Already allocated by the parent, or not allocatable at all */
+  if (!priv->needs_allocation || priv->parent == NULL)
+    return;
+
+  if (!CLUTTER_ACTOR_IS_MAPPED (self) && !clutter_actor_has_mapped_clones (self))
+    return;
+
+  CLUTTER_NOTE (LAYOUT, "Reallocating '%s' without its parent",
+                _clutter_actor_get_debug_name (self));
+
+  clutter_actor_allocate (self, &priv->requested_allocation);
+  stats = clutter_actor_get_layout_stats (self);
+  if (stats)
+    stats->n_pruned_relayouts++;
+}
+
 /**
  * clutter_actor_set_allocation:
  * @self: a #ClutterActor
@@ -9437,7 +9762,7 @@ clutter_actor_set_fixed_position_set (ClutterActor *self,
   self->priv->position_set = is_set != FALSE;
   g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_FIXED_POSITION_SET]);
 
-  clutter_actor_queue_relayout (self);
+  clutter_actor_queue_parent_relayout (self);
 }
 
 /**
@@ -9503,7 +9828,7 @@ clutter_actor_set_min_width (ClutterActor *self,
 
   g_object_thaw_notify (G_OBJECT (self));
 
-  clutter_actor_queue_relayout (self);
+  clutter_actor_queue_parent_relayout (self);
 }
 
 static void
@@ -9538,7 +9863,7 @@ clutter_actor_set_min_height (ClutterActor *self,
 
   g_object_thaw_notify (G_OBJECT (self));
 
-  clutter_actor_queue_relayout (self);
+  clutter_actor_queue_parent_relayout (self);
 }
 
 static void
@@ -9566,7 +9891,7 @@ clutter_actor_set_natural_width (ClutterActor *self,
 
   g_object_thaw_notify (G_OBJECT (self));
 
-  clutter_actor_queue_relayout (self);
+  clutter_actor_queue_parent_relayout (self);
 }
 
 static void
@@ -9594,7 +9919,7 @@ clutter_actor_set_natural_height (ClutterActor *self,
 
   g_object_thaw_notify (G_OBJECT (self));
 
-  clutter_actor_queue_relayout (self);
+  clutter_actor_queue_parent_relayout (self);
 }
 
 static void
@@ -9614,7 +9939,7 @@ clutter_actor_set_min_width_set (ClutterActor *self,
 
   clutter_actor_notify_if_geometry_changed (self, &old);
 
-  clutter_actor_queue_relayout (self);
+  clutter_actor_queue_parent_relayout (self);
 }
 
 static void
@@ -9634,7 +9959,7 @@ clutter_actor_set_min_height_set (ClutterActor *self,
 
   clutter_actor_notify_if_geometry_changed (self, &old);
 
-  clutter_actor_queue_relayout (self);
+  clutter_actor_queue_parent_relayout (self);
 }
 
 static void
@@ -9654,7 +9979,7 @@ clutter_actor_set_natural_width_set (ClutterActor *self,
 
   clutter_actor_notify_if_geometry_changed (self, &old);
 
-  clutter_actor_queue_relayout (self);
+  clutter_actor_queue_parent_relayout (self);
 }
 
 static void
@@ -9674,7 +9999,7 @@ clutter_actor_set_natural_height_set (ClutterActor *self,
 
   clutter_actor_notify_if_geometry_changed (self, &old);
 
-  clutter_actor_queue_relayout (self);
+  clutter_actor_queue_parent_relayout (self);
 }
 
 /**
@@ -9710,7 +10035,7 @@ clutter_actor_set_request_mode (ClutterActor       *self,
 
   g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_REQUEST_MODE]);
 
-  clutter_actor_queue_relayout (self);
+  clutter_actor_queue_parent_relayout (self);
 }
 
 /**
@@ -10347,7 +10672,7 @@ clutter_actor_set_x_internal (ClutterActor *self,
 
   clutter_actor_notify_if_geometry_changed (self, &old);
 
-  clutter_actor_queue_relayout (self);
+  clutter_actor_queue_parent_relayout (self);
 }
 
 static inline void
@@ -10370,7 +10695,7 @@ clutter_actor_set_y_internal (ClutterActor *self,
 
   clutter_actor_notify_if_geometry_changed (self, &old);
 
-  clutter_actor_queue_relayout (self);
+  clutter_actor_queue_parent_relayout (self);
 }
 
 static void
@@ -10399,7 +10724,7 @@ clutter_actor_set_position_internal (ClutterActor           *self,
 
   clutter_actor_notify_if_geometry_changed (self, &old);
 
-  clutter_actor_queue_relayout (self);
+  clutter_actor_queue_parent_relayout (self);
 }
 
 /**
@@ -13296,7 +13621,7 @@ clutter_actor_set_animatable_property (ClutterActor *actor,
   g_object_thaw_notify (obj);
 }
 
-static void
+void
 clutter_actor_update_pointer (ClutterActor *self)
 {
   ClutterInputDevice *pointer;
@@ -13367,6 +13692,188 @@ clutter_actor_set_final_state (ClutterAnimatable *animatable,
   g_free (p_name);
 }
 
+/*< private >
+ * clutter_actor_get_animatable_n_components:
+ * @self: a #ClutterActor
+ * @pspec: the #GParamSpec of an animatable property of @self
+ *
+ * Retrieves the number of components of @pspec that can be set using
+ * clutter_actor_set_animatable_components(), bypassing the #GValue
+ * based #ClutterAnimatable path.
+ *
+ * Return value: the number of components, or 0 if @pspec must be set
+ *   through clutter_animatable_set_final_state()
+ */
+int
+clutter_actor_get_animatable_n_components (ClutterActor *self,
+                                           GParamSpec   *pspec)
+{
+  ClutterAnimatableInterface *iface = CLUTTER_ANIMATABLE_GET_IFACE (self);
+
+  /* Subclasses may change how animated values are applied */
+  if (iface->set_final_state != clutter_actor_set_final_state ||
+      iface->interpolate_value != NULL)
+    return 0;
+
+  if (pspec->owner_type != CLUTTER_TYPE_ACTOR ||
+      (pspec->flags & CLUTTER_PARAM_ANIMATABLE) == 0)
+    return 0;
+
+  switch (pspec->param_id)
+    {
+    case PROP_X:
+    case PROP_Y:
+    case PROP_WIDTH:
+    case PROP_HEIGHT:
+    case PROP_Z_POSITION:
+    case PROP_OPACITY:
+    case PROP_PIVOT_POINT_Z:
+    case PROP_TRANSLATION_X:
+    case PROP_TRANSLATION_Y:
+    case PROP_TRANSLATION_Z:
+    case PROP_SCALE_X:
+    case PROP_SCALE_Y:
+    case PROP_SCALE_Z:
+    case PROP_ROTATION_ANGLE_X:
+    case PROP_ROTATION_ANGLE_Y:
+    case PROP_ROTATION_ANGLE_Z:
+    case PROP_MARGIN_TOP:
+    case PROP_MARGIN_BOTTOM:
+    case PROP_MARGIN_LEFT:
+    case PROP_MARGIN_RIGHT:
+      return 1;
+
+    case PROP_POSITION:
+    case PROP_PIVOT_POINT:
+      return 2;
+
+    case PROP_BACKGROUND_COLOR:
+      return 4;
+
+    default:
+      return 0;
+    }
+}
+
+/*< private >
+ * clutter_actor_set_animatable_components:
+ * @self: a #ClutterActor
+ * @pspec: the #GParamSpec of an animatable property of @self
+ * @components: the new value of the property, split into components
+ *
+ * Sets the value of @pspec from @components, converted the same way
+ * #ClutterInterval converts interpolated values. Unlike
+ * clutter_animatable_set_final_state(), this does not update the pointer;
+ * callers are expected to call clutter_actor_update_pointer() once they
+ * are done setting properties.
+ */
+void
+clutter_actor_set_animatable_components (ClutterActor *self,
+                                         GParamSpec   *pspec,
+                                         const double *components)
+{
+  GObject *obj = G_OBJECT (self);
+
+  g_object_freeze_notify (obj);
+
+  switch (pspec->param_id)
+    {
+    case PROP_X:
+      clutter_actor_set_x_internal (self, components[0]);
+      break;
+
+    case PROP_Y:
+      clutter_actor_set_y_internal (self, components[0]);
+      break;
+
+    case PROP_WIDTH:
+      clutter_actor_set_width_internal (self, components[0]);
+      break;
+
+    case PROP_HEIGHT:
+      clutter_actor_set_height_internal (self, components[0]);
+      break;
+
+    case PROP_Z_POSITION:
+      clutter_actor_set_z_position_internal (self, components[0]);
+      break;
+
+    case PROP_OPACITY:
+      clutter_actor_set_opacity_internal (self,
+                                          (guint) CLAMP (components[0],
+                                                         0.0, 255.0));
+      break;
+
+    case PROP_PIVOT_POINT_Z:
+      clutter_actor_set_pivot_point_z_internal (self, components[0]);
+      break;
+
+    case PROP_TRANSLATION_X:
+    case PROP_TRANSLATION_Y:
+    case PROP_TRANSLATION_Z:
+      clutter_actor_set_translation_internal (self, components[0], pspec);
+      break;
+
+    case PROP_SCALE_X:
+    case PROP_SCALE_Y:
+    case PROP_SCALE_Z:
+      clutter_actor_set_scale_factor_internal (self, components[0], pspec);
+      break;
+
+    case PROP_ROTATION_ANGLE_X:
+    case PROP_ROTATION_ANGLE_Y:
+    case PROP_ROTATION_ANGLE_Z:
+      clutter_actor_set_rotation_angle_internal (self, components[0], pspec);
+      break;
+
+    case PROP_MARGIN_TOP:
+    case PROP_MARGIN_BOTTOM:
+    case PROP_MARGIN_LEFT:
+    case PROP_MARGIN_RIGHT:
+      clutter_actor_set_margin_internal (self, components[0], pspec);
+      break;
+
+    case PROP_POSITION:
+      {
+        graphene_point_t position =
+          GRAPHENE_POINT_INIT (components[0], components[1]);
+
+        clutter_actor_set_position_internal (self, &position);
+      }
+      break;
+
+    case PROP_PIVOT_POINT:
+      {
+        graphene_point_t pivot =
+          GRAPHENE_POINT_INIT (components[0], components[1]);
+
+        clutter_actor_set_pivot_point_internal (self, &pivot);
+      }
+      break;
+
+    case PROP_BACKGROUND_COLOR:
+      {
+        /* Easing modes overshooting the end points can take the
+         * components out of range
+         */
+        ClutterColor color = {
+          .red = (guint8) CLAMP (components[0], 0.0, 255.0),
+          .green = (guint8) CLAMP (components[1], 0.0, 255.0),
+          .blue = (guint8) CLAMP (components[2], 0.0, 255.0),
+          .alpha = (guint8) CLAMP (components[3], 0.0, 255.0),
+        };
+
+        clutter_actor_set_background_color_internal (self, &color);
+      }
+      break;
+
+    default:
+      g_assert_not_reached ();
+    }
+
+  g_object_thaw_notify (obj);
+}
+
 static ClutterActor *
 clutter_actor_get_actor (ClutterAnimatable *animatable)
 {
@@ -15021,7 +15528,7 @@ clutter_actor_add_constraint (ClutterActor      *self,
 
   _clutter_meta_group_add_meta (priv->constraints,
                                 CLUTTER_ACTOR_META (constraint));
-  clutter_actor_queue_relayout (self);
+  clutter_actor_queue_parent_relayout (self);
 
   g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_CONSTRAINTS]);
 }
@@ -15088,7 +15595,7 @@ clutter_actor_remove_constraint (ClutterActor      *self,
   if (_clutter_meta_group_peek_metas (priv->constraints) == NULL)
     g_clear_object (&priv->constraints);
 
-  clutter_actor_queue_relayout (self);
+  clutter_actor_queue_parent_relayout (self);
 
   g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_CONSTRAINTS]);
 }
@@ -15123,7 +15630,7 @@ clutter_actor_remove_constraint_by_name (ClutterActor *self,
     return;
 
   _clutter_meta_group_remove_meta (priv->constraints, meta);
-  clutter_actor_queue_relayout (self);
+  clutter_actor_queue_parent_relayout (self);
 }
 
 /**
@@ -15195,7 +15702,7 @@ clutter_actor_clear_constraints (ClutterActor *self)
 
   _clutter_meta_group_clear_metas_no_internal (self->priv->constraints);
 
-  clutter_actor_queue_relayout (self);
+  clutter_actor_queue_parent_relayout (self);
 }
 
 /**
@@ -18737,7 +19244,7 @@ clutter_actor_queue_compute_expand (ClutterActor *self)
     }
 
   if (changed)
-    clutter_actor_queue_relayout (self);
+    clutter_actor_queue_parent_relayout (self);
 }
 
 /**
@@ -37,6 +37,17 @@ CLUTTER_EXPORT
 void            _clutter_event_push                     (const ClutterEvent *event,
                                                          gboolean            do_copy);
 
+CLUTTER_EXPORT
+void            _clutter_event_push_batch               (ClutterEvent       **events,
+                                                         unsigned int         n_events);
+
+CLUTTER_EXPORT
+int             _clutter_events_get_n_pending           (void);
+
+CLUTTER_EXPORT
+void            _clutter_event_merge_motion             (ClutterEvent       *event,
+                                                         ClutterEvent       *to_discard);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_EVENT_PRIVATE_H__ */
@@ -61,6 +61,8 @@ typedef struct _ClutterEventPrivate {
   ClutterModifierType latched_state;
   ClutterModifierType locked_state;
 
+  GArray *motion_history;
+
   guint is_pointer_emulated : 1;
 } ClutterEventPrivate;
 
@@ -1326,6 +1328,9 @@ clutter_event_copy (const ClutterEvent *event)
             g_memdup2 (event->motion.axes,
                        sizeof (double) * CLUTTER_INPUT_AXIS_LAST);
         }
+      /* Not shared, as merging appends to it in place */
+      if (real_event->motion_history)
+        new_real_event->motion_history = g_array_copy (real_event->motion_history);
       break;
 
     case CLUTTER_TOUCH_BEGIN:
@@ -1381,6 +1386,7 @@ clutter_event_free (ClutterEvent *event)
 
         case CLUTTER_MOTION:
           g_free (event->motion.axes);
+          g_clear_pointer (&real_event->motion_history, g_array_unref);
           break;
 
         case CLUTTER_SCROLL:
@@ -1448,6 +1454,34 @@ _clutter_event_push (const ClutterEvent *event,
   g_main_context_wakeup (NULL);
 }
 
+/*< private >
+ * _clutter_event_push_batch:
+ * @events: (array length=n_events) (transfer full): events to push
+ * @n_events: number of events
+ *
+ * Pushes all @events onto the event queue at once, waking up the main
+ * context only once for the whole batch.
+ */
+void
+_clutter_event_push_batch (ClutterEvent **events,
+                           unsigned int   n_events)
+{
+  ClutterMainContext *context = _clutter_context_get_default ();
+  unsigned int i;
+
+  g_assert (context != NULL);
+
+  if (n_events == 0)
+    return;
+
+  g_async_queue_lock (context->events_queue);
+  for (i = 0; i < n_events; i++)
+    g_async_queue_push_unlocked (context->events_queue, events[i]);
+  g_async_queue_unlock (context->events_queue);
+
+  g_main_context_wakeup (NULL);
+}
+
 /**
  * clutter_event_put:
  * @event: a #ClutterEvent
@@ -1485,6 +1519,21 @@ clutter_events_pending (void)
   return g_async_queue_length (context->events_queue) > 0;
 }
 
+/*< private >
+ * _clutter_events_get_n_pending:
+ *
+ * Returns: the number of events in the event queue
+ */
+int
+_clutter_events_get_n_pending (void)
+{
+  ClutterMainContext *context = _clutter_context_get_default ();
+
+  g_return_val_if_fail (context != NULL, 0);
+
+  return MAX (g_async_queue_length (context->events_queue), 0);
+}
+
 /**
  * clutter_get_current_event_time:
  *
@@ -2205,6 +2254,114 @@ clutter_event_get_time_us (const ClutterEvent *event)
   return 0;
 }
 
+static void
+append_motion_history (GArray             *history,
+                       const ClutterEvent *event)
+{
+  ClutterEventPrivate *real_event = (ClutterEventPrivate *) event;
+  ClutterMotionHistoryEntry entry;
+
+  if (real_event->motion_history)
+    {
+      g_array_append_vals (history,
+                           real_event->motion_history->data,
+                           real_event->motion_history->len);
+      return;
+    }
+
+  entry = (ClutterMotionHistoryEntry) {
+    .time_us = event->motion.time_us,
+    .x = event->motion.x,
+    .y = event->motion.y,
+  };
+  entry.has_relative_motion =
+    clutter_event_get_relative_motion (event,
+                                       &entry.dx, &entry.dy,
+                                       &entry.dx_unaccel, &entry.dy_unaccel);
+
+  g_array_append_val (history, entry);
+}
+
+/*< private >
+ * _clutter_event_merge_motion:
+ * @event: a motion event
+ * @to_discard: an earlier motion event from the same device
+ *
+ * Folds @to_discard into @event, so that @event can be delivered in its
+ * place. Relative motion is accumulated, and the samples of both events
+ * are kept in the motion history of @event. The motion history of
+ * @to_discard is taken over and appended to, so that repeatedly merging
+ * into the latest event doesn't copy the samples each time.
+ */
+void
+_clutter_event_merge_motion (ClutterEvent *event,
+                             ClutterEvent *to_discard)
+{
+  ClutterEventPrivate *real_event = (ClutterEventPrivate *) event;
+  ClutterEventPrivate *real_to_discard = (ClutterEventPrivate *) to_discard;
+  double dx, dy;
+  double dx_unaccel, dy_unaccel;
+  double dst_dx = 0.0, dst_dy = 0.0;
+  double dst_dx_unaccel = 0.0, dst_dy_unaccel = 0.0;
+  GArray *history;
+
+  g_return_if_fail (event->type == CLUTTER_MOTION);
+  g_return_if_fail (to_discard->type == CLUTTER_MOTION);
+
+  history = g_steal_pointer (&real_to_discard->motion_history);
+  if (!history)
+    {
+      history = g_array_new (FALSE, FALSE, sizeof (ClutterMotionHistoryEntry));
+      append_motion_history (history, to_discard);
+    }
+  append_motion_history (history, event);
+  g_clear_pointer (&real_event->motion_history, g_array_unref);
+  real_event->motion_history = history;
+
+  if (!clutter_event_get_relative_motion (to_discard,
+                                          &dx, &dy,
+                                          &dx_unaccel, &dy_unaccel))
+    return;
+
+  clutter_event_get_relative_motion (event,
+                                     &dst_dx, &dst_dy,
+                                     &dst_dx_unaccel, &dst_dy_unaccel);
+
+  event->motion.flags |= CLUTTER_EVENT_FLAG_RELATIVE_MOTION;
+  event->motion.dx = dx + dst_dx;
+  event->motion.dy = dy + dst_dy;
+  event->motion.dx_unaccel = dx_unaccel + dst_dx_unaccel;
+  event->motion.dy_unaccel = dy_unaccel + dst_dy_unaccel;
+}
+
+/**
+ * clutter_event_get_motion_history:
+ * @event: a #ClutterEvent of type %CLUTTER_MOTION
+ * @n_entries: (out): return location for the number of entries
+ *
+ * Retrieves the individual motion samples that were merged into @event
+ * when motion events were compressed, oldest first. The last entry
+ * corresponds to the most recent sample, which @event itself describes.
+ *
+ * Returns: (array length=n_entries) (nullable): the motion samples, or
+ *   %NULL if no motion was merged into @event
+ */
+const ClutterMotionHistoryEntry *
+clutter_event_get_motion_history (const ClutterEvent *event,
+                                  size_t             *n_entries)
+{
+  ClutterEventPrivate *real_event = (ClutterEventPrivate *) event;
+
+  if (event->type != CLUTTER_MOTION || !real_event->motion_history)
+    {
+      *n_entries = 0;
+      return NULL;
+    }
+
+  *n_entries = real_event->motion_history->len;
+  return (const ClutterMotionHistoryEntry *) real_event->motion_history->data;
+}
+
 gboolean
 clutter_event_get_relative_motion (const ClutterEvent *event,
                                    double             *dx,
@@ -111,6 +111,7 @@ typedef struct _ClutterAnyEvent         ClutterAnyEvent;
 typedef struct _ClutterButtonEvent      ClutterButtonEvent;
 typedef struct _ClutterKeyEvent         ClutterKeyEvent;
 typedef struct _ClutterMotionEvent      ClutterMotionEvent;
+typedef struct _ClutterMotionHistoryEntry ClutterMotionHistoryEntry;
 typedef struct _ClutterScrollEvent      ClutterScrollEvent;
 typedef struct _ClutterCrossingEvent    ClutterCrossingEvent;
 typedef struct _ClutterTouchEvent       ClutterTouchEvent;
@@ -307,6 +308,33 @@ struct _ClutterMotionEvent
   double dy_unaccel;
 };
 
+/**
+ * ClutterMotionHistoryEntry:
+ * @time_us: time of the sample, in microseconds
+ * @x: X coordinate of the sample
+ * @y: Y coordinate of the sample
+ * @has_relative_motion: whether the sample carried relative motion
+ * @dx: relative motion on the X axis
+ * @dy: relative motion on the Y axis
+ * @dx_unaccel: unaccelerated relative motion on the X axis
+ * @dy_unaccel: unaccelerated relative motion on the Y axis
+ *
+ * A single motion sample that was merged into a #ClutterMotionEvent,
+ * see clutter_event_get_motion_history().
+ */
+struct _ClutterMotionHistoryEntry
+{
+  int64_t time_us;
+  float x;
+  float y;
+
+  gboolean has_relative_motion;
+  double dx;
+  double dy;
+  double dx_unaccel;
+  double dy_unaccel;
+};
+
 /**
  * ClutterScrollEvent:
  * @type: event type
@@ -841,6 +869,9 @@ gboolean                 clutter_event_get_relative_motion (const ClutterEvent *
                                                             double             *dx_unaccel,
                                                             double             *dy_unaccel);
 
+CLUTTER_EXPORT
+const ClutterMotionHistoryEntry * clutter_event_get_motion_history (const ClutterEvent *event,
+                                                                    size_t             *n_entries);
 
 G_END_DECLS
 
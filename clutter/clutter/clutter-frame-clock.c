@@ -23,6 +23,7 @@
 #include "clutter/clutter-main.h"
 #include "clutter/clutter-private.h"
 #include "clutter/clutter-timeline-private.h"
+#include "clutter/clutter-transition-batch-private.h"
 #include "cogl/cogl-trace.h"
 
 enum
@@ -45,6 +46,23 @@ typedef struct _EstimateQueue
   int next_index;
 } EstimateQueue;
 
+/* A render time histogram holds the weights of measured durations in
+ * buckets of RENDER_TIME_HISTOGRAM_BUCKET_US. Older measurements decay, so
+ * that the histogram follows changes in the rendering load, while a single
+ * slow frame doesn't outweigh a regular pattern.
+ */
+#define RENDER_TIME_HISTOGRAM_BUCKET_US 100
+#define RENDER_TIME_HISTOGRAM_N_BUCKETS 500
+#define RENDER_TIME_HISTOGRAM_DECAY 0.98f
+
+typedef struct _RenderTimeHistogram
+{
+  float weights[RENDER_TIME_HISTOGRAM_N_BUCKETS];
+  float total_weight;
+} RenderTimeHistogram;
+
+#define DEFAULT_RENDER_TIME_PERCENTILE 0.95
+
 #define SYNC_DELAY_FALLBACK_FRACTION 0.875
 
 typedef struct _ClutterFrameListener
@@ -77,6 +95,13 @@ struct _ClutterFrameClock
   int64_t refresh_interval_us;
   ClutterFrameListener listener;
 
+  ClutterFrameClockMode mode;
+  /* Shortest and longest time between two presentations in the variable
+   * refresh rate mode, or 0 if unknown.
+   */
+  int64_t min_variable_interval_us;
+  int64_t max_variable_interval_us;
+
   GSource *source;
 
   int64_t frame_count;
@@ -105,12 +130,35 @@ struct _ClutterFrameClock
   /* If we got new measurements last frame. */
   gboolean got_measurements_last_frame;
 
+  ClutterFrameClockScheduler scheduler;
+  /* Durations between dispatch start and buffer swap. */
+  RenderTimeHistogram cpu_render_time_us;
+  /* Durations between buffer swap and both GPU rendering finish and KMS
+   * submission.
+   */
+  RenderTimeHistogram gpu_render_time_us;
+  double render_time_percentile;
+
+  /* Presentation time the last dispatched frame was scheduled for. */
+  int64_t dispatched_presentation_time_us;
+  int64_t presented_frames;
+  int64_t missed_deadlines;
+
+  /* Time between dispatch and presentation of the last presented frame. */
+  int64_t last_frame_latency_us;
+
   gboolean pending_reschedule;
   gboolean pending_reschedule_now;
 
   int inhibit_count;
 
   GList *timelines;
+
+  /* Frames of transitions that are applied together once all timelines
+   * have been advanced.
+   */
+  ClutterTransitionBatch *transition_batch;
+  gboolean is_advancing_timelines;
 };
 
 G_DEFINE_TYPE (ClutterFrameClock, clutter_frame_clock,
@@ -124,6 +172,45 @@ estimate_queue_add_value (EstimateQueue *queue,
   queue->next_index = (queue->next_index + 1) % ESTIMATE_QUEUE_LENGTH;
 }
 
+static void
+render_time_histogram_add_value (RenderTimeHistogram *histogram,
+                                 int64_t              value_us)
+{
+  int bucket;
+  int i;
+
+  for (i = 0; i < RENDER_TIME_HISTOGRAM_N_BUCKETS; i++)
+    histogram->weights[i] *= RENDER_TIME_HISTOGRAM_DECAY;
+
+  bucket = CLAMP (value_us / RENDER_TIME_HISTOGRAM_BUCKET_US,
+                  0, RENDER_TIME_HISTOGRAM_N_BUCKETS - 1);
+  histogram->weights[bucket] += 1.0f;
+
+  histogram->total_weight =
+    histogram->total_weight * RENDER_TIME_HISTOGRAM_DECAY + 1.0f;
+}
+
+static int64_t
+render_time_histogram_get_percentile (RenderTimeHistogram *histogram,
+                                      double               percentile)
+{
+  float threshold;
+  float weight = 0.0f;
+  int i;
+
+  threshold = histogram->total_weight * percentile;
+
+  for (i = 0; i < RENDER_TIME_HISTOGRAM_N_BUCKETS - 1; i++)
+    {
+      weight += histogram->weights[i];
+      if (weight >= threshold)
+        break;
+    }
+
+  /* Upper bound of the bucket */
+  return (i + 1) * RENDER_TIME_HISTOGRAM_BUCKET_US;
+}
+
 float
 clutter_frame_clock_get_refresh_rate (ClutterFrameClock *frame_clock)
 {
@@ -163,6 +250,29 @@ clutter_frame_clock_remove_timeline (ClutterFrameClock *frame_clock,
   frame_clock->timelines = g_list_remove (frame_clock->timelines, timeline);
 }
 
+/*
+ * clutter_frame_clock_batch_frame:
+ * @frame_clock: a #ClutterFrameClock
+ * @timeline: a #ClutterTimeline advanced by @frame_clock
+ *
+ * Defers applying the current frame of @timeline until all timelines of
+ * @frame_clock have been advanced, so that it can be evaluated together
+ * with the frames of other transitions.
+ *
+ * Returns: %TRUE if the frame was deferred, %FALSE if the caller must
+ *   apply it itself
+ */
+gboolean
+clutter_frame_clock_batch_frame (ClutterFrameClock *frame_clock,
+                                 ClutterTimeline   *timeline)
+{
+  if (!frame_clock->is_advancing_timelines)
+    return FALSE;
+
+  return clutter_transition_batch_add (frame_clock->transition_batch,
+                                       timeline);
+}
+
 static void
 advance_timelines (ClutterFrameClock *frame_clock,
                    int64_t            time_us)
@@ -194,6 +304,8 @@ advance_timelines (ClutterFrameClock *frame_clock,
   timelines = g_list_copy (frame_clock->timelines);
   g_list_foreach (timelines, (GFunc) g_object_ref, NULL);
 
+  frame_clock->is_advancing_timelines = TRUE;
+
   for (l = timelines; l; l = l->next)
     {
       ClutterTimeline *timeline = l->data;
@@ -201,6 +313,10 @@ advance_timelines (ClutterFrameClock *frame_clock,
       _clutter_timeline_do_tick (timeline, time_us / 1000);
     }
 
+  frame_clock->is_advancing_timelines = FALSE;
+
+  clutter_transition_batch_flush (frame_clock->transition_batch);
+
   g_list_free_full (timelines, g_object_unref);
 }
 
@@ -301,9 +417,48 @@ clutter_frame_clock_notify_presented (ClutterFrameClock *frame_clock,
       estimate_queue_add_value (&frame_clock->swap_to_flip_us,
                                 swap_to_flip_us);
 
+      render_time_histogram_add_value (&frame_clock->cpu_render_time_us,
+                                       dispatch_to_swap_us);
+      render_time_histogram_add_value (&frame_clock->gpu_render_time_us,
+                                       MAX (swap_to_rendering_done_us,
+                                            swap_to_flip_us));
+
       frame_clock->got_measurements_last_frame = TRUE;
     }
 
+  if (frame_info->presentation_time != 0 &&
+      frame_clock->last_dispatch_time_us != 0)
+    {
+      frame_clock->last_frame_latency_us =
+        frame_info->presentation_time - frame_clock->last_dispatch_time_us;
+
+      CLUTTER_NOTE (FRAME_TIMINGS, "Frame latency %ld µs",
+                    frame_clock->last_frame_latency_us);
+    }
+
+  if (frame_clock->dispatched_presentation_time_us != 0 &&
+      frame_info->presentation_time != 0)
+    {
+      frame_clock->presented_frames++;
+
+      /* Presented at least one refresh cycle after the one the frame was
+       * scheduled for.
+       */
+      if (frame_info->presentation_time >
+          frame_clock->dispatched_presentation_time_us +
+          frame_clock->refresh_interval_us / 2)
+        {
+          CLUTTER_NOTE (FRAME_TIMINGS,
+                        "Missed deadline, presented %ld µs late",
+                        frame_info->presentation_time -
+                        frame_clock->dispatched_presentation_time_us);
+
+          frame_clock->missed_deadlines++;
+        }
+
+      frame_clock->dispatched_presentation_time_us = 0;
+    }
+
   if (frame_info->refresh_rate > 1)
     {
       clutter_frame_clock_set_refresh_rate (frame_clock,
@@ -345,6 +500,28 @@ clutter_frame_clock_notify_ready (ClutterFrameClock *frame_clock)
     }
 }
 
+static int64_t
+compute_histogram_render_time_us (ClutterFrameClock *frame_clock)
+{
+  int64_t cpu_render_time_us;
+  int64_t gpu_render_time_us;
+
+  cpu_render_time_us =
+    render_time_histogram_get_percentile (&frame_clock->cpu_render_time_us,
+                                          frame_clock->render_time_percentile);
+  gpu_render_time_us =
+    render_time_histogram_get_percentile (&frame_clock->gpu_render_time_us,
+                                          frame_clock->render_time_percentile);
+
+  /* Like the estimate based on maximums, but using the durations that the
+   * configured percentile of recent frames didn't exceed.
+   */
+  return cpu_render_time_us +
+         gpu_render_time_us +
+         frame_clock->vblank_duration_us +
+         clutter_max_render_time_constant_us;
+}
+
 static int64_t
 clutter_frame_clock_compute_max_render_time_us (ClutterFrameClock *frame_clock)
 {
@@ -362,6 +539,12 @@ clutter_frame_clock_compute_max_render_time_us (ClutterFrameClock *frame_clock)
                   CLUTTER_DEBUG_DISABLE_DYNAMIC_MAX_RENDER_TIME))
     return refresh_interval_us * SYNC_DELAY_FALLBACK_FRACTION;
 
+  if (frame_clock->scheduler == CLUTTER_FRAME_CLOCK_SCHEDULER_HISTOGRAM)
+    {
+      max_render_time_us = compute_histogram_render_time_us (frame_clock);
+      return CLAMP (max_render_time_us, 0, refresh_interval_us);
+    }
+
   for (i = 0; i < ESTIMATE_QUEUE_LENGTH; ++i)
     {
       max_dispatch_to_swap_us =
@@ -542,6 +725,66 @@ calculate_next_update_time_us (ClutterFrameClock *frame_clock,
   *out_next_presentation_time_us = next_presentation_time_us;
 }
 
+static void
+calculate_next_variable_update_time_us (ClutterFrameClock *frame_clock,
+                                        int64_t           *out_next_update_time_us,
+                                        int64_t           *out_next_presentation_time_us)
+{
+  int64_t now_us;
+  int64_t max_render_time_us;
+  int64_t min_interval_us;
+  int64_t max_interval_us;
+  int64_t last_presentation_time_us;
+  int64_t next_presentation_time_us;
+
+  now_us = g_get_monotonic_time ();
+
+  if (frame_clock->last_presentation_time_us == 0)
+    {
+      *out_next_update_time_us = now_us;
+      *out_next_presentation_time_us = 0;
+      return;
+    }
+
+  max_render_time_us =
+    clutter_frame_clock_compute_max_render_time_us (frame_clock);
+
+  /* The refresh rate of the mode is the highest one the display can do */
+  min_interval_us = MAX (frame_clock->refresh_interval_us,
+                         frame_clock->min_variable_interval_us);
+  max_interval_us = frame_clock->max_variable_interval_us;
+
+  /*
+   * There is no vblank grid to align to; a frame is presented as soon as it
+   * is ready, but not sooner than the minimum interval after the last one.
+   * If nothing was presented for longer than the maximum interval, the
+   * display repeated the last frame on its own, and the minimum interval
+   * counts from that repeat instead.
+   *
+   *    last_presentation_time_us
+   *   /        repeated by the display
+   *  /        /     now_us
+   * |--------|-----o-|---->
+   *  \______/ \______/
+   *   max_interval_us
+   *           min_interval_us
+   */
+  last_presentation_time_us = frame_clock->last_presentation_time_us;
+  if (max_interval_us > min_interval_us &&
+      now_us - last_presentation_time_us > max_interval_us)
+    {
+      last_presentation_time_us +=
+        ((now_us - last_presentation_time_us) / max_interval_us) *
+        max_interval_us;
+    }
+
+  next_presentation_time_us = MAX (last_presentation_time_us + min_interval_us,
+                                   now_us + max_render_time_us);
+
+  *out_next_update_time_us = next_presentation_time_us - max_render_time_us;
+  *out_next_presentation_time_us = next_presentation_time_us;
+}
+
 void
 clutter_frame_clock_inhibit (ClutterFrameClock *frame_clock)
 {
@@ -629,9 +872,19 @@ clutter_frame_clock_schedule_update (ClutterFrameClock *frame_clock)
       next_update_time_us = g_get_monotonic_time ();
       break;
     case CLUTTER_FRAME_CLOCK_STATE_IDLE:
-      calculate_next_update_time_us (frame_clock,
-                                     &next_update_time_us,
-                                     &frame_clock->next_presentation_time_us);
+      switch (frame_clock->mode)
+        {
+        case CLUTTER_FRAME_CLOCK_MODE_FIXED:
+          calculate_next_update_time_us (frame_clock,
+                                         &next_update_time_us,
+                                         &frame_clock->next_presentation_time_us);
+          break;
+        case CLUTTER_FRAME_CLOCK_MODE_VARIABLE:
+          calculate_next_variable_update_time_us (frame_clock,
+                                                  &next_update_time_us,
+                                                  &frame_clock->next_presentation_time_us);
+          break;
+        }
       frame_clock->is_next_presentation_time_valid =
         (frame_clock->next_presentation_time_us != 0);
       break;
@@ -678,6 +931,16 @@ clutter_frame_clock_dispatch (ClutterFrameClock *frame_clock,
   frame_clock->last_dispatch_time_us = time_us;
   g_source_set_ready_time (frame_clock->source, -1);
 
+  if (frame_clock->is_next_presentation_time_valid)
+    {
+      frame_clock->dispatched_presentation_time_us =
+        frame_clock->next_presentation_time_us;
+    }
+  else
+    {
+      frame_clock->dispatched_presentation_time_us = 0;
+    }
+
   frame_clock->state = CLUTTER_FRAME_CLOCK_STATE_DISPATCHING;
 
   frame_count = frame_clock->frame_count++;
@@ -802,9 +1065,155 @@ clutter_frame_clock_get_max_render_time_debug_info (ClutterFrameClock *frame_clo
   g_string_append_printf (string, "\nConstant: %d µs",
                           clutter_max_render_time_constant_us);
 
+  if (frame_clock->scheduler == CLUTTER_FRAME_CLOCK_SCHEDULER_HISTOGRAM)
+    {
+      g_string_append_printf (string,
+                              "\nHistogram (%.0f%%): %ld µs "
+                              "(CPU %ld µs, GPU %ld µs)",
+                              frame_clock->render_time_percentile * 100.0,
+                              compute_histogram_render_time_us (frame_clock),
+                              render_time_histogram_get_percentile (
+                                &frame_clock->cpu_render_time_us,
+                                frame_clock->render_time_percentile),
+                              render_time_histogram_get_percentile (
+                                &frame_clock->gpu_render_time_us,
+                                frame_clock->render_time_percentile));
+    }
+
+  g_string_append_printf (string, "\nMissed deadlines: %ld of %ld frames",
+                          frame_clock->missed_deadlines,
+                          frame_clock->presented_frames);
+
   return string;
 }
 
+/**
+ * clutter_frame_clock_set_mode:
+ * @frame_clock: a #ClutterFrameClock
+ * @mode: the #ClutterFrameClockMode
+ *
+ * Sets whether @frame_clock schedules frames for the fixed refresh cycle of
+ * the display, or, if the display has a variable refresh rate, dispatches
+ * them as soon as possible.
+ */
+void
+clutter_frame_clock_set_mode (ClutterFrameClock     *frame_clock,
+                              ClutterFrameClockMode  mode)
+{
+  if (frame_clock->mode == mode)
+    return;
+
+  frame_clock->mode = mode;
+  frame_clock->is_next_presentation_time_valid = FALSE;
+}
+
+ClutterFrameClockMode
+clutter_frame_clock_get_mode (ClutterFrameClock *frame_clock)
+{
+  return frame_clock->mode;
+}
+
+/**
+ * clutter_frame_clock_set_variable_refresh_range:
+ * @frame_clock: a #ClutterFrameClock
+ * @min_refresh_rate: the lowest refresh rate of the display, or 0 if unknown
+ * @max_refresh_rate: the highest refresh rate of the display, or 0 if unknown
+ *
+ * Sets the range within which the time between two presentations is kept
+ * in %CLUTTER_FRAME_CLOCK_MODE_VARIABLE.
+ */
+void
+clutter_frame_clock_set_variable_refresh_range (ClutterFrameClock *frame_clock,
+                                                float              min_refresh_rate,
+                                                float              max_refresh_rate)
+{
+  frame_clock->max_variable_interval_us =
+    min_refresh_rate > 0 ? (int64_t) (0.5 + G_USEC_PER_SEC / min_refresh_rate)
+                         : 0;
+  frame_clock->min_variable_interval_us =
+    max_refresh_rate > 0 ? (int64_t) (0.5 + G_USEC_PER_SEC / max_refresh_rate)
+                         : 0;
+}
+
+/**
+ * clutter_frame_clock_get_frame_latency_us:
+ * @frame_clock: a #ClutterFrameClock
+ *
+ * Returns: the time between the dispatch and the presentation of the last
+ *   presented frame, in microseconds, or 0 if unknown
+ */
+int64_t
+clutter_frame_clock_get_frame_latency_us (ClutterFrameClock *frame_clock)
+{
+  return frame_clock->last_frame_latency_us;
+}
+
+/**
+ * clutter_frame_clock_get_max_render_time_us:
+ * @frame_clock: a #ClutterFrameClock
+ *
+ * Returns: the time @frame_clock currently reserves for rendering a frame
+ *   before its presentation, in microseconds
+ */
+int64_t
+clutter_frame_clock_get_max_render_time_us (ClutterFrameClock *frame_clock)
+{
+  return clutter_frame_clock_compute_max_render_time_us (frame_clock);
+}
+
+/**
+ * clutter_frame_clock_set_scheduler:
+ * @frame_clock: a #ClutterFrameClock
+ * @scheduler: the #ClutterFrameClockScheduler to use
+ *
+ * Sets how @frame_clock estimates the time needed to render a frame, and
+ * thus how long before the next presentation it dispatches frames. The
+ * default is %CLUTTER_FRAME_CLOCK_SCHEDULER_MAX_RENDER_TIME.
+ */
+void
+clutter_frame_clock_set_scheduler (ClutterFrameClock          *frame_clock,
+                                   ClutterFrameClockScheduler  scheduler)
+{
+  frame_clock->scheduler = scheduler;
+}
+
+/**
+ * clutter_frame_clock_set_render_time_percentile:
+ * @frame_clock: a #ClutterFrameClock
+ * @percentile: the fraction of frames, between 0 and 1, that should make
+ *   it in time
+ *
+ * Sets the percentile of recent render times that
+ * %CLUTTER_FRAME_CLOCK_SCHEDULER_HISTOGRAM dispatches frames for.
+ */
+void
+clutter_frame_clock_set_render_time_percentile (ClutterFrameClock *frame_clock,
+                                                double             percentile)
+{
+  g_return_if_fail (percentile > 0.0 && percentile <= 1.0);
+
+  frame_clock->render_time_percentile = percentile;
+}
+
+/**
+ * clutter_frame_clock_get_deadline_stats:
+ * @frame_clock: a #ClutterFrameClock
+ * @out_presented_frames: (out) (optional): return location for the number
+ *   of presented frames that were scheduled for a presentation time
+ * @out_missed_deadlines: (out) (optional): return location for the number
+ *   of those frames that were presented later than scheduled
+ */
+void
+clutter_frame_clock_get_deadline_stats (ClutterFrameClock *frame_clock,
+                                        int64_t           *out_presented_frames,
+                                        int64_t           *out_missed_deadlines)
+{
+  if (out_presented_frames)
+    *out_presented_frames = frame_clock->presented_frames;
+  if (out_missed_deadlines)
+    *out_missed_deadlines = frame_clock->missed_deadlines;
+}
+
 static GSourceFuncs frame_clock_source_funcs = {
   NULL,
   NULL,
@@ -874,6 +1283,9 @@ clutter_frame_clock_dispose (GObject *object)
       g_clear_pointer (&frame_clock->source, g_source_unref);
     }
 
+  g_clear_pointer (&frame_clock->transition_batch,
+                   clutter_transition_batch_free);
+
   G_OBJECT_CLASS (clutter_frame_clock_parent_class)->dispose (object);
 }
 
@@ -881,6 +1293,9 @@ static void
 clutter_frame_clock_init (ClutterFrameClock *frame_clock)
 {
   frame_clock->state = CLUTTER_FRAME_CLOCK_STATE_INIT;
+  frame_clock->transition_batch = clutter_transition_batch_new ();
+  frame_clock->scheduler = CLUTTER_FRAME_CLOCK_SCHEDULER_MAX_RENDER_TIME;
+  frame_clock->render_time_percentile = DEFAULT_RENDER_TIME_PERCENTILE;
 }
 
 static void
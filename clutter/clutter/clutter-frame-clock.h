@@ -34,6 +34,33 @@ typedef enum _ClutterFrameResult
   CLUTTER_FRAME_RESULT_IDLE,
 } ClutterFrameResult;
 
+/**
+ * ClutterFrameClockMode: (skip)
+ * @CLUTTER_FRAME_CLOCK_MODE_FIXED: frames are presented at a fixed refresh
+ *   rate
+ * @CLUTTER_FRAME_CLOCK_MODE_VARIABLE: the display has a variable refresh
+ *   rate, and frames are presented as soon as they are ready
+ */
+typedef enum _ClutterFrameClockMode
+{
+  CLUTTER_FRAME_CLOCK_MODE_FIXED,
+  CLUTTER_FRAME_CLOCK_MODE_VARIABLE,
+} ClutterFrameClockMode;
+
+/**
+ * ClutterFrameClockScheduler: (skip)
+ * @CLUTTER_FRAME_CLOCK_SCHEDULER_MAX_RENDER_TIME: dispatch early enough for
+ *   the slowest of the last few frames
+ * @CLUTTER_FRAME_CLOCK_SCHEDULER_HISTOGRAM: dispatch early enough for a
+ *   percentile of the recent render times, measured separately for the CPU
+ *   and the GPU phase
+ */
+typedef enum _ClutterFrameClockScheduler
+{
+  CLUTTER_FRAME_CLOCK_SCHEDULER_MAX_RENDER_TIME,
+  CLUTTER_FRAME_CLOCK_SCHEDULER_HISTOGRAM,
+} ClutterFrameClockScheduler;
+
 #define CLUTTER_TYPE_FRAME_CLOCK (clutter_frame_clock_get_type ())
 CLUTTER_EXPORT
 G_DECLARE_FINAL_TYPE (ClutterFrameClock, clutter_frame_clock,
@@ -81,15 +108,50 @@ void clutter_frame_clock_inhibit (ClutterFrameClock *frame_clock);
 CLUTTER_EXPORT
 void clutter_frame_clock_uninhibit (ClutterFrameClock *frame_clock);
 
+CLUTTER_EXPORT
+void clutter_frame_clock_set_mode (ClutterFrameClock     *frame_clock,
+                                   ClutterFrameClockMode  mode);
+
+CLUTTER_EXPORT
+ClutterFrameClockMode clutter_frame_clock_get_mode (ClutterFrameClock *frame_clock);
+
+CLUTTER_EXPORT
+void clutter_frame_clock_set_variable_refresh_range (ClutterFrameClock *frame_clock,
+                                                     float              min_refresh_rate,
+                                                     float              max_refresh_rate);
+
+CLUTTER_EXPORT
+int64_t clutter_frame_clock_get_frame_latency_us (ClutterFrameClock *frame_clock);
+
+CLUTTER_EXPORT
+int64_t clutter_frame_clock_get_max_render_time_us (ClutterFrameClock *frame_clock);
+
+CLUTTER_EXPORT
+void clutter_frame_clock_set_scheduler (ClutterFrameClock          *frame_clock,
+                                        ClutterFrameClockScheduler  scheduler);
+
+CLUTTER_EXPORT
+void clutter_frame_clock_set_render_time_percentile (ClutterFrameClock *frame_clock,
+                                                     double             percentile);
+
+CLUTTER_EXPORT
+void clutter_frame_clock_get_deadline_stats (ClutterFrameClock *frame_clock,
+                                             int64_t           *out_presented_frames,
+                                             int64_t           *out_missed_deadlines);
+
 void clutter_frame_clock_add_timeline (ClutterFrameClock *frame_clock,
                                        ClutterTimeline   *timeline);
 
 void clutter_frame_clock_remove_timeline (ClutterFrameClock *frame_clock,
                                           ClutterTimeline   *timeline);
 
+gboolean clutter_frame_clock_batch_frame (ClutterFrameClock *frame_clock,
+                                          ClutterTimeline   *timeline);
+
 CLUTTER_EXPORT
 float clutter_frame_clock_get_refresh_rate (ClutterFrameClock *frame_clock);
 
+CLUTTER_EXPORT
 void clutter_frame_clock_record_flip_time (ClutterFrameClock *frame_clock,
                                            int64_t            flip_time_us);
 
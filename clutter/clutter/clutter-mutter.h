@@ -74,6 +74,10 @@ gboolean clutter_actor_is_effectively_on_stage_view (ClutterActor     *self,
 CLUTTER_EXPORT
 int64_t clutter_stage_get_frame_counter (ClutterStage *stage);
 
+CLUTTER_EXPORT
+void clutter_stage_get_layout_stats (ClutterStage       *stage,
+                                     ClutterLayoutStats *stats);
+
 CLUTTER_EXPORT
 void clutter_stage_capture_view_into (ClutterStage          *stage,
                                       ClutterStageView      *view,
@@ -88,6 +92,10 @@ CLUTTER_EXPORT
 void clutter_stage_view_assign_next_scanout (ClutterStageView *stage_view,
                                              CoglScanout      *scanout);
 
+CLUTTER_EXPORT
+void clutter_stage_view_add_redraw_clip (ClutterStageView            *view,
+                                         const cairo_rectangle_int_t *clip);
+
 CLUTTER_EXPORT
 gboolean clutter_actor_has_damage (ClutterActor *actor);
 
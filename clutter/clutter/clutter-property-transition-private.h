@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2022 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CLUTTER_PROPERTY_TRANSITION_PRIVATE_H
+#define CLUTTER_PROPERTY_TRANSITION_PRIVATE_H
+
+#include "clutter-property-transition.h"
+
+G_BEGIN_DECLS
+
+GParamSpec * clutter_property_transition_get_pspec (ClutterPropertyTransition *transition);
+
+G_END_DECLS
+
+#endif /* CLUTTER_PROPERTY_TRANSITION_PRIVATE_H */
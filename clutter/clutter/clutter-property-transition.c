@@ -33,6 +33,7 @@
 #include "clutter-build-config.h"
 
 #include "clutter-property-transition.h"
+#include "clutter-property-transition-private.h"
 
 #include "clutter-animatable.h"
 #include "clutter-debug.h"
@@ -376,3 +377,9 @@ clutter_property_transition_get_property_name (ClutterPropertyTransition *transi
 
   return transition->priv->property_name;
 }
+
+GParamSpec *
+clutter_property_transition_get_pspec (ClutterPropertyTransition *transition)
+{
+  return transition->priv->pspec;
+}
@@ -22,6 +22,7 @@
 #ifndef __CLUTTER_STAGE_PRIVATE_H__
 #define __CLUTTER_STAGE_PRIVATE_H__
 
+#include <clutter/clutter-actor-private.h>
 #include <clutter/clutter-grab.h>
 #include <clutter/clutter-stage-window.h>
 #include <clutter/clutter-stage.h>
@@ -129,11 +130,16 @@ void            clutter_stage_queue_actor_relayout      (ClutterStage *stage,
 void clutter_stage_dequeue_actor_relayout (ClutterStage *stage,
                                            ClutterActor *actor);
 
+void clutter_stage_queue_actor_deferred_relayout (ClutterStage *stage,
+                                                  ClutterActor *actor);
+
 GList * clutter_stage_get_views_for_rect (ClutterStage          *stage,
                                           const graphene_rect_t *rect);
 
 void clutter_stage_set_actor_needs_immediate_relayout (ClutterStage *stage);
 
+ClutterLayoutStats * clutter_stage_get_pending_layout_stats (ClutterStage *stage);
+
 void clutter_stage_update_device_entry (ClutterStage         *self,
                                         ClutterInputDevice   *device,
                                         ClutterEventSequence *sequence,
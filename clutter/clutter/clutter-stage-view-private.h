@@ -46,14 +46,12 @@ void clutter_stage_view_invalidate_projection (ClutterStageView *view);
 void clutter_stage_view_set_projection (ClutterStageView        *view,
                                         const graphene_matrix_t *matrix);
 
-CLUTTER_EXPORT
-void clutter_stage_view_add_redraw_clip (ClutterStageView            *view,
-                                         const cairo_rectangle_int_t *clip);
-
 gboolean clutter_stage_view_has_full_redraw_clip (ClutterStageView *view);
 
+CLUTTER_EXPORT
 gboolean clutter_stage_view_has_redraw_clip (ClutterStageView *view);
 
+CLUTTER_EXPORT
 const cairo_region_t * clutter_stage_view_peek_redraw_clip (ClutterStageView *view);
 
 CLUTTER_EXPORT
@@ -123,8 +123,13 @@ struct _ClutterStagePrivate
   GArray *paint_volume_stack;
 
   GSList *pending_relayouts;
+  GSList *pending_deferred_relayouts;
   GHashTable *pending_queue_redraws;
 
+  /* Layout work of the current frame, and of the last finished one */
+  ClutterLayoutStats pending_layout_stats;
+  ClutterLayoutStats layout_stats;
+
   int update_freeze_count;
 
   gboolean pending_finish_queue_redraws;
@@ -636,32 +641,6 @@ _clutter_stage_has_queued_events (ClutterStage *stage)
   return priv->event_queue->length > 0;
 }
 
-static void
-clutter_stage_compress_motion (ClutterStage       *stage,
-                               ClutterEvent       *event,
-                               const ClutterEvent *to_discard)
-{
-  double dx, dy;
-  double dx_unaccel, dy_unaccel;
-  double dst_dx = 0.0, dst_dy = 0.0;
-  double dst_dx_unaccel = 0.0, dst_dy_unaccel = 0.0;
-
-  if (!clutter_event_get_relative_motion (to_discard,
-                                          &dx, &dy,
-                                          &dx_unaccel, &dy_unaccel))
-    return;
-
-  clutter_event_get_relative_motion (event,
-                                     &dst_dx, &dst_dy,
-                                     &dst_dx_unaccel, &dst_dy_unaccel);
-
-  event->motion.flags |= CLUTTER_EVENT_FLAG_RELATIVE_MOTION;
-  event->motion.dx = dx + dst_dx;
-  event->motion.dy = dy + dst_dy;
-  event->motion.dx_unaccel = dx_unaccel + dst_dx_unaccel;
-  event->motion.dy_unaccel = dy_unaccel + dst_dy_unaccel;
-}
-
 void
 _clutter_stage_process_queued_events (ClutterStage *stage)
 {
@@ -720,7 +699,7 @@ _clutter_stage_process_queued_events (ClutterStage *stage)
                             (int) event->motion.y);
 
               if (next_event->type == CLUTTER_MOTION)
-                clutter_stage_compress_motion (stage, next_event, event);
+                _clutter_event_merge_motion (next_event, event);
 
               goto next_event;
             }
@@ -761,6 +740,20 @@ clutter_stage_queue_actor_relayout (ClutterStage *stage,
                                              g_object_ref (actor));
 }
 
+void
+clutter_stage_queue_actor_deferred_relayout (ClutterStage *stage,
+                                             ClutterActor *actor)
+{
+  ClutterStagePrivate *priv = stage->priv;
+
+  if (priv->pending_relayouts == NULL &&
+      priv->pending_deferred_relayouts == NULL)
+    clutter_stage_schedule_update (stage);
+
+  priv->pending_deferred_relayouts =
+    g_slist_prepend (priv->pending_deferred_relayouts, g_object_ref (actor));
+}
+
 void
 clutter_stage_dequeue_actor_relayout (ClutterStage *stage,
                                       ClutterActor *actor)
@@ -802,17 +795,31 @@ clutter_stage_maybe_relayout (ClutterActor *actor)
   ClutterStage *stage = CLUTTER_STAGE (actor);
   ClutterStagePrivate *priv = stage->priv;
   g_autoptr (GSList) stolen_list = NULL;
+  g_autoptr (GSList) deferred_list = NULL;
   GSList *l;
   int count = 0;
 
   /* No work to do? Avoid the extraneous debug log messages too. */
-  if (priv->pending_relayouts == NULL)
+  if (priv->pending_relayouts == NULL &&
+      priv->pending_deferred_relayouts == NULL)
     return;
 
   COGL_TRACE_BEGIN_SCOPED (ClutterStageRelayout, "Layout");
 
   CLUTTER_NOTE (ACTOR, ">>> Recomputing layout");
 
+  /* Relayouts of actors whose size request changed must go through their
+   * parents, which may queue more relayouts, so check them first.
+   */
+  deferred_list = g_steal_pointer (&priv->pending_deferred_relayouts);
+  for (l = deferred_list; l; l = l->next)
+    {
+      ClutterActor *deferred_actor = l->data;
+
+      if (!clutter_actor_finish_deferred_relayout (deferred_actor))
+        g_clear_object (&l->data);
+    }
+
   stolen_list = g_steal_pointer (&priv->pending_relayouts);
   for (l = stolen_list; l; l = l->next)
     {
@@ -840,6 +847,24 @@ clutter_stage_maybe_relayout (ClutterActor *actor)
       count++;
     }
 
+  /* The rest only needs to be allocated again within the same box, unless
+   * a parent did that already.
+   */
+  for (l = deferred_list; l; l = l->next)
+    {
+      g_autoptr (ClutterActor) deferred_actor = l->data;
+
+      if (!deferred_actor)
+        continue;
+
+      if (_clutter_actor_get_stage_internal (deferred_actor) != actor)
+        continue;
+
+      clutter_actor_allocate_deferred (deferred_actor);
+
+      count++;
+    }
+
   CLUTTER_NOTE (ACTOR, "<<< Completed recomputing layout of %d subtrees", count);
 
   if (count)
@@ -908,6 +933,9 @@ clutter_stage_finish_layout (ClutterStage *stage)
     }
 
   g_warn_if_fail (!priv->actor_needs_immediate_relayout);
+
+  priv->layout_stats = priv->pending_layout_stats;
+  priv->pending_layout_stats = (ClutterLayoutStats) { 0, };
 }
 
 void
@@ -1201,6 +1229,9 @@ clutter_stage_dispose (GObject *object)
   g_slist_free_full (priv->pending_relayouts,
                      (GDestroyNotify) g_object_unref);
   priv->pending_relayouts = NULL;
+  g_slist_free_full (priv->pending_deferred_relayouts,
+                     (GDestroyNotify) g_object_unref);
+  priv->pending_deferred_relayouts = NULL;
 
   /* this will release the reference on the stage */
   stage_manager = clutter_stage_manager_get_default ();
@@ -2806,6 +2837,25 @@ clutter_stage_get_frame_counter (ClutterStage          *stage)
   return _clutter_stage_window_get_frame_counter (stage_window);
 }
 
+/**
+ * clutter_stage_get_layout_stats: (skip)
+ * @stage: a #ClutterStage
+ * @stats: (out): return location for the layout statistics
+ *
+ * Retrieves the amount of layout work, i.e. calls to the allocate and
+ * preferred size virtual functions of actors, done between the last
+ * updated frame and the one before it.
+ */
+void
+clutter_stage_get_layout_stats (ClutterStage       *stage,
+                                ClutterLayoutStats *stats)
+{
+  g_return_if_fail (CLUTTER_IS_STAGE (stage));
+  g_return_if_fail (stats != NULL);
+
+  *stats = stage->priv->layout_stats;
+}
+
 void
 clutter_stage_presented (ClutterStage     *stage,
                          ClutterStageView *view,
@@ -3150,6 +3200,14 @@ clutter_stage_set_actor_needs_immediate_relayout (ClutterStage *stage)
   priv->actor_needs_immediate_relayout = TRUE;
 }
 
+ClutterLayoutStats *
+clutter_stage_get_pending_layout_stats (ClutterStage *stage)
+{
+  ClutterStagePrivate *priv = stage->priv;
+
+  return &priv->pending_layout_stats;
+}
+
 static void
 on_device_actor_reactive_changed (ClutterActor       *actor,
                                   GParamSpec         *pspec,
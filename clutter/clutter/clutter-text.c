@@ -97,6 +97,27 @@ struct _LayoutCache
   guint age;
 };
 
+typedef struct _AsyncLayout     AsyncLayout;
+
+struct _AsyncLayout
+{
+  /* Layout being shaped in a worker thread. It uses its own PangoContext,
+   * on the font map shared by all asynchronous layouts
+   */
+  PangoLayout *layout;
+
+  gint width;
+  gint height;
+  PangoEllipsizeMode ellipsize;
+
+  /* The value of ClutterTextPrivate::layout_generation when the task was
+   * queued; results of an older generation are discarded
+   */
+  guint generation;
+
+  GCancellable *cancellable;
+};
+
 struct _ClutterTextInputFocus
 {
   ClutterInputFocus parent_instance;
@@ -119,6 +140,13 @@ struct _ClutterTextPrivate
   LayoutCache cached_layouts[N_CACHED_LAYOUTS];
   guint cache_age;
 
+  /* Layouts that are being shaped off the main thread, and the layout
+   * used for painting and size requests until they are ready
+   */
+  GList *pending_layouts;
+  PangoLayout *stale_layout;
+  guint layout_generation;
+
   /* These are the attributes set by the attributes property */
   PangoAttrList *attrs;
   /* These are the attributes derived from the text when the
@@ -219,6 +247,7 @@ struct _ClutterTextPrivate
   guint show_password_hint      : 1;
   guint password_hint_visible   : 1;
   guint resolved_direction      : 4;
+  guint async_layout            : 1;
 };
 
 enum
@@ -256,6 +285,7 @@ enum
   PROP_SELECTED_TEXT_COLOR_SET,
   PROP_INPUT_HINTS,
   PROP_INPUT_PURPOSE,
+  PROP_ASYNC_LAYOUT,
 
   PROP_LAST
 };
@@ -726,6 +756,7 @@ clutter_text_ensure_effective_attributes (ClutterText *self)
 
 static PangoLayout *
 clutter_text_create_layout_no_cache (ClutterText       *text,
+                                     PangoContext      *context,
 				     gint               width,
 				     gint               height,
 				     PangoEllipsizeMode ellipsize)
@@ -735,7 +766,7 @@ clutter_text_create_layout_no_cache (ClutterText       *text,
   gchar *contents;
   gsize contents_len;
 
-  layout = clutter_actor_create_pango_layout (CLUTTER_ACTOR (text), NULL);
+  layout = pango_layout_new (context);
   pango_layout_set_font_description (layout, priv->font_desc);
 
   contents = clutter_text_get_display_text (text);
@@ -802,7 +833,7 @@ clutter_text_create_layout_no_cache (ClutterText       *text,
            }
         }
 
-      pango_context_set_base_dir (clutter_actor_get_pango_context (CLUTTER_ACTOR (text)), pango_dir);
+      pango_context_set_base_dir (context, pango_dir);
 
       priv->resolved_direction = pango_dir;
 
@@ -830,12 +861,106 @@ clutter_text_create_layout_no_cache (ClutterText       *text,
   return layout;
 }
 
+static inline gboolean
+clutter_text_use_async_layout (ClutterText *text)
+{
+  ClutterTextPrivate *priv = text->priv;
+
+  /* Editing needs the layout to match the buffer for cursor and
+   * selection handling, so only read-only text is shaped off-thread
+   */
+  return priv->async_layout && !priv->editable;
+}
+
+/* Pango font maps aren't thread safe, so all layouts shaped off the main
+ * thread use a font map of their own, separate from the one used by every
+ * actor on the main thread. Its users hold async_font_map_lock, on any
+ * thread, while doing anything that may look up fonts or glyphs.
+ */
+static PangoFontMap *async_font_map = NULL;
+static GMutex async_font_map_lock;
+
+static gboolean
+is_async_layout (PangoLayout *layout)
+{
+  PangoContext *context = pango_layout_get_context (layout);
+
+  return (async_font_map &&
+          pango_context_get_font_map (context) == async_font_map);
+}
+
+static void
+lock_layout_font_map (PangoLayout *layout)
+{
+  if (is_async_layout (layout))
+    g_mutex_lock (&async_font_map_lock);
+}
+
+static void
+unlock_layout_font_map (PangoLayout *layout)
+{
+  if (is_async_layout (layout))
+    g_mutex_unlock (&async_font_map_lock);
+}
+
+static void
+async_layout_free (AsyncLayout *async_layout)
+{
+  g_clear_object (&async_layout->layout);
+  g_clear_object (&async_layout->cancellable);
+  g_free (async_layout);
+}
+
+static void
+clutter_text_cancel_async_layouts (ClutterText *text)
+{
+  ClutterTextPrivate *priv = text->priv;
+  GList *l;
+
+  for (l = priv->pending_layouts; l; l = l->next)
+    {
+      AsyncLayout *async_layout = l->data;
+
+      g_cancellable_cancel (async_layout->cancellable);
+    }
+
+  g_clear_pointer (&priv->pending_layouts, g_list_free);
+}
+
 static void
 clutter_text_dirty_cache (ClutterText *text)
 {
   ClutterTextPrivate *priv = text->priv;
+  LayoutCache *newest_cache = NULL;
   int i;
 
+  clutter_text_cancel_async_layouts (text);
+  priv->layout_generation++;
+
+  /* When shaping asynchronously, keep painting the most recently used
+   * layout until the replacement is ready
+   */
+  if (clutter_text_use_async_layout (text))
+    {
+      for (i = 0; i < N_CACHED_LAYOUTS; i++)
+        {
+          if (priv->cached_layouts[i].layout == NULL)
+            continue;
+
+          if (!newest_cache || priv->cached_layouts[i].age > newest_cache->age)
+            newest_cache = priv->cached_layouts + i;
+        }
+
+      if (newest_cache)
+        {
+          g_set_object (&priv->stale_layout, newest_cache->layout);
+        }
+    }
+  else
+    {
+      g_clear_object (&priv->stale_layout);
+    }
+
   /* Delete the cached layouts so they will be recreated the next time
      they are needed */
   for (i = 0; i < N_CACHED_LAYOUTS; i++)
@@ -848,6 +973,238 @@ clutter_text_dirty_cache (ClutterText *text)
   clutter_text_dirty_paint_volume (text);
 }
 
+static LayoutCache *
+clutter_text_get_oldest_cache (ClutterText *text)
+{
+  ClutterTextPrivate *priv = text->priv;
+  LayoutCache *oldest_cache = priv->cached_layouts;
+  int i;
+
+  for (i = 0; i < N_CACHED_LAYOUTS; i++)
+    {
+      if (priv->cached_layouts[i].layout == NULL)
+        return priv->cached_layouts + i;
+
+      if (priv->cached_layouts[i].age < oldest_cache->age)
+        oldest_cache = priv->cached_layouts + i;
+    }
+
+  return oldest_cache;
+}
+
+static PangoLayout *
+clutter_text_get_stale_layout (ClutterText *text)
+{
+  ClutterTextPrivate *priv = text->priv;
+
+  /* Nothing has been shaped yet; an empty layout with the right font
+   * still gives a sensible line height until shaping has finished
+   */
+  if (priv->stale_layout == NULL)
+    {
+      priv->stale_layout =
+        clutter_actor_create_pango_layout (CLUTTER_ACTOR (text), NULL);
+      pango_layout_set_font_description (priv->stale_layout, priv->font_desc);
+    }
+
+  return priv->stale_layout;
+}
+
+static void
+shape_layout_in_thread (GTask        *task,
+                        gpointer      source_object,
+                        gpointer      task_data,
+                        GCancellable *cancellable)
+{
+  AsyncLayout *async_layout = task_data;
+  PangoRectangle logical_rect;
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  /* Retrieving the extents makes Pango itemize, shape and line-break
+   * the whole text; the result is kept inside the layout
+   */
+  g_mutex_lock (&async_font_map_lock);
+  pango_layout_get_extents (async_layout->layout, NULL, &logical_rect);
+  g_mutex_unlock (&async_font_map_lock);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+on_async_layout_ready (GObject      *source_object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+  ClutterText *text = CLUTTER_TEXT (source_object);
+  ClutterTextPrivate *priv = text->priv;
+  AsyncLayout *async_layout = g_task_get_task_data (G_TASK (result));
+  g_autoptr (GError) error = NULL;
+  LayoutCache *cache;
+
+  if (!g_task_propagate_boolean (G_TASK (result), &error))
+    return;
+
+  if (async_layout->generation != priv->layout_generation)
+    return;
+
+  priv->pending_layouts = g_list_remove (priv->pending_layouts, async_layout);
+
+  CLUTTER_NOTE (ACTOR, "ClutterText: %p: async layout ready for size %dx%d",
+                text,
+                async_layout->width,
+                async_layout->height);
+
+  /* The glyph cache lives in Cogl, so it must be filled in from here */
+  lock_layout_font_map (async_layout->layout);
+  cogl_pango_ensure_glyph_cache_for_layout (async_layout->layout);
+  unlock_layout_font_map (async_layout->layout);
+
+  cache = clutter_text_get_oldest_cache (text);
+  g_clear_object (&cache->layout);
+  cache->layout = g_steal_pointer (&async_layout->layout);
+  cache->age = priv->cache_age++;
+
+  if (!priv->pending_layouts)
+    g_clear_object (&priv->stale_layout);
+
+  /* The new layout most likely has a different size */
+  clutter_text_dirty_paint_volume (text);
+  clutter_actor_queue_relayout (CLUTTER_ACTOR (text));
+}
+
+/*
+ * Creates a context on the asynchronous layout font map, set up like the
+ * context of the actor. The font map is created on first use and kept in
+ * sync with the shared one, so its glyph cache is reused by all
+ * asynchronously shaped layouts.
+ */
+static PangoContext *
+clutter_text_create_async_pango_context (ClutterText *text)
+{
+  PangoContext *shared_context =
+    clutter_actor_get_pango_context (CLUTTER_ACTOR (text));
+  CoglPangoFontMap *shared_font_map =
+    COGL_PANGO_FONT_MAP (pango_context_get_font_map (shared_context));
+  ClutterBackend *backend = clutter_get_default_backend ();
+  static double async_font_map_resolution = -1.0;
+  double resolution;
+  PangoContext *context;
+
+  resolution = clutter_backend_get_resolution (backend);
+
+  g_mutex_lock (&async_font_map_lock);
+
+  if (!async_font_map)
+    {
+      async_font_map = cogl_pango_font_map_new ();
+      cogl_pango_font_map_set_use_mipmapping (COGL_PANGO_FONT_MAP (async_font_map),
+                                              cogl_pango_font_map_get_use_mipmapping (shared_font_map));
+    }
+
+  if (resolution != async_font_map_resolution)
+    {
+      cogl_pango_font_map_set_resolution (COGL_PANGO_FONT_MAP (async_font_map),
+                                          resolution);
+      async_font_map_resolution = resolution;
+    }
+
+  context =
+    cogl_pango_font_map_create_context (COGL_PANGO_FONT_MAP (async_font_map));
+
+  g_mutex_unlock (&async_font_map_lock);
+
+  pango_context_set_base_dir (context,
+                              pango_context_get_base_dir (shared_context));
+  pango_context_set_language (context,
+                              pango_context_get_language (shared_context));
+  pango_context_set_font_description (context,
+                                      pango_context_get_font_description (shared_context));
+  pango_cairo_context_set_font_options (context,
+                                        pango_cairo_context_get_font_options (shared_context));
+  pango_cairo_context_set_resolution (context,
+                                      pango_cairo_context_get_resolution (shared_context));
+
+  return context;
+}
+
+/*
+ * clutter_text_queue_async_layout:
+ * @text: a #ClutterText
+ * @width: the width of the layout, in Pango units
+ * @height: the height of the layout, in Pango units
+ * @ellipsize: the ellipsize mode of the layout
+ *
+ * Sets up a layout for the given size and shapes it in a worker thread;
+ * once it is ready it gets added to the layout cache and a relayout is
+ * queued.
+ *
+ * Return value: the layout to use until shaping has finished
+ */
+static PangoLayout *
+clutter_text_queue_async_layout (ClutterText        *text,
+                                 gint                width,
+                                 gint                height,
+                                 PangoEllipsizeMode  ellipsize)
+{
+  ClutterTextPrivate *priv = text->priv;
+  g_autoptr (PangoContext) context = NULL;
+  g_autoptr (GTask) task = NULL;
+  AsyncLayout *async_layout;
+  PangoAttrList *attrs;
+  GList *l;
+
+  for (l = priv->pending_layouts; l; l = l->next)
+    {
+      async_layout = l->data;
+
+      if (async_layout->width == width &&
+          async_layout->height == height &&
+          async_layout->ellipsize == ellipsize)
+        return clutter_text_get_stale_layout (text);
+    }
+
+  /* Pango objects aren't thread safe, so the worker gets a context of its
+   * own on the asynchronous layout font map, and a private copy of the
+   * attributes shared with the actor
+   */
+  context = clutter_text_create_async_pango_context (text);
+
+  async_layout = g_new0 (AsyncLayout, 1);
+  async_layout->layout =
+    clutter_text_create_layout_no_cache (text, context, width, height, ellipsize);
+  async_layout->width = width;
+  async_layout->height = height;
+  async_layout->ellipsize = ellipsize;
+  async_layout->generation = priv->layout_generation;
+  async_layout->cancellable = g_cancellable_new ();
+
+  attrs = pango_layout_get_attributes (async_layout->layout);
+  if (attrs)
+    {
+      g_autoptr (PangoAttrList) attrs_copy = NULL;
+
+      attrs_copy = pango_attr_list_copy (attrs);
+      pango_layout_set_attributes (async_layout->layout, attrs_copy);
+    }
+
+  priv->pending_layouts = g_list_prepend (priv->pending_layouts, async_layout);
+
+  CLUTTER_NOTE (ACTOR, "ClutterText: %p: queued async layout for size %dx%d",
+                text,
+                width,
+                height);
+
+  task = g_task_new (text, async_layout->cancellable,
+                     on_async_layout_ready, NULL);
+  g_task_set_source_tag (task, clutter_text_queue_async_layout);
+  g_task_set_task_data (task, async_layout, (GDestroyNotify) async_layout_free);
+  g_task_run_in_thread (task, shape_layout_in_thread);
+
+  return clutter_text_get_stale_layout (text);
+}
+
 /*
  * clutter_text_set_font_description_internal:
  * @self: a #ClutterText
@@ -1102,13 +1459,18 @@ clutter_text_create_layout (ClutterText *text,
                 allocation_width,
                 allocation_height);
 
+  if (clutter_text_use_async_layout (text))
+    return clutter_text_queue_async_layout (text, width, height, ellipsize);
+
   /* If we make it here then we didn't have a cached version so we
      need to recreate the layout */
   if (oldest_cache->layout)
     g_object_unref (oldest_cache->layout);
 
   oldest_cache->layout =
-    clutter_text_create_layout_no_cache (text, width, height, ellipsize);
+    clutter_text_create_layout_no_cache (text,
+                                         clutter_actor_get_pango_context (CLUTTER_ACTOR (text)),
+                                         width, height, ellipsize);
 
   cogl_pango_ensure_glyph_cache_for_layout (oldest_cache->layout);
 
@@ -1628,6 +1990,10 @@ clutter_text_set_property (GObject      *gobject,
       clutter_text_set_single_line_mode (self, g_value_get_boolean (value));
       break;
 
+    case PROP_ASYNC_LAYOUT:
+      clutter_text_set_async_layout (self, g_value_get_boolean (value));
+      break;
+
     case PROP_SELECTED_TEXT_COLOR:
       clutter_text_set_selected_text_color (self, clutter_value_get_color (value));
       break;
@@ -1729,6 +2095,10 @@ clutter_text_get_property (GObject    *gobject,
       g_value_set_boolean (value, priv->single_line_mode);
       break;
 
+    case PROP_ASYNC_LAYOUT:
+      g_value_set_boolean (value, priv->async_layout);
+      break;
+
     case PROP_ELLIPSIZE:
       g_value_set_enum (value, priv->ellipsize);
       break;
@@ -1774,6 +2144,7 @@ clutter_text_dispose (GObject *gobject)
 
   /* get rid of the entire cache */
   clutter_text_dirty_cache (self);
+  g_clear_object (&priv->stale_layout);
 
   g_clear_signal_handler (&priv->direction_changed_id, self);
   g_clear_signal_handler (&priv->settings_changed_id,
@@ -1962,7 +2333,9 @@ paint_selection_rectangle (ClutterText           *self,
                             color->blue,
                             paint_opacity * color->alpha / 255);
 
+  lock_layout_font_map (layout);
   cogl_pango_show_layout (fb, layout, priv->text_x, 0, &cogl_color);
+  unlock_layout_font_map (layout);
 
   cogl_framebuffer_pop_clip (fb);
   cogl_object_unref (color_pipeline);
@@ -2807,7 +3180,9 @@ clutter_text_paint (ClutterActor        *self,
                             priv->text_color.green,
                             priv->text_color.blue,
                             real_opacity);
+  lock_layout_font_map (layout);
   cogl_pango_show_layout (fb, layout, priv->text_x, priv->text_y, &color);
+  unlock_layout_font_map (layout);
 
   selection_paint (text, fb);
 
@@ -2911,7 +3286,9 @@ clutter_text_get_paint_volume (ClutterActor       *self,
       _clutter_paint_volume_init_static (&priv->paint_volume, self);
 
       layout = clutter_text_get_layout (text);
+      lock_layout_font_map (layout);
       pango_layout_get_extents (layout, &ink_rect, NULL);
+      unlock_layout_font_map (layout);
 
       origin.x = pango_to_logical_pixels (ink_rect.x, resource_scale);
       origin.y = pango_to_logical_pixels (ink_rect.y, resource_scale);
@@ -4400,6 +4777,23 @@ clutter_text_class_init (ClutterTextClass *klass)
   obj_props[PROP_INPUT_PURPOSE] = pspec;
   g_object_class_install_property (gobject_class, PROP_INPUT_PURPOSE, pspec);
 
+  /**
+   * ClutterText:async-layout:
+   *
+   * Whether the text should be shaped in a worker thread. While shaping
+   * is in progress the previous layout keeps being painted.
+   *
+   * The #ClutterText:async-layout property is ignored if the
+   * #ClutterText:editable property is set to %TRUE.
+   */
+  pspec = g_param_spec_boolean ("async-layout",
+                                P_("Asynchronous Layout"),
+                                P_("Whether the text should be shaped off the main thread"),
+                                FALSE,
+                                CLUTTER_PARAM_READWRITE);
+  obj_props[PROP_ASYNC_LAYOUT] = pspec;
+  g_object_class_install_property (gobject_class, PROP_ASYNC_LAYOUT, pspec);
+
   /**
    * ClutterText::text-changed:
    * @self: the #ClutterText that emitted the signal
@@ -5032,6 +5426,13 @@ clutter_text_set_editable (ClutterText *self,
             clutter_text_im_focus (self);
         }
 
+      /* Editable text is always shaped synchronously */
+      if (priv->async_layout)
+        {
+          clutter_text_dirty_cache (self);
+          clutter_actor_queue_relayout (CLUTTER_ACTOR (self));
+        }
+
       clutter_text_queue_redraw (CLUTTER_ACTOR (self));
 
       g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_EDITABLE]);
@@ -6737,6 +7138,59 @@ clutter_text_get_single_line_mode (ClutterText *self)
   return self->priv->single_line_mode;
 }
 
+/**
+ * clutter_text_set_async_layout:
+ * @self: a #ClutterText
+ * @async_layout: whether to shape the text in a worker thread
+ *
+ * Sets whether @self shapes its text off the main thread.
+ *
+ * When enabled, a layout that isn't in the layout cache yet is shaped
+ * in a worker thread. Until it is ready, the previously shaped layout is
+ * used both for painting and for size requests; once shaping has
+ * finished a relayout is queued, so that size requests get updated.
+ *
+ * This is useful for actors showing long, non-editable text, where
+ * shaping can take longer than a frame. Editable #ClutterText actors
+ * always shape their text synchronously.
+ */
+void
+clutter_text_set_async_layout (ClutterText *self,
+                               gboolean     async_layout)
+{
+  ClutterTextPrivate *priv;
+
+  g_return_if_fail (CLUTTER_IS_TEXT (self));
+
+  priv = self->priv;
+
+  if (priv->async_layout == async_layout)
+    return;
+
+  priv->async_layout = async_layout;
+
+  clutter_text_dirty_cache (self);
+  clutter_actor_queue_relayout (CLUTTER_ACTOR (self));
+
+  g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_ASYNC_LAYOUT]);
+}
+
+/**
+ * clutter_text_get_async_layout:
+ * @self: a #ClutterText
+ *
+ * Retrieves whether @self shapes its text off the main thread.
+ *
+ * Return value: %TRUE if asynchronous layout is enabled
+ */
+gboolean
+clutter_text_get_async_layout (ClutterText *self)
+{
+  g_return_val_if_fail (CLUTTER_IS_TEXT (self), FALSE);
+
+  return self->priv->async_layout;
+}
+
 /**
  * clutter_text_set_preedit_string:
  * @self: a #ClutterText
@@ -270,6 +270,11 @@ void                  clutter_text_set_single_line_mode (ClutterText          *s
                                                          gboolean              single_line);
 CLUTTER_EXPORT
 gboolean              clutter_text_get_single_line_mode (ClutterText          *self);
+CLUTTER_EXPORT
+void                  clutter_text_set_async_layout     (ClutterText          *self,
+                                                         gboolean              async_layout);
+CLUTTER_EXPORT
+gboolean              clutter_text_get_async_layout     (ClutterText          *self);
 
 CLUTTER_EXPORT
 void                  clutter_text_set_selected_text_color  (ClutterText          *self,
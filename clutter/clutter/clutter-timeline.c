@@ -167,6 +167,9 @@ struct _ClutterTimelinePrivate
    */
   guint waiting_first_tick : 1;
   guint auto_reverse       : 1;
+
+  /* If we are being advanced by the frame clock */
+  guint in_tick            : 1;
 };
 
 typedef struct {
@@ -1172,6 +1175,31 @@ emit_frame_signal (ClutterTimeline *timeline)
   g_signal_emit (timeline, timeline_signals[NEW_FRAME], 0, elapsed);
 }
 
+/* Lets the frame clock apply the frame together with the frames of other
+ * transitions instead of emitting ::new-frame, when nothing else can
+ * observe the difference.
+ */
+static gboolean
+maybe_batch_frame (ClutterTimeline *timeline)
+{
+  ClutterTimelinePrivate *priv = timeline->priv;
+
+  if (!priv->in_tick || !priv->frame_clock)
+    return FALSE;
+
+  /* ::marker-reached handlers expect the frame to be applied already */
+  if (priv->markers_by_name &&
+      g_hash_table_size (priv->markers_by_name) > 0)
+    return FALSE;
+
+  if (g_signal_has_handler_pending (timeline,
+                                    timeline_signals[NEW_FRAME],
+                                    0, TRUE))
+    return FALSE;
+
+  return clutter_frame_clock_batch_frame (priv->frame_clock, timeline);
+}
+
 static gboolean
 is_complete (ClutterTimeline *timeline)
 {
@@ -1234,7 +1262,8 @@ clutter_timeline_do_frame (ClutterTimeline *timeline)
   if (!is_complete (timeline))
     {
       /* Emit the signal */
-      emit_frame_signal (timeline);
+      if (!maybe_batch_frame (timeline))
+        emit_frame_signal (timeline);
       check_markers (timeline, priv->msecs_delta);
 
       g_object_unref (timeline);
@@ -1920,7 +1949,9 @@ _clutter_timeline_do_tick (ClutterTimeline *timeline,
       priv->last_frame_time = tick_time;
       priv->msecs_delta = 0;
       priv->waiting_first_tick = FALSE;
+      priv->in_tick = TRUE;
       clutter_timeline_do_frame (timeline);
+      priv->in_tick = FALSE;
     }
   else
     {
@@ -1944,7 +1975,9 @@ _clutter_timeline_do_tick (ClutterTimeline *timeline,
           /* Avoid accumulating error */
           priv->last_frame_time += msecs;
           priv->msecs_delta = msecs;
+          priv->in_tick = TRUE;
           clutter_timeline_do_frame (timeline);
+          priv->in_tick = FALSE;
         }
     }
 }
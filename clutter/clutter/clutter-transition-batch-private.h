@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2022 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CLUTTER_TRANSITION_BATCH_PRIVATE_H
+#define CLUTTER_TRANSITION_BATCH_PRIVATE_H
+
+#include <glib.h>
+
+#include "clutter-timeline.h"
+
+G_BEGIN_DECLS
+
+typedef struct _ClutterTransitionBatch ClutterTransitionBatch;
+
+ClutterTransitionBatch * clutter_transition_batch_new (void);
+
+void clutter_transition_batch_free (ClutterTransitionBatch *batch);
+
+gboolean clutter_transition_batch_add (ClutterTransitionBatch *batch,
+                                       ClutterTimeline        *timeline);
+
+void clutter_transition_batch_flush (ClutterTransitionBatch *batch);
+
+G_END_DECLS
+
+#endif /* CLUTTER_TRANSITION_BATCH_PRIVATE_H */
@@ -0,0 +1,370 @@
+/*
+ * Copyright (C) 2022 Red Hat Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A transition batch collects the frames of plain #ClutterPropertyTransition
+ * instances animating #ClutterActor properties while the frame clock
+ * advances its timelines, and evaluates them all at once afterwards.
+ *
+ * Instead of emitting #ClutterTimeline::new-frame and going through
+ * #ClutterInterval and #GValue for every transition, the initial and final
+ * values are gathered into flat arrays, the easing and interpolation are
+ * evaluated in tight loops over those arrays, and the results are written
+ * straight to the actors.
+ */
+
+#include "clutter-build-config.h"
+
+#include "clutter-transition-batch-private.h"
+
+#include "clutter-actor-private.h"
+#include "clutter-color.h"
+#include "clutter-debug.h"
+#include "clutter-easing.h"
+#include "clutter-interval.h"
+#include "clutter-private.h"
+#include "clutter-property-transition-private.h"
+
+#define MAX_COMPONENTS 4
+
+struct _ClutterTransitionBatch
+{
+  GPtrArray *transitions;
+
+  /* Indexed by transition */
+  unsigned int size;
+  ClutterAnimationMode *modes;
+  double *elapsed;
+  double *duration;
+  double *progress;
+  unsigned int *first_component;
+  unsigned int *n_components;
+
+  /* Indexed by component */
+  unsigned int component_size;
+  double *initial;
+  double *final;
+  double *factor;
+  double *values;
+};
+
+ClutterTransitionBatch *
+clutter_transition_batch_new (void)
+{
+  ClutterTransitionBatch *batch;
+
+  batch = g_new0 (ClutterTransitionBatch, 1);
+  batch->transitions = g_ptr_array_new_with_free_func (g_object_unref);
+
+  return batch;
+}
+
+void
+clutter_transition_batch_free (ClutterTransitionBatch *batch)
+{
+  g_ptr_array_unref (batch->transitions);
+
+  g_free (batch->modes);
+  g_free (batch->elapsed);
+  g_free (batch->duration);
+  g_free (batch->progress);
+  g_free (batch->first_component);
+  g_free (batch->n_components);
+
+  g_free (batch->initial);
+  g_free (batch->final);
+  g_free (batch->factor);
+  g_free (batch->values);
+
+  g_free (batch);
+}
+
+static void
+ensure_size (ClutterTransitionBatch *batch,
+             unsigned int            n_transitions)
+{
+  unsigned int n_components = n_transitions * MAX_COMPONENTS;
+
+  if (batch->size < n_transitions)
+    {
+      batch->size = MAX (n_transitions, batch->size * 2);
+
+      batch->modes = g_renew (ClutterAnimationMode, batch->modes, batch->size);
+      batch->elapsed = g_renew (double, batch->elapsed, batch->size);
+      batch->duration = g_renew (double, batch->duration, batch->size);
+      batch->progress = g_renew (double, batch->progress, batch->size);
+      batch->first_component = g_renew (unsigned int, batch->first_component,
+                                        batch->size);
+      batch->n_components = g_renew (unsigned int, batch->n_components,
+                                     batch->size);
+    }
+
+  if (batch->component_size < n_components)
+    {
+      batch->component_size = MAX (n_components, batch->component_size * 2);
+
+      batch->initial = g_renew (double, batch->initial, batch->component_size);
+      batch->final = g_renew (double, batch->final, batch->component_size);
+      batch->factor = g_renew (double, batch->factor, batch->component_size);
+      batch->values = g_renew (double, batch->values, batch->component_size);
+    }
+}
+
+static unsigned int
+gather_components (const GValue *value,
+                   double       *components)
+{
+  GType value_type = G_VALUE_TYPE (value);
+
+  if (value_type == G_TYPE_FLOAT)
+    {
+      components[0] = g_value_get_float (value);
+      return 1;
+    }
+  else if (value_type == G_TYPE_DOUBLE)
+    {
+      components[0] = g_value_get_double (value);
+      return 1;
+    }
+  else if (value_type == G_TYPE_UINT)
+    {
+      components[0] = g_value_get_uint (value);
+      return 1;
+    }
+  else if (value_type == GRAPHENE_TYPE_POINT)
+    {
+      const graphene_point_t *point = g_value_get_boxed (value);
+
+      if (!point)
+        return 0;
+
+      components[0] = point->x;
+      components[1] = point->y;
+      return 2;
+    }
+  else if (value_type == CLUTTER_TYPE_COLOR)
+    {
+      const ClutterColor *color = clutter_value_get_color (value);
+
+      if (!color)
+        return 0;
+
+      components[0] = color->red;
+      components[1] = color->green;
+      components[2] = color->blue;
+      components[3] = color->alpha;
+      return 4;
+    }
+
+  return 0;
+}
+
+static ClutterActor *
+get_batchable_actor (ClutterTransition  *transition,
+                     GParamSpec        **out_pspec)
+{
+  ClutterAnimatable *animatable;
+  ClutterInterval *interval;
+  GParamSpec *pspec;
+
+  animatable = clutter_transition_get_animatable (transition);
+  if (!CLUTTER_IS_ACTOR (animatable))
+    return NULL;
+
+  /* Interval subclasses may compute values in their own way */
+  interval = clutter_transition_get_interval (transition);
+  if (!interval ||
+      G_OBJECT_TYPE (interval) != CLUTTER_TYPE_INTERVAL ||
+      !clutter_interval_is_valid (interval))
+    return NULL;
+
+  pspec =
+    clutter_property_transition_get_pspec (CLUTTER_PROPERTY_TRANSITION (transition));
+  if (!pspec ||
+      clutter_interval_get_value_type (interval) != G_PARAM_SPEC_VALUE_TYPE (pspec))
+    return NULL;
+
+  if (clutter_actor_get_animatable_n_components (CLUTTER_ACTOR (animatable),
+                                                 pspec) == 0)
+    return NULL;
+
+  *out_pspec = pspec;
+  return CLUTTER_ACTOR (animatable);
+}
+
+/*
+ * clutter_transition_batch_add:
+ * @batch: a #ClutterTransitionBatch
+ * @timeline: a #ClutterTimeline that just advanced
+ *
+ * Adds the current frame of @timeline to @batch, if @timeline is a
+ * transition the batch knows how to evaluate. The new values are only
+ * applied once clutter_transition_batch_flush() is called.
+ *
+ * Returns: %TRUE if the frame was added, %FALSE if the caller must
+ *   emit #ClutterTimeline::new-frame itself
+ */
+gboolean
+clutter_transition_batch_add (ClutterTransitionBatch *batch,
+                              ClutterTimeline        *timeline)
+{
+  GParamSpec *pspec;
+
+  /* Subclasses may override how values are computed and applied */
+  if (G_OBJECT_TYPE (timeline) != CLUTTER_TYPE_PROPERTY_TRANSITION)
+    return FALSE;
+
+  if (!get_batchable_actor (CLUTTER_TRANSITION (timeline), &pspec))
+    return FALSE;
+
+  g_ptr_array_add (batch->transitions, g_object_ref (timeline));
+
+  return TRUE;
+}
+
+void
+clutter_transition_batch_flush (ClutterTransitionBatch *batch)
+{
+  g_autoptr (GPtrArray) transitions = NULL;
+  g_autoptr (GPtrArray) stages = NULL;
+  unsigned int n_transitions;
+  unsigned int n_components;
+  unsigned int i, j;
+
+  if (batch->transitions->len == 0)
+    return;
+
+  /* Applying values may end up adding frames for the next flush */
+  transitions = g_steal_pointer (&batch->transitions);
+  batch->transitions = g_ptr_array_new_with_free_func (g_object_unref);
+
+  n_transitions = transitions->len;
+  ensure_size (batch, n_transitions);
+
+  CLUTTER_NOTE (ANIMATION, "Flushing %u batched transitions", n_transitions);
+
+  /* Gather the interval end points and timeline state */
+  n_components = 0;
+  for (i = 0; i < n_transitions; i++)
+    {
+      ClutterTimeline *timeline = g_ptr_array_index (transitions, i);
+      ClutterInterval *interval;
+      GParamSpec *pspec;
+      unsigned int n_initial, n_final;
+
+      batch->modes[i] = CLUTTER_LINEAR;
+      batch->elapsed[i] = 0.0;
+      batch->duration[i] = 1.0;
+      batch->first_component[i] = n_components;
+      batch->n_components[i] = 0;
+
+      /* Stopped or detached by a handler after being added */
+      if (!clutter_timeline_is_playing (timeline) ||
+          !get_batchable_actor (CLUTTER_TRANSITION (timeline), &pspec))
+        continue;
+
+      interval = clutter_transition_get_interval (CLUTTER_TRANSITION (timeline));
+      n_initial =
+        gather_components (clutter_interval_peek_initial_value (interval),
+                           batch->initial + n_components);
+      n_final =
+        gather_components (clutter_interval_peek_final_value (interval),
+                           batch->final + n_components);
+      if (n_initial == 0 || n_initial != n_final)
+        continue;
+
+      batch->modes[i] = clutter_timeline_get_progress_mode (timeline);
+      batch->elapsed[i] = clutter_timeline_get_elapsed_time (timeline);
+      batch->duration[i] = clutter_timeline_get_duration (timeline);
+      batch->n_components[i] = n_initial;
+      n_components += n_initial;
+    }
+
+  /* Linear progress */
+  for (i = 0; i < n_transitions; i++)
+    batch->progress[i] = batch->elapsed[i] / batch->duration[i];
+
+  /* Easing */
+  for (i = 0; i < n_transitions; i++)
+    {
+      ClutterAnimationMode mode = batch->modes[i];
+
+      if (mode == CLUTTER_LINEAR)
+        continue;
+
+      if (mode > CLUTTER_LINEAR && mode <= CLUTTER_EASE_IN_OUT_BOUNCE)
+        {
+          batch->progress[i] = clutter_easing_for_mode (mode,
+                                                        batch->elapsed[i],
+                                                        batch->duration[i]);
+        }
+      else
+        {
+          ClutterTimeline *timeline = g_ptr_array_index (transitions, i);
+
+          /* Parametrized and custom progress functions */
+          batch->progress[i] = clutter_timeline_get_progress (timeline);
+        }
+    }
+
+  for (i = 0; i < n_transitions; i++)
+    {
+      for (j = 0; j < batch->n_components[i]; j++)
+        batch->factor[batch->first_component[i] + j] = batch->progress[i];
+    }
+
+  /* Interpolation, using the same formula as ClutterInterval */
+  for (j = 0; j < n_components; j++)
+    {
+      batch->values[j] = (batch->factor[j] *
+                          (batch->final[j] - batch->initial[j])) +
+                         batch->initial[j];
+    }
+
+  /* Write the results back to the actors */
+  stages = g_ptr_array_new_with_free_func (g_object_unref);
+  for (i = 0; i < n_transitions; i++)
+    {
+      ClutterTimeline *timeline = g_ptr_array_index (transitions, i);
+      ClutterActor *actor;
+      ClutterActor *stage;
+      GParamSpec *pspec;
+
+      if (batch->n_components[i] == 0)
+        continue;
+
+      /* Applying an earlier value might have stopped this transition */
+      if (!clutter_timeline_is_playing (timeline))
+        continue;
+
+      actor = get_batchable_actor (CLUTTER_TRANSITION (timeline), &pspec);
+      if (!actor)
+        continue;
+
+      clutter_actor_set_animatable_components (actor, pspec,
+                                               batch->values +
+                                               batch->first_component[i]);
+
+      stage = _clutter_actor_get_stage_internal (actor);
+      if (stage && !g_ptr_array_find (stages, stage, NULL))
+        g_ptr_array_add (stages, g_object_ref (stage));
+    }
+
+  /* Repick once per stage rather than once per property */
+  for (i = 0; i < stages->len; i++)
+    clutter_actor_update_pointer (g_ptr_array_index (stages, i));
+}
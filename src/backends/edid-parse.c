@@ -391,7 +391,9 @@ decode_display_descriptor (const uchar *desc,
       decode_lf_string (desc + 5, 13, info->dsc_string);
       break;
     case 0xFD:
-      /* Range Limits */
+      /* Range Limits, with the EDID 1.4 rate offsets */
+      info->min_vert_rate_hz = desc[0x05] + ((desc[0x04] & 0x01) ? 255 : 0);
+      info->max_vert_rate_hz = desc[0x06] + ((desc[0x04] & 0x02) ? 255 : 0);
       break;
     case 0xFB:
       /* Color Point */
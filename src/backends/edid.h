@@ -186,6 +186,10 @@ struct MonitorInfo
   char		dsc_serial_number[14];
   char		dsc_product_name[14];
   char		dsc_string[14];		/* Unspecified ASCII data */
+
+  /* Display range limits */
+  int		min_vert_rate_hz;	/* 0 if not specified */
+  int		max_vert_rate_hz;	/* 0 if not specified */
 };
 
 MonitorInfo *decode_edid (const uchar *data);
@@ -131,6 +131,7 @@ META_EXPORT_TEST
 MetaCursorTracker * meta_backend_get_cursor_tracker (MetaBackend *backend);
 MetaCursorRenderer * meta_backend_get_cursor_renderer_for_device (MetaBackend        *backend,
                                                                   ClutterInputDevice *device);
+META_EXPORT_TEST
 MetaCursorRenderer * meta_backend_get_cursor_renderer (MetaBackend *backend);
 META_EXPORT_TEST
 MetaRenderer * meta_backend_get_renderer (MetaBackend *backend);
@@ -139,6 +140,7 @@ MetaEgl * meta_backend_get_egl (MetaBackend *backend);
 #ifdef HAVE_REMOTE_DESKTOP
 MetaRemoteDesktop * meta_backend_get_remote_desktop (MetaBackend *backend);
 
+META_EXPORT_TEST
 MetaScreenCast * meta_backend_get_screen_cast (MetaBackend *backend);
 #endif
 
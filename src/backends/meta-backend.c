@@ -1082,12 +1082,18 @@ clutter_source_dispatch (GSource     *source,
                          gpointer     user_data)
 {
   MetaBackendSource *backend_source = (MetaBackendSource *) source;
-  ClutterEvent *event = clutter_event_get ();
-
-  if (event)
+  ClutterStage *stage =
+    CLUTTER_STAGE (meta_backend_get_stage (backend_source->backend));
+  ClutterEvent *event;
+  int n_events;
+
+  /* Handle every event that was queued when the source was dispatched, so
+   * that a batch of events from the input thread costs a single main loop
+   * iteration. Events queued while handling them wait for the next one. */
+  n_events = _clutter_events_get_n_pending ();
+  while (n_events-- > 0 && (event = clutter_event_get ()))
     {
-      event->any.stage =
-        CLUTTER_STAGE (meta_backend_get_stage (backend_source->backend));
+      event->any.stage = stage;
       clutter_do_event (event);
       meta_backend_update_from_event (backend_source->backend, event);
       clutter_event_free (event);
@@ -0,0 +1,456 @@
+/*
+ * Copyright (C) 2022 Red Hat
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Reads back regions of a framebuffer into CPU memory laid out like the
+ * framebuffer itself, i.e. each rectangle ends up at the same position in the
+ * destination as it has in the framebuffer.
+ *
+ * The asynchronous variant reads the rectangles into a pixel buffer object,
+ * and only copies them into the destination once a fence placed after the
+ * read has signalled, so that the main thread doesn't have to wait for the
+ * GPU to finish rendering. Cogl flips rows read from onscreen framebuffers
+ * and converts formats the driver can't read into on the CPU, which would
+ * wait all the same, so onscreen framebuffers are first blitted into an
+ * offscreen one, and formats that would need converting are read
+ * synchronously.
+ */
+
+#include "config.h"
+
+#include "backends/meta-framebuffer-readback.h"
+
+#include <string.h>
+
+struct _MetaFramebufferReadback
+{
+  CoglFramebuffer *framebuffer;
+  CoglPixelFormat format;
+  int bpp;
+
+  CoglPixelBuffer *pixel_buffer;
+  CoglOffscreen *offscreen;
+
+  struct {
+    CoglFramebuffer *framebuffer;
+    CoglFenceClosure *fence;
+    cairo_region_t *region;
+    uint8_t *dst_data;
+    int dst_stride;
+    MetaFramebufferReadbackFunc func;
+    gpointer user_data;
+    int64_t cpu_time_us;
+  } pending;
+
+  int64_t cpu_time_us;
+};
+
+MetaFramebufferReadback *
+meta_framebuffer_readback_new (CoglFramebuffer *framebuffer,
+                               CoglPixelFormat  format)
+{
+  MetaFramebufferReadback *readback;
+
+  g_return_val_if_fail (cogl_pixel_format_get_n_planes (format) == 1, NULL);
+
+  readback = g_new0 (MetaFramebufferReadback, 1);
+  readback->framebuffer = framebuffer;
+  readback->format = format;
+  readback->bpp = cogl_pixel_format_get_bytes_per_pixel (format, 0);
+
+  return readback;
+}
+
+static void
+clear_pending (MetaFramebufferReadback *readback)
+{
+  readback->pending.framebuffer = NULL;
+  readback->pending.fence = NULL;
+  g_clear_pointer (&readback->pending.region, cairo_region_destroy);
+  readback->pending.dst_data = NULL;
+  readback->pending.dst_stride = 0;
+  readback->pending.func = NULL;
+  readback->pending.user_data = NULL;
+  readback->pending.cpu_time_us = 0;
+}
+
+void
+meta_framebuffer_readback_cancel (MetaFramebufferReadback *readback)
+{
+  if (!readback->pending.fence)
+    return;
+
+  cogl_framebuffer_cancel_fence_callback (readback->pending.framebuffer,
+                                          readback->pending.fence);
+  clear_pending (readback);
+}
+
+void
+meta_framebuffer_readback_free (MetaFramebufferReadback *readback)
+{
+  meta_framebuffer_readback_cancel (readback);
+  g_clear_pointer (&readback->pixel_buffer, cogl_object_unref);
+  g_clear_object (&readback->offscreen);
+  g_free (readback);
+}
+
+gboolean
+meta_framebuffer_readback_is_pending (MetaFramebufferReadback *readback)
+{
+  return !!readback->pending.fence;
+}
+
+/*
+ * Returns the time the main thread spent on the last completed read back,
+ * including copying the pixels into place.
+ */
+int64_t
+meta_framebuffer_readback_get_cpu_time_us (MetaFramebufferReadback *readback)
+{
+  return readback->cpu_time_us;
+}
+
+gboolean
+meta_framebuffer_readback_read_region (MetaFramebufferReadback *readback,
+                                       const cairo_region_t    *region,
+                                       uint8_t                 *dst_data,
+                                       int                      dst_stride)
+{
+  CoglContext *cogl_context =
+    cogl_framebuffer_get_context (readback->framebuffer);
+  int64_t start_time_us;
+  gboolean ret = TRUE;
+  int n_rects, i;
+
+  g_return_val_if_fail (!readback->pending.fence, FALSE);
+
+  COGL_TRACE_BEGIN_SCOPED (ReadRegion, "Framebuffer readback (sync)");
+
+  start_time_us = g_get_monotonic_time ();
+
+  n_rects = cairo_region_num_rectangles (region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      CoglBitmap *bitmap;
+
+      cairo_region_get_rectangle (region, i, &rect);
+
+      bitmap = cogl_bitmap_new_for_data (cogl_context,
+                                         rect.width, rect.height,
+                                         readback->format,
+                                         dst_stride,
+                                         dst_data +
+                                         rect.y * dst_stride +
+                                         rect.x * readback->bpp);
+      ret = cogl_framebuffer_read_pixels_into_bitmap (readback->framebuffer,
+                                                      rect.x, rect.y,
+                                                      COGL_READ_PIXELS_COLOR_BUFFER,
+                                                      bitmap);
+      cogl_object_unref (bitmap);
+
+      if (!ret)
+        break;
+    }
+
+  readback->cpu_time_us = g_get_monotonic_time () - start_time_us;
+
+  return ret;
+}
+
+static void
+copy_pending_rectangles (MetaFramebufferReadback *readback,
+                         const uint8_t           *data)
+{
+  const cairo_region_t *region = readback->pending.region;
+  size_t offset = 0;
+  int n_rects, i;
+
+  n_rects = cairo_region_num_rectangles (region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      int rowstride;
+      uint8_t *dst;
+      int y;
+
+      cairo_region_get_rectangle (region, i, &rect);
+      rowstride = rect.width * readback->bpp;
+      dst = (readback->pending.dst_data +
+             rect.y * readback->pending.dst_stride +
+             rect.x * readback->bpp);
+
+      for (y = 0; y < rect.height; y++)
+        {
+          memcpy (dst, data + offset, rowstride);
+          dst += readback->pending.dst_stride;
+          offset += rowstride;
+        }
+    }
+}
+
+static void
+finish_pending (MetaFramebufferReadback *readback)
+{
+  MetaFramebufferReadbackFunc func;
+  gpointer user_data;
+  int64_t start_time_us;
+  uint8_t *data;
+
+  COGL_TRACE_BEGIN_SCOPED (CopyRegion, "Framebuffer readback (copy)");
+
+  start_time_us = g_get_monotonic_time ();
+
+  data = cogl_buffer_map (COGL_BUFFER (readback->pixel_buffer),
+                          COGL_BUFFER_ACCESS_READ,
+                          0);
+  if (data)
+    {
+      copy_pending_rectangles (readback, data);
+      cogl_buffer_unmap (COGL_BUFFER (readback->pixel_buffer));
+    }
+  else
+    {
+      g_warning ("Failed to map framebuffer readback pixel buffer");
+    }
+
+  readback->cpu_time_us = (readback->pending.cpu_time_us +
+                           g_get_monotonic_time () - start_time_us);
+
+  func = readback->pending.func;
+  user_data = readback->pending.user_data;
+  clear_pending (readback);
+
+  func (readback, user_data);
+}
+
+static void
+on_fence_signalled (CoglFence *fence,
+                    void      *user_data)
+{
+  MetaFramebufferReadback *readback = user_data;
+
+  /* Freed by Cogl once the callback returns */
+  readback->pending.fence = NULL;
+
+  finish_pending (readback);
+}
+
+/*
+ * Completes a pending read back right away, waiting for the GPU to finish
+ * rendering if it hasn't yet. The callback is called before returning.
+ */
+void
+meta_framebuffer_readback_flush (MetaFramebufferReadback *readback)
+{
+  if (!readback->pending.fence)
+    return;
+
+  cogl_framebuffer_cancel_fence_callback (readback->pending.framebuffer,
+                                          readback->pending.fence);
+  readback->pending.fence = NULL;
+
+  finish_pending (readback);
+}
+
+static gboolean
+ensure_pixel_buffer (MetaFramebufferReadback *readback)
+{
+  CoglContext *cogl_context;
+  size_t size;
+
+  if (readback->pixel_buffer)
+    return TRUE;
+
+  /* Rectangles of a region never overlap, so a buffer the size of the
+   * framebuffer can always hold all of them. */
+  cogl_context = cogl_framebuffer_get_context (readback->framebuffer);
+  size = ((size_t) cogl_framebuffer_get_width (readback->framebuffer) *
+          cogl_framebuffer_get_height (readback->framebuffer) *
+          readback->bpp);
+
+  readback->pixel_buffer = cogl_pixel_buffer_new (cogl_context, size, NULL);
+  return !!readback->pixel_buffer;
+}
+
+static CoglFramebuffer *
+ensure_read_framebuffer (MetaFramebufferReadback *readback)
+{
+  CoglContext *cogl_context;
+  CoglTexture2D *texture;
+  CoglOffscreen *offscreen;
+  g_autoptr (GError) error = NULL;
+  int width, height;
+
+  if (!COGL_IS_ONSCREEN (readback->framebuffer))
+    return readback->framebuffer;
+
+  if (readback->offscreen)
+    return COGL_FRAMEBUFFER (readback->offscreen);
+
+  cogl_context = cogl_framebuffer_get_context (readback->framebuffer);
+  if (!cogl_has_feature (cogl_context, COGL_FEATURE_ID_BLIT_FRAMEBUFFER))
+    return NULL;
+
+  width = cogl_framebuffer_get_width (readback->framebuffer);
+  height = cogl_framebuffer_get_height (readback->framebuffer);
+  texture = cogl_texture_2d_new_with_size (cogl_context, width, height);
+  if (!texture)
+    return NULL;
+
+  cogl_primitive_texture_set_auto_mipmap (COGL_PRIMITIVE_TEXTURE (texture),
+                                          FALSE);
+  offscreen = cogl_offscreen_new_with_texture (COGL_TEXTURE (texture));
+  cogl_object_unref (texture);
+
+  if (!cogl_framebuffer_allocate (COGL_FRAMEBUFFER (offscreen), &error))
+    {
+      g_warning ("Failed to allocate framebuffer for reading back: %s",
+                 error->message);
+      g_object_unref (offscreen);
+      return NULL;
+    }
+
+  readback->offscreen = offscreen;
+  return COGL_FRAMEBUFFER (offscreen);
+}
+
+static gboolean
+is_format_read_directly (MetaFramebufferReadback *readback,
+                         CoglFramebuffer         *framebuffer)
+{
+  CoglContext *cogl_context = cogl_framebuffer_get_context (framebuffer);
+  CoglRenderer *cogl_renderer = cogl_context_get_renderer (cogl_context);
+  CoglPixelFormat internal_format =
+    cogl_framebuffer_get_internal_format (framebuffer);
+  CoglPixelFormat format = readback->format;
+
+  switch (cogl_renderer_get_driver (cogl_renderer))
+    {
+    case COGL_DRIVER_GL:
+    case COGL_DRIVER_GL3:
+      break;
+    case COGL_DRIVER_GLES2:
+      /* The only format GLES reads into in any case */
+      if ((format & ~COGL_PREMULT_BIT) != COGL_PIXEL_FORMAT_RGBA_8888)
+        return FALSE;
+      break;
+    default:
+      return FALSE;
+    }
+
+  if ((format & COGL_A_BIT) &&
+      (format & COGL_PREMULT_BIT) != (internal_format & COGL_PREMULT_BIT))
+    return FALSE;
+
+  return TRUE;
+}
+
+/*
+ * Returns %FALSE if the pixels can't be read back asynchronously, in which
+ * case nothing was read, and @func will not be called.
+ */
+gboolean
+meta_framebuffer_readback_read_region_async (MetaFramebufferReadback     *readback,
+                                             const cairo_region_t        *region,
+                                             uint8_t                     *dst_data,
+                                             int                          dst_stride,
+                                             MetaFramebufferReadbackFunc  func,
+                                             gpointer                     user_data)
+{
+  CoglContext *cogl_context =
+    cogl_framebuffer_get_context (readback->framebuffer);
+  CoglFramebuffer *read_framebuffer;
+  CoglFenceClosure *fence;
+  int64_t start_time_us;
+  size_t offset = 0;
+  int n_rects, i;
+
+  g_return_val_if_fail (!readback->pending.fence, FALSE);
+
+  if (!cogl_has_feature (cogl_context, COGL_FEATURE_ID_FENCE))
+    return FALSE;
+
+  read_framebuffer = ensure_read_framebuffer (readback);
+  if (!read_framebuffer)
+    return FALSE;
+
+  if (!is_format_read_directly (readback, read_framebuffer))
+    return FALSE;
+
+  if (!ensure_pixel_buffer (readback))
+    return FALSE;
+
+  COGL_TRACE_BEGIN_SCOPED (ReadRegionAsync, "Framebuffer readback (async)");
+
+  start_time_us = g_get_monotonic_time ();
+
+  n_rects = cairo_region_num_rectangles (region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      CoglBitmap *bitmap;
+      int rowstride;
+      gboolean ret;
+
+      cairo_region_get_rectangle (region, i, &rect);
+      rowstride = rect.width * readback->bpp;
+
+      if (read_framebuffer != readback->framebuffer &&
+          !cogl_blit_framebuffer (readback->framebuffer, read_framebuffer,
+                                  rect.x, rect.y,
+                                  rect.x, rect.y,
+                                  rect.width, rect.height,
+                                  NULL))
+        return FALSE;
+
+      bitmap = cogl_bitmap_new_from_buffer (COGL_BUFFER (readback->pixel_buffer),
+                                            readback->format,
+                                            rect.width, rect.height,
+                                            rowstride,
+                                            offset);
+      ret = cogl_framebuffer_read_pixels_into_bitmap (read_framebuffer,
+                                                      rect.x, rect.y,
+                                                      COGL_READ_PIXELS_COLOR_BUFFER,
+                                                      bitmap);
+      cogl_object_unref (bitmap);
+
+      if (!ret)
+        return FALSE;
+
+      offset += (size_t) rowstride * rect.height;
+    }
+
+  fence = cogl_framebuffer_add_fence_callback (read_framebuffer,
+                                               on_fence_signalled,
+                                               readback);
+  if (!fence)
+    return FALSE;
+
+  readback->pending.framebuffer = read_framebuffer;
+  readback->pending.fence = fence;
+  readback->pending.region = cairo_region_copy (region);
+  readback->pending.dst_data = dst_data;
+  readback->pending.dst_stride = dst_stride;
+  readback->pending.func = func;
+  readback->pending.user_data = user_data;
+  readback->pending.cpu_time_us = g_get_monotonic_time () - start_time_us;
+
+  return TRUE;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2022 Red Hat
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef META_FRAMEBUFFER_READBACK_H
+#define META_FRAMEBUFFER_READBACK_H
+
+#include <cairo.h>
+#include <glib.h>
+#include <stdint.h>
+
+#include "cogl/cogl.h"
+#include "core/util-private.h"
+
+typedef struct _MetaFramebufferReadback MetaFramebufferReadback;
+
+typedef void (* MetaFramebufferReadbackFunc) (MetaFramebufferReadback *readback,
+                                              gpointer                 user_data);
+
+META_EXPORT_TEST
+MetaFramebufferReadback * meta_framebuffer_readback_new (CoglFramebuffer *framebuffer,
+                                                         CoglPixelFormat  format);
+
+META_EXPORT_TEST
+void meta_framebuffer_readback_free (MetaFramebufferReadback *readback);
+
+META_EXPORT_TEST
+gboolean meta_framebuffer_readback_read_region (MetaFramebufferReadback *readback,
+                                                const cairo_region_t    *region,
+                                                uint8_t                 *dst_data,
+                                                int                      dst_stride);
+
+META_EXPORT_TEST
+gboolean meta_framebuffer_readback_read_region_async (MetaFramebufferReadback     *readback,
+                                                      const cairo_region_t        *region,
+                                                      uint8_t                     *dst_data,
+                                                      int                          dst_stride,
+                                                      MetaFramebufferReadbackFunc  func,
+                                                      gpointer                     user_data);
+
+META_EXPORT_TEST
+gboolean meta_framebuffer_readback_is_pending (MetaFramebufferReadback *readback);
+
+void meta_framebuffer_readback_cancel (MetaFramebufferReadback *readback);
+
+void meta_framebuffer_readback_flush (MetaFramebufferReadback *readback);
+
+META_EXPORT_TEST
+int64_t meta_framebuffer_readback_get_cpu_time_us (MetaFramebufferReadback *readback);
+
+#endif /* META_FRAMEBUFFER_READBACK_H */
@@ -319,6 +319,9 @@ meta_output_info_parse_edid (MetaOutputInfo *output_info,
           output_info->serial = g_strdup_printf ("0x%08x", parsed_edid->serial_number);
         }
 
+      output_info->min_refresh_rate = parsed_edid->min_vert_rate_hz;
+      output_info->max_refresh_rate = parsed_edid->max_vert_rate_hz;
+
       g_free (parsed_edid);
     }
 
@@ -102,6 +102,11 @@ typedef struct _MetaOutputInfo
 
   gboolean supports_underscanning;
   gboolean supports_color_transform;
+  gboolean supports_vrr;
+
+  /* Refresh rate range from the EDID, 0 if unknown */
+  int min_refresh_rate;
+  int max_refresh_rate;
 
   /*
    * Get a new preferred mode on hotplug events, to handle dynamic guest
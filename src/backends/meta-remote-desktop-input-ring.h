@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2022 Red Hat
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Layout of the shared memory ring of a remote desktop input channel, as
+ * opened with org.gnome.Mutter.RemoteDesktop.Session.OpenInputChannel.
+ *
+ * The ring is a single producer, single consumer queue. The client writes
+ * events at 'head' and then advances it; the display server reads events at
+ * 'tail' and then advances it. Both are free running counters, that are
+ * masked with 'n_events' - 1 to get the slot index. Both sides must access
+ * them with atomic loads and stores. After queueing a batch of events, the
+ * client writes a 64 bit integer to the notify file descriptor to wake up the
+ * display server.
+ *
+ * The statistics at the end of the header are written by the display server
+ * after each dispatched batch, and may be read by the client to measure the
+ * input latency.
+ */
+
+#ifndef META_REMOTE_DESKTOP_INPUT_RING_H
+#define META_REMOTE_DESKTOP_INPUT_RING_H
+
+#include <stdint.h>
+
+#define META_REMOTE_DESKTOP_INPUT_RING_VERSION 1
+
+typedef enum _MetaRemoteDesktopInputEventType
+{
+  META_REMOTE_DESKTOP_INPUT_EVENT_POINTER_MOTION_RELATIVE = 1,
+  META_REMOTE_DESKTOP_INPUT_EVENT_POINTER_MOTION_ABSOLUTE = 2,
+  META_REMOTE_DESKTOP_INPUT_EVENT_POINTER_BUTTON = 3,
+  META_REMOTE_DESKTOP_INPUT_EVENT_KEYBOARD_KEYCODE = 4,
+} MetaRemoteDesktopInputEventType;
+
+typedef struct _MetaRemoteDesktopInputEvent
+{
+  /* A MetaRemoteDesktopInputEventType */
+  uint32_t type;
+
+  /* evdev button or key code, and whether it is pressed */
+  uint32_t code;
+  uint32_t pressed;
+
+  uint32_t padding;
+
+  /* CLOCK_MONOTONIC time the event was queued at, in microseconds */
+  uint64_t time_us;
+
+  /* Relative motion, or absolute position in the stream the channel was
+   * opened for; must be finite. Absolute positions are dropped on channels
+   * opened without a stream. */
+  double x;
+  double y;
+} MetaRemoteDesktopInputEvent;
+
+typedef struct _MetaRemoteDesktopInputRing
+{
+  uint32_t version;
+  uint32_t n_events;
+
+  uint32_t head;
+  uint8_t head_padding[60];
+
+  uint32_t tail;
+  uint8_t tail_padding[60];
+
+  uint64_t n_dispatched;
+  uint64_t total_latency_us;
+  uint64_t last_dispatch_time_us;
+  uint64_t padding;
+
+  MetaRemoteDesktopInputEvent events[];
+} MetaRemoteDesktopInputRing;
+
+#endif /* META_REMOTE_DESKTOP_INPUT_RING_H */
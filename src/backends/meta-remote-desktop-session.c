@@ -34,7 +34,9 @@
 #include <xkbcommon/xkbcommon.h>
 
 #include "backends/meta-dbus-session-watcher.h"
+#include "backends/meta-monitor-manager-private.h"
 #include "backends/meta-screen-cast-session.h"
+#include "backends/meta-screen-cast-window-stream.h"
 #include "backends/meta-remote-access-controller-private.h"
 #include "backends/x11/meta-backend-x11.h"
 #include "cogl/cogl.h"
@@ -45,6 +47,10 @@
 
 #include "meta-dbus-remote-desktop.h"
 
+#ifdef HAVE_NATIVE_BACKEND
+#include "backends/native/meta-virtual-input-device-native.h"
+#endif
+
 #define META_REMOTE_DESKTOP_SESSION_DBUS_PATH "/org/gnome/Mutter/RemoteDesktop/Session"
 
 #define TRANSFER_REQUEST_CLEANUP_TIMEOUT_MS (s2ms (15))
@@ -85,6 +91,9 @@ struct _MetaRemoteDesktopSession
   ClutterVirtualInputDevice *virtual_keyboard;
   ClutterVirtualInputDevice *virtual_touchscreen;
 
+  gboolean has_input_channel;
+  char *input_channel_stream_path;
+
   MetaRemoteDesktopSessionHandle *handle;
 
   gboolean is_clipboard_enabled;
@@ -216,6 +225,9 @@ meta_remote_desktop_session_close (MetaRemoteDesktopSession *session)
   g_clear_object (&session->virtual_keyboard);
   g_clear_object (&session->virtual_touchscreen);
 
+  session->has_input_channel = FALSE;
+  g_clear_pointer (&session->input_channel_stream_path, g_free);
+
   meta_dbus_session_notify_closed (META_DBUS_SESSION (session));
   meta_dbus_remote_desktop_session_emit_closed (skeleton);
   g_dbus_interface_skeleton_unexport (G_DBUS_INTERFACE_SKELETON (session));
@@ -936,6 +948,165 @@ handle_notify_touch_up (MetaDBusRemoteDesktopSession *skeleton,
   return TRUE;
 }
 
+#ifdef HAVE_NATIVE_BACKEND
+static void
+update_input_channel_transform (MetaRemoteDesktopSession *session)
+{
+  MetaScreenCastStream *stream;
+  double x0, y0, x1, y1;
+
+  if (!session->has_input_channel ||
+      !session->input_channel_stream_path ||
+      !session->screen_cast_session)
+    return;
+
+  stream = meta_screen_cast_session_get_stream (session->screen_cast_session,
+                                                session->input_channel_stream_path);
+  if (!stream)
+    return;
+
+  /* Monitor, area and virtual streams map stream coordinates to the stage
+   * with a scale and an offset, so two points are enough to describe it. */
+  if (!meta_screen_cast_stream_transform_position (stream, 0.0, 0.0, &x0, &y0) ||
+      !meta_screen_cast_stream_transform_position (stream, 1.0, 1.0, &x1, &y1))
+    return;
+
+  meta_virtual_input_device_native_set_input_ring_transform (
+    META_VIRTUAL_INPUT_DEVICE_NATIVE (session->virtual_pointer),
+    x0, y0, x1 - x0, y1 - y0);
+}
+
+static void
+on_input_channel_monitors_changed (MetaMonitorManager       *monitor_manager,
+                                   MetaRemoteDesktopSession *session)
+{
+  update_input_channel_transform (session);
+}
+#endif /* HAVE_NATIVE_BACKEND */
+
+static gboolean
+handle_open_input_channel (MetaDBusRemoteDesktopSession *skeleton,
+                           GDBusMethodInvocation        *invocation,
+                           GUnixFDList                  *fd_list_in,
+                           GVariant                     *options_variant)
+{
+#ifdef HAVE_NATIVE_BACKEND
+  MetaRemoteDesktopSession *session = META_REMOTE_DESKTOP_SESSION (skeleton);
+  MetaBackend *backend = meta_remote_desktop_get_backend (session->remote_desktop);
+  MetaMonitorManager *monitor_manager =
+    meta_backend_get_monitor_manager (backend);
+  g_autoptr (GError) error = NULL;
+  g_autoptr (GUnixFDList) fd_list = NULL;
+  const char *stream_path = NULL;
+  int ring_fd;
+  int notify_fd;
+  GVariant *ring_fd_variant;
+  GVariant *notify_fd_variant;
+
+  if (!meta_remote_desktop_session_check_can_notify (session, invocation))
+    return TRUE;
+
+  if (session->has_input_channel)
+    {
+      g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
+                                             G_DBUS_ERROR_FAILED,
+                                             "Input channel already open");
+      return TRUE;
+    }
+
+  g_variant_lookup (options_variant, "stream", "&s", &stream_path);
+  if (stream_path)
+    {
+      MetaScreenCastStream *stream;
+
+      if (!session->screen_cast_session)
+        {
+          g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
+                                                 G_DBUS_ERROR_FAILED,
+                                                 "No screen cast active");
+          return TRUE;
+        }
+
+      stream = meta_screen_cast_session_get_stream (session->screen_cast_session,
+                                                    stream_path);
+      if (!stream)
+        {
+          g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
+                                                 G_DBUS_ERROR_FAILED,
+                                                 "Unknown stream");
+          return TRUE;
+        }
+
+      if (META_IS_SCREEN_CAST_WINDOW_STREAM (stream))
+        {
+          g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
+                                                 G_DBUS_ERROR_NOT_SUPPORTED,
+                                                 "Window streams not supported");
+          return TRUE;
+        }
+    }
+
+  ensure_virtual_device (session, CLUTTER_POINTER_DEVICE);
+
+  if (!META_IS_VIRTUAL_INPUT_DEVICE_NATIVE (session->virtual_pointer))
+    {
+      g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
+                                             G_DBUS_ERROR_NOT_SUPPORTED,
+                                             "Input channel not supported");
+      return TRUE;
+    }
+
+  if (!meta_virtual_input_device_native_open_input_ring (
+         META_VIRTUAL_INPUT_DEVICE_NATIVE (session->virtual_pointer),
+         &ring_fd, &notify_fd, &error))
+    {
+      g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
+                                             G_DBUS_ERROR_FAILED,
+                                             "Failed to open input channel: %s",
+                                             error->message);
+      return TRUE;
+    }
+
+  meta_topic (META_DEBUG_REMOTE_DESKTOP,
+              "Opened input channel for %s",
+              g_dbus_method_invocation_get_sender (invocation));
+
+  session->has_input_channel = TRUE;
+  session->input_channel_stream_path = g_strdup (stream_path);
+
+  if (stream_path)
+    {
+      g_signal_connect_object (monitor_manager, "monitors-changed-internal",
+                               G_CALLBACK (on_input_channel_monitors_changed),
+                               session, 0);
+      update_input_channel_transform (session);
+    }
+
+  fd_list = g_unix_fd_list_new ();
+
+  ring_fd_variant = g_variant_new_handle (g_unix_fd_list_append (fd_list,
+                                                                 ring_fd,
+                                                                 NULL));
+  close (ring_fd);
+  notify_fd_variant = g_variant_new_handle (g_unix_fd_list_append (fd_list,
+                                                                   notify_fd,
+                                                                   NULL));
+  close (notify_fd);
+
+  meta_dbus_remote_desktop_session_complete_open_input_channel (skeleton,
+                                                                invocation,
+                                                                fd_list,
+                                                                ring_fd_variant,
+                                                                notify_fd_variant);
+#else
+  g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
+                                         G_DBUS_ERROR_NOT_SUPPORTED,
+                                         "Input channel not supported");
+#endif /* HAVE_NATIVE_BACKEND */
+
+  return TRUE;
+}
+
 static MetaSelectionSourceRemote *
 create_remote_desktop_source (MetaRemoteDesktopSession  *session,
                               GVariant                  *mime_types_variant,
@@ -1656,6 +1827,7 @@ meta_remote_desktop_session_init_iface (MetaDBusRemoteDesktopSessionIface *iface
   iface->handle_notify_touch_down = handle_notify_touch_down;
   iface->handle_notify_touch_motion = handle_notify_touch_motion;
   iface->handle_notify_touch_up = handle_notify_touch_up;
+  iface->handle_open_input_channel = handle_open_input_channel;
   iface->handle_enable_clipboard = handle_enable_clipboard;
   iface->handle_disable_clipboard = handle_disable_clipboard;
   iface->handle_set_selection = handle_set_selection;
@@ -245,16 +245,21 @@ meta_renderer_add_view (MetaRenderer     *renderer,
                         MetaRendererView *view)
 {
   MetaRendererPrivate *priv = meta_renderer_get_instance_private (renderer);
+  MetaSettings *settings = meta_backend_get_settings (priv->backend);
+  ClutterFrameClock *frame_clock =
+    clutter_stage_view_get_frame_clock (CLUTTER_STAGE_VIEW (view));
 
   priv->views = g_list_append (priv->views, view);
 
-  if (priv->is_paused)
+  if (meta_settings_is_experimental_feature_enabled (
+        settings, META_EXPERIMENTAL_FEATURE_HISTOGRAM_FRAME_SCHEDULER))
     {
-      ClutterFrameClock *frame_clock =
-        clutter_stage_view_get_frame_clock (CLUTTER_STAGE_VIEW (view));
-
-      clutter_frame_clock_inhibit (frame_clock);
+      clutter_frame_clock_set_scheduler (frame_clock,
+                                         CLUTTER_FRAME_CLOCK_SCHEDULER_HISTOGRAM);
     }
+
+  if (priv->is_paused)
+    clutter_frame_clock_inhibit (frame_clock);
 }
 
 /**
@@ -240,6 +240,13 @@ before_stage_painted (MetaStage           *stage,
   MetaScreenCastAreaStreamSrc *area_src =
     META_SCREEN_CAST_AREA_STREAM_SRC (user_data);
   MetaScreenCastStreamSrc *src = META_SCREEN_CAST_STREAM_SRC (area_src);
+  MetaScreenCastStream *stream = meta_screen_cast_stream_src_get_stream (src);
+  MetaScreenCastAreaStream *area_stream = META_SCREEN_CAST_AREA_STREAM (stream);
+
+  meta_screen_cast_stream_src_add_view_damage (
+    src, view,
+    meta_screen_cast_area_stream_get_area (area_stream),
+    meta_screen_cast_area_stream_get_scale (area_stream));
 
   if (area_src->maybe_record_idle_id)
     return;
@@ -335,9 +342,12 @@ static void
 on_monitors_changed (MetaMonitorManager          *monitor_manager,
                      MetaScreenCastAreaStreamSrc *area_src)
 {
+  MetaScreenCastStreamSrc *src = META_SCREEN_CAST_STREAM_SRC (area_src);
   MetaStage *stage = META_STAGE (get_stage (area_src));
   GList *l;
 
+  meta_screen_cast_stream_src_add_damage (src, NULL);
+
   for (l = area_src->watches; l; l = l->next)
     meta_stage_remove_watch (stage, l->data);
   g_clear_pointer (&area_src->watches, g_list_free);
@@ -645,6 +655,8 @@ meta_screen_cast_area_stream_src_class_init (MetaScreenCastAreaStreamSrcClass *k
     meta_screen_cast_area_stream_src_record_to_buffer;
   src_class->record_to_framebuffer =
     meta_screen_cast_area_stream_src_record_to_framebuffer;
+  src_class->record_for_readback =
+    meta_screen_cast_area_stream_src_record_to_framebuffer;
   src_class->record_follow_up =
     meta_screen_cast_area_stream_record_follow_up;
   src_class->set_cursor_metadata =
@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) 2022 Red Hat
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Paints the content of a monitor into an offscreen framebuffer at most once
+ * per stage frame, so that all monitor streams recording the same monitor
+ * with the same paint flags can scale and convert from it instead of each
+ * painting the stage again. Streams reading the capture back into memory
+ * share a single read back of it too.
+ */
+
+#include "config.h"
+
+#include "backends/meta-screen-cast-monitor-capture.h"
+
+#include <string.h>
+
+#include "backends/meta-backend-private.h"
+#include "backends/meta-framebuffer-readback.h"
+#include "backends/meta-logical-monitor.h"
+#include "core/util-private.h"
+
+struct _MetaScreenCastMonitorCapture
+{
+  GObject parent;
+
+  MetaScreenCast *screen_cast;
+  MetaMonitor *monitor;
+  ClutterPaintFlag paint_flags;
+
+  CoglFramebuffer *framebuffer;
+  gboolean is_valid;
+
+  /* The part of the capture read back into read_back_data since it was last
+   * painted */
+  uint8_t *read_back_data;
+  int read_back_stride;
+  cairo_region_t *read_back_region;
+};
+
+G_DEFINE_TYPE (MetaScreenCastMonitorCapture,
+               meta_screen_cast_monitor_capture,
+               G_TYPE_OBJECT)
+
+MetaMonitor *
+meta_screen_cast_monitor_capture_get_monitor (MetaScreenCastMonitorCapture *capture)
+{
+  return capture->monitor;
+}
+
+ClutterPaintFlag
+meta_screen_cast_monitor_capture_get_paint_flags (MetaScreenCastMonitorCapture *capture)
+{
+  return capture->paint_flags;
+}
+
+static void
+clear_read_back (MetaScreenCastMonitorCapture *capture)
+{
+  g_clear_pointer (&capture->read_back_region, cairo_region_destroy);
+}
+
+void
+meta_screen_cast_monitor_capture_invalidate (MetaScreenCastMonitorCapture *capture)
+{
+  capture->is_valid = FALSE;
+  clear_read_back (capture);
+}
+
+static float
+get_scale (MetaScreenCastMonitorCapture *capture)
+{
+  MetaLogicalMonitor *logical_monitor;
+
+  if (!meta_is_stage_views_scaled ())
+    return 1.0;
+
+  logical_monitor = meta_monitor_get_logical_monitor (capture->monitor);
+  return meta_logical_monitor_get_scale (logical_monitor);
+}
+
+static CoglFramebuffer *
+ensure_framebuffer (MetaScreenCastMonitorCapture  *capture,
+                    int                            width,
+                    int                            height,
+                    GError                       **error)
+{
+  CoglContext *cogl_context =
+    clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  CoglTexture2D *texture;
+  CoglOffscreen *offscreen;
+
+  if (capture->framebuffer &&
+      cogl_framebuffer_get_width (capture->framebuffer) == width &&
+      cogl_framebuffer_get_height (capture->framebuffer) == height)
+    return capture->framebuffer;
+
+  g_clear_object (&capture->framebuffer);
+  capture->is_valid = FALSE;
+  clear_read_back (capture);
+  g_clear_pointer (&capture->read_back_data, g_free);
+
+  texture = cogl_texture_2d_new_with_size (cogl_context, width, height);
+  if (!texture)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                   "Failed to create %dx%d texture", width, height);
+      return NULL;
+    }
+
+  offscreen = cogl_offscreen_new_with_texture (COGL_TEXTURE (texture));
+  cogl_object_unref (texture);
+
+  if (!cogl_framebuffer_allocate (COGL_FRAMEBUFFER (offscreen), error))
+    {
+      g_object_unref (offscreen);
+      return NULL;
+    }
+
+  capture->framebuffer = COGL_FRAMEBUFFER (offscreen);
+  return capture->framebuffer;
+}
+
+/*
+ * Returns an offscreen framebuffer with the current content of the monitor,
+ * at the size of the monitor in physical pixels. The stage is only painted if
+ * it changed since the last time.
+ */
+CoglFramebuffer *
+meta_screen_cast_monitor_capture_record (MetaScreenCastMonitorCapture  *capture,
+                                         GError                       **error)
+{
+  MetaBackend *backend = meta_screen_cast_get_backend (capture->screen_cast);
+  ClutterStage *stage = CLUTTER_STAGE (meta_backend_get_stage (backend));
+  MetaLogicalMonitor *logical_monitor;
+  CoglFramebuffer *framebuffer;
+  gboolean did_paint = FALSE;
+  float scale;
+  int width, height;
+
+  logical_monitor = meta_monitor_get_logical_monitor (capture->monitor);
+  scale = get_scale (capture);
+  width = (int) roundf (logical_monitor->rect.width * scale);
+  height = (int) roundf (logical_monitor->rect.height * scale);
+
+  framebuffer = ensure_framebuffer (capture, width, height, error);
+  if (!framebuffer)
+    return NULL;
+
+  if (!capture->is_valid)
+    {
+      clutter_stage_paint_to_framebuffer (stage, framebuffer,
+                                          &logical_monitor->rect,
+                                          scale,
+                                          capture->paint_flags);
+      cogl_framebuffer_flush (framebuffer);
+
+      capture->is_valid = TRUE;
+      did_paint = TRUE;
+
+      meta_topic (META_DEBUG_SCREEN_CAST,
+                  "Captured monitor %s",
+                  meta_monitor_get_connector (capture->monitor));
+    }
+
+  meta_screen_cast_add_monitor_capture_stats (capture->screen_cast,
+                                              did_paint ? 1 : 0, 0, 1);
+
+  return framebuffer;
+}
+
+static gboolean
+read_back_region (MetaScreenCastMonitorCapture  *capture,
+                  CoglFramebuffer               *framebuffer,
+                  const cairo_region_t          *region,
+                  GError                       **error)
+{
+  MetaFramebufferReadback *readback;
+  gboolean retval;
+
+  readback = meta_framebuffer_readback_new (framebuffer,
+                                            CLUTTER_CAIRO_FORMAT_ARGB32);
+  retval = meta_framebuffer_readback_read_region (readback, region,
+                                                  capture->read_back_data,
+                                                  capture->read_back_stride);
+  meta_framebuffer_readback_free (readback);
+
+  if (!retval)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                   "Failed to read back monitor capture");
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/*
+ * Records the monitor like meta_screen_cast_monitor_capture_record(), and
+ * copies @region of it into @data. Only the part of @region not yet read back
+ * since the capture was last painted is read from the GPU; the rest is copied
+ * from what earlier calls read back.
+ */
+gboolean
+meta_screen_cast_monitor_capture_read_back (MetaScreenCastMonitorCapture  *capture,
+                                            const cairo_region_t          *region,
+                                            int                            stride,
+                                            uint8_t                       *data,
+                                            GError                       **error)
+{
+  CoglFramebuffer *framebuffer;
+  cairo_rectangle_int_t capture_rect;
+  cairo_region_t *copy_region;
+  cairo_region_t *missing_region;
+  gboolean did_read_back = FALSE;
+  int n_rects, i;
+
+  framebuffer = meta_screen_cast_monitor_capture_record (capture, error);
+  if (!framebuffer)
+    return FALSE;
+
+  capture_rect = (cairo_rectangle_int_t) {
+    .width = cogl_framebuffer_get_width (framebuffer),
+    .height = cogl_framebuffer_get_height (framebuffer),
+  };
+
+  if (!capture->read_back_data)
+    {
+      capture->read_back_stride = capture_rect.width * 4;
+      capture->read_back_data =
+        g_malloc (capture->read_back_stride * capture_rect.height);
+    }
+  if (!capture->read_back_region)
+    capture->read_back_region = cairo_region_create ();
+
+  copy_region = cairo_region_copy (region);
+  cairo_region_intersect_rectangle (copy_region, &capture_rect);
+
+  missing_region = cairo_region_copy (copy_region);
+  cairo_region_subtract (missing_region, capture->read_back_region);
+  if (!cairo_region_is_empty (missing_region))
+    {
+      if (!read_back_region (capture, framebuffer, missing_region, error))
+        {
+          cairo_region_destroy (missing_region);
+          cairo_region_destroy (copy_region);
+          return FALSE;
+        }
+
+      cairo_region_union (capture->read_back_region, missing_region);
+      did_read_back = TRUE;
+    }
+  cairo_region_destroy (missing_region);
+
+  n_rects = cairo_region_num_rectangles (copy_region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      int y;
+
+      cairo_region_get_rectangle (copy_region, i, &rect);
+
+      for (y = rect.y; y < rect.y + rect.height; y++)
+        {
+          memcpy (data + y * stride + rect.x * 4,
+                  (capture->read_back_data +
+                   y * capture->read_back_stride + rect.x * 4),
+                  rect.width * 4);
+        }
+    }
+  cairo_region_destroy (copy_region);
+
+  meta_screen_cast_add_monitor_capture_stats (capture->screen_cast,
+                                              0, did_read_back ? 1 : 0, 0);
+
+  return TRUE;
+}
+
+MetaScreenCastMonitorCapture *
+meta_screen_cast_monitor_capture_new (MetaScreenCast   *screen_cast,
+                                      MetaMonitor      *monitor,
+                                      ClutterPaintFlag  paint_flags)
+{
+  MetaScreenCastMonitorCapture *capture;
+
+  capture = g_object_new (META_TYPE_SCREEN_CAST_MONITOR_CAPTURE, NULL);
+  capture->screen_cast = screen_cast;
+  capture->monitor = g_object_ref (monitor);
+  capture->paint_flags = paint_flags;
+
+  return capture;
+}
+
+static void
+meta_screen_cast_monitor_capture_finalize (GObject *object)
+{
+  MetaScreenCastMonitorCapture *capture =
+    META_SCREEN_CAST_MONITOR_CAPTURE (object);
+
+  clear_read_back (capture);
+  g_clear_pointer (&capture->read_back_data, g_free);
+  g_clear_object (&capture->framebuffer);
+  g_clear_object (&capture->monitor);
+
+  G_OBJECT_CLASS (meta_screen_cast_monitor_capture_parent_class)->finalize (object);
+}
+
+static void
+meta_screen_cast_monitor_capture_init (MetaScreenCastMonitorCapture *capture)
+{
+}
+
+static void
+meta_screen_cast_monitor_capture_class_init (MetaScreenCastMonitorCaptureClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = meta_screen_cast_monitor_capture_finalize;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2022 Red Hat
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef META_SCREEN_CAST_MONITOR_CAPTURE_H
+#define META_SCREEN_CAST_MONITOR_CAPTURE_H
+
+#include <glib-object.h>
+
+#include "backends/meta-monitor.h"
+#include "backends/meta-screen-cast.h"
+#include "clutter/clutter.h"
+#include "cogl/cogl.h"
+
+#define META_TYPE_SCREEN_CAST_MONITOR_CAPTURE (meta_screen_cast_monitor_capture_get_type ())
+G_DECLARE_FINAL_TYPE (MetaScreenCastMonitorCapture,
+                      meta_screen_cast_monitor_capture,
+                      META, SCREEN_CAST_MONITOR_CAPTURE,
+                      GObject)
+
+MetaMonitor * meta_screen_cast_monitor_capture_get_monitor (MetaScreenCastMonitorCapture *capture);
+
+ClutterPaintFlag meta_screen_cast_monitor_capture_get_paint_flags (MetaScreenCastMonitorCapture *capture);
+
+void meta_screen_cast_monitor_capture_invalidate (MetaScreenCastMonitorCapture *capture);
+
+CoglFramebuffer * meta_screen_cast_monitor_capture_record (MetaScreenCastMonitorCapture  *capture,
+                                                          GError                       **error);
+
+gboolean meta_screen_cast_monitor_capture_read_back (MetaScreenCastMonitorCapture  *capture,
+                                                     const cairo_region_t          *region,
+                                                     int                            stride,
+                                                     uint8_t                       *data,
+                                                     GError                       **error);
+
+MetaScreenCastMonitorCapture * meta_screen_cast_monitor_capture_new (MetaScreenCast   *screen_cast,
+                                                                     MetaMonitor      *monitor,
+                                                                     ClutterPaintFlag  paint_flags);
+
+#endif /* META_SCREEN_CAST_MONITOR_CAPTURE_H */
@@ -30,6 +30,7 @@
 #include "backends/meta-cursor-tracker-private.h"
 #include "backends/meta-logical-monitor.h"
 #include "backends/meta-monitor.h"
+#include "backends/meta-screen-cast-monitor-capture.h"
 #include "backends/meta-screen-cast-monitor-stream.h"
 #include "backends/meta-screen-cast-session.h"
 #include "backends/meta-stage-private.h"
@@ -46,6 +47,8 @@ struct _MetaScreenCastMonitorStreamSrc
 
   GList *watches;
 
+  MetaScreenCastMonitorCapture *capture;
+
   gulong position_invalidated_handler_id;
   gulong cursor_changed_handler_id;
 
@@ -89,6 +92,18 @@ get_monitor (MetaScreenCastMonitorStreamSrc *monitor_src)
   return meta_screen_cast_monitor_stream_get_monitor (monitor_stream);
 }
 
+static float
+get_stream_scale (MetaScreenCastMonitorStreamSrc *monitor_src)
+{
+  MetaLogicalMonitor *logical_monitor;
+
+  if (!meta_is_stage_views_scaled ())
+    return 1.0;
+
+  logical_monitor = meta_monitor_get_logical_monitor (get_monitor (monitor_src));
+  return meta_logical_monitor_get_scale (logical_monitor);
+}
+
 static gboolean
 meta_screen_cast_monitor_stream_src_get_specs (MetaScreenCastStreamSrc *src,
                                                int                     *width,
@@ -162,8 +177,17 @@ before_stage_painted (MetaStage           *stage,
   MetaScreenCastMonitorStreamSrc *monitor_src =
     META_SCREEN_CAST_MONITOR_STREAM_SRC (user_data);
   MetaScreenCastStreamSrc *src = META_SCREEN_CAST_STREAM_SRC (monitor_src);
+  MetaLogicalMonitor *logical_monitor;
   MetaScreenCastRecordFlag flags;
 
+  if (monitor_src->capture)
+    meta_screen_cast_monitor_capture_invalidate (monitor_src->capture);
+
+  logical_monitor = meta_monitor_get_logical_monitor (get_monitor (monitor_src));
+  meta_screen_cast_stream_src_add_view_damage (src, view,
+                                               &logical_monitor->rect,
+                                               get_stream_scale (monitor_src));
+
   if (monitor_src->maybe_record_idle_id)
     return;
 
@@ -390,6 +414,12 @@ static void
 on_monitors_changed (MetaMonitorManager             *monitor_manager,
                      MetaScreenCastMonitorStreamSrc *monitor_src)
 {
+  MetaScreenCastStreamSrc *src = META_SCREEN_CAST_STREAM_SRC (monitor_src);
+
+  if (monitor_src->capture)
+    meta_screen_cast_monitor_capture_invalidate (monitor_src->capture);
+
+  meta_screen_cast_stream_src_add_damage (src, NULL);
   reattach_watches (monitor_src);
 }
 
@@ -468,6 +498,8 @@ meta_screen_cast_monitor_stream_src_disable (MetaScreenCastStreamSrc *src)
 
   g_clear_handle_id (&monitor_src->maybe_record_idle_id, g_source_remove);
 
+  g_clear_object (&monitor_src->capture);
+
   switch (meta_screen_cast_stream_get_cursor_mode (stream))
     {
     case META_SCREEN_CAST_CURSOR_MODE_METADATA:
@@ -479,32 +511,13 @@ meta_screen_cast_monitor_stream_src_disable (MetaScreenCastStreamSrc *src)
     }
 }
 
-static gboolean
-meta_screen_cast_monitor_stream_src_record_to_buffer (MetaScreenCastStreamSrc  *src,
-                                                      int                       width,
-                                                      int                       height,
-                                                      int                       stride,
-                                                      uint8_t                  *data,
-                                                      GError                  **error)
+static ClutterPaintFlag
+get_paint_flags (MetaScreenCastMonitorStreamSrc *monitor_src)
 {
-  MetaScreenCastMonitorStreamSrc *monitor_src =
-    META_SCREEN_CAST_MONITOR_STREAM_SRC (src);
+  MetaScreenCastStreamSrc *src = META_SCREEN_CAST_STREAM_SRC (monitor_src);
   MetaScreenCastStream *stream = meta_screen_cast_stream_src_get_stream (src);
-  ClutterStage *stage;
-  MetaMonitor *monitor;
-  MetaLogicalMonitor *logical_monitor;
-  float scale;
   ClutterPaintFlag paint_flags = CLUTTER_PAINT_FLAG_CLEAR;
 
-  monitor = get_monitor (monitor_src);
-  logical_monitor = meta_monitor_get_logical_monitor (monitor);
-  stage = get_stage (monitor_src);
-
-  if (meta_is_stage_views_scaled ())
-    scale = meta_logical_monitor_get_scale (logical_monitor);
-  else
-    scale = 1.0;
-
   switch (meta_screen_cast_stream_get_cursor_mode (stream))
     {
     case META_SCREEN_CAST_CURSOR_MODE_METADATA:
@@ -516,15 +529,75 @@ meta_screen_cast_monitor_stream_src_record_to_buffer (MetaScreenCastStreamSrc  *
       break;
     }
 
-  if (!clutter_stage_paint_to_buffer (stage, &logical_monitor->rect, scale,
-                                      data,
-                                      stride,
-                                      CLUTTER_CAIRO_FORMAT_ARGB32,
-                                      paint_flags,
-                                      error))
-    return FALSE;
+  return paint_flags;
+}
 
-  return TRUE;
+static MetaScreenCastMonitorCapture *
+ensure_capture (MetaScreenCastMonitorStreamSrc *monitor_src)
+{
+  MetaScreenCastStreamSrc *src = META_SCREEN_CAST_STREAM_SRC (monitor_src);
+  MetaScreenCastStream *stream = meta_screen_cast_stream_src_get_stream (src);
+  MetaScreenCastSession *session = meta_screen_cast_stream_get_session (stream);
+  MetaScreenCast *screen_cast =
+    meta_screen_cast_session_get_screen_cast (session);
+
+  if (!monitor_src->capture)
+    {
+      monitor_src->capture =
+        meta_screen_cast_ensure_monitor_capture (screen_cast,
+                                                 get_monitor (monitor_src),
+                                                 get_paint_flags (monitor_src));
+    }
+
+  return monitor_src->capture;
+}
+
+static gboolean
+read_back_capture (MetaScreenCastMonitorStreamSrc  *monitor_src,
+                   const cairo_region_t            *region,
+                   int                              stride,
+                   uint8_t                         *data,
+                   GError                         **error)
+{
+  return meta_screen_cast_monitor_capture_read_back (ensure_capture (monitor_src),
+                                                     region, stride, data,
+                                                     error);
+}
+
+static gboolean
+meta_screen_cast_monitor_stream_src_record_to_buffer (MetaScreenCastStreamSrc  *src,
+                                                      int                       width,
+                                                      int                       height,
+                                                      int                       stride,
+                                                      uint8_t                  *data,
+                                                      GError                  **error)
+{
+  MetaScreenCastMonitorStreamSrc *monitor_src =
+    META_SCREEN_CAST_MONITOR_STREAM_SRC (src);
+  cairo_rectangle_int_t rect = { .width = width, .height = height };
+  cairo_region_t *region;
+  gboolean retval;
+
+  region = cairo_region_create_rectangle (&rect);
+  retval = read_back_capture (monitor_src, region, stride, data, error);
+  cairo_region_destroy (region);
+
+  return retval;
+}
+
+static gboolean
+meta_screen_cast_monitor_stream_src_record_region_to_buffer (MetaScreenCastStreamSrc  *src,
+                                                             const cairo_region_t     *region,
+                                                             int                       width,
+                                                             int                       height,
+                                                             int                       stride,
+                                                             uint8_t                  *data,
+                                                             GError                  **error)
+{
+  MetaScreenCastMonitorStreamSrc *monitor_src =
+    META_SCREEN_CAST_MONITOR_STREAM_SRC (src);
+
+  return read_back_capture (monitor_src, region, stride, data, error);
 }
 
 static gboolean
@@ -595,6 +668,22 @@ meta_screen_cast_monitor_stream_src_record_to_framebuffer (MetaScreenCastStreamS
   return TRUE;
 }
 
+static CoglTexture *
+meta_screen_cast_monitor_stream_src_record_to_texture (MetaScreenCastStreamSrc  *src,
+                                                       GError                  **error)
+{
+  MetaScreenCastMonitorStreamSrc *monitor_src =
+    META_SCREEN_CAST_MONITOR_STREAM_SRC (src);
+  CoglFramebuffer *framebuffer;
+
+  framebuffer = meta_screen_cast_monitor_capture_record (ensure_capture (monitor_src),
+                                                         error);
+  if (!framebuffer)
+    return NULL;
+
+  return cogl_offscreen_get_texture (COGL_OFFSCREEN (framebuffer));
+}
+
 static void
 meta_screen_cast_monitor_stream_record_follow_up (MetaScreenCastStreamSrc *src)
 {
@@ -759,6 +848,10 @@ meta_screen_cast_monitor_stream_src_class_init (MetaScreenCastMonitorStreamSrcCl
   src_class->disable = meta_screen_cast_monitor_stream_src_disable;
   src_class->record_to_buffer =
     meta_screen_cast_monitor_stream_src_record_to_buffer;
+  src_class->record_region_to_buffer =
+    meta_screen_cast_monitor_stream_src_record_region_to_buffer;
+  src_class->record_to_texture =
+    meta_screen_cast_monitor_stream_src_record_to_texture;
   src_class->record_to_framebuffer =
     meta_screen_cast_monitor_stream_src_record_to_framebuffer;
   src_class->record_follow_up =
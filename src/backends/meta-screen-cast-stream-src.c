@@ -26,6 +26,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <math.h>
 #include <pipewire/pipewire.h>
 #include <spa/param/props.h>
 #include <spa/param/format-utils.h>
@@ -38,9 +39,11 @@
 #include <drm_fourcc.h>
 #endif
 
+#include "backends/meta-framebuffer-readback.h"
 #include "backends/meta-screen-cast-session.h"
 #include "backends/meta-screen-cast-stream.h"
 #include "clutter/clutter-mutter.h"
+#include "compositor/region-utils.h"
 #include "core/meta-fraction.h"
 #include "meta/boxes.h"
 
@@ -51,6 +54,12 @@
   (sizeof (struct spa_meta_cursor) + \
    sizeof (struct spa_meta_bitmap) + width * height * 4)
 
+#define MAX_DAMAGE_RECTS 16
+
+#define N_READBACK_FRAMES 3
+
+#define MAX_PLANES 3
+
 #define DEFAULT_SIZE SPA_RECTANGLE (1280, 720)
 #define MIN_SIZE SPA_RECTANGLE (1, 1)
 #define MAX_SIZE SPA_RECTANGLE (16384, 16386)
@@ -84,6 +93,113 @@ typedef struct _MetaPipeWireSource
   struct pw_loop *pipewire_loop;
 } MetaPipeWireSource;
 
+typedef struct _MetaScreenCastReadbackFrame
+{
+  MetaScreenCastStreamSrc *src;
+  MetaFramebufferReadback *readback;
+
+  struct pw_buffer *buffer;
+  int64_t record_time_us;
+} MetaScreenCastReadbackFrame;
+
+/*
+ * YUV frames are converted on the GPU into a single RGBA offscreen, where each
+ * texel holds four bytes of a plane, and the planes are stacked on top of each
+ * other sharing the stride of the luma plane. That way the packed offscreen
+ * can be read back into the buffer as is.
+ */
+typedef struct _MetaScreenCastPlanePacking
+{
+  /* Size in stream pixels one texel covers */
+  int texel_width;
+  int texel_height;
+
+  /* Horizontal offsets in stream pixels from the texel center to sample the
+   * four bytes at */
+  float sample_offsets[4];
+
+  /* RGB weights and offset of the first and third, and the second and fourth
+   * bytes */
+  const float *even_coefficients;
+  const float *odd_coefficients;
+} MetaScreenCastPlanePacking;
+
+/* BT.709, limited range */
+static const float y_coefficients[] = { 0.1826, 0.6142, 0.0620, 0.0627 };
+static const float u_coefficients[] = { -0.1006, -0.3386, 0.4392, 0.5020 };
+static const float v_coefficients[] = { 0.4392, -0.3989, -0.0403, 0.5020 };
+
+static const MetaScreenCastPlanePacking luma_packing = {
+  .texel_width = 4,
+  .texel_height = 1,
+  .sample_offsets = { -1.5, -0.5, 0.5, 1.5 },
+  .even_coefficients = y_coefficients,
+  .odd_coefficients = y_coefficients,
+};
+
+/* Chroma is sampled in between 2x2 pixel blocks, letting linear filtering
+ * average them. */
+static const MetaScreenCastPlanePacking nv12_chroma_packing = {
+  .texel_width = 4,
+  .texel_height = 2,
+  .sample_offsets = { -1.0, -1.0, 1.0, 1.0 },
+  .even_coefficients = u_coefficients,
+  .odd_coefficients = v_coefficients,
+};
+
+static const MetaScreenCastPlanePacking i420_u_packing = {
+  .texel_width = 8,
+  .texel_height = 2,
+  .sample_offsets = { -3.0, -1.0, 1.0, 3.0 },
+  .even_coefficients = u_coefficients,
+  .odd_coefficients = u_coefficients,
+};
+
+static const MetaScreenCastPlanePacking i420_v_packing = {
+  .texel_width = 8,
+  .texel_height = 2,
+  .sample_offsets = { -3.0, -1.0, 1.0, 3.0 },
+  .even_coefficients = v_coefficients,
+  .odd_coefficients = v_coefficients,
+};
+
+static const MetaScreenCastPlanePacking *nv12_packings[] = {
+  &luma_packing,
+  &nv12_chroma_packing,
+  NULL,
+};
+
+static const MetaScreenCastPlanePacking *i420_packings[] = {
+  &luma_packing,
+  &i420_u_packing,
+  &i420_v_packing,
+  NULL,
+};
+
+static const char *plane_packing_glsl_declarations =
+"uniform vec4 sample_offsets;                                              \n"
+"uniform vec4 even_coefficients;                                           \n"
+"uniform vec4 odd_coefficients;                                            \n";
+
+static const char *plane_packing_glsl =
+"  vec2 uv = vec2 (cogl_tex_coord.st);                                     \n"
+"                                                                          \n"
+"  vec3 rgb0 = texture2D (cogl_sampler,                                    \n"
+"                         uv + vec2 (sample_offsets.x, 0.0)).rgb;          \n"
+"  vec3 rgb1 = texture2D (cogl_sampler,                                    \n"
+"                         uv + vec2 (sample_offsets.y, 0.0)).rgb;          \n"
+"  vec3 rgb2 = texture2D (cogl_sampler,                                    \n"
+"                         uv + vec2 (sample_offsets.z, 0.0)).rgb;          \n"
+"  vec3 rgb3 = texture2D (cogl_sampler,                                    \n"
+"                         uv + vec2 (sample_offsets.w, 0.0)).rgb;          \n"
+"                                                                          \n"
+"  cogl_texel = vec4 (dot (rgb0, even_coefficients.rgb),                   \n"
+"                     dot (rgb1, odd_coefficients.rgb),                    \n"
+"                     dot (rgb2, even_coefficients.rgb),                   \n"
+"                     dot (rgb3, odd_coefficients.rgb)) +                  \n"
+"               vec4 (even_coefficients.a, odd_coefficients.a,             \n"
+"                     even_coefficients.a, odd_coefficients.a);            \n";
+
 typedef struct _MetaScreenCastStreamSrcPrivate
 {
   MetaScreenCastStream *stream;
@@ -102,10 +218,34 @@ typedef struct _MetaScreenCastStreamSrcPrivate
 
   struct spa_video_info_raw video_format;
   int video_stride;
-
-  int64_t last_frame_timestamp_us;
+  int n_planes;
+
+  /* Frames and cursor-only updates are each sent on their own tick grid,
+   * spaced by the negotiated frame rate. Updates arriving before the next
+   * tick are coalesced into it. */
+  int64_t next_frame_time_us;
+  int64_t next_cursor_time_us;
+  gboolean frame_pending;
+  gboolean cursor_update_pending;
+  unsigned int n_coalesced_updates;
   guint follow_up_frame_source_id;
 
+  /* Damage since the last recorded frame, in stream coordinates; NULL when
+   * the whole frame is damaged. */
+  cairo_region_t *damage;
+
+  /* Each buffer's user_data holds the region it is out of date in, or NULL
+   * if its content is unknown. */
+  GList *buffers;
+
+  CoglFramebuffer *readback_framebuffer;
+  MetaScreenCastReadbackFrame readback_frames[N_READBACK_FRAMES];
+
+  CoglFramebuffer *source_framebuffer;
+  CoglPipeline *scale_pipeline;
+  CoglFramebuffer *packed_framebuffer;
+  CoglPipeline *plane_pipelines[MAX_PLANES];
+
   GHashTable *dmabuf_handles;
 } MetaScreenCastStreamSrcPrivate;
 
@@ -213,6 +353,23 @@ meta_screen_cast_stream_src_record_to_buffer (MetaScreenCastStreamSrc  *src,
   return klass->record_to_buffer (src, width, height, stride, data, error);
 }
 
+static gboolean
+meta_screen_cast_stream_src_record_region_to_buffer (MetaScreenCastStreamSrc  *src,
+                                                     const cairo_region_t     *region,
+                                                     int                       width,
+                                                     int                       height,
+                                                     int                       stride,
+                                                     uint8_t                  *data,
+                                                     GError                  **error)
+{
+  MetaScreenCastStreamSrcClass *klass =
+    META_SCREEN_CAST_STREAM_SRC_GET_CLASS (src);
+
+  return klass->record_region_to_buffer (src, region,
+                                         width, height, stride, data,
+                                         error);
+}
+
 static gboolean
 meta_screen_cast_stream_src_record_to_framebuffer (MetaScreenCastStreamSrc  *src,
                                                    CoglFramebuffer          *framebuffer,
@@ -224,6 +381,17 @@ meta_screen_cast_stream_src_record_to_framebuffer (MetaScreenCastStreamSrc  *src
   return klass->record_to_framebuffer (src, framebuffer, error);
 }
 
+static gboolean
+meta_screen_cast_stream_src_record_for_readback (MetaScreenCastStreamSrc  *src,
+                                                 CoglFramebuffer          *framebuffer,
+                                                 GError                  **error)
+{
+  MetaScreenCastStreamSrcClass *klass =
+    META_SCREEN_CAST_STREAM_SRC_GET_CLASS (src);
+
+  return klass->record_for_readback (src, framebuffer, error);
+}
+
 static void
 meta_screen_cast_stream_src_record_follow_up (MetaScreenCastStreamSrc *src)
 {
@@ -244,6 +412,143 @@ meta_screen_cast_stream_src_set_cursor_metadata (MetaScreenCastStreamSrc *src,
     klass->set_cursor_metadata (src, spa_meta_cursor);
 }
 
+static const MetaScreenCastPlanePacking **
+get_plane_packings (MetaScreenCastStreamSrc *src)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+
+  switch (priv->video_format.format)
+    {
+    case SPA_VIDEO_FORMAT_NV12:
+      return nv12_packings;
+    case SPA_VIDEO_FORMAT_I420:
+      return i420_packings;
+    default:
+      return NULL;
+    }
+}
+
+static gboolean
+is_packed_format (MetaScreenCastStreamSrc *src)
+{
+  return !!get_plane_packings (src);
+}
+
+static int
+get_n_planes (MetaScreenCastStreamSrc *src)
+{
+  const MetaScreenCastPlanePacking **packings;
+  int n_planes = 0;
+
+  packings = get_plane_packings (src);
+  if (!packings)
+    return 1;
+
+  while (packings[n_planes])
+    n_planes++;
+
+  return n_planes;
+}
+
+/*
+ * Returns the rectangle, in texels, @plane occupies in the packed offscreen.
+ */
+static void
+get_packed_plane_rect (MetaScreenCastStreamSrc *src,
+                       int                      plane,
+                       cairo_rectangle_int_t   *rect)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  const MetaScreenCastPlanePacking **packings = get_plane_packings (src);
+  int width = priv->video_format.size.width;
+  int height = priv->video_format.size.height;
+  int i;
+
+  *rect = (cairo_rectangle_int_t) { 0 };
+
+  for (i = 0; i <= plane; i++)
+    {
+      const MetaScreenCastPlanePacking *packing = packings[i];
+
+      rect->y += rect->height;
+      rect->width = (width + packing->texel_width - 1) / packing->texel_width;
+      rect->height =
+        (height + packing->texel_height - 1) / packing->texel_height;
+    }
+}
+
+static void
+get_source_size (MetaScreenCastStreamSrc *src,
+                 int                     *width,
+                 int                     *height)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  float frame_rate;
+
+  if (!meta_screen_cast_stream_src_get_specs (src, width, height, &frame_rate))
+    {
+      *width = priv->video_format.size.width;
+      *height = priv->video_format.size.height;
+    }
+}
+
+static gboolean
+is_scaled (MetaScreenCastStreamSrc *src)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  int source_width, source_height;
+
+  get_source_size (src, &source_width, &source_height);
+
+  return (source_width != (int) priv->video_format.size.width ||
+          source_height != (int) priv->video_format.size.height);
+}
+
+static gboolean
+needs_conversion (MetaScreenCastStreamSrc *src)
+{
+  return is_packed_format (src) || is_scaled (src);
+}
+
+/*
+ * Sources record and report rectangles in their own size, which differs from
+ * the stream size when the consumer negotiated a smaller one.
+ */
+static void
+source_rect_to_stream (MetaScreenCastStreamSrc *src,
+                       MetaRectangle           *rect)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  int source_width, source_height;
+  double scale_x, scale_y;
+  int x1, y1, x2, y2;
+
+  get_source_size (src, &source_width, &source_height);
+  if (source_width == (int) priv->video_format.size.width &&
+      source_height == (int) priv->video_format.size.height)
+    return;
+
+  scale_x = (double) priv->video_format.size.width / source_width;
+  scale_y = (double) priv->video_format.size.height / source_height;
+
+  x1 = (int) floor (rect->x * scale_x);
+  y1 = (int) floor (rect->y * scale_y);
+  x2 = (int) ceil ((rect->x + rect->width) * scale_x);
+  y2 = (int) ceil ((rect->y + rect->height) * scale_y);
+
+  *rect = (MetaRectangle) {
+    .x = x1,
+    .y = y1,
+    .width = x2 - x1,
+    .height = y2 - y1,
+  };
+}
+
 static gboolean
 draw_cursor_sprite_via_offscreen (MetaScreenCastStreamSrc  *src,
                                   CoglTexture              *cursor_texture,
@@ -464,8 +769,22 @@ add_cursor_metadata (MetaScreenCastStreamSrc *src,
 
   spa_meta_cursor = spa_buffer_find_meta_data (spa_buffer, SPA_META_Cursor,
                                                sizeof (*spa_meta_cursor));
-  if (spa_meta_cursor)
-    meta_screen_cast_stream_src_set_cursor_metadata (src, spa_meta_cursor);
+  if (!spa_meta_cursor)
+    return;
+
+  meta_screen_cast_stream_src_set_cursor_metadata (src, spa_meta_cursor);
+
+  if (spa_meta_cursor->id != 0)
+    {
+      MetaRectangle position = {
+        .x = spa_meta_cursor->position.x,
+        .y = spa_meta_cursor->position.y,
+      };
+
+      source_rect_to_stream (src, &position);
+      spa_meta_cursor->position.x = position.x;
+      spa_meta_cursor->position.y = position.y;
+    }
 }
 
 static void
@@ -487,202 +806,1196 @@ maybe_record_cursor (MetaScreenCastStreamSrc *src,
   g_assert_not_reached ();
 }
 
-static gboolean
-do_record_frame (MetaScreenCastStreamSrc  *src,
-                 MetaScreenCastRecordFlag  flags,
-                 struct spa_buffer        *spa_buffer,
-                 uint8_t                  *data,
-                 GError                  **error)
+void
+meta_screen_cast_stream_src_add_damage (MetaScreenCastStreamSrc *src,
+                                        const cairo_region_t    *damage)
 {
   MetaScreenCastStreamSrcPrivate *priv =
     meta_screen_cast_stream_src_get_instance_private (src);
-  gboolean dmabuf_only;
 
-  dmabuf_only = flags & META_SCREEN_CAST_RECORD_FLAG_DMABUF_ONLY;
-  if (!dmabuf_only &&
-      (spa_buffer->datas[0].data ||
-       spa_buffer->datas[0].type == SPA_DATA_MemFd))
-    {
-      int width = priv->video_format.size.width;
-      int height = priv->video_format.size.height;
-      int stride = priv->video_stride;
+  if (!priv->damage)
+    return;
 
-      return meta_screen_cast_stream_src_record_to_buffer (src,
-                                                           width,
-                                                           height,
-                                                           stride,
-                                                           data,
-                                                           error);
-    }
-  else if (spa_buffer->datas[0].type == SPA_DATA_DmaBuf)
+  if (!damage)
     {
-      CoglDmaBufHandle *dmabuf_handle =
-        g_hash_table_lookup (priv->dmabuf_handles,
-                             GINT_TO_POINTER (spa_buffer->datas[0].fd));
-      CoglFramebuffer *dmabuf_fbo =
-        cogl_dma_buf_handle_get_framebuffer (dmabuf_handle);
-
-      return meta_screen_cast_stream_src_record_to_framebuffer (src,
-                                                                dmabuf_fbo,
-                                                                error);
+      g_clear_pointer (&priv->damage, cairo_region_destroy);
+      return;
     }
 
-  g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
-               "Unknown SPA buffer type %u", spa_buffer->datas[0].type);
-  return FALSE;
+  cairo_region_union (priv->damage, damage);
 }
 
-gboolean
-meta_screen_cast_stream_src_pending_follow_up_frame (MetaScreenCastStreamSrc *src)
+void
+meta_screen_cast_stream_src_add_view_damage (MetaScreenCastStreamSrc *src,
+                                             ClutterStageView        *view,
+                                             const MetaRectangle     *stage_rect,
+                                             float                    scale)
 {
   MetaScreenCastStreamSrcPrivate *priv =
     meta_screen_cast_stream_src_get_instance_private (src);
+  const cairo_region_t *redraw_clip;
+  cairo_region_t *damage;
+  cairo_rectangle_int_t stream_rect;
 
-  return priv->follow_up_frame_source_id != 0;
-}
+  if (!priv->damage)
+    return;
 
-static gboolean
-follow_up_frame_cb (gpointer user_data)
-{
-  MetaScreenCastStreamSrc *src = user_data;
-  MetaScreenCastStreamSrcPrivate *priv =
-    meta_screen_cast_stream_src_get_instance_private (src);
+  redraw_clip = clutter_stage_view_peek_redraw_clip (view);
+  if (redraw_clip)
+    {
+      damage = cairo_region_copy (redraw_clip);
+    }
+  else
+    {
+      cairo_rectangle_int_t view_layout;
 
-  priv->follow_up_frame_source_id = 0;
-  meta_screen_cast_stream_src_record_follow_up (src);
+      clutter_stage_view_get_layout (view, &view_layout);
+      damage = cairo_region_create_rectangle (&view_layout);
+    }
 
-  return G_SOURCE_REMOVE;
+  cairo_region_intersect_rectangle (damage, stage_rect);
+  cairo_region_translate (damage, -stage_rect->x, -stage_rect->y);
+
+  if (!G_APPROX_VALUE (scale, 1.0f, FLT_EPSILON))
+    {
+      cairo_region_t *scaled_damage;
+
+      scaled_damage = meta_region_scale_double (damage, scale,
+                                                META_ROUNDING_STRATEGY_GROW);
+      cairo_region_destroy (damage);
+      damage = scaled_damage;
+    }
+
+  stream_rect = (cairo_rectangle_int_t) {
+    .width = priv->video_format.size.width,
+    .height = priv->video_format.size.height,
+  };
+  cairo_region_intersect_rectangle (damage, &stream_rect);
+
+  meta_screen_cast_stream_src_add_damage (src, damage);
+  cairo_region_destroy (damage);
 }
 
-static void
-maybe_schedule_follow_up_frame (MetaScreenCastStreamSrc *src,
-                                int64_t                  timeout_us)
+/*
+ * Grows @stream_rect so that it starts and ends on whole stage pixels of
+ * @stage_area painted at @scale, and sets @out_stage_rect to the matching
+ * stage rectangle. Fractional scales can't be aligned, in which case FALSE
+ * is returned.
+ */
+gboolean
+meta_screen_cast_stream_src_stream_rect_to_stage (const MetaRectangle *stage_area,
+                                                  float                scale,
+                                                  MetaRectangle       *stream_rect,
+                                                  MetaRectangle       *out_stage_rect)
 {
-  MetaScreenCastStreamSrcPrivate *priv =
-    meta_screen_cast_stream_src_get_instance_private (src);
+  int int_scale;
+  int x1, y1, x2, y2;
 
-  if (priv->follow_up_frame_source_id)
-    return;
+  int_scale = (int) roundf (scale);
+  if (int_scale < 1 || !G_APPROX_VALUE (scale, int_scale, FLT_EPSILON))
+    return FALSE;
 
-  priv->follow_up_frame_source_id = g_timeout_add (us2ms (timeout_us),
-                                                   follow_up_frame_cb,
-                                                   src);
+  x1 = stream_rect->x / int_scale;
+  y1 = stream_rect->y / int_scale;
+  x2 = (stream_rect->x + stream_rect->width + int_scale - 1) / int_scale;
+  y2 = (stream_rect->y + stream_rect->height + int_scale - 1) / int_scale;
+
+  *out_stage_rect = (MetaRectangle) {
+    .x = stage_area->x + x1,
+    .y = stage_area->y + y1,
+    .width = x2 - x1,
+    .height = y2 - y1,
+  };
+  *stream_rect = (MetaRectangle) {
+    .x = x1 * int_scale,
+    .y = y1 * int_scale,
+    .width = (x2 - x1) * int_scale,
+    .height = (y2 - y1) * int_scale,
+  };
+
+  return TRUE;
 }
 
-void
-meta_screen_cast_stream_src_maybe_record_frame (MetaScreenCastStreamSrc  *src,
-                                                MetaScreenCastRecordFlag  flags)
+static void
+add_video_damage_metadata (MetaScreenCastStreamSrc *src,
+                           struct spa_buffer       *spa_buffer)
 {
   MetaScreenCastStreamSrcPrivate *priv =
     meta_screen_cast_stream_src_get_instance_private (src);
-  MetaRectangle crop_rect;
-  struct pw_buffer *buffer;
-  struct spa_buffer *spa_buffer;
-  uint8_t *data = NULL;
-  uint64_t now_us;
-  g_autoptr (GError) error = NULL;
-
-  now_us = g_get_monotonic_time ();
-  if (priv->video_format.max_framerate.num > 0 &&
-      priv->last_frame_timestamp_us != 0)
-    {
-      int64_t min_interval_us;
-      int64_t time_since_last_frame_us;
+  struct spa_meta *spa_meta_video_damage;
+  struct spa_meta_region *spa_meta_regions;
+  int n_max_regions;
+  int n_regions = 0;
+
+  spa_meta_video_damage = spa_buffer_find_meta (spa_buffer,
+                                                SPA_META_VideoDamage);
+  if (!spa_meta_video_damage)
+    return;
 
-      min_interval_us =
-        ((G_USEC_PER_SEC * priv->video_format.max_framerate.denom) /
-         priv->video_format.max_framerate.num);
+  spa_meta_regions = spa_meta_video_damage->data;
+  n_max_regions =
+    spa_meta_video_damage->size / sizeof (struct spa_meta_region);
+  if (n_max_regions == 0)
+    return;
 
-      time_since_last_frame_us = now_us - priv->last_frame_timestamp_us;
-      if (time_since_last_frame_us < min_interval_us)
+  if (priv->damage &&
+      cairo_region_num_rectangles (priv->damage) < n_max_regions)
+    {
+      for (; n_regions < cairo_region_num_rectangles (priv->damage);
+           n_regions++)
         {
-          int64_t timeout_us;
+          cairo_rectangle_int_t rect;
 
-          timeout_us = min_interval_us - time_since_last_frame_us;
-          maybe_schedule_follow_up_frame (src, timeout_us);
-          return;
+          cairo_region_get_rectangle (priv->damage, n_regions, &rect);
+          spa_meta_regions[n_regions].region =
+            SPA_REGION (rect.x, rect.y, rect.width, rect.height);
         }
     }
+  else if (priv->damage)
+    {
+      cairo_rectangle_int_t extents;
 
-  if (!priv->pipewire_stream)
-    return;
-
-  buffer = pw_stream_dequeue_buffer (priv->pipewire_stream);
-  if (!buffer)
+      cairo_region_get_extents (priv->damage, &extents);
+      spa_meta_regions[n_regions++].region =
+        SPA_REGION (extents.x, extents.y, extents.width, extents.height);
+    }
+  else
     {
-      meta_topic (META_DEBUG_SCREEN_CAST,
-                  "Couldn't dequeue a buffer from pipewire stream (node id %u), "
-                  "maybe your encoding is too slow?",
-                  pw_stream_get_node_id (priv->pipewire_stream));
-      return;
+      spa_meta_regions[n_regions++].region =
+        SPA_REGION (0, 0,
+                    priv->video_format.size.width,
+                    priv->video_format.size.height);
     }
 
-  spa_buffer = buffer->buffer;
-  data = spa_buffer->datas[0].data;
+  /* A zero sized region terminates the list. */
+  if (n_regions < n_max_regions)
+    spa_meta_regions[n_regions].region = SPA_REGION (0, 0, 0, 0);
+}
 
-  if (spa_buffer->datas[0].type != SPA_DATA_DmaBuf && !data)
-    {
-      g_critical ("Invalid buffer data");
-      return;
-    }
+static void
+update_buffer_damage (MetaScreenCastStreamSrc *src,
+                      struct pw_buffer        *recorded_buffer)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  GList *l;
 
-  if (!(flags & META_SCREEN_CAST_RECORD_FLAG_CURSOR_ONLY))
+  for (l = priv->buffers; l; l = l->next)
     {
-      g_clear_handle_id (&priv->follow_up_frame_source_id, g_source_remove);
-      if (do_record_frame (src, flags, spa_buffer, data, &error))
+      struct pw_buffer *buffer = l->data;
+      cairo_region_t *stale_region = buffer->user_data;
+
+      if (buffer == recorded_buffer)
+        {
+          g_clear_pointer (&stale_region, cairo_region_destroy);
+          buffer->user_data = cairo_region_create ();
+        }
+      else if (!stale_region)
         {
-          struct spa_meta_region *spa_meta_video_crop;
-
-          spa_buffer->datas[0].chunk->size = spa_buffer->datas[0].maxsize;
-          spa_buffer->datas[0].chunk->stride = priv->video_stride;
-
-          /* Update VideoCrop if needed */
-          spa_meta_video_crop =
-            spa_buffer_find_meta_data (spa_buffer, SPA_META_VideoCrop,
-                                       sizeof (*spa_meta_video_crop));
-          if (spa_meta_video_crop)
-            {
-              if (meta_screen_cast_stream_src_get_videocrop (src, &crop_rect))
-                {
-                  spa_meta_video_crop->region.position.x = crop_rect.x;
-                  spa_meta_video_crop->region.position.y = crop_rect.y;
-                  spa_meta_video_crop->region.size.width = crop_rect.width;
-                  spa_meta_video_crop->region.size.height = crop_rect.height;
-                }
-              else
-                {
-                  spa_meta_video_crop->region.position.x = 0;
-                  spa_meta_video_crop->region.position.y = 0;
-                  spa_meta_video_crop->region.size.width =
-                    priv->video_format.size.width;
-                  spa_meta_video_crop->region.size.height =
-                    priv->video_format.size.height;
-                }
-            }
+          continue;
+        }
+      else if (priv->damage)
+        {
+          cairo_region_union (stale_region, priv->damage);
         }
       else
         {
-          g_warning ("Failed to record screen cast frame: %s", error->message);
-          spa_buffer->datas[0].chunk->size = 0;
+          cairo_region_destroy (stale_region);
+          buffer->user_data = NULL;
         }
     }
-  else
-    {
-      spa_buffer->datas[0].chunk->size = 0;
-    }
 
-  maybe_record_cursor (src, spa_buffer);
-
-  priv->last_frame_timestamp_us = now_us;
+  g_clear_pointer (&priv->damage, cairo_region_destroy);
 
-  pw_stream_queue_buffer (priv->pipewire_stream, buffer);
+  /* Damage is reported by sources in their own coordinates, so don't track
+   * it when the frames are converted, but always record them fully. */
+  if (!needs_conversion (src))
+    priv->damage = cairo_region_create ();
 }
 
-gboolean
-meta_screen_cast_stream_src_is_enabled (MetaScreenCastStreamSrc *src)
+static void
+invalidate_buffer (struct pw_buffer *buffer)
 {
-  MetaScreenCastStreamSrcPrivate *priv =
-    meta_screen_cast_stream_src_get_instance_private (src);
+  g_clear_pointer ((cairo_region_t **) &buffer->user_data,
+                   cairo_region_destroy);
+}
+
+/*
+ * Returns the region @buffer has to be updated in to hold the current frame,
+ * or NULL if all of it has to be.
+ */
+static cairo_region_t *
+get_buffer_record_region (MetaScreenCastStreamSrc *src,
+                          struct pw_buffer        *buffer)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  cairo_region_t *stale_region = buffer->user_data;
+  cairo_region_t *region;
+
+  if (!stale_region || !priv->damage)
+    return NULL;
+
+  region = cairo_region_copy (stale_region);
+  cairo_region_union (region, priv->damage);
+  if (cairo_region_num_rectangles (region) > MAX_DAMAGE_RECTS)
+    {
+      cairo_rectangle_int_t extents;
+
+      cairo_region_get_extents (region, &extents);
+      cairo_region_destroy (region);
+      region = cairo_region_create_rectangle (&extents);
+    }
+
+  return region;
+}
+
+static CoglFramebuffer *
+create_offscreen (int      width,
+                  int      height,
+                  GError **error)
+{
+  CoglContext *cogl_context =
+    clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  CoglTexture2D *texture;
+  CoglOffscreen *offscreen;
+
+  texture = cogl_texture_2d_new_with_size (cogl_context, width, height);
+  if (!texture)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                   "Failed to create %dx%d texture", width, height);
+      return NULL;
+    }
+
+  offscreen = cogl_offscreen_new_with_texture (COGL_TEXTURE (texture));
+  cogl_object_unref (texture);
+
+  if (!cogl_framebuffer_allocate (COGL_FRAMEBUFFER (offscreen), error))
+    {
+      g_object_unref (offscreen);
+      return NULL;
+    }
+
+  return COGL_FRAMEBUFFER (offscreen);
+}
+
+static CoglFramebuffer *
+ensure_readback_framebuffer (MetaScreenCastStreamSrc  *src,
+                             GError                  **error)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+
+  if (!priv->readback_framebuffer)
+    {
+      priv->readback_framebuffer =
+        create_offscreen (priv->video_format.size.width,
+                          priv->video_format.size.height,
+                          error);
+    }
+
+  return priv->readback_framebuffer;
+}
+
+static CoglFramebuffer *
+ensure_source_framebuffer (MetaScreenCastStreamSrc  *src,
+                           int                       width,
+                           int                       height,
+                           GError                  **error)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+
+  if (priv->source_framebuffer &&
+      cogl_framebuffer_get_width (priv->source_framebuffer) == width &&
+      cogl_framebuffer_get_height (priv->source_framebuffer) == height)
+    return priv->source_framebuffer;
+
+  g_clear_object (&priv->source_framebuffer);
+
+  priv->source_framebuffer = create_offscreen (width, height, error);
+  return priv->source_framebuffer;
+}
+
+/*
+ * Returns a texture with the frame at the size of the source, either one the
+ * source shares between its streams, or one recorded for this stream only.
+ */
+static CoglTexture *
+record_source_texture (MetaScreenCastStreamSrc  *src,
+                       GError                  **error)
+{
+  MetaScreenCastStreamSrcClass *klass =
+    META_SCREEN_CAST_STREAM_SRC_GET_CLASS (src);
+  CoglFramebuffer *source_framebuffer;
+  int source_width, source_height;
+
+  if (klass->record_to_texture)
+    return klass->record_to_texture (src, error);
+
+  get_source_size (src, &source_width, &source_height);
+
+  source_framebuffer = ensure_source_framebuffer (src,
+                                                  source_width,
+                                                  source_height,
+                                                  error);
+  if (!source_framebuffer)
+    return NULL;
+
+  if (!meta_screen_cast_stream_src_record_for_readback (src,
+                                                        source_framebuffer,
+                                                        error))
+    return NULL;
+
+  return cogl_offscreen_get_texture (COGL_OFFSCREEN (source_framebuffer));
+}
+
+/*
+ * Records the frame at the size of the source, and draws it scaled to the
+ * size of @framebuffer.
+ */
+static gboolean
+record_scaled_to_framebuffer (MetaScreenCastStreamSrc  *src,
+                              CoglFramebuffer          *framebuffer,
+                              GError                  **error)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  CoglTexture *texture;
+  int width, height;
+
+  texture = record_source_texture (src, error);
+  if (!texture)
+    return FALSE;
+
+  if (!priv->scale_pipeline)
+    {
+      CoglContext *cogl_context = cogl_framebuffer_get_context (framebuffer);
+
+      priv->scale_pipeline = cogl_pipeline_new (cogl_context);
+      cogl_pipeline_set_layer_filters (priv->scale_pipeline, 0,
+                                       COGL_PIPELINE_FILTER_LINEAR,
+                                       COGL_PIPELINE_FILTER_LINEAR);
+      cogl_pipeline_set_layer_wrap_mode (priv->scale_pipeline, 0,
+                                         COGL_PIPELINE_WRAP_MODE_CLAMP_TO_EDGE);
+      cogl_pipeline_set_blend (priv->scale_pipeline,
+                               "RGBA = ADD (SRC_COLOR, 0)", NULL);
+    }
+
+  cogl_pipeline_set_layer_texture (priv->scale_pipeline, 0, texture);
+
+  width = cogl_framebuffer_get_width (framebuffer);
+  height = cogl_framebuffer_get_height (framebuffer);
+
+  cogl_framebuffer_set_viewport (framebuffer, 0, 0, width, height);
+  cogl_framebuffer_orthographic (framebuffer, 0, 0, width, height, 0, 1.0);
+  cogl_framebuffer_draw_textured_rectangle (framebuffer,
+                                            priv->scale_pipeline,
+                                            0, 0, width, height,
+                                            0, 0, 1, 1);
+  cogl_framebuffer_flush (framebuffer);
+
+  return TRUE;
+}
+
+static CoglPipeline *
+create_plane_pipeline (MetaScreenCastStreamSrc          *src,
+                       CoglTexture                      *texture,
+                       const MetaScreenCastPlanePacking *packing)
+{
+  static CoglPipelineKey plane_pipeline_key =
+    "meta-screen-cast-plane-pipeline-private";
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  CoglContext *cogl_context =
+    clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  CoglPipeline *plane_pipeline;
+  CoglPipeline *pipeline;
+  float sample_offsets[4];
+  int i;
+
+  plane_pipeline = cogl_context_get_named_pipeline (cogl_context,
+                                                    &plane_pipeline_key);
+  if (G_UNLIKELY (!plane_pipeline))
+    {
+      CoglSnippet *snippet;
+
+      plane_pipeline = cogl_pipeline_new (cogl_context);
+      cogl_pipeline_set_layer_null_texture (plane_pipeline, 0);
+      cogl_pipeline_set_layer_filters (plane_pipeline, 0,
+                                       COGL_PIPELINE_FILTER_LINEAR,
+                                       COGL_PIPELINE_FILTER_LINEAR);
+      cogl_pipeline_set_layer_wrap_mode (plane_pipeline, 0,
+                                         COGL_PIPELINE_WRAP_MODE_CLAMP_TO_EDGE);
+      cogl_pipeline_set_blend (plane_pipeline,
+                               "RGBA = ADD (SRC_COLOR, 0)", NULL);
+
+      snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_TEXTURE_LOOKUP,
+                                  plane_packing_glsl_declarations,
+                                  NULL);
+      cogl_snippet_set_replace (snippet, plane_packing_glsl);
+      cogl_pipeline_add_layer_snippet (plane_pipeline, 0, snippet);
+      cogl_object_unref (snippet);
+
+      cogl_context_set_named_pipeline (cogl_context, &plane_pipeline_key,
+                                       plane_pipeline);
+    }
+
+  pipeline = cogl_pipeline_copy (plane_pipeline);
+  cogl_pipeline_set_layer_texture (pipeline, 0, texture);
+
+  for (i = 0; i < 4; i++)
+    {
+      sample_offsets[i] = (packing->sample_offsets[i] /
+                           priv->video_format.size.width);
+    }
+
+  cogl_pipeline_set_uniform_float (pipeline,
+                                   cogl_pipeline_get_uniform_location (pipeline,
+                                                                       "sample_offsets"),
+                                   4, 1,
+                                   sample_offsets);
+  cogl_pipeline_set_uniform_float (pipeline,
+                                   cogl_pipeline_get_uniform_location (pipeline,
+                                                                       "even_coefficients"),
+                                   4, 1,
+                                   packing->even_coefficients);
+  cogl_pipeline_set_uniform_float (pipeline,
+                                   cogl_pipeline_get_uniform_location (pipeline,
+                                                                       "odd_coefficients"),
+                                   4, 1,
+                                   packing->odd_coefficients);
+
+  return pipeline;
+}
+
+static CoglFramebuffer *
+ensure_packed_framebuffer (MetaScreenCastStreamSrc  *src,
+                           CoglFramebuffer          *framebuffer,
+                           GError                  **error)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  const MetaScreenCastPlanePacking **packings = get_plane_packings (src);
+  CoglTexture *texture;
+  cairo_rectangle_int_t last_plane_rect;
+  int i;
+
+  if (priv->packed_framebuffer)
+    return priv->packed_framebuffer;
+
+  get_packed_plane_rect (src, priv->n_planes - 1, &last_plane_rect);
+  priv->packed_framebuffer =
+    create_offscreen (priv->video_stride / 4,
+                      last_plane_rect.y + last_plane_rect.height,
+                      error);
+  if (!priv->packed_framebuffer)
+    return NULL;
+
+  cogl_framebuffer_orthographic (priv->packed_framebuffer,
+                                 0, 0,
+                                 priv->video_stride / 4,
+                                 last_plane_rect.y + last_plane_rect.height,
+                                 0, 1.0);
+
+  texture = cogl_offscreen_get_texture (COGL_OFFSCREEN (framebuffer));
+  for (i = 0; i < priv->n_planes; i++)
+    {
+      priv->plane_pipelines[i] = create_plane_pipeline (src,
+                                                        texture,
+                                                        packings[i]);
+    }
+
+  return priv->packed_framebuffer;
+}
+
+/*
+ * Records the frame into an offscreen the stream buffers can be read back
+ * from as is, scaling it down and converting it to YUV on the GPU if needed.
+ */
+static CoglFramebuffer *
+record_frame_for_readback (MetaScreenCastStreamSrc  *src,
+                           GError                  **error)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  MetaScreenCastStreamSrcClass *klass =
+    META_SCREEN_CAST_STREAM_SRC_GET_CLASS (src);
+  const MetaScreenCastPlanePacking **packings;
+  CoglFramebuffer *framebuffer;
+  CoglFramebuffer *packed_framebuffer;
+  int i;
+
+  framebuffer = ensure_readback_framebuffer (src, error);
+  if (!framebuffer)
+    return NULL;
+
+  if (is_scaled (src) || klass->record_to_texture)
+    {
+      if (!record_scaled_to_framebuffer (src, framebuffer, error))
+        return NULL;
+    }
+  else
+    {
+      if (!meta_screen_cast_stream_src_record_for_readback (src, framebuffer,
+                                                            error))
+        return NULL;
+    }
+
+  packings = get_plane_packings (src);
+  if (!packings)
+    return framebuffer;
+
+  packed_framebuffer = ensure_packed_framebuffer (src, framebuffer, error);
+  if (!packed_framebuffer)
+    return NULL;
+
+  for (i = 0; i < priv->n_planes; i++)
+    {
+      cairo_rectangle_int_t plane_rect;
+      float s2, t2;
+
+      get_packed_plane_rect (src, i, &plane_rect);
+      s2 = ((float) plane_rect.width * packings[i]->texel_width /
+            priv->video_format.size.width);
+      t2 = ((float) plane_rect.height * packings[i]->texel_height /
+            priv->video_format.size.height);
+
+      cogl_framebuffer_draw_textured_rectangle (packed_framebuffer,
+                                                priv->plane_pipelines[i],
+                                                plane_rect.x,
+                                                plane_rect.y,
+                                                plane_rect.x + plane_rect.width,
+                                                plane_rect.y + plane_rect.height,
+                                                0, 0, s2, t2);
+    }
+  cogl_framebuffer_flush (packed_framebuffer);
+
+  return packed_framebuffer;
+}
+
+static CoglPixelFormat
+get_readback_format (MetaScreenCastStreamSrc *src)
+{
+  if (is_packed_format (src))
+    return COGL_PIXEL_FORMAT_RGBA_8888_PRE;
+  else
+    return CLUTTER_CAIRO_FORMAT_ARGB32;
+}
+
+/*
+ * Returns the region of the read back framebuffer @buffer has to be updated
+ * from, in its pixels.
+ */
+static cairo_region_t *
+get_readback_region (MetaScreenCastStreamSrc *src,
+                     struct pw_buffer        *buffer)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  cairo_region_t *region;
+
+  if (is_packed_format (src))
+    {
+      int i;
+
+      region = cairo_region_create ();
+      for (i = 0; i < priv->n_planes; i++)
+        {
+          cairo_rectangle_int_t plane_rect;
+
+          get_packed_plane_rect (src, i, &plane_rect);
+          cairo_region_union_rectangle (region, &plane_rect);
+        }
+
+      return region;
+    }
+
+  region = get_buffer_record_region (src, buffer);
+  if (!region)
+    {
+      cairo_rectangle_int_t stream_rect = {
+        .width = priv->video_format.size.width,
+        .height = priv->video_format.size.height,
+      };
+
+      region = cairo_region_create_rectangle (&stream_rect);
+    }
+
+  return region;
+}
+
+static gboolean
+record_converted_to_buffer (MetaScreenCastStreamSrc  *src,
+                            struct pw_buffer         *buffer,
+                            uint8_t                  *data,
+                            GError                  **error)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  MetaFramebufferReadback *readback;
+  CoglFramebuffer *framebuffer;
+  cairo_region_t *region;
+  gboolean retval;
+
+  framebuffer = record_frame_for_readback (src, error);
+  if (!framebuffer)
+    return FALSE;
+
+  readback = meta_framebuffer_readback_new (framebuffer,
+                                            get_readback_format (src));
+  region = get_readback_region (src, buffer);
+  retval = meta_framebuffer_readback_read_region (readback, region,
+                                                  data, priv->video_stride);
+  cairo_region_destroy (region);
+  meta_framebuffer_readback_free (readback);
+
+  if (!retval)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                   "Failed to read back converted frame");
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+do_record_frame (MetaScreenCastStreamSrc  *src,
+                 MetaScreenCastRecordFlag  flags,
+                 struct pw_buffer         *buffer,
+                 uint8_t                  *data,
+                 GError                  **error)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  MetaScreenCastStreamSrcClass *klass =
+    META_SCREEN_CAST_STREAM_SRC_GET_CLASS (src);
+  struct spa_buffer *spa_buffer = buffer->buffer;
+  gboolean dmabuf_only;
+
+  dmabuf_only = flags & META_SCREEN_CAST_RECORD_FLAG_DMABUF_ONLY;
+  if (!dmabuf_only &&
+      (spa_buffer->datas[0].data ||
+       spa_buffer->datas[0].type == SPA_DATA_MemFd))
+    {
+      int width = priv->video_format.size.width;
+      int height = priv->video_format.size.height;
+      int stride = priv->video_stride;
+      cairo_region_t *region;
+
+      if (needs_conversion (src))
+        return record_converted_to_buffer (src, buffer, data, error);
+
+      region = get_buffer_record_region (src, buffer);
+      if (region && klass->record_region_to_buffer)
+        {
+          gboolean retval;
+
+          retval = meta_screen_cast_stream_src_record_region_to_buffer (src,
+                                                                        region,
+                                                                        width,
+                                                                        height,
+                                                                        stride,
+                                                                        data,
+                                                                        error);
+          cairo_region_destroy (region);
+
+          return retval;
+        }
+      g_clear_pointer (&region, cairo_region_destroy);
+
+      return meta_screen_cast_stream_src_record_to_buffer (src,
+                                                           width,
+                                                           height,
+                                                           stride,
+                                                           data,
+                                                           error);
+    }
+  else if (spa_buffer->datas[0].type == SPA_DATA_DmaBuf)
+    {
+      CoglDmaBufHandle *dmabuf_handle =
+        g_hash_table_lookup (priv->dmabuf_handles,
+                             GINT_TO_POINTER (spa_buffer->datas[0].fd));
+      CoglFramebuffer *dmabuf_fbo =
+        cogl_dma_buf_handle_get_framebuffer (dmabuf_handle);
+
+      if (is_scaled (src))
+        return record_scaled_to_framebuffer (src, dmabuf_fbo, error);
+
+      return meta_screen_cast_stream_src_record_to_framebuffer (src,
+                                                                dmabuf_fbo,
+                                                                error);
+    }
+
+  g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+               "Unknown SPA buffer type %u", spa_buffer->datas[0].type);
+  return FALSE;
+}
+
+gboolean
+meta_screen_cast_stream_src_pending_follow_up_frame (MetaScreenCastStreamSrc *src)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+
+  return priv->frame_pending;
+}
+
+static int64_t
+get_frame_interval_us (MetaScreenCastStreamSrc *src)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+
+  if (priv->video_format.max_framerate.num <= 0)
+    return 0;
+
+  return ((G_USEC_PER_SEC * priv->video_format.max_framerate.denom) /
+          priv->video_format.max_framerate.num);
+}
+
+static void
+advance_tick (int64_t *next_time_us,
+              int64_t  interval_us,
+              int64_t  now_us)
+{
+  /* Stay on the tick grid, so that late captures don't lower the frame rate,
+   * unless the stream has been idle for longer than an interval. */
+  *next_time_us += interval_us;
+  if (*next_time_us <= now_us)
+    *next_time_us = now_us + interval_us;
+}
+
+static gboolean follow_up_frame_cb (gpointer user_data);
+
+static void
+maybe_schedule_follow_up_frame (MetaScreenCastStreamSrc *src,
+                                int64_t                  timeout_us)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+
+  if (priv->follow_up_frame_source_id)
+    return;
+
+  priv->follow_up_frame_source_id = g_timeout_add (us2ms (MAX (timeout_us, 0)),
+                                                   follow_up_frame_cb,
+                                                   src);
+}
+
+static void
+schedule_pending_updates (MetaScreenCastStreamSrc *src,
+                          int64_t                  now_us)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+
+  if (priv->frame_pending)
+    maybe_schedule_follow_up_frame (src, priv->next_frame_time_us - now_us);
+  else if (priv->cursor_update_pending)
+    maybe_schedule_follow_up_frame (src, priv->next_cursor_time_us - now_us);
+}
+
+static gboolean
+follow_up_frame_cb (gpointer user_data)
+{
+  MetaScreenCastStreamSrc *src = user_data;
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  int64_t now_us;
+
+  priv->follow_up_frame_source_id = 0;
+
+  now_us = g_get_monotonic_time ();
+  if (priv->frame_pending && now_us >= priv->next_frame_time_us)
+    {
+      /* The frame carries the cursor along. */
+      priv->frame_pending = FALSE;
+      priv->cursor_update_pending = FALSE;
+      meta_screen_cast_stream_src_record_follow_up (src);
+    }
+  else if (priv->cursor_update_pending && now_us >= priv->next_cursor_time_us)
+    {
+      meta_screen_cast_stream_src_maybe_record_frame (src,
+                                                      META_SCREEN_CAST_RECORD_FLAG_CURSOR_ONLY);
+    }
+
+  schedule_pending_updates (src, now_us);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+finish_recorded_frame (MetaScreenCastStreamSrc *src,
+                       struct pw_buffer        *buffer)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  struct spa_buffer *spa_buffer = buffer->buffer;
+  struct spa_meta_region *spa_meta_video_crop;
+  MetaRectangle crop_rect;
+
+  if (is_packed_format (src))
+    {
+      int i;
+
+      for (i = 0; i < priv->n_planes && i < (int) spa_buffer->n_datas; i++)
+        {
+          struct spa_chunk *chunk = spa_buffer->datas[i].chunk;
+          cairo_rectangle_int_t plane_rect;
+
+          get_packed_plane_rect (src, i, &plane_rect);
+          chunk->offset = plane_rect.y * priv->video_stride;
+          chunk->size = plane_rect.height * priv->video_stride;
+          chunk->stride = priv->video_stride;
+        }
+    }
+  else
+    {
+      spa_buffer->datas[0].chunk->size = spa_buffer->datas[0].maxsize;
+      spa_buffer->datas[0].chunk->stride = priv->video_stride;
+    }
+
+  /* Update VideoCrop if needed */
+  spa_meta_video_crop =
+    spa_buffer_find_meta_data (spa_buffer, SPA_META_VideoCrop,
+                               sizeof (*spa_meta_video_crop));
+  if (spa_meta_video_crop)
+    {
+      if (meta_screen_cast_stream_src_get_videocrop (src, &crop_rect))
+        {
+          source_rect_to_stream (src, &crop_rect);
+
+          spa_meta_video_crop->region.position.x = crop_rect.x;
+          spa_meta_video_crop->region.position.y = crop_rect.y;
+          spa_meta_video_crop->region.size.width = crop_rect.width;
+          spa_meta_video_crop->region.size.height = crop_rect.height;
+        }
+      else
+        {
+          spa_meta_video_crop->region.position.x = 0;
+          spa_meta_video_crop->region.position.y = 0;
+          spa_meta_video_crop->region.size.width =
+            priv->video_format.size.width;
+          spa_meta_video_crop->region.size.height =
+            priv->video_format.size.height;
+        }
+    }
+
+  add_video_damage_metadata (src, spa_buffer);
+  update_buffer_damage (src, buffer);
+}
+
+static void
+on_readback_done (MetaFramebufferReadback *readback,
+                  gpointer                 user_data)
+{
+  MetaScreenCastReadbackFrame *frame = user_data;
+  MetaScreenCastStreamSrc *src = frame->src;
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  struct pw_buffer *buffer;
+
+  buffer = g_steal_pointer (&frame->buffer);
+
+  meta_topic (META_DEBUG_SCREEN_CAST,
+              "Recorded frame with asynchronous readback, "
+              "main thread time: %" G_GINT64_FORMAT " us",
+              frame->record_time_us +
+              meta_framebuffer_readback_get_cpu_time_us (readback));
+
+  pw_stream_queue_buffer (priv->pipewire_stream, buffer);
+}
+
+static void
+cancel_readback_frame (MetaScreenCastStreamSrc     *src,
+                       MetaScreenCastReadbackFrame *frame,
+                       gboolean                     queue_buffer)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  struct pw_buffer *buffer;
+
+  if (!frame->buffer)
+    return;
+
+  meta_framebuffer_readback_cancel (frame->readback);
+
+  buffer = g_steal_pointer (&frame->buffer);
+  invalidate_buffer (buffer);
+
+  if (queue_buffer && priv->pipewire_stream)
+    {
+      buffer->buffer->datas[0].chunk->size = 0;
+      pw_stream_queue_buffer (priv->pipewire_stream, buffer);
+    }
+}
+
+static void
+cancel_readback_frames (MetaScreenCastStreamSrc *src)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  int i;
+
+  for (i = 0; i < N_READBACK_FRAMES; i++)
+    cancel_readback_frame (src, &priv->readback_frames[i], TRUE);
+}
+
+static void
+clear_readback_frames (MetaScreenCastStreamSrc *src)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  int i;
+
+  cancel_readback_frames (src);
+
+  for (i = 0; i < N_READBACK_FRAMES; i++)
+    {
+      g_clear_pointer (&priv->readback_frames[i].readback,
+                       meta_framebuffer_readback_free);
+    }
+  g_clear_object (&priv->readback_framebuffer);
+
+  for (i = 0; i < MAX_PLANES; i++)
+    g_clear_pointer (&priv->plane_pipelines[i], cogl_object_unref);
+  g_clear_object (&priv->packed_framebuffer);
+  g_clear_pointer (&priv->scale_pipeline, cogl_object_unref);
+  g_clear_object (&priv->source_framebuffer);
+}
+
+static MetaScreenCastReadbackFrame *
+find_idle_readback_frame (MetaScreenCastStreamSrc *src)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  int i;
+
+  for (i = 0; i < N_READBACK_FRAMES; i++)
+    {
+      if (!priv->readback_frames[i].buffer)
+        return &priv->readback_frames[i];
+    }
+
+  return NULL;
+}
+
+/*
+ * Renders the frame on the GPU and starts reading it back into the MemFd
+ * @buffer without waiting for it; the buffer is queued once the read back
+ * has completed. Returns FALSE if the frame has to be recorded synchronously
+ * instead.
+ */
+static gboolean
+maybe_record_frame_async (MetaScreenCastStreamSrc  *src,
+                          MetaScreenCastRecordFlag  flags,
+                          struct pw_buffer         *buffer)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  MetaScreenCastStreamSrcClass *klass =
+    META_SCREEN_CAST_STREAM_SRC_GET_CLASS (src);
+  CoglContext *cogl_context =
+    clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  struct spa_buffer *spa_buffer = buffer->buffer;
+  MetaScreenCastReadbackFrame *frame;
+  CoglFramebuffer *framebuffer;
+  cairo_region_t *region;
+  int64_t start_time_us;
+  g_autoptr (GError) error = NULL;
+
+  if (!klass->record_for_readback && !klass->record_to_texture)
+    return FALSE;
+
+  if (flags & META_SCREEN_CAST_RECORD_FLAG_DMABUF_ONLY)
+    return FALSE;
+
+  if (spa_buffer->datas[0].type != SPA_DATA_MemFd)
+    return FALSE;
+
+  if (!cogl_has_feature (cogl_context, COGL_FEATURE_ID_FENCE))
+    return FALSE;
+
+  frame = find_idle_readback_frame (src);
+  if (!frame)
+    return FALSE;
+
+  start_time_us = g_get_monotonic_time ();
+
+  framebuffer = record_frame_for_readback (src, &error);
+  if (!framebuffer)
+    {
+      g_warning ("Failed to record screen cast frame for read back: %s",
+                 error->message);
+      return FALSE;
+    }
+
+  if (!frame->readback)
+    {
+      frame->src = src;
+      frame->readback =
+        meta_framebuffer_readback_new (framebuffer,
+                                       get_readback_format (src));
+    }
+
+  region = get_readback_region (src, buffer);
+
+  if (!meta_framebuffer_readback_read_region_async (frame->readback,
+                                                    region,
+                                                    spa_buffer->datas[0].data,
+                                                    priv->video_stride,
+                                                    on_readback_done,
+                                                    frame))
+    {
+      cairo_region_destroy (region);
+      return FALSE;
+    }
+  cairo_region_destroy (region);
+
+  frame->buffer = buffer;
+
+  finish_recorded_frame (src, buffer);
+  maybe_record_cursor (src, spa_buffer);
+
+  frame->record_time_us = g_get_monotonic_time () - start_time_us;
+
+  return TRUE;
+}
+
+void
+meta_screen_cast_stream_src_maybe_record_frame (MetaScreenCastStreamSrc  *src,
+                                                MetaScreenCastRecordFlag  flags)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  struct pw_buffer *buffer;
+  struct spa_buffer *spa_buffer;
+  uint8_t *data = NULL;
+  int64_t now_us;
+  g_autoptr (GError) error = NULL;
+
+  if (!priv->pipewire_stream)
+    return;
+
+  now_us = g_get_monotonic_time ();
+  if (flags & META_SCREEN_CAST_RECORD_FLAG_CURSOR_ONLY)
+    {
+      /* A pending frame will carry the cursor along. */
+      if (priv->frame_pending)
+        return;
+
+      if (now_us < priv->next_cursor_time_us)
+        {
+          priv->cursor_update_pending = TRUE;
+          schedule_pending_updates (src, now_us);
+          return;
+        }
+    }
+  else if (now_us < priv->next_frame_time_us)
+    {
+      /* Let the damage accumulate until the next tick rather than capturing
+       * every stage frame. */
+      if (!priv->frame_pending)
+        {
+          /* Any pending cursor update is folded into the frame. */
+          g_clear_handle_id (&priv->follow_up_frame_source_id,
+                             g_source_remove);
+          priv->frame_pending = TRUE;
+        }
+      priv->n_coalesced_updates++;
+      schedule_pending_updates (src, now_us);
+      return;
+    }
+
+  /* Frames have to reach the consumer in order, so don't overtake the ones
+   * that are still being read back. */
+  if (!(flags & META_SCREEN_CAST_RECORD_FLAG_CURSOR_ONLY) &&
+      !find_idle_readback_frame (src))
+    {
+      meta_topic (META_DEBUG_SCREEN_CAST,
+                  "All frame read backs are busy, postponing frame");
+      priv->frame_pending = TRUE;
+      maybe_schedule_follow_up_frame (src, G_USEC_PER_SEC / 60);
+      return;
+    }
+
+  buffer = pw_stream_dequeue_buffer (priv->pipewire_stream);
+  if (!buffer)
+    {
+      meta_topic (META_DEBUG_SCREEN_CAST,
+                  "Couldn't dequeue a buffer from pipewire stream (node id %u), "
+                  "maybe your encoding is too slow?",
+                  pw_stream_get_node_id (priv->pipewire_stream));
+      return;
+    }
+
+  spa_buffer = buffer->buffer;
+  data = spa_buffer->datas[0].data;
+
+  if (spa_buffer->datas[0].type != SPA_DATA_DmaBuf && !data)
+    {
+      g_critical ("Invalid buffer data");
+      return;
+    }
+
+  if (!(flags & META_SCREEN_CAST_RECORD_FLAG_CURSOR_ONLY))
+    {
+      int64_t start_time_us;
+
+      meta_topic (META_DEBUG_SCREEN_CAST,
+                  "Recording frame, %u stage updates coalesced into it",
+                  priv->n_coalesced_updates);
+
+      priv->frame_pending = FALSE;
+      priv->cursor_update_pending = FALSE;
+      priv->n_coalesced_updates = 0;
+      g_clear_handle_id (&priv->follow_up_frame_source_id, g_source_remove);
+      advance_tick (&priv->next_frame_time_us, get_frame_interval_us (src),
+                    now_us);
+
+      if (maybe_record_frame_async (src, flags, buffer))
+        return;
+
+      start_time_us = g_get_monotonic_time ();
+
+      if (do_record_frame (src, flags, buffer, data, &error))
+        {
+          finish_recorded_frame (src, buffer);
+
+          meta_topic (META_DEBUG_SCREEN_CAST,
+                      "Recorded frame synchronously, "
+                      "main thread time: %" G_GINT64_FORMAT " us",
+                      g_get_monotonic_time () - start_time_us);
+        }
+      else
+        {
+          g_warning ("Failed to record screen cast frame: %s", error->message);
+          spa_buffer->datas[0].chunk->size = 0;
+          invalidate_buffer (buffer);
+        }
+    }
+  else
+    {
+      priv->cursor_update_pending = FALSE;
+      advance_tick (&priv->next_cursor_time_us, get_frame_interval_us (src),
+                    now_us);
+
+      spa_buffer->datas[0].chunk->size = 0;
+    }
+
+  maybe_record_cursor (src, spa_buffer);
+
+  pw_stream_queue_buffer (priv->pipewire_stream, buffer);
+}
+
+gboolean
+meta_screen_cast_stream_src_is_enabled (MetaScreenCastStreamSrc *src)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
 
   return priv->is_enabled;
 }
@@ -693,6 +2006,8 @@ meta_screen_cast_stream_src_enable (MetaScreenCastStreamSrc *src)
   MetaScreenCastStreamSrcPrivate *priv =
     meta_screen_cast_stream_src_get_instance_private (src);
 
+  g_clear_pointer (&priv->damage, cairo_region_destroy);
+
   META_SCREEN_CAST_STREAM_SRC_GET_CLASS (src)->enable (src);
 
   priv->is_enabled = TRUE;
@@ -707,6 +2022,9 @@ meta_screen_cast_stream_src_disable (MetaScreenCastStreamSrc *src)
   META_SCREEN_CAST_STREAM_SRC_GET_CLASS (src)->disable (src);
 
   g_clear_handle_id (&priv->follow_up_frame_source_id, g_source_remove);
+  priv->frame_pending = FALSE;
+  priv->cursor_update_pending = FALSE;
+  cancel_readback_frames (src);
 
   priv->is_enabled = FALSE;
 }
@@ -770,7 +2088,7 @@ on_stream_param_changed (void                 *data,
   uint8_t params_buffer[1024];
   int32_t width, height, stride, size;
   struct spa_pod_builder pod_builder;
-  const struct spa_pod *params[3];
+  const struct spa_pod *params[4];
   const int bpp = 4;
   int buffer_types;
 
@@ -782,10 +2100,34 @@ on_stream_param_changed (void                 *data,
 
   width = priv->video_format.size.width;
   height = priv->video_format.size.height;
-  stride = SPA_ROUND_UP_N (width * bpp, 4);
-  size = height * stride;
 
-  priv->video_stride = stride;
+  g_clear_pointer (&priv->damage, cairo_region_destroy);
+  clear_readback_frames (src);
+
+  priv->next_frame_time_us = 0;
+  priv->next_cursor_time_us = 0;
+
+  priv->n_planes = get_n_planes (src);
+
+  if (is_packed_format (src))
+    {
+      cairo_rectangle_int_t last_plane_rect;
+
+      /* All planes share the stride of the luma plane, and are placed after
+       * each other in a single memory block. */
+      stride = SPA_ROUND_UP_N (width, 4);
+      priv->video_stride = stride;
+
+      get_packed_plane_rect (src, priv->n_planes - 1, &last_plane_rect);
+      size = (last_plane_rect.y + last_plane_rect.height) * stride;
+    }
+  else
+    {
+      stride = SPA_ROUND_UP_N (width * bpp, 4);
+      priv->video_stride = stride;
+
+      size = height * stride;
+    }
 
   pod_builder = SPA_POD_BUILDER_INIT (params_buffer, sizeof (params_buffer));
 
@@ -798,7 +2140,7 @@ on_stream_param_changed (void                 *data,
     &pod_builder,
     SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
     SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int (16, 2, 16),
-    SPA_PARAM_BUFFERS_blocks, SPA_POD_Int (1),
+    SPA_PARAM_BUFFERS_blocks, SPA_POD_Int (priv->n_planes),
     SPA_PARAM_BUFFERS_size, SPA_POD_Int (size),
     SPA_PARAM_BUFFERS_stride, SPA_POD_Int (stride),
     SPA_PARAM_BUFFERS_align, SPA_POD_Int (16),
@@ -816,6 +2158,15 @@ on_stream_param_changed (void                 *data,
     SPA_PARAM_META_type, SPA_POD_Id (SPA_META_Cursor),
     SPA_PARAM_META_size, SPA_POD_Int (CURSOR_META_SIZE (384, 384)));
 
+  params[3] = spa_pod_builder_add_object (
+    &pod_builder,
+    SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta,
+    SPA_PARAM_META_type, SPA_POD_Id (SPA_META_VideoDamage),
+    SPA_PARAM_META_size, SPA_POD_CHOICE_RANGE_Int (
+      sizeof (struct spa_meta_region) * MAX_DAMAGE_RECTS,
+      sizeof (struct spa_meta_region) * 1,
+      sizeof (struct spa_meta_region) * MAX_DAMAGE_RECTS));
+
   pw_stream_update_params (priv->pipewire_stream, params, G_N_ELEMENTS (params));
 
   if (klass->notify_params_updated)
@@ -836,13 +2187,27 @@ on_stream_add_buffer (void             *data,
   CoglDmaBufHandle *dmabuf_handle;
   struct spa_buffer *spa_buffer = buffer->buffer;
   struct spa_data *spa_data = spa_buffer->datas;
-  const int bpp = 4;
-  int stride;
+  int size;
+  uint32_t i;
+
+  if (is_packed_format (src))
+    {
+      cairo_rectangle_int_t last_plane_rect;
+
+      get_packed_plane_rect (src, priv->n_planes - 1, &last_plane_rect);
+      size = ((last_plane_rect.y + last_plane_rect.height) *
+              priv->video_stride);
+    }
+  else
+    {
+      size = priv->video_stride * priv->video_format.size.height;
+    }
 
-  stride = SPA_ROUND_UP_N (priv->video_format.size.width * bpp, 4);
+  buffer->user_data = NULL;
+  priv->buffers = g_list_prepend (priv->buffers, buffer);
 
   spa_data[0].mapoffset = 0;
-  spa_data[0].maxsize = stride * priv->video_format.size.height;
+  spa_data[0].maxsize = size;
   spa_data[0].data = NULL;
 
   if (spa_data[0].type & (1 << SPA_DATA_DmaBuf))
@@ -897,7 +2262,7 @@ on_stream_add_buffer (void             *data,
           return;
         }
       spa_data[0].mapoffset = 0;
-      spa_data[0].maxsize = stride * priv->video_format.size.height;
+      spa_data[0].maxsize = size;
 
       if (ftruncate (spa_data[0].fd, spa_data[0].maxsize) < 0)
         {
@@ -924,6 +2289,18 @@ on_stream_add_buffer (void             *data,
           g_critical ("Failed to mmap memory: %m");
           return;
         }
+
+      /* Planes other than the first one refer to the same memory, at the
+       * chunk offset they are placed at. */
+      for (i = 1; i < spa_buffer->n_datas; i++)
+        {
+          spa_data[i].type = SPA_DATA_MemFd;
+          spa_data[i].flags = SPA_DATA_FLAG_READWRITE;
+          spa_data[i].fd = spa_data[0].fd;
+          spa_data[i].mapoffset = 0;
+          spa_data[i].maxsize = spa_data[0].maxsize;
+          spa_data[i].data = spa_data[0].data;
+        }
     }
 }
 
@@ -936,6 +2313,16 @@ on_stream_remove_buffer (void             *data,
     meta_screen_cast_stream_src_get_instance_private (src);
   struct spa_buffer *spa_buffer = buffer->buffer;
   struct spa_data *spa_data = spa_buffer->datas;
+  int i;
+
+  for (i = 0; i < N_READBACK_FRAMES; i++)
+    {
+      if (priv->readback_frames[i].buffer == buffer)
+        cancel_readback_frame (src, &priv->readback_frames[i], FALSE);
+    }
+
+  priv->buffers = g_list_remove (priv->buffers, buffer);
+  invalidate_buffer (buffer);
 
   if (spa_data[0].type == SPA_DATA_DmaBuf)
     {
@@ -968,6 +2355,8 @@ create_pipewire_stream (MetaScreenCastStreamSrc  *src,
 {
   MetaScreenCastStreamSrcPrivate *priv =
     meta_screen_cast_stream_src_get_instance_private (src);
+  MetaScreenCastStreamSrcClass *klass =
+    META_SCREEN_CAST_STREAM_SRC_GET_CLASS (src);
 #ifdef HAVE_NATIVE_BACKEND
   MetaScreenCastStream *stream = meta_screen_cast_stream_src_get_stream (src);
   MetaScreenCastSession *session = meta_screen_cast_stream_get_session (stream);
@@ -980,13 +2369,15 @@ create_pipewire_stream (MetaScreenCastStreamSrc  *src,
   CoglRenderer *cogl_renderer = cogl_context_get_renderer (cogl_context);
 #endif /* HAVE_NATIVE_BACKEND */
   struct pw_stream *pipewire_stream;
-  uint8_t buffer[1024];
+  uint8_t buffer[2048];
   struct spa_pod_builder pod_builder =
     SPA_POD_BUILDER_INIT (buffer, sizeof (buffer));
   int width;
   int height;
   float frame_rate;
-  const struct spa_pod *params[2];
+  struct spa_rectangle default_size, min_size, max_size;
+  struct spa_fraction default_framerate, min_framerate, max_framerate;
+  const struct spa_pod *params[4];
   int n_params = 0;
   int result;
 
@@ -1006,107 +2397,102 @@ create_pipewire_stream (MetaScreenCastStreamSrc  *src,
   if (meta_screen_cast_stream_src_get_specs (src, &width, &height, &frame_rate))
     {
       MetaFraction frame_rate_fraction;
-      struct spa_fraction max_framerate;
-      struct spa_fraction min_framerate;
 
       frame_rate_fraction = meta_fraction_from_double (frame_rate);
 
       min_framerate = SPA_FRACTION (1, 1);
       max_framerate = SPA_FRACTION (frame_rate_fraction.num,
                                     frame_rate_fraction.denom);
+      default_framerate = max_framerate;
 
-#ifdef HAVE_NATIVE_BACKEND
-      if (cogl_renderer_is_dma_buf_supported (cogl_renderer))
-        {
-          uint64_t modifier = DRM_FORMAT_MOD_INVALID;
-
-          params[n_params++] = push_format_object (
-            &pod_builder,
-            SPA_VIDEO_FORMAT_BGRx, &modifier, 1,
-            SPA_FORMAT_VIDEO_size, SPA_POD_Rectangle (&SPA_RECTANGLE (width,
-                                                                      height)),
-            SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction (&SPA_FRACTION (0, 1)),
-            SPA_FORMAT_VIDEO_maxFramerate,
-            SPA_POD_CHOICE_RANGE_Fraction (&max_framerate,
-                                           &min_framerate,
-                                           &max_framerate),
-            0);
-          params[n_params++] = push_format_object (
-            &pod_builder,
-            SPA_VIDEO_FORMAT_BGRx, NULL, 0,
-            SPA_FORMAT_VIDEO_size, SPA_POD_Rectangle (&SPA_RECTANGLE (width,
-                                                                      height)),
-            SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction (&SPA_FRACTION (0, 1)),
-            SPA_FORMAT_VIDEO_maxFramerate,
-            SPA_POD_CHOICE_RANGE_Fraction (&max_framerate,
-                                           &min_framerate,
-                                           &max_framerate),
-            0);
-        }
+      /* Frames can be scaled down on the GPU, but never up. */
+      default_size = SPA_RECTANGLE (width, height);
+      max_size = default_size;
+      if (klass->record_for_readback || klass->record_to_texture)
+        min_size = MIN_SIZE;
       else
-#endif /* HAVE_NATIVE_BACKEND */
-        {
-          params[n_params++] = push_format_object (
-            &pod_builder,
-            SPA_VIDEO_FORMAT_BGRx, NULL, 0,
-            SPA_FORMAT_VIDEO_size, SPA_POD_Rectangle (&SPA_RECTANGLE (width,
-                                                                      height)),
-            SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction (&SPA_FRACTION (0, 1)),
-            SPA_FORMAT_VIDEO_maxFramerate,
-            SPA_POD_CHOICE_RANGE_Fraction (&max_framerate,
-                                           &min_framerate,
-                                           &max_framerate),
-            0);
-        }
+        min_size = default_size;
     }
   else
     {
+      default_framerate = DEFAULT_FRAME_RATE;
+      min_framerate = MIN_FRAME_RATE;
+      max_framerate = MAX_FRAME_RATE;
+
+      default_size = DEFAULT_SIZE;
+      min_size = MIN_SIZE;
+      max_size = MAX_SIZE;
+    }
+
 #ifdef HAVE_NATIVE_BACKEND
-      if (cogl_renderer_is_dma_buf_supported (cogl_renderer))
-        {
-          uint64_t modifier = DRM_FORMAT_MOD_INVALID;
-
-          params[n_params++] = push_format_object (
-            &pod_builder,
-            SPA_VIDEO_FORMAT_BGRx, &modifier, 1,
-            SPA_FORMAT_VIDEO_size, SPA_POD_CHOICE_RANGE_Rectangle (&DEFAULT_SIZE,
-                                                                   &MIN_SIZE,
-                                                                   &MAX_SIZE),
-            SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction (&SPA_FRACTION (0, 1)),
-            SPA_FORMAT_VIDEO_maxFramerate,
-            SPA_POD_CHOICE_RANGE_Fraction (&DEFAULT_FRAME_RATE,
-                                           &MIN_FRAME_RATE,
-                                           &MAX_FRAME_RATE),
-            0);
-          params[n_params++] = push_format_object (
-            &pod_builder,
-            SPA_VIDEO_FORMAT_BGRx, NULL, 0,
-            SPA_FORMAT_VIDEO_size, SPA_POD_CHOICE_RANGE_Rectangle (&DEFAULT_SIZE,
-                                                                   &MIN_SIZE,
-                                                                   &MAX_SIZE),
-            SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction (&SPA_FRACTION (0, 1)),
-            SPA_FORMAT_VIDEO_maxFramerate,
-            SPA_POD_CHOICE_RANGE_Fraction (&DEFAULT_FRAME_RATE,
-                                           &MIN_FRAME_RATE,
-                                           &MAX_FRAME_RATE),
-            0);
-        }
-      else
+  if (cogl_renderer_is_dma_buf_supported (cogl_renderer))
+    {
+      uint64_t modifier = DRM_FORMAT_MOD_INVALID;
+
+      params[n_params++] = push_format_object (
+        &pod_builder,
+        SPA_VIDEO_FORMAT_BGRx, &modifier, 1,
+        SPA_FORMAT_VIDEO_size, SPA_POD_CHOICE_RANGE_Rectangle (&default_size,
+                                                               &min_size,
+                                                               &max_size),
+        SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction (&SPA_FRACTION (0, 1)),
+        SPA_FORMAT_VIDEO_maxFramerate,
+        SPA_POD_CHOICE_RANGE_Fraction (&default_framerate,
+                                       &min_framerate,
+                                       &max_framerate),
+        0);
+    }
 #endif /* HAVE_NATIVE_BACKEND */
-        {
-          params[n_params++] = push_format_object (
-            &pod_builder,
-            SPA_VIDEO_FORMAT_BGRx, NULL, 0,
-            SPA_FORMAT_VIDEO_size, SPA_POD_CHOICE_RANGE_Rectangle (&DEFAULT_SIZE,
-                                                                   &MIN_SIZE,
-                                                                   &MAX_SIZE),
-            SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction (&SPA_FRACTION (0, 1)),
-            SPA_FORMAT_VIDEO_maxFramerate,
-            SPA_POD_CHOICE_RANGE_Fraction (&DEFAULT_FRAME_RATE,
-                                           &MIN_FRAME_RATE,
-                                           &MAX_FRAME_RATE),
-            0);
-        }
+
+  params[n_params++] = push_format_object (
+    &pod_builder,
+    SPA_VIDEO_FORMAT_BGRx, NULL, 0,
+    SPA_FORMAT_VIDEO_size, SPA_POD_CHOICE_RANGE_Rectangle (&default_size,
+                                                           &min_size,
+                                                           &max_size),
+    SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction (&SPA_FRACTION (0, 1)),
+    SPA_FORMAT_VIDEO_maxFramerate,
+    SPA_POD_CHOICE_RANGE_Fraction (&default_framerate,
+                                   &min_framerate,
+                                   &max_framerate),
+    0);
+
+  /* YUV frames are converted on the GPU and read back into MemFd buffers, so
+   * they are only offered without modifiers. */
+  if (klass->record_for_readback)
+    {
+      params[n_params++] = push_format_object (
+        &pod_builder,
+        SPA_VIDEO_FORMAT_NV12, NULL, 0,
+        SPA_FORMAT_VIDEO_size, SPA_POD_CHOICE_RANGE_Rectangle (&default_size,
+                                                               &min_size,
+                                                               &max_size),
+        SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction (&SPA_FRACTION (0, 1)),
+        SPA_FORMAT_VIDEO_maxFramerate,
+        SPA_POD_CHOICE_RANGE_Fraction (&default_framerate,
+                                       &min_framerate,
+                                       &max_framerate),
+        SPA_FORMAT_VIDEO_colorRange,
+        SPA_POD_Id (SPA_VIDEO_COLOR_RANGE_16_235),
+        SPA_FORMAT_VIDEO_colorMatrix,
+        SPA_POD_Id (SPA_VIDEO_COLOR_MATRIX_BT709),
+        0);
+      params[n_params++] = push_format_object (
+        &pod_builder,
+        SPA_VIDEO_FORMAT_I420, NULL, 0,
+        SPA_FORMAT_VIDEO_size, SPA_POD_CHOICE_RANGE_Rectangle (&default_size,
+                                                               &min_size,
+                                                               &max_size),
+        SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction (&SPA_FRACTION (0, 1)),
+        SPA_FORMAT_VIDEO_maxFramerate,
+        SPA_POD_CHOICE_RANGE_Fraction (&default_framerate,
+                                       &min_framerate,
+                                       &max_framerate),
+        SPA_FORMAT_VIDEO_colorRange,
+        SPA_POD_Id (SPA_VIDEO_COLOR_RANGE_16_235),
+        SPA_FORMAT_VIDEO_colorMatrix,
+        SPA_POD_Id (SPA_VIDEO_COLOR_MATRIX_BT709),
+        0);
     }
 
   pw_stream_add_listener (pipewire_stream,
@@ -1295,7 +2681,10 @@ meta_screen_cast_stream_src_dispose (GObject *object)
   if (meta_screen_cast_stream_src_is_enabled (src))
     meta_screen_cast_stream_src_disable (src);
 
+  clear_readback_frames (src);
   g_clear_pointer (&priv->pipewire_stream, pw_stream_destroy);
+  g_clear_pointer (&priv->buffers, g_list_free);
+  g_clear_pointer (&priv->damage, cairo_region_destroy);
   g_clear_pointer (&priv->dmabuf_handles, g_hash_table_destroy);
   g_clear_pointer (&priv->pipewire_core, pw_core_disconnect);
   g_clear_pointer (&priv->pipewire_context, pw_context_destroy);
@@ -66,9 +66,21 @@ struct _MetaScreenCastStreamSrcClass
                                  int                       stride,
                                  uint8_t                  *data,
                                  GError                  **error);
+  gboolean (* record_region_to_buffer) (MetaScreenCastStreamSrc  *src,
+                                        const cairo_region_t     *region,
+                                        int                       width,
+                                        int                       height,
+                                        int                       stride,
+                                        uint8_t                  *data,
+                                        GError                  **error);
   gboolean (* record_to_framebuffer) (MetaScreenCastStreamSrc  *src,
                                       CoglFramebuffer          *framebuffer,
                                       GError                  **error);
+  gboolean (* record_for_readback) (MetaScreenCastStreamSrc  *src,
+                                    CoglFramebuffer          *framebuffer,
+                                    GError                  **error);
+  CoglTexture * (* record_to_texture) (MetaScreenCastStreamSrc  *src,
+                                       GError                  **error);
   void (* record_follow_up) (MetaScreenCastStreamSrc *src);
 
   gboolean (* get_videocrop) (MetaScreenCastStreamSrc *src,
@@ -91,6 +103,19 @@ gboolean meta_screen_cast_stream_src_pending_follow_up_frame (MetaScreenCastStre
 
 MetaScreenCastStream * meta_screen_cast_stream_src_get_stream (MetaScreenCastStreamSrc *src);
 
+void meta_screen_cast_stream_src_add_damage (MetaScreenCastStreamSrc *src,
+                                             const cairo_region_t    *damage);
+
+void meta_screen_cast_stream_src_add_view_damage (MetaScreenCastStreamSrc *src,
+                                                  ClutterStageView        *view,
+                                                  const MetaRectangle     *stage_rect,
+                                                  float                    scale);
+
+gboolean meta_screen_cast_stream_src_stream_rect_to_stage (const MetaRectangle *stage_area,
+                                                           float                scale,
+                                                           MetaRectangle       *stream_rect,
+                                                           MetaRectangle       *out_stage_rect);
+
 gboolean meta_screen_cast_stream_src_draw_cursor_into (MetaScreenCastStreamSrc  *src,
                                                        CoglTexture              *cursor_texture,
                                                        float                     scale,
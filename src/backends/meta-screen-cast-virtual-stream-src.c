@@ -39,6 +39,7 @@ struct _MetaScreenCastVirtualStreamSrc
   gboolean hw_cursor_inhibited;
 
   MetaStageWatch *watch;
+  MetaStageWatch *damage_watch;
 
   gulong position_invalidated_handler_id;
   gulong cursor_changed_handler_id;
@@ -183,6 +184,20 @@ actors_painted (MetaStage           *stage,
   meta_screen_cast_stream_src_maybe_record_frame (src, flags);
 }
 
+static void
+before_stage_painted (MetaStage           *stage,
+                      ClutterStageView    *view,
+                      ClutterPaintContext *paint_context,
+                      gpointer             user_data)
+{
+  MetaScreenCastStreamSrc *src = META_SCREEN_CAST_STREAM_SRC (user_data);
+  MetaRectangle view_layout;
+
+  clutter_stage_view_get_layout (view, &view_layout);
+  meta_screen_cast_stream_src_add_view_damage (src, view, &view_layout,
+                                               clutter_stage_view_get_scale (view));
+}
+
 static void
 add_watch (MetaScreenCastVirtualStreamSrc *virtual_src)
 {
@@ -191,6 +206,12 @@ add_watch (MetaScreenCastVirtualStreamSrc *virtual_src)
 
   g_return_if_fail (!virtual_src->watch);
 
+  virtual_src->damage_watch =
+    meta_stage_watch_view (meta_stage,
+                           view_from_src (src),
+                           META_STAGE_WATCH_BEFORE_PAINT,
+                           before_stage_painted,
+                           virtual_src);
   virtual_src->watch = meta_stage_watch_view (meta_stage,
                                               view_from_src (src),
                                               META_STAGE_WATCH_AFTER_PAINT,
@@ -198,15 +219,26 @@ add_watch (MetaScreenCastVirtualStreamSrc *virtual_src)
                                               virtual_src);
 }
 
+static void
+remove_watch (MetaScreenCastVirtualStreamSrc *virtual_src)
+{
+  MetaScreenCastStreamSrc *src = META_SCREEN_CAST_STREAM_SRC (virtual_src);
+  MetaStage *meta_stage = META_STAGE (stage_from_src (src));
+
+  meta_stage_remove_watch (meta_stage, virtual_src->damage_watch);
+  virtual_src->damage_watch = NULL;
+  meta_stage_remove_watch (meta_stage, virtual_src->watch);
+  virtual_src->watch = NULL;
+}
+
 static void
 on_monitors_changed (MetaMonitorManager             *monitor_manager,
                      MetaScreenCastVirtualStreamSrc *virtual_src)
 {
   MetaScreenCastStreamSrc *src = META_SCREEN_CAST_STREAM_SRC (virtual_src);
-  MetaStage *stage = META_STAGE (stage_from_src (src));
 
-  meta_stage_remove_watch (stage, virtual_src->watch);
-  virtual_src->watch = NULL;
+  meta_screen_cast_stream_src_add_damage (src, NULL);
+  remove_watch (virtual_src);
   add_watch (virtual_src);
 }
 
@@ -289,11 +321,7 @@ meta_screen_cast_virtual_stream_src_disable (MetaScreenCastStreamSrc *src)
     uninhibit_hw_cursor (virtual_src);
 
   if (virtual_src->watch)
-    {
-      meta_stage_remove_watch (META_STAGE (stage_from_src (src)),
-                               virtual_src->watch);
-      virtual_src->watch = NULL;
-    }
+    remove_watch (virtual_src);
 
   g_clear_signal_handler (&virtual_src->position_invalidated_handler_id,
                           cursor_tracker);
@@ -331,6 +359,56 @@ meta_screen_cast_virtual_stream_src_record_to_buffer (MetaScreenCastStreamSrc  *
   return TRUE;
 }
 
+static gboolean
+meta_screen_cast_virtual_stream_src_record_region_to_buffer (MetaScreenCastStreamSrc  *src,
+                                                             const cairo_region_t     *region,
+                                                             int                       width,
+                                                             int                       height,
+                                                             int                       stride,
+                                                             uint8_t                  *data,
+                                                             GError                  **error)
+{
+  ClutterStageView *view = view_from_src (src);
+  MetaRectangle view_layout;
+  float view_scale;
+  int n_rects, i;
+
+  clutter_stage_view_get_layout (view, &view_layout);
+  view_scale = clutter_stage_view_get_scale (view);
+
+  n_rects = cairo_region_num_rectangles (region);
+  for (i = 0; i < n_rects; i++)
+    {
+      MetaRectangle stream_rect;
+      MetaRectangle stage_rect;
+      const int bpp = 4;
+
+      cairo_region_get_rectangle (region, i, &stream_rect);
+      if (!meta_screen_cast_stream_src_stream_rect_to_stage (&view_layout,
+                                                             view_scale,
+                                                             &stream_rect,
+                                                             &stage_rect))
+        {
+          return meta_screen_cast_virtual_stream_src_record_to_buffer (src,
+                                                                       width,
+                                                                       height,
+                                                                       stride,
+                                                                       data,
+                                                                       error);
+        }
+
+      clutter_stage_capture_view_into (stage_from_src (src),
+                                       view,
+                                       &stage_rect,
+                                       data +
+                                       stream_rect.y * stride +
+                                       stream_rect.x * bpp,
+                                       stride);
+    }
+
+  return TRUE;
+}
+
 static gboolean
 meta_screen_cast_virtual_stream_src_record_to_framebuffer (MetaScreenCastStreamSrc  *src,
                                                            CoglFramebuffer          *framebuffer,
@@ -623,8 +701,12 @@ meta_screen_cast_virtual_stream_src_class_init (MetaScreenCastVirtualStreamSrcCl
   src_class->disable = meta_screen_cast_virtual_stream_src_disable;
   src_class->record_to_buffer =
     meta_screen_cast_virtual_stream_src_record_to_buffer;
+  src_class->record_region_to_buffer =
+    meta_screen_cast_virtual_stream_src_record_region_to_buffer;
   src_class->record_to_framebuffer =
     meta_screen_cast_virtual_stream_src_record_to_framebuffer;
+  src_class->record_for_readback =
+    meta_screen_cast_virtual_stream_src_record_to_framebuffer;
   src_class->record_follow_up =
     meta_screen_cast_virtual_stream_record_follow_up;
   src_class->set_cursor_metadata =
@@ -41,6 +41,8 @@ struct _MetaScreenCastWindowStreamSrc
   unsigned long cursor_changed_handler_id;
 
   gboolean cursor_bitmap_invalid;
+
+  MetaRectangle last_buffer_bounds;
 };
 
 G_DEFINE_TYPE (MetaScreenCastWindowStreamSrc,
@@ -344,6 +346,34 @@ meta_screen_cast_window_stream_src_stop (MetaScreenCastWindowStreamSrc *window_s
     }
 }
 
+static void
+add_window_damage (MetaScreenCastWindowStreamSrc *window_src)
+{
+  MetaScreenCastStreamSrc *src = META_SCREEN_CAST_STREAM_SRC (window_src);
+  MetaScreenCastStream *stream = meta_screen_cast_stream_src_get_stream (src);
+  MetaRectangle buffer_bounds;
+  cairo_region_t *damage;
+
+  /* The embedded cursor may be drawn anywhere within the stream. */
+  if (meta_screen_cast_stream_get_cursor_mode (stream) ==
+      META_SCREEN_CAST_CURSOR_MODE_EMBEDDED)
+    {
+      meta_screen_cast_stream_src_add_damage (src, NULL);
+      return;
+    }
+
+  /* The window damage signal carries no region, so damage the area the
+   * window content covers now and the one it covered in the last frame. */
+  meta_screen_cast_window_stream_src_get_videocrop (src, &buffer_bounds);
+
+  damage = cairo_region_create_rectangle (&buffer_bounds);
+  cairo_region_union_rectangle (damage, &window_src->last_buffer_bounds);
+  meta_screen_cast_stream_src_add_damage (src, damage);
+  cairo_region_destroy (damage);
+
+  window_src->last_buffer_bounds = buffer_bounds;
+}
+
 static void
 screen_cast_window_damaged (MetaWindowActor               *actor,
                             MetaScreenCastWindowStreamSrc *window_src)
@@ -351,6 +381,8 @@ screen_cast_window_damaged (MetaWindowActor               *actor,
   MetaScreenCastStreamSrc *src = META_SCREEN_CAST_STREAM_SRC (window_src);
   MetaScreenCastRecordFlag flags;
 
+  add_window_damage (window_src);
+
   flags = META_SCREEN_CAST_RECORD_FLAG_NONE;
   meta_screen_cast_stream_src_maybe_record_frame (src, flags);
 }
@@ -607,6 +639,8 @@ meta_screen_cast_window_stream_src_class_init (MetaScreenCastWindowStreamSrcClas
     meta_screen_cast_window_stream_src_record_to_buffer;
   src_class->record_to_framebuffer =
     meta_screen_cast_window_stream_src_record_to_framebuffer;
+  src_class->record_for_readback =
+    meta_screen_cast_window_stream_src_record_to_framebuffer;
   src_class->record_follow_up =
     meta_screen_cast_window_stream_record_follow_up;
   src_class->get_videocrop = meta_screen_cast_window_stream_src_get_videocrop;
@@ -28,6 +28,7 @@
 
 #include "backends/meta-backend-private.h"
 #include "backends/meta-remote-desktop-session.h"
+#include "backends/meta-screen-cast-monitor-capture.h"
 #include "backends/meta-screen-cast-session.h"
 
 #define META_SCREEN_CAST_DBUS_SERVICE "org.gnome.Mutter.ScreenCast"
@@ -48,6 +49,11 @@ struct _MetaScreenCast
   MetaBackend *backend;
 
   gboolean disable_dma_bufs;
+
+  GList *monitor_captures;
+  int n_monitor_capture_paints;
+  int n_monitor_capture_read_backs;
+  int n_monitor_capture_frames;
 };
 
 static void
@@ -96,6 +102,72 @@ meta_screen_cast_get_backend (MetaScreenCast *screen_cast)
   return screen_cast->backend;
 }
 
+static void
+on_monitor_capture_finalized (gpointer  user_data,
+                              GObject  *where_the_object_was)
+{
+  MetaScreenCast *screen_cast = user_data;
+
+  screen_cast->monitor_captures = g_list_remove (screen_cast->monitor_captures,
+                                                 where_the_object_was);
+}
+
+/*
+ * Returns a new reference to the capture shared by all streams recording
+ * @monitor with @paint_flags.
+ */
+MetaScreenCastMonitorCapture *
+meta_screen_cast_ensure_monitor_capture (MetaScreenCast   *screen_cast,
+                                         MetaMonitor      *monitor,
+                                         ClutterPaintFlag  paint_flags)
+{
+  MetaScreenCastMonitorCapture *capture;
+  GList *l;
+
+  for (l = screen_cast->monitor_captures; l; l = l->next)
+    {
+      capture = l->data;
+
+      if (meta_screen_cast_monitor_capture_get_monitor (capture) == monitor &&
+          meta_screen_cast_monitor_capture_get_paint_flags (capture) ==
+          paint_flags)
+        return g_object_ref (capture);
+    }
+
+  capture = meta_screen_cast_monitor_capture_new (screen_cast,
+                                                  monitor,
+                                                  paint_flags);
+  g_object_weak_ref (G_OBJECT (capture),
+                     on_monitor_capture_finalized,
+                     screen_cast);
+  screen_cast->monitor_captures = g_list_prepend (screen_cast->monitor_captures,
+                                                  capture);
+
+  return capture;
+}
+
+void
+meta_screen_cast_add_monitor_capture_stats (MetaScreenCast *screen_cast,
+                                            int             n_paints,
+                                            int             n_read_backs,
+                                            int             n_frames)
+{
+  screen_cast->n_monitor_capture_paints += n_paints;
+  screen_cast->n_monitor_capture_read_backs += n_read_backs;
+  screen_cast->n_monitor_capture_frames += n_frames;
+}
+
+void
+meta_screen_cast_get_monitor_capture_stats (MetaScreenCast *screen_cast,
+                                            int            *n_paints,
+                                            int            *n_read_backs,
+                                            int            *n_frames)
+{
+  *n_paints = screen_cast->n_monitor_capture_paints;
+  *n_read_backs = screen_cast->n_monitor_capture_read_backs;
+  *n_frames = screen_cast->n_monitor_capture_frames;
+}
+
 void
 meta_screen_cast_disable_dma_bufs (MetaScreenCast *screen_cast)
 {
@@ -324,6 +396,7 @@ meta_screen_cast_finalize (GObject *object)
     g_bus_unown_name (screen_cast->dbus_name_id);
 
   g_assert (!screen_cast->sessions);
+  g_assert (!screen_cast->monitor_captures);
 
   G_OBJECT_CLASS (meta_screen_cast_parent_class)->finalize (object);
 }
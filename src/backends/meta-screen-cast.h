@@ -27,6 +27,7 @@
 
 #include "backends/meta-backend-private.h"
 #include "backends/meta-dbus-session-watcher.h"
+#include "clutter/clutter.h"
 
 #include "meta-dbus-screen-cast.h"
 
@@ -44,6 +45,8 @@ typedef enum _MetaScreenCastFlag
   META_SCREEN_CAST_FLAG_IS_PLATFORM = 1 << 1,
 } MetaScreenCastFlag;
 
+typedef struct _MetaScreenCastMonitorCapture MetaScreenCastMonitorCapture;
+
 #define META_TYPE_SCREEN_CAST (meta_screen_cast_get_type ())
 G_DECLARE_FINAL_TYPE (MetaScreenCast, meta_screen_cast,
                       META, SCREEN_CAST,
@@ -63,6 +66,21 @@ CoglDmaBufHandle * meta_screen_cast_create_dma_buf_handle (MetaScreenCast *scree
                                                            int             width,
                                                            int             height);
 
+MetaScreenCastMonitorCapture * meta_screen_cast_ensure_monitor_capture (MetaScreenCast   *screen_cast,
+                                                                        MetaMonitor      *monitor,
+                                                                        ClutterPaintFlag  paint_flags);
+
+void meta_screen_cast_add_monitor_capture_stats (MetaScreenCast *screen_cast,
+                                                 int             n_paints,
+                                                 int             n_read_backs,
+                                                 int             n_frames);
+
+META_EXPORT_TEST
+void meta_screen_cast_get_monitor_capture_stats (MetaScreenCast *screen_cast,
+                                                 int            *n_paints,
+                                                 int            *n_read_backs,
+                                                 int            *n_frames);
+
 MetaScreenCast * meta_screen_cast_new (MetaBackend            *backend,
                                        MetaDbusSessionWatcher *session_watcher);
 
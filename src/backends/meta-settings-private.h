@@ -35,6 +35,8 @@ typedef enum _MetaExperimentalFeature
   META_EXPERIMENTAL_FEATURE_KMS_MODIFIERS  = (1 << 1),
   META_EXPERIMENTAL_FEATURE_RT_SCHEDULER = (1 << 2),
   META_EXPERIMENTAL_FEATURE_AUTOCLOSE_XWAYLAND  = (1 << 3),
+  META_EXPERIMENTAL_FEATURE_VARIABLE_REFRESH_RATE = (1 << 4),
+  META_EXPERIMENTAL_FEATURE_HISTOGRAM_FRAME_SCHEDULER = (1 << 5),
 } MetaExperimentalFeature;
 
 typedef enum _MetaXwaylandExtension
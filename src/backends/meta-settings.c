@@ -296,6 +296,10 @@ experimental_features_handler (GVariant *features_variant,
         feature = META_EXPERIMENTAL_FEATURE_RT_SCHEDULER;
       else if (g_str_equal (feature_str, "autoclose-xwayland"))
         feature = META_EXPERIMENTAL_FEATURE_AUTOCLOSE_XWAYLAND;
+      else if (g_str_equal (feature_str, "variable-refresh-rate"))
+        feature = META_EXPERIMENTAL_FEATURE_VARIABLE_REFRESH_RATE;
+      else if (g_str_equal (feature_str, "histogram-frame-scheduler"))
+        feature = META_EXPERIMENTAL_FEATURE_HISTOGRAM_FRAME_SCHEDULER;
 
       if (feature)
         g_message ("Enabling experimental feature '%s'", feature_str);
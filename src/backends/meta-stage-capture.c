@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) 2022 Red Hat
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Captures a logical rectangle of the stage, as last presented, without
+ * repainting it and without waiting for the GPU.
+ *
+ * The part of each stage view intersecting the rectangle is blitted into an
+ * offscreen framebuffer the size of the capture. That framebuffer is then
+ * read back asynchronously in the requested pixel format, so the format
+ * conversion happens as part of the GPU side transfer. Only when a view
+ * can't be blitted, e.g. because its scale differs from the capture scale or
+ * it is being scanned out directly, is the rectangle painted instead.
+ *
+ * Blitting requires the view to keep its contents in an offscreen
+ * framebuffer or a shadow framebuffer, as is the case for virtual monitors
+ * and transformed or shadowed KMS monitors. The back buffer of an onscreen is
+ * undefined after it was swapped, so for plain KMS monitors, the common case,
+ * painting is the primary path. It still avoids waiting for the GPU, since
+ * the result is read back asynchronously either way.
+ */
+
+#include "config.h"
+
+#include "backends/meta-stage-capture.h"
+
+#include <math.h>
+
+#include "backends/meta-backend-private.h"
+#include "backends/meta-framebuffer-readback.h"
+#include "backends/meta-renderer.h"
+#include "clutter/clutter.h"
+
+typedef struct _CaptureData
+{
+  CoglFramebuffer *framebuffer;
+  MetaFramebufferReadback *readback;
+
+  uint8_t *data;
+  int width;
+  int height;
+  int stride;
+  float scale;
+} CaptureData;
+
+static void
+capture_data_free (CaptureData *capture_data)
+{
+  g_clear_pointer (&capture_data->readback, meta_framebuffer_readback_free);
+  g_clear_object (&capture_data->framebuffer);
+  g_free (capture_data->data);
+  g_free (capture_data);
+}
+
+static GList *
+get_views_for_rect (MetaBackend         *backend,
+                    const MetaRectangle *rect)
+{
+  MetaRenderer *renderer = meta_backend_get_renderer (backend);
+  GList *views = NULL;
+  GList *l;
+
+  for (l = meta_renderer_get_views (renderer); l; l = l->next)
+    {
+      ClutterStageView *view = l->data;
+      MetaRectangle view_layout;
+
+      clutter_stage_view_get_layout (view, &view_layout);
+      if (meta_rectangle_overlap (&view_layout, rect))
+        views = g_list_prepend (views, view);
+    }
+
+  return views;
+}
+
+static gboolean
+blit_views (GList               *views,
+            const MetaRectangle *rect,
+            float                scale,
+            CoglFramebuffer     *framebuffer)
+{
+  GList *l;
+
+  for (l = views; l; l = l->next)
+    {
+      ClutterStageView *view = l->data;
+      CoglFramebuffer *view_framebuffer;
+      MetaRectangle view_layout;
+      MetaRectangle intersection;
+      g_autoptr (GError) error = NULL;
+
+      if (clutter_stage_view_get_scale (view) != scale ||
+          clutter_stage_view_peek_scanout (view))
+        return FALSE;
+
+      clutter_stage_view_get_layout (view, &view_layout);
+      meta_rectangle_intersect (&view_layout, rect, &intersection);
+
+      view_framebuffer = clutter_stage_view_get_framebuffer (view);
+      if (COGL_IS_ONSCREEN (view_framebuffer))
+        return FALSE;
+
+      if (!cogl_blit_framebuffer (view_framebuffer,
+                                  framebuffer,
+                                  (int) roundf ((intersection.x - view_layout.x) * scale),
+                                  (int) roundf ((intersection.y - view_layout.y) * scale),
+                                  (int) roundf ((intersection.x - rect->x) * scale),
+                                  (int) roundf ((intersection.y - rect->y) * scale),
+                                  (int) roundf (intersection.width * scale),
+                                  (int) roundf (intersection.height * scale),
+                                  &error))
+        {
+          meta_topic (META_DEBUG_RENDER,
+                      "Failed to blit view for stage capture: %s",
+                      error->message);
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+static void
+on_capture_read (MetaFramebufferReadback *readback,
+                 gpointer                 user_data)
+{
+  GTask *task = G_TASK (user_data);
+
+  if (!g_task_return_error_if_cancelled (task))
+    g_task_return_boolean (task, TRUE);
+
+  g_object_unref (task);
+}
+
+/**
+ * meta_stage_capture_region_async:
+ * @backend: a #MetaBackend
+ * @rect: the rectangle to capture, in stage coordinates
+ * @format: the single plane pixel format of the result
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called once the pixels are available
+ * @user_data: data passed to @callback
+ *
+ * Captures the part of the stage inside @rect, at the largest scale of the
+ * views it intersects. Areas not covered by any view are transparent.
+ */
+void
+meta_stage_capture_region_async (MetaBackend         *backend,
+                                 const MetaRectangle *rect,
+                                 CoglPixelFormat      format,
+                                 GCancellable        *cancellable,
+                                 GAsyncReadyCallback  callback,
+                                 gpointer             user_data)
+{
+  ClutterActor *stage = meta_backend_get_stage (backend);
+  ClutterBackend *clutter_backend = meta_backend_get_clutter_backend (backend);
+  CoglContext *cogl_context = clutter_backend_get_cogl_context (clutter_backend);
+  g_autoptr (GTask) task = NULL;
+  g_autoptr (GError) error = NULL;
+  g_autoptr (GList) views = NULL;
+  CaptureData *capture_data;
+  CoglTexture2D *texture;
+  cairo_rectangle_int_t capture_rect;
+  cairo_region_t *region;
+  GList *l;
+
+  g_return_if_fail (cogl_pixel_format_get_n_planes (format) == 1);
+
+  task = g_task_new (backend, cancellable, callback, user_data);
+  g_task_set_source_tag (task, meta_stage_capture_region_async);
+
+  views = get_views_for_rect (backend, rect);
+  if (!views)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                               "Rectangle outside of the stage");
+      return;
+    }
+
+  COGL_TRACE_BEGIN_SCOPED (CaptureRegion, "Stage capture");
+
+  capture_data = g_new0 (CaptureData, 1);
+  g_task_set_task_data (task, capture_data, (GDestroyNotify) capture_data_free);
+
+  capture_data->scale = 1.0;
+  for (l = views; l; l = l->next)
+    {
+      capture_data->scale = MAX (clutter_stage_view_get_scale (l->data),
+                                 capture_data->scale);
+    }
+
+  capture_data->width = (int) roundf (rect->width * capture_data->scale);
+  capture_data->height = (int) roundf (rect->height * capture_data->scale);
+  capture_data->stride =
+    capture_data->width * cogl_pixel_format_get_bytes_per_pixel (format, 0);
+
+  texture = cogl_texture_2d_new_with_size (cogl_context,
+                                           capture_data->width,
+                                           capture_data->height);
+  capture_data->framebuffer =
+    COGL_FRAMEBUFFER (cogl_offscreen_new_with_texture (COGL_TEXTURE (texture)));
+  cogl_object_unref (texture);
+
+  if (!cogl_framebuffer_allocate (capture_data->framebuffer, &error))
+    {
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
+
+  cogl_framebuffer_clear4f (capture_data->framebuffer, COGL_BUFFER_BIT_COLOR,
+                            0.0, 0.0, 0.0, 0.0);
+
+  if (!cogl_has_feature (cogl_context, COGL_FEATURE_ID_BLIT_FRAMEBUFFER) ||
+      !blit_views (views, rect, capture_data->scale, capture_data->framebuffer))
+    {
+      cairo_rectangle_int_t paint_rect = {
+        .x = rect->x,
+        .y = rect->y,
+        .width = rect->width,
+        .height = rect->height,
+      };
+
+      meta_topic (META_DEBUG_RENDER,
+                  "Painting stage capture of %dx%d+%d+%d",
+                  rect->width, rect->height, rect->x, rect->y);
+
+      clutter_stage_paint_to_framebuffer (CLUTTER_STAGE (stage),
+                                          capture_data->framebuffer,
+                                          &paint_rect,
+                                          capture_data->scale,
+                                          CLUTTER_PAINT_FLAG_CLEAR);
+    }
+
+  capture_data->data = g_malloc0 ((size_t) capture_data->stride *
+                                  capture_data->height);
+  capture_data->readback =
+    meta_framebuffer_readback_new (capture_data->framebuffer, format);
+
+  capture_rect = (cairo_rectangle_int_t) {
+    .width = capture_data->width,
+    .height = capture_data->height,
+  };
+  region = cairo_region_create_rectangle (&capture_rect);
+
+  if (meta_framebuffer_readback_read_region_async (capture_data->readback,
+                                                   region,
+                                                   capture_data->data,
+                                                   capture_data->stride,
+                                                   on_capture_read,
+                                                   g_object_ref (task)))
+    {
+      cairo_region_destroy (region);
+      return;
+    }
+
+  /* The callback will never be called, drop the reference it would own */
+  g_object_unref (task);
+
+  if (meta_framebuffer_readback_read_region (capture_data->readback,
+                                             region,
+                                             capture_data->data,
+                                             capture_data->stride))
+    {
+      g_task_return_boolean (task, TRUE);
+    }
+  else
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "Failed to read back stage capture");
+    }
+
+  cairo_region_destroy (region);
+}
+
+/**
+ * meta_stage_capture_region_finish:
+ * @backend: a #MetaBackend
+ * @result: the #GAsyncResult passed to the callback
+ * @out_width: (out) (optional): width of the capture in pixels
+ * @out_height: (out) (optional): height of the capture in pixels
+ * @out_stride: (out) (optional): stride of the capture in bytes
+ * @out_scale: (out) (optional): the scale the capture was made at
+ * @error: return location for a #GError
+ *
+ * Returns: (transfer full): the captured pixels, to be freed with g_free(),
+ *   or %NULL on error.
+ */
+uint8_t *
+meta_stage_capture_region_finish (MetaBackend   *backend,
+                                  GAsyncResult  *result,
+                                  int           *out_width,
+                                  int           *out_height,
+                                  int           *out_stride,
+                                  float         *out_scale,
+                                  GError       **error)
+{
+  GTask *task = G_TASK (result);
+  CaptureData *capture_data;
+
+  g_return_val_if_fail (g_task_is_valid (result, backend), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (task) ==
+                        meta_stage_capture_region_async, NULL);
+
+  if (!g_task_propagate_boolean (task, error))
+    return NULL;
+
+  capture_data = g_task_get_task_data (task);
+
+  if (out_width)
+    *out_width = capture_data->width;
+  if (out_height)
+    *out_height = capture_data->height;
+  if (out_stride)
+    *out_stride = capture_data->stride;
+  if (out_scale)
+    *out_scale = capture_data->scale;
+
+  return g_steal_pointer (&capture_data->data);
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2022 Red Hat
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef META_STAGE_CAPTURE_H
+#define META_STAGE_CAPTURE_H
+
+#include <gio/gio.h>
+#include <stdint.h>
+
+#include "cogl/cogl.h"
+#include "core/util-private.h"
+#include "meta/boxes.h"
+#include "meta/meta-backend.h"
+
+META_EXPORT_TEST
+void meta_stage_capture_region_async (MetaBackend         *backend,
+                                      const MetaRectangle *rect,
+                                      CoglPixelFormat      format,
+                                      GCancellable        *cancellable,
+                                      GAsyncReadyCallback  callback,
+                                      gpointer             user_data);
+
+META_EXPORT_TEST
+uint8_t * meta_stage_capture_region_finish (MetaBackend   *backend,
+                                            GAsyncResult  *result,
+                                            int           *out_width,
+                                            int           *out_height,
+                                            int           *out_stride,
+                                            float         *out_scale,
+                                            GError       **error);
+
+#endif /* META_STAGE_CAPTURE_H */
@@ -685,6 +685,7 @@ meta_stage_impl_scanout_view (MetaStageImpl     *stage_impl,
   CoglContext *cogl_context = cogl_framebuffer_get_context (framebuffer);
   CoglOnscreen *onscreen;
   CoglFrameInfo *frame_info;
+  cairo_region_t *redraw_clip;
 
   g_assert (COGL_IS_ONSCREEN (framebuffer));
 
@@ -702,6 +703,11 @@ meta_stage_impl_scanout_view (MetaStageImpl     *stage_impl,
       return FALSE;
     }
 
+  /* The redraw clip was passed on as the damage of the scanout buffer, so
+   * it mustn't accumulate into the next frame. */
+  redraw_clip = clutter_stage_view_take_redraw_clip (stage_view);
+  g_clear_pointer (&redraw_clip, cairo_region_destroy);
+
   priv->global_frame_counter++;
 
   return TRUE;
@@ -60,6 +60,9 @@ void meta_overlay_set_visible (MetaOverlay *overlay,
 
 gboolean meta_overlay_is_visible (MetaOverlay *overlay);
 
+gboolean meta_stage_has_visible_overlay_in (MetaStage             *stage,
+                                            const graphene_rect_t *rect);
+
 void meta_stage_set_active (MetaStage *stage,
                             gboolean   is_active);
 
@@ -74,6 +77,9 @@ META_EXPORT_TEST
 void meta_stage_remove_watch (MetaStage      *stage,
                               MetaStageWatch *watch);
 
+gboolean meta_stage_is_view_watched (MetaStage        *stage,
+                                     ClutterStageView *view);
+
 G_END_DECLS
 
 #endif /* META_STAGE_PRIVATE_H */
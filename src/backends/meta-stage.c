@@ -430,6 +430,26 @@ meta_overlay_is_visible (MetaOverlay *overlay)
   return overlay->is_visible;
 }
 
+gboolean
+meta_stage_has_visible_overlay_in (MetaStage             *stage,
+                                   const graphene_rect_t *rect)
+{
+  GList *l;
+
+  for (l = stage->overlays; l; l = l->next)
+    {
+      MetaOverlay *overlay = l->data;
+
+      if (!overlay->is_visible || !overlay->texture)
+        continue;
+
+      if (graphene_rect_intersection (&overlay->current_rect, rect, NULL))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
 void
 meta_stage_set_active (MetaStage *stage,
                        gboolean   is_active)
@@ -464,6 +484,29 @@ meta_stage_watch_view (MetaStage           *stage,
   return watch;
 }
 
+gboolean
+meta_stage_is_view_watched (MetaStage        *stage,
+                            ClutterStageView *view)
+{
+  int i;
+
+  for (i = 0; i < N_WATCH_MODES; i++)
+    {
+      GPtrArray *watchers = stage->watchers[i];
+      unsigned int j;
+
+      for (j = 0; j < watchers->len; j++)
+        {
+          MetaStageWatch *watch = g_ptr_array_index (watchers, j);
+
+          if (!watch->view || watch->view == view)
+            return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
 void
 meta_stage_remove_watch (MetaStage      *stage,
                          MetaStageWatch *watch)
@@ -185,9 +185,25 @@ update_viewports (MetaBackend *backend)
   g_object_unref (viewports);
 }
 
+static gboolean
+make_thread_realtime (MetaDbusRealtimeKit1  *rtkit_proxy,
+                      pid_t                  thread_id,
+                      GError               **error)
+{
+  uint32_t priority;
+
+  priority = sched_get_priority_min (SCHED_RR);
+  return meta_dbus_realtime_kit1_call_make_thread_realtime_sync (rtkit_proxy,
+                                                                 thread_id,
+                                                                 priority,
+                                                                 NULL,
+                                                                 error);
+}
+
 static void
 meta_backend_native_post_init (MetaBackend *backend)
 {
+  MetaBackendNative *native = META_BACKEND_NATIVE (backend);
   MetaSettings *settings = meta_backend_get_settings (backend);
 
   META_BACKEND_CLASS (meta_backend_native_parent_class)->post_init (backend);
@@ -210,14 +226,13 @@ meta_backend_native_post_init (MetaBackend *backend)
 
       if (rtkit_proxy)
         {
-          uint32_t priority;
-
-          priority = sched_get_priority_min (SCHED_RR);
-          meta_dbus_realtime_kit1_call_make_thread_realtime_sync (rtkit_proxy,
-                                                                  gettid (),
-                                                                  priority,
-                                                                  NULL,
-                                                                  &error);
+          pid_t kms_thread_id;
+
+          kms_thread_id = meta_kms_get_impl_thread_id (native->kms);
+
+          if (make_thread_realtime (rtkit_proxy, gettid (), &error) &&
+              kms_thread_id)
+            make_thread_realtime (rtkit_proxy, kms_thread_id, &error);
         }
 
       if (error)
@@ -42,6 +42,7 @@
 #include "backends/native/meta-crtc-kms.h"
 #include "backends/native/meta-device-pool.h"
 #include "backends/native/meta-drm-buffer-gbm.h"
+#include "backends/native/meta-kms-cursor-manager.h"
 #include "backends/native/meta-kms-device.h"
 #include "backends/native/meta-kms-plane.h"
 #include "backends/native/meta-kms-update.h"
@@ -77,6 +78,10 @@
  */
 #define HW_CURSOR_BUFFER_COUNT 3
 
+/* Number of realized cursor buffers kept around for reuse, across sprites,
+ * animation frames, scales, transforms and GPUs. */
+#define CURSOR_BUFFER_CACHE_SIZE 64
+
 static GQuark quark_cursor_sprite = 0;
 
 typedef struct _CrtcCursorData
@@ -99,9 +104,30 @@ struct _MetaCursorRendererNativePrivate
 
   MetaCursorSprite *last_cursor;
   guint animation_timeout_id;
+
+  GHashTable *buffer_cache;
+  GQueue buffer_cache_lru;
+  GList *buffer_cache_gpus;
+
+  int n_buffer_uploads;
 };
 typedef struct _MetaCursorRendererNativePrivate MetaCursorRendererNativePrivate;
 
+typedef struct _CursorBufferCacheEntry
+{
+  MetaGpuKms *gpu_kms;
+  GBytes *pixels;
+  int width;
+  int height;
+  int rowstride;
+  uint32_t gbm_format;
+  float scale;
+  MetaMonitorTransform transform;
+
+  MetaDrmBuffer *buffer;
+  GList link;
+} CursorBufferCacheEntry;
+
 typedef struct _MetaCursorRendererNativeGpuData
 {
   gboolean hw_cursor_broken;
@@ -187,15 +213,24 @@ meta_create_cursor_renderer_native_gpu_data (MetaGpuKms *gpu_kms)
   return cursor_renderer_gpu_data;
 }
 
+static void on_cached_gpu_finalized (gpointer  user_data,
+                                     GObject  *where_the_object_was);
+
 static void
 meta_cursor_renderer_native_finalize (GObject *object)
 {
   MetaCursorRendererNative *renderer = META_CURSOR_RENDERER_NATIVE (object);
   MetaCursorRendererNativePrivate *priv =
     meta_cursor_renderer_native_get_instance_private (renderer);
+  GList *l;
 
   g_clear_handle_id (&priv->animation_timeout_id, g_source_remove);
 
+  for (l = priv->buffer_cache_gpus; l; l = l->next)
+    g_object_weak_unref (l->data, on_cached_gpu_finalized, renderer);
+  g_clear_pointer (&priv->buffer_cache_gpus, g_list_free);
+  g_clear_pointer (&priv->buffer_cache, g_hash_table_unref);
+
   G_OBJECT_CLASS (meta_cursor_renderer_native_parent_class)->finalize (object);
 }
 
@@ -282,11 +317,22 @@ ensure_crtc_cursor_data (MetaCrtcKms *crtc_kms)
   return crtc_cursor_data;
 }
 
+static MetaKmsCursorManager *
+get_kms_cursor_manager (MetaCursorRendererNative *native)
+{
+  MetaCursorRendererNativePrivate *priv =
+    meta_cursor_renderer_native_get_instance_private (native);
+  MetaBackendNative *backend_native = META_BACKEND_NATIVE (priv->backend);
+
+  return meta_kms_get_cursor_manager (meta_backend_native_get_kms (backend_native));
+}
+
 static void
 assign_cursor_plane (MetaCursorRendererNative *native,
                      MetaCrtcKms              *crtc_kms,
                      int                       x,
                      int                       y,
+                     MetaKmsCursorPlacement   *placement,
                      MetaCursorSprite         *cursor_sprite)
 {
   MetaCrtc *crtc = META_CRTC (crtc_kms);
@@ -364,6 +410,17 @@ assign_cursor_plane (MetaCursorRendererNative *native,
                                        on_kms_update_result,
                                        native);
 
+  placement->src_rect = src_rect;
+  placement->plane_width = cursor_width;
+  placement->plane_height = cursor_height;
+  placement->hotspot_x = cursor_hotspot_x;
+  placement->hotspot_y = cursor_hotspot_y;
+  meta_kms_cursor_manager_update_crtc (get_kms_cursor_manager (native),
+                                       kms_crtc,
+                                       cursor_plane,
+                                       buffer,
+                                       placement);
+
   crtc_cursor_data->buffer = buffer;
 
   if (cursor_gpu_state->pending_buffer_state == META_CURSOR_BUFFER_STATE_SET)
@@ -416,6 +473,9 @@ set_crtc_cursor (MetaCursorRendererNative *cursor_renderer_native,
   MetaMonitorMode *monitor_mode;
   MetaMonitorCrtcMode *monitor_crtc_mode;
   const MetaCrtcModeInfo *crtc_mode_info;
+  MetaKmsCursorPlacement placement;
+  int hot_x, hot_y;
+  float texture_scale;
 
   view_scale = clutter_stage_view_get_scale (CLUTTER_STAGE_VIEW (view));
 
@@ -461,6 +521,22 @@ set_crtc_cursor (MetaCursorRendererNative *cursor_renderer_native,
                                                              monitor_mode,
                                                              output);
   crtc_mode_info = meta_crtc_mode_get_info (monitor_crtc_mode->crtc_mode);
+
+  /* Lets the cursor be moved from the input thread without a new frame */
+  meta_cursor_sprite_get_hotspot (cursor_sprite, &hot_x, &hot_y);
+  texture_scale = meta_cursor_sprite_get_texture_scale (cursor_sprite);
+  placement = (MetaKmsCursorPlacement) {
+    .sprite_offset = GRAPHENE_POINT_INIT (-hot_x * texture_scale,
+                                          -hot_y * texture_scale),
+    .crtc_origin = crtc_config->layout.origin,
+    .scale = view_scale,
+    .transform = inverted_transform,
+    .crtc_width = crtc_mode_info->width,
+    .crtc_height = crtc_mode_info->height,
+    .width = cursor_rect.width,
+    .height = cursor_rect.height,
+  };
+
   meta_rectangle_transform (&cursor_rect,
                             inverted_transform,
                             crtc_mode_info->width,
@@ -471,6 +547,7 @@ set_crtc_cursor (MetaCursorRendererNative *cursor_renderer_native,
                        META_CRTC_KMS (crtc),
                        cursor_rect.x,
                        cursor_rect.y,
+                       &placement,
                        cursor_sprite);
 }
 
@@ -494,6 +571,9 @@ unset_crtc_cursor (MetaCursorRendererNative *native,
   kms_device = meta_kms_crtc_get_device (kms_crtc);
   cursor_plane = meta_kms_device_get_cursor_plane_for (kms_device, kms_crtc);
 
+  meta_kms_cursor_manager_unset_crtc (get_kms_cursor_manager (native),
+                                      kms_crtc);
+
   if (cursor_plane)
     {
       MetaKms *kms = meta_kms_device_get_kms (kms_device);
@@ -1218,10 +1298,9 @@ ensure_cursor_priv (MetaCursorSprite *cursor_sprite)
   return cursor_priv;
 }
 
-static void
+static MetaDrmBuffer *
 load_cursor_sprite_gbm_buffer_for_gpu (MetaCursorRendererNative *native,
                                        MetaGpuKms               *gpu_kms,
-                                       MetaCursorSprite         *cursor_sprite,
                                        uint8_t                  *pixels,
                                        uint                      width,
                                        uint                      height,
@@ -1237,7 +1316,7 @@ load_cursor_sprite_gbm_buffer_for_gpu (MetaCursorRendererNative *native,
   cursor_renderer_gpu_data =
     meta_cursor_renderer_native_gpu_data_from_gpu (gpu_kms);
   if (!cursor_renderer_gpu_data)
-    return;
+    return NULL;
 
   cursor_width = (uint64_t) cursor_renderer_gpu_data->cursor_width;
   cursor_height = (uint64_t) cursor_renderer_gpu_data->cursor_height;
@@ -1246,7 +1325,7 @@ load_cursor_sprite_gbm_buffer_for_gpu (MetaCursorRendererNative *native,
     {
       meta_warning ("Invalid theme cursor size (must be at most %ux%u)",
                     (unsigned int)cursor_width, (unsigned int)cursor_height);
-      return;
+      return NULL;
     }
 
   gbm_device = meta_gbm_device_from_gpu (gpu_kms);
@@ -1273,7 +1352,7 @@ load_cursor_sprite_gbm_buffer_for_gpu (MetaCursorRendererNative *native,
           g_warning ("Failed to open '%s' for updating the cursor: %s",
                      meta_gpu_kms_get_file_path (gpu_kms),
                      error->message);
-          return;
+          return NULL;
         }
 
       bo = gbm_bo_create (gbm_device, cursor_width, cursor_height,
@@ -1281,7 +1360,7 @@ load_cursor_sprite_gbm_buffer_for_gpu (MetaCursorRendererNative *native,
       if (!bo)
         {
           meta_warning ("Failed to allocate HW cursor buffer");
-          return;
+          return NULL;
         }
 
       memset (buf, 0, sizeof(buf));
@@ -1292,9 +1371,11 @@ load_cursor_sprite_gbm_buffer_for_gpu (MetaCursorRendererNative *native,
           meta_warning ("Failed to write cursors buffer data: %s",
                         g_strerror (errno));
           gbm_bo_destroy (bo);
-          return;
+          return NULL;
         }
 
+      priv->n_buffer_uploads++;
+
       flags = META_DRM_BUFFER_FLAG_DISABLE_MODIFIERS;
       buffer_gbm = meta_drm_buffer_gbm_new_take (device_file, bo, flags,
                                                  &error);
@@ -1303,15 +1384,15 @@ load_cursor_sprite_gbm_buffer_for_gpu (MetaCursorRendererNative *native,
           meta_warning ("Failed to create DRM buffer wrapper: %s",
                         error->message);
           gbm_bo_destroy (bo);
-          return;
+          return NULL;
         }
 
-      set_pending_cursor_sprite_buffer (cursor_sprite, gpu_kms,
-                                        META_DRM_BUFFER (buffer_gbm));
+      return META_DRM_BUFFER (buffer_gbm);
     }
   else
     {
       meta_warning ("HW cursor for format %d not supported", gbm_format);
+      return NULL;
     }
 }
 
@@ -1436,6 +1517,123 @@ scale_and_transform_cursor_sprite_cpu (uint8_t              *pixels,
   return target_surface;
 }
 
+static guint
+cursor_buffer_cache_entry_hash (gconstpointer key)
+{
+  const CursorBufferCacheEntry *entry = key;
+
+  return (g_bytes_hash (entry->pixels) ^
+          g_direct_hash (entry->gpu_kms) ^
+          (guint) entry->transform ^
+          (guint) (entry->scale * 1000));
+}
+
+static gboolean
+cursor_buffer_cache_entry_equal (gconstpointer a,
+                                 gconstpointer b)
+{
+  const CursorBufferCacheEntry *entry_a = a;
+  const CursorBufferCacheEntry *entry_b = b;
+
+  return (entry_a->gpu_kms == entry_b->gpu_kms &&
+          entry_a->width == entry_b->width &&
+          entry_a->height == entry_b->height &&
+          entry_a->rowstride == entry_b->rowstride &&
+          entry_a->gbm_format == entry_b->gbm_format &&
+          entry_a->scale == entry_b->scale &&
+          entry_a->transform == entry_b->transform &&
+          g_bytes_equal (entry_a->pixels, entry_b->pixels));
+}
+
+static void
+cursor_buffer_cache_entry_free (CursorBufferCacheEntry *entry)
+{
+  g_bytes_unref (entry->pixels);
+  g_object_unref (entry->buffer);
+  g_free (entry);
+}
+
+static MetaDrmBuffer *
+lookup_cached_cursor_buffer (MetaCursorRendererNative *native,
+                             CursorBufferCacheEntry   *lookup_entry)
+{
+  MetaCursorRendererNativePrivate *priv =
+    meta_cursor_renderer_native_get_instance_private (native);
+  CursorBufferCacheEntry *entry;
+
+  entry = g_hash_table_lookup (priv->buffer_cache, lookup_entry);
+  if (!entry)
+    return NULL;
+
+  g_queue_unlink (&priv->buffer_cache_lru, &entry->link);
+  g_queue_push_head_link (&priv->buffer_cache_lru, &entry->link);
+
+  return entry->buffer;
+}
+
+static void
+on_cached_gpu_finalized (gpointer  user_data,
+                         GObject  *where_the_object_was)
+{
+  MetaCursorRendererNative *native = user_data;
+  MetaCursorRendererNativePrivate *priv =
+    meta_cursor_renderer_native_get_instance_private (native);
+  GHashTableIter iter;
+  CursorBufferCacheEntry *entry;
+
+  priv->buffer_cache_gpus = g_list_remove (priv->buffer_cache_gpus,
+                                           where_the_object_was);
+
+  g_hash_table_iter_init (&iter, priv->buffer_cache);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &entry, NULL))
+    {
+      if ((GObject *) entry->gpu_kms != where_the_object_was)
+        continue;
+
+      g_queue_unlink (&priv->buffer_cache_lru, &entry->link);
+      g_hash_table_iter_remove (&iter);
+    }
+}
+
+static void
+cache_cursor_buffer (MetaCursorRendererNative *native,
+                     CursorBufferCacheEntry   *lookup_entry,
+                     MetaDrmBuffer            *buffer)
+{
+  MetaCursorRendererNativePrivate *priv =
+    meta_cursor_renderer_native_get_instance_private (native);
+  CursorBufferCacheEntry *entry;
+
+  if (g_queue_get_length (&priv->buffer_cache_lru) >= CURSOR_BUFFER_CACHE_SIZE)
+    {
+      GList *link;
+
+      link = g_queue_pop_tail_link (&priv->buffer_cache_lru);
+      g_hash_table_remove (priv->buffer_cache, link->data);
+    }
+
+  entry = g_new0 (CursorBufferCacheEntry, 1);
+  *entry = *lookup_entry;
+  entry->pixels = g_bytes_new (g_bytes_get_data (lookup_entry->pixels, NULL),
+                               g_bytes_get_size (lookup_entry->pixels));
+  entry->buffer = g_object_ref (buffer);
+  entry->link = (GList) { .data = entry };
+
+  g_hash_table_add (priv->buffer_cache, entry);
+  g_queue_push_head_link (&priv->buffer_cache_lru, &entry->link);
+
+  /* Entries are keyed on the GPU, so drop them before it can be replaced
+   * by another one at the same address. */
+  if (!g_list_find (priv->buffer_cache_gpus, entry->gpu_kms))
+    {
+      g_object_weak_ref (G_OBJECT (entry->gpu_kms),
+                         on_cached_gpu_finalized,
+                         native);
+      priv->buffer_cache_gpus = g_list_prepend (priv->buffer_cache_gpus,
+                                                entry->gpu_kms);
+    }
+}
+
 static void
 load_scaled_and_transformed_cursor_sprite (MetaCursorRendererNative *native,
                                            MetaGpuKms               *gpu_kms,
@@ -1448,6 +1646,34 @@ load_scaled_and_transformed_cursor_sprite (MetaCursorRendererNative *native,
                                            int                       rowstride,
                                            uint32_t                  gbm_format)
 {
+  g_autoptr (GBytes) pixels = NULL;
+  CursorBufferCacheEntry lookup_entry;
+  MetaDrmBuffer *buffer;
+
+  /* The same images are realized over and over again, e.g. for every frame
+   * of an animated cursor, or when moving between monitors with different
+   * scales or transforms, so look them up by content before scaling,
+   * transforming and uploading them again. */
+  pixels = g_bytes_new_static (data, (size_t) rowstride * height);
+  lookup_entry = (CursorBufferCacheEntry) {
+    .gpu_kms = gpu_kms,
+    .pixels = pixels,
+    .width = width,
+    .height = height,
+    .rowstride = rowstride,
+    .gbm_format = gbm_format,
+    .scale = relative_scale,
+    .transform = relative_transform,
+  };
+
+  buffer = lookup_cached_cursor_buffer (native, &lookup_entry);
+  if (buffer)
+    {
+      set_pending_cursor_sprite_buffer (cursor_sprite, gpu_kms,
+                                        g_object_ref (buffer));
+      return;
+    }
+
   if (!G_APPROX_VALUE (relative_scale, 1.f, FLT_EPSILON) ||
       relative_transform != META_MONITOR_TRANSFORM_NORMAL)
     {
@@ -1460,28 +1686,32 @@ load_scaled_and_transformed_cursor_sprite (MetaCursorRendererNative *native,
                                                        relative_scale,
                                                        relative_transform);
 
-      load_cursor_sprite_gbm_buffer_for_gpu (native,
-                                             gpu_kms,
-                                             cursor_sprite,
-                                             cairo_image_surface_get_data (surface),
-                                             cairo_image_surface_get_width (surface),
-                                             cairo_image_surface_get_width (surface),
-                                             cairo_image_surface_get_stride (surface),
-                                             gbm_format);
+      buffer = load_cursor_sprite_gbm_buffer_for_gpu (native,
+                                                      gpu_kms,
+                                                      cairo_image_surface_get_data (surface),
+                                                      cairo_image_surface_get_width (surface),
+                                                      cairo_image_surface_get_width (surface),
+                                                      cairo_image_surface_get_stride (surface),
+                                                      gbm_format);
 
       cairo_surface_destroy (surface);
     }
   else
     {
-      load_cursor_sprite_gbm_buffer_for_gpu (native,
-                                             gpu_kms,
-                                             cursor_sprite,
-                                             data,
-                                             width,
-                                             height,
-                                             rowstride,
-                                             gbm_format);
+      buffer = load_cursor_sprite_gbm_buffer_for_gpu (native,
+                                                      gpu_kms,
+                                                      data,
+                                                      width,
+                                                      height,
+                                                      rowstride,
+                                                      gbm_format);
     }
+
+  if (!buffer)
+    return;
+
+  cache_cursor_buffer (native, &lookup_entry, buffer);
+  set_pending_cursor_sprite_buffer (cursor_sprite, gpu_kms, buffer);
 }
 
 #ifdef HAVE_WAYLAND
@@ -1776,6 +2006,8 @@ force_update_hw_cursor (MetaCursorRendererNative *native)
     meta_cursor_renderer_native_get_instance_private (native);
   GList *l;
 
+  meta_kms_cursor_manager_reset (get_kms_cursor_manager (native));
+
   for (l = meta_backend_get_gpus (priv->backend); l; l = l->next)
     {
       MetaGpu *gpu = l->data;
@@ -1801,6 +2033,13 @@ on_monitors_changed (MetaMonitorManager       *monitors,
   force_update_hw_cursor (native);
 }
 
+static void
+on_power_save_mode_changed (MetaMonitorManager       *monitor_manager,
+                            MetaCursorRendererNative *native)
+{
+  force_update_hw_cursor (native);
+}
+
 static void
 init_hw_cursor_support_for_gpu (MetaGpuKms *gpu_kms)
 {
@@ -1869,6 +2108,9 @@ meta_cursor_renderer_native_new (MetaBackend        *backend,
   g_signal_connect_object (monitor_manager, "monitors-changed-internal",
                            G_CALLBACK (on_monitors_changed),
                            cursor_renderer_native, 0);
+  g_signal_connect_object (monitor_manager, "power-save-mode-changed",
+                           G_CALLBACK (on_power_save_mode_changed),
+                           cursor_renderer_native, 0);
   g_signal_connect (backend, "gpu-added",
                     G_CALLBACK (on_gpu_added_for_cursor), NULL);
 
@@ -1885,6 +2127,24 @@ meta_cursor_renderer_native_new (MetaBackend        *backend,
 static void
 meta_cursor_renderer_native_init (MetaCursorRendererNative *native)
 {
+  MetaCursorRendererNativePrivate *priv =
+    meta_cursor_renderer_native_get_instance_private (native);
+
+  priv->buffer_cache =
+    g_hash_table_new_full (cursor_buffer_cache_entry_hash,
+                           cursor_buffer_cache_entry_equal,
+                           (GDestroyNotify) cursor_buffer_cache_entry_free,
+                           NULL);
+  g_queue_init (&priv->buffer_cache_lru);
+}
+
+int
+meta_cursor_renderer_native_get_n_buffer_uploads (MetaCursorRendererNative *native)
+{
+  MetaCursorRendererNativePrivate *priv =
+    meta_cursor_renderer_native_get_instance_private (native);
+
+  return priv->n_buffer_uploads;
 }
 
 void
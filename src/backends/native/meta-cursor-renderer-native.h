@@ -27,9 +27,11 @@
 
 #include "backends/meta-cursor-renderer.h"
 #include "backends/native/meta-backend-native-types.h"
+#include "core/util-private.h"
 #include "meta/meta-backend.h"
 
 #define META_TYPE_CURSOR_RENDERER_NATIVE (meta_cursor_renderer_native_get_type ())
+META_EXPORT_TEST
 G_DECLARE_FINAL_TYPE (MetaCursorRendererNative, meta_cursor_renderer_native,
                       META, CURSOR_RENDERER_NATIVE,
                       MetaCursorRenderer)
@@ -44,4 +46,7 @@ void meta_cursor_renderer_native_invalidate_gpu_state (MetaCursorRendererNative
                                                        MetaCursorSprite         *cursor_sprite,
                                                        MetaGpuKms               *gpu_kms);
 
+META_EXPORT_TEST
+int meta_cursor_renderer_native_get_n_buffer_uploads (MetaCursorRendererNative *native);
+
 #endif /* META_CURSOR_RENDERER_NATIVE_H */
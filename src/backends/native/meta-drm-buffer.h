@@ -48,6 +48,7 @@ int meta_drm_buffer_export_fd (MetaDrmBuffer  *buffer,
 gboolean meta_drm_buffer_ensure_fb_id (MetaDrmBuffer  *buffer,
                                        GError        **error);
 
+META_EXPORT_TEST
 uint32_t meta_drm_buffer_get_fb_id (MetaDrmBuffer *buffer);
 
 int meta_drm_buffer_get_width (MetaDrmBuffer *buffer);
@@ -58,6 +59,7 @@ int meta_drm_buffer_get_stride (MetaDrmBuffer *buffer);
 
 int meta_drm_buffer_get_bpp (MetaDrmBuffer *buffer);
 
+META_EXPORT_TEST
 uint32_t meta_drm_buffer_get_format (MetaDrmBuffer *buffer);
 
 int meta_drm_buffer_get_offset (MetaDrmBuffer *buffer,
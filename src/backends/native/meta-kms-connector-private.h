@@ -31,9 +31,19 @@ typedef enum _MetaKmsConnectorProp
   META_KMS_CONNECTOR_PROP_UNDERSCAN_VBORDER,
   META_KMS_CONNECTOR_PROP_PRIVACY_SCREEN_SW_STATE,
   META_KMS_CONNECTOR_PROP_PRIVACY_SCREEN_HW_STATE,
+  META_KMS_CONNECTOR_PROP_EDID,
+  META_KMS_CONNECTOR_PROP_TILE,
+  META_KMS_CONNECTOR_PROP_SUGGESTED_X,
+  META_KMS_CONNECTOR_PROP_SUGGESTED_Y,
+  META_KMS_CONNECTOR_PROP_HOTPLUG_MODE_UPDATE,
+  META_KMS_CONNECTOR_PROP_SCALING_MODE,
+  META_KMS_CONNECTOR_PROP_PANEL_ORIENTATION,
+  META_KMS_CONNECTOR_PROP_NON_DESKTOP,
+  META_KMS_CONNECTOR_PROP_VRR_CAPABLE,
   META_KMS_CONNECTOR_N_PROPS
 } MetaKmsConnectorProp;
 
+META_EXPORT_TEST
 uint32_t meta_kms_connector_get_prop_id (MetaKmsConnector     *connector,
                                          MetaKmsConnectorProp  prop);
 
@@ -41,6 +51,7 @@ const char * meta_kms_connector_get_prop_name (MetaKmsConnector     *connector,
                                                MetaKmsConnectorProp  prop);
 
 MetaKmsUpdateChanges meta_kms_connector_update_state (MetaKmsConnector *connector,
+                                                      drmModeConnector *drm_connector,
                                                       drmModeRes       *drm_resources);
 
 void meta_kms_connector_disable (MetaKmsConnector *connector);
@@ -52,6 +52,11 @@ struct _MetaKmsConnector
 
   MetaKmsConnectorPropTable prop_table;
 
+  uint64_t panel_orientation_map[META_MONITOR_N_TRANSFORMS];
+  uint32_t panel_orientations;
+
+  GBytes *drm_snapshot;
+
   uint32_t edid_blob_id;
   uint32_t tile_blob_id;
 
@@ -196,38 +201,25 @@ sync_fd_held (MetaKmsConnector  *connector,
   connector->fd_held = should_hold_fd;
 }
 
-static void
-set_panel_orientation (MetaKmsConnectorState *state,
-                       drmModePropertyPtr     prop,
-                       uint64_t               orientation)
+static MetaMonitorTransform
+panel_orientation_to_transform (MetaKmsConnector *connector,
+                                uint64_t          orientation)
 {
-  const char *name;
+  MetaMonitorTransform transform;
 
-  name = prop->enums[orientation].name;
-  if (strcmp (name, "Upside Down") == 0)
-    {
-      state->panel_orientation_transform = META_MONITOR_TRANSFORM_180;
-    }
-  else if (strcmp (name, "Left Side Up") == 0)
+  for (transform = 0; transform < META_MONITOR_N_TRANSFORMS; transform++)
     {
-      /* Left side up, rotate 90 degrees counter clockwise to correct */
-      state->panel_orientation_transform = META_MONITOR_TRANSFORM_90;
-    }
-  else if (strcmp (name, "Right Side Up") == 0)
-    {
-      /* Right side up, rotate 270 degrees counter clockwise to correct */
-      state->panel_orientation_transform = META_MONITOR_TRANSFORM_270;
-    }
-  else
-    {
-      state->panel_orientation_transform = META_MONITOR_TRANSFORM_NORMAL;
+      if (connector->panel_orientations & (1 << transform) &&
+          connector->panel_orientation_map[transform] == orientation)
+        return transform;
     }
+
+  return META_MONITOR_TRANSFORM_NORMAL;
 }
 
 static void
 set_privacy_screen (MetaKmsConnectorState *state,
                     MetaKmsConnector      *connector,
-                    drmModePropertyPtr     prop,
                     uint64_t               value)
 {
   if (!meta_kms_connector_is_privacy_screen_supported (connector))
@@ -258,48 +250,72 @@ set_privacy_screen (MetaKmsConnectorState *state,
     state->privacy_screen_state |= META_PRIVACY_SCREEN_LOCKED;
 }
 
+static gboolean
+find_connector_prop (MetaKmsConnector     *connector,
+                     uint32_t              prop_id,
+                     MetaKmsConnectorProp *out_prop)
+{
+  MetaKmsConnectorProp prop;
+
+  for (prop = 0; prop < META_KMS_CONNECTOR_N_PROPS; prop++)
+    {
+      if (connector->prop_table.props[prop].prop_id == prop_id)
+        {
+          *out_prop = prop;
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
 static void
 state_set_properties (MetaKmsConnectorState *state,
-                      MetaKmsImplDevice     *impl_device,
                       MetaKmsConnector      *connector,
                       drmModeConnector      *drm_connector)
 {
-  int fd;
   int i;
 
-  fd = meta_kms_impl_device_get_fd (impl_device);
-
   for (i = 0; i < drm_connector->count_props; i++)
     {
-      drmModePropertyPtr prop;
+      MetaKmsConnectorProp prop;
+      uint64_t value;
 
-      prop = drmModeGetProperty (fd, drm_connector->props[i]);
-      if (!prop)
+      if (!find_connector_prop (connector, drm_connector->props[i], &prop))
         continue;
 
-      if ((prop->flags & DRM_MODE_PROP_RANGE) &&
-          strcmp (prop->name, "suggested X") == 0)
-        state->suggested_x = drm_connector->prop_values[i];
-      else if ((prop->flags & DRM_MODE_PROP_RANGE) &&
-               strcmp (prop->name, "suggested Y") == 0)
-        state->suggested_y = drm_connector->prop_values[i];
-      else if ((prop->flags & DRM_MODE_PROP_RANGE) &&
-               strcmp (prop->name, "hotplug_mode_update") == 0)
-        state->hotplug_mode_update = drm_connector->prop_values[i];
-      else if (strcmp (prop->name, "scaling mode") == 0)
-        state->has_scaling = TRUE;
-      else if ((prop->flags & DRM_MODE_PROP_ENUM) &&
-               strcmp (prop->name, "panel orientation") == 0)
-        set_panel_orientation (state, prop, drm_connector->prop_values[i]);
-      else if ((prop->flags & DRM_MODE_PROP_RANGE) &&
-               strcmp (prop->name, "non-desktop") == 0)
-        state->non_desktop = drm_connector->prop_values[i];
-      else if (prop->prop_id == meta_kms_connector_get_prop_id (connector,
-                META_KMS_CONNECTOR_PROP_PRIVACY_SCREEN_HW_STATE))
-        set_privacy_screen (state, connector, prop,
-                            drm_connector->prop_values[i]);
-
-      drmModeFreeProperty (prop);
+      value = drm_connector->prop_values[i];
+
+      switch (prop)
+        {
+        case META_KMS_CONNECTOR_PROP_SUGGESTED_X:
+          state->suggested_x = value;
+          break;
+        case META_KMS_CONNECTOR_PROP_SUGGESTED_Y:
+          state->suggested_y = value;
+          break;
+        case META_KMS_CONNECTOR_PROP_HOTPLUG_MODE_UPDATE:
+          state->hotplug_mode_update = value;
+          break;
+        case META_KMS_CONNECTOR_PROP_SCALING_MODE:
+          state->has_scaling = TRUE;
+          break;
+        case META_KMS_CONNECTOR_PROP_PANEL_ORIENTATION:
+          state->panel_orientation_transform =
+            panel_orientation_to_transform (connector, value);
+          break;
+        case META_KMS_CONNECTOR_PROP_NON_DESKTOP:
+          state->non_desktop = value;
+          break;
+        case META_KMS_CONNECTOR_PROP_VRR_CAPABLE:
+          state->vrr_capable = value;
+          break;
+        case META_KMS_CONNECTOR_PROP_PRIVACY_SCREEN_HW_STATE:
+          set_privacy_screen (state, connector, value);
+          break;
+        default:
+          break;
+        }
     }
 }
 
@@ -401,35 +417,24 @@ state_set_blobs (MetaKmsConnectorState *state,
                  MetaKmsImplDevice     *impl_device,
                  drmModeConnector      *drm_connector)
 {
-  int fd;
   int i;
 
-  fd = meta_kms_impl_device_get_fd (impl_device);
-
   for (i = 0; i < drm_connector->count_props; i++)
     {
-      drmModePropertyPtr prop;
+      MetaKmsConnectorProp prop;
+      uint32_t blob_id;
 
-      prop = drmModeGetProperty (fd, drm_connector->props[i]);
-      if (!prop)
+      if (!find_connector_prop (connector, drm_connector->props[i], &prop))
         continue;
 
-      if (prop->flags & DRM_MODE_PROP_BLOB)
-        {
-          uint32_t blob_id;
-
-          blob_id = drm_connector->prop_values[i];
-
-          if (blob_id)
-            {
-              if (strcmp (prop->name, "EDID") == 0)
-                state_set_edid (state, connector, impl_device, blob_id);
-              else if (strcmp (prop->name, "TILE") == 0)
-                state_set_tile_info (state, connector, impl_device, blob_id);
-            }
-        }
+      blob_id = drm_connector->prop_values[i];
+      if (!blob_id)
+        continue;
 
-      drmModeFreeProperty (prop);
+      if (prop == META_KMS_CONNECTOR_PROP_EDID)
+        state_set_edid (state, connector, impl_device, blob_id);
+      else if (prop == META_KMS_CONNECTOR_PROP_TILE)
+        state_set_tile_info (state, connector, impl_device, blob_id);
     }
 }
 
@@ -460,32 +465,19 @@ state_set_modes (MetaKmsConnectorState *state,
 }
 
 static void
-set_encoder_device_idx_bit (uint32_t          *encoder_device_idxs,
-                            uint32_t           encoder_id,
-                            MetaKmsImplDevice *impl_device,
-                            drmModeRes        *drm_resources)
+set_encoder_device_idx_bit (uint32_t   *encoder_device_idxs,
+                            uint32_t    encoder_id,
+                            drmModeRes *drm_resources)
 {
-  int fd;
   int i;
 
-  fd = meta_kms_impl_device_get_fd (impl_device);
-
   for (i = 0; i < drm_resources->count_encoders; i++)
     {
-      drmModeEncoder *drm_encoder;
-
-      drm_encoder = drmModeGetEncoder (fd, drm_resources->encoders[i]);
-      if (!drm_encoder)
-        continue;
-
-      if (drm_encoder->encoder_id == encoder_id)
+      if (drm_resources->encoders[i] == encoder_id)
         {
           *encoder_device_idxs |= (1 << i);
-          drmModeFreeEncoder (drm_encoder);
           break;
         }
-
-      drmModeFreeEncoder (drm_encoder);
     }
 }
 
@@ -519,7 +511,6 @@ state_set_crtc_state (MetaKmsConnectorState *state,
 
       set_encoder_device_idx_bit (&encoder_device_idxs,
                                   drm_encoder->encoder_id,
-                                  impl_device,
                                   drm_resources);
 
       if (drm_connector->encoder_id == drm_encoder->encoder_id)
@@ -622,6 +613,9 @@ meta_kms_connector_state_changes (MetaKmsConnectorState *state,
   if (state->hotplug_mode_update != new_state->hotplug_mode_update)
     return META_KMS_UPDATE_CHANGE_FULL;
 
+  if (state->vrr_capable != new_state->vrr_capable)
+    return META_KMS_UPDATE_CHANGE_FULL;
+
   if (state->panel_orientation_transform !=
       new_state->panel_orientation_transform)
     return META_KMS_UPDATE_CHANGE_FULL;
@@ -655,6 +649,77 @@ meta_kms_connector_update_state_changes (MetaKmsConnector      *connector,
     current_state->privacy_screen_state = new_state->privacy_screen_state;
 }
 
+static void
+append_snapshot_data (GByteArray *snapshot,
+                      const void *data,
+                      size_t      size)
+{
+  g_byte_array_append (snapshot, data, size);
+}
+
+static GBytes *
+snapshot_drm_connector (drmModeConnector *drm_connector)
+{
+  GByteArray *snapshot;
+
+  snapshot = g_byte_array_new ();
+
+  append_snapshot_data (snapshot, &drm_connector->connection,
+                        sizeof (drm_connector->connection));
+  append_snapshot_data (snapshot, &drm_connector->encoder_id,
+                        sizeof (drm_connector->encoder_id));
+  append_snapshot_data (snapshot, &drm_connector->mmWidth,
+                        sizeof (drm_connector->mmWidth));
+  append_snapshot_data (snapshot, &drm_connector->mmHeight,
+                        sizeof (drm_connector->mmHeight));
+  append_snapshot_data (snapshot, &drm_connector->subpixel,
+                        sizeof (drm_connector->subpixel));
+
+  append_snapshot_data (snapshot, &drm_connector->count_modes,
+                        sizeof (drm_connector->count_modes));
+  append_snapshot_data (snapshot, drm_connector->modes,
+                        drm_connector->count_modes *
+                        sizeof (drmModeModeInfo));
+
+  append_snapshot_data (snapshot, &drm_connector->count_props,
+                        sizeof (drm_connector->count_props));
+  append_snapshot_data (snapshot, drm_connector->props,
+                        drm_connector->count_props * sizeof (uint32_t));
+  append_snapshot_data (snapshot, drm_connector->prop_values,
+                        drm_connector->count_props * sizeof (uint64_t));
+
+  append_snapshot_data (snapshot, &drm_connector->count_encoders,
+                        sizeof (drm_connector->count_encoders));
+  append_snapshot_data (snapshot, drm_connector->encoders,
+                        drm_connector->count_encoders * sizeof (uint32_t));
+
+  return g_byte_array_free_to_bytes (snapshot);
+}
+
+static MetaKmsUpdateChanges
+refresh_crtc_state (MetaKmsConnectorState *state,
+                    drmModeConnector      *drm_connector,
+                    MetaKmsImplDevice     *impl_device,
+                    drmModeRes            *drm_resources)
+{
+  MetaKmsConnectorState new_state = { 0 };
+
+  state_set_crtc_state (&new_state, drm_connector, impl_device, drm_resources);
+
+  if (state->current_crtc_id == new_state.current_crtc_id &&
+      state->common_possible_crtcs == new_state.common_possible_crtcs &&
+      state->common_possible_clones == new_state.common_possible_clones &&
+      state->encoder_device_idxs == new_state.encoder_device_idxs)
+    return META_KMS_UPDATE_CHANGE_NONE;
+
+  state->current_crtc_id = new_state.current_crtc_id;
+  state->common_possible_crtcs = new_state.common_possible_crtcs;
+  state->common_possible_clones = new_state.common_possible_clones;
+  state->encoder_device_idxs = new_state.encoder_device_idxs;
+
+  return META_KMS_UPDATE_CHANGE_FULL;
+}
+
 static MetaKmsUpdateChanges
 meta_kms_connector_read_state (MetaKmsConnector  *connector,
                                MetaKmsImplDevice *impl_device,
@@ -663,10 +728,12 @@ meta_kms_connector_read_state (MetaKmsConnector  *connector,
 {
   g_autoptr (MetaKmsConnectorState) state = NULL;
   g_autoptr (MetaKmsConnectorState) current_state = NULL;
+  g_autoptr (GBytes) drm_snapshot = NULL;
   MetaKmsUpdateChanges connector_changes;
   MetaKmsUpdateChanges changes;
 
   current_state = g_steal_pointer (&connector->current_state);
+  drm_snapshot = g_steal_pointer (&connector->drm_snapshot);
   changes = META_KMS_UPDATE_CHANGE_NONE;
 
   if (!drm_connector)
@@ -687,11 +754,30 @@ meta_kms_connector_read_state (MetaKmsConnector  *connector,
       goto out;
     }
 
+  /* If nothing the kernel reports about the connector changed since the last
+   * read, there is no need to fetch the blobs and rebuild the modes again;
+   * only the encoder routing may have moved under us.
+   */
+  if (current_state && drm_snapshot)
+    {
+      g_autoptr (GBytes) new_drm_snapshot = NULL;
+
+      new_drm_snapshot = snapshot_drm_connector (drm_connector);
+      if (g_bytes_equal (drm_snapshot, new_drm_snapshot))
+        {
+          changes |= refresh_crtc_state (current_state, drm_connector,
+                                         impl_device, drm_resources);
+          connector->current_state = g_steal_pointer (&current_state);
+          connector->drm_snapshot = g_steal_pointer (&drm_snapshot);
+          goto out;
+        }
+    }
+
   state = meta_kms_connector_state_new ();
 
   state_set_blobs (state, connector, impl_device, drm_connector);
 
-  state_set_properties (state, impl_device, connector, drm_connector);
+  state_set_properties (state, connector, drm_connector);
 
   state->subpixel_order =
     drm_subpixel_order_to_cogl_subpixel_order (drm_connector->subpixel);
@@ -727,6 +813,8 @@ meta_kms_connector_read_state (MetaKmsConnector  *connector,
       connector->current_state = g_steal_pointer (&state);
     }
 
+  connector->drm_snapshot = snapshot_drm_connector (drm_connector);
+
 out:
   sync_fd_held (connector, impl_device);
 
@@ -735,22 +823,16 @@ out:
 
 MetaKmsUpdateChanges
 meta_kms_connector_update_state (MetaKmsConnector *connector,
+                                 drmModeConnector *drm_connector,
                                  drmModeRes       *drm_resources)
 {
   MetaKmsImplDevice *impl_device;
-  drmModeConnector *drm_connector;
-  MetaKmsUpdateChanges changes;
 
   impl_device = meta_kms_device_get_impl_device (connector->device);
-  drm_connector = drmModeGetConnector (meta_kms_impl_device_get_fd (impl_device),
-                                       connector->id);
-
-  changes = meta_kms_connector_read_state (connector, impl_device,
-                                           drm_connector,
-                                           drm_resources);
-  g_clear_pointer (&drm_connector, drmModeFreeConnector);
 
-  return changes;
+  return meta_kms_connector_read_state (connector, impl_device,
+                                        drm_connector,
+                                        drm_resources);
 }
 
 void
@@ -835,6 +917,48 @@ meta_kms_connector_predict_state (MetaKmsConnector *connector,
   sync_fd_held (connector, impl_device);
 }
 
+static void
+parse_panel_orientations (MetaKmsImplDevice  *impl_device,
+                          MetaKmsProp        *prop,
+                          drmModePropertyPtr  drm_prop,
+                          uint64_t            drm_prop_value,
+                          gpointer            user_data)
+{
+  MetaKmsConnector *connector = user_data;
+  int i;
+
+  for (i = 0; i < drm_prop->count_enums; i++)
+    {
+      MetaMonitorTransform transform = -1;
+
+      if (strcmp (drm_prop->enums[i].name, "Normal") == 0)
+        {
+          transform = META_MONITOR_TRANSFORM_NORMAL;
+        }
+      else if (strcmp (drm_prop->enums[i].name, "Upside Down") == 0)
+        {
+          transform = META_MONITOR_TRANSFORM_180;
+        }
+      else if (strcmp (drm_prop->enums[i].name, "Left Side Up") == 0)
+        {
+          /* Left side up, rotate 90 degrees counter clockwise to correct */
+          transform = META_MONITOR_TRANSFORM_90;
+        }
+      else if (strcmp (drm_prop->enums[i].name, "Right Side Up") == 0)
+        {
+          /* Right side up, rotate 270 degrees counter clockwise to correct */
+          transform = META_MONITOR_TRANSFORM_270;
+        }
+
+      if (transform != -1)
+        {
+          connector->panel_orientations |= 1 << transform;
+          connector->panel_orientation_map[transform] =
+            drm_prop->enums[i].value;
+        }
+    }
+}
+
 static void
 init_properties (MetaKmsConnector  *connector,
                  MetaKmsImplDevice *impl_device,
@@ -879,6 +1003,52 @@ init_properties (MetaKmsConnector  *connector,
           .name = "privacy-screen hw-state",
           .type = DRM_MODE_PROP_ENUM,
         },
+      [META_KMS_CONNECTOR_PROP_EDID] =
+        {
+          .name = "EDID",
+          .type = DRM_MODE_PROP_BLOB,
+        },
+      [META_KMS_CONNECTOR_PROP_TILE] =
+        {
+          .name = "TILE",
+          .type = DRM_MODE_PROP_BLOB,
+        },
+      [META_KMS_CONNECTOR_PROP_SUGGESTED_X] =
+        {
+          .name = "suggested X",
+          .type = DRM_MODE_PROP_RANGE,
+        },
+      [META_KMS_CONNECTOR_PROP_SUGGESTED_Y] =
+        {
+          .name = "suggested Y",
+          .type = DRM_MODE_PROP_RANGE,
+        },
+      [META_KMS_CONNECTOR_PROP_HOTPLUG_MODE_UPDATE] =
+        {
+          .name = "hotplug_mode_update",
+          .type = DRM_MODE_PROP_RANGE,
+        },
+      [META_KMS_CONNECTOR_PROP_SCALING_MODE] =
+        {
+          .name = "scaling mode",
+          .type = DRM_MODE_PROP_ENUM,
+        },
+      [META_KMS_CONNECTOR_PROP_PANEL_ORIENTATION] =
+        {
+          .name = "panel orientation",
+          .type = DRM_MODE_PROP_ENUM,
+          .parse = parse_panel_orientations,
+        },
+      [META_KMS_CONNECTOR_PROP_NON_DESKTOP] =
+        {
+          .name = "non-desktop",
+          .type = DRM_MODE_PROP_RANGE,
+        },
+      [META_KMS_CONNECTOR_PROP_VRR_CAPABLE] =
+        {
+          .name = "vrr_capable",
+          .type = DRM_MODE_PROP_RANGE,
+        },
     }
   };
 
@@ -888,7 +1058,7 @@ init_properties (MetaKmsConnector  *connector,
                                         drm_connector->count_props,
                                         connector->prop_table.props,
                                         META_KMS_CONNECTOR_N_PROPS,
-                                        NULL);
+                                        connector);
 }
 
 static char *
@@ -971,6 +1141,7 @@ meta_kms_connector_finalize (GObject *object)
     }
 
   g_clear_pointer (&connector->current_state, meta_kms_connector_state_free);
+  g_clear_pointer (&connector->drm_snapshot, g_bytes_unref);
   g_free (connector->name);
 
   G_OBJECT_CLASS (meta_kms_connector_parent_class)->finalize (object);
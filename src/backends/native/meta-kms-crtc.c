@@ -92,6 +92,12 @@ meta_kms_crtc_is_active (MetaKmsCrtc *crtc)
   return crtc->current_state.is_active;
 }
 
+gboolean
+meta_kms_crtc_is_vrr_supported (MetaKmsCrtc *crtc)
+{
+  return !!crtc->prop_table.props[META_KMS_CRTC_PROP_VRR_ENABLED].prop_id;
+}
+
 static void
 read_gamma_state (MetaKmsCrtc       *crtc,
                   MetaKmsCrtcState  *crtc_state,
@@ -137,6 +143,9 @@ meta_kms_crtc_state_changes (MetaKmsCrtcState *state,
   if (!meta_drm_mode_equal (&state->drm_mode, &other_state->drm_mode))
     return META_KMS_UPDATE_CHANGE_FULL;
 
+  if (state->vrr_enabled != other_state->vrr_enabled)
+    return META_KMS_UPDATE_CHANGE_FULL;
+
   if (state->gamma.size != other_state->gamma.size)
     return META_KMS_UPDATE_CHANGE_GAMMA;
 
@@ -191,7 +200,9 @@ meta_kms_crtc_read_state (MetaKmsCrtc             *crtc,
   MetaKmsCrtcState crtc_state = {0};
   MetaKmsUpdateChanges changes = META_KMS_UPDATE_CHANGE_NONE;
   MetaKmsProp *active_prop;
+  MetaKmsProp *vrr_enabled_prop;
   int active_idx;
+  int vrr_enabled_idx;
 
   crtc_state.rect = (MetaRectangle) {
     .x = drm_crtc->x,
@@ -217,6 +228,15 @@ meta_kms_crtc_read_state (MetaKmsCrtc             *crtc,
       crtc_state.is_active = drm_crtc->mode_valid;
     }
 
+  vrr_enabled_prop = &crtc->prop_table.props[META_KMS_CRTC_PROP_VRR_ENABLED];
+  if (vrr_enabled_prop->prop_id)
+    {
+      vrr_enabled_idx = find_prop_idx (vrr_enabled_prop,
+                                       drm_props->props,
+                                       drm_props->count_props);
+      crtc_state.vrr_enabled = !!drm_props->prop_values[vrr_enabled_idx];
+    }
+
   if (!crtc_state.is_active)
     {
       if (crtc->current_state.is_active)
@@ -232,11 +252,12 @@ meta_kms_crtc_read_state (MetaKmsCrtc             *crtc,
   crtc->current_state = crtc_state;
 
   meta_topic (META_DEBUG_KMS,
-              "Read CRTC %u state: active: %d, mode: %s, changed: %s",
+              "Read CRTC %u state: active: %d, mode: %s, vrr: %d, changed: %s",
               crtc->id, crtc->current_state.is_active,
               crtc->current_state.is_drm_mode_valid
                 ? crtc->current_state.drm_mode.name
                 : "(nil)",
+              crtc->current_state.vrr_enabled,
               changes == META_KMS_UPDATE_CHANGE_NONE
                 ? "no"
                 : "yes");
@@ -292,6 +313,7 @@ meta_kms_crtc_predict_state (MetaKmsCrtc   *crtc,
 {
   GList *mode_sets;
   GList *crtc_gammas;
+  GList *crtc_updates;
   GList *l;
 
   mode_sets = meta_kms_update_get_mode_sets (update);
@@ -347,6 +369,20 @@ meta_kms_crtc_predict_state (MetaKmsCrtc   *crtc,
 
       break;
     }
+
+  crtc_updates = meta_kms_update_get_crtc_updates (update);
+  for (l = crtc_updates; l; l = l->next)
+    {
+      MetaKmsCrtcUpdate *crtc_update = l->data;
+
+      if (crtc_update->crtc != crtc)
+        continue;
+
+      if (crtc_update->vrr.has_update)
+        crtc->current_state.vrr_enabled = crtc_update->vrr.is_enabled;
+
+      break;
+    }
 }
 
 static void
@@ -388,6 +424,11 @@ init_proporties (MetaKmsCrtc       *crtc,
           .name = "GAMMA_LUT",
           .type = DRM_MODE_PROP_BLOB,
         },
+      [META_KMS_CRTC_PROP_VRR_ENABLED] =
+        {
+          .name = "VRR_ENABLED",
+          .type = DRM_MODE_PROP_RANGE,
+        },
     }
   };
 
@@ -31,6 +31,7 @@
 typedef struct _MetaKmsCrtcState
 {
   gboolean is_active;
+  gboolean vrr_enabled;
 
   MetaRectangle rect;
   gboolean is_drm_mode_valid;
@@ -74,6 +75,9 @@ int meta_kms_crtc_get_idx (MetaKmsCrtc *crtc);
 META_EXPORT_TEST
 gboolean meta_kms_crtc_is_active (MetaKmsCrtc *crtc);
 
+META_EXPORT_TEST
+gboolean meta_kms_crtc_is_vrr_supported (MetaKmsCrtc *crtc);
+
 void meta_kms_crtc_gamma_free (MetaKmsCrtcGamma *gamma);
 
 MetaKmsCrtcGamma * meta_kms_crtc_gamma_new (MetaKmsCrtc    *crtc,
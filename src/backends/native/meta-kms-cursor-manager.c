@@ -0,0 +1,599 @@
+/*
+ * Copyright (C) 2022 Red Hat
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Moves the hardware cursor directly from the input thread, without waiting
+ * for the next stage view frame.
+ *
+ * The cursor renderer publishes the cursor buffer and how the pointer
+ * position maps to each CRTC whenever it assigns a cursor plane. Pointer
+ * motion is then passed straight from the input thread to the KMS impl
+ * thread, which commits cursor-only updates moving the cursor plane. Cursor
+ * plane assignments of regular updates are adjusted to the latest pointer
+ * position as well, so that a frame prepared earlier never moves the cursor
+ * back.
+ *
+ * A cursor-only commit while a page flip is pending on the CRTC would make
+ * either of them fail, so the move is then held back until the flip
+ * completed, unless the flip itself already placed the cursor.
+ *
+ * This is only done when the KMS impl runs in its own thread; otherwise the
+ * cursor keeps following the frame clock.
+ */
+
+#include "config.h"
+
+#include "backends/native/meta-kms-cursor-manager.h"
+
+#include <math.h>
+
+#include "backends/native/meta-drm-buffer.h"
+#include "backends/native/meta-kms-crtc.h"
+#include "backends/native/meta-kms-device-private.h"
+#include "backends/native/meta-kms-impl-device.h"
+#include "backends/native/meta-kms-plane.h"
+#include "backends/native/meta-kms-private.h"
+#include "backends/native/meta-kms-update-private.h"
+#include "cogl/cogl.h"
+#include "core/boxes-private.h"
+#include "meta/util.h"
+
+/* Generation of a cursor plane without buffer */
+#define NO_BUFFER_GENERATION 0
+/* Generation of a buffer that was replaced before it was committed */
+#define UNKNOWN_BUFFER_GENERATION G_MAXUINT64
+
+typedef struct _CrtcCursorState
+{
+  MetaKmsPlane *cursor_plane;
+  MetaDrmBuffer *buffer;
+  uint64_t buffer_generation;
+  MetaKmsCursorPlacement placement;
+
+  /* Generation of the buffer last successfully committed in the impl
+   * context. Buffers may be freed and reallocated at the same address, so
+   * they are told apart by generation rather than by pointer. */
+  uint64_t committed_generation;
+
+  gboolean needs_move;
+} CrtcCursorState;
+
+struct _MetaKmsCursorManager
+{
+  MetaKms *kms;
+
+  GMutex mutex;
+
+  GHashTable *crtc_states;
+  uint64_t last_buffer_generation;
+
+  gboolean has_position;
+  graphene_point_t position;
+
+  gboolean is_update_queued;
+  int64_t queued_time_us;
+
+  unsigned int n_commits;
+  int64_t last_latency_us;
+};
+
+static void
+crtc_cursor_state_free (CrtcCursorState *crtc_state)
+{
+  g_clear_object (&crtc_state->buffer);
+  g_free (crtc_state);
+}
+
+MetaKmsCursorManager *
+meta_kms_cursor_manager_new (MetaKms *kms)
+{
+  MetaKmsCursorManager *cursor_manager;
+
+  cursor_manager = g_new0 (MetaKmsCursorManager, 1);
+  cursor_manager->kms = kms;
+  g_mutex_init (&cursor_manager->mutex);
+  cursor_manager->crtc_states =
+    g_hash_table_new_full (NULL, NULL,
+                           NULL, (GDestroyNotify) crtc_cursor_state_free);
+
+  return cursor_manager;
+}
+
+void
+meta_kms_cursor_manager_free (MetaKmsCursorManager *cursor_manager)
+{
+  g_hash_table_unref (cursor_manager->crtc_states);
+  g_mutex_clear (&cursor_manager->mutex);
+  g_free (cursor_manager);
+}
+
+void
+meta_kms_cursor_manager_update_crtc (MetaKmsCursorManager         *cursor_manager,
+                                     MetaKmsCrtc                  *crtc,
+                                     MetaKmsPlane                 *cursor_plane,
+                                     MetaDrmBuffer                *buffer,
+                                     const MetaKmsCursorPlacement *placement)
+{
+  g_autoptr (MetaDrmBuffer) old_buffer = NULL;
+  CrtcCursorState *crtc_state;
+
+  g_mutex_lock (&cursor_manager->mutex);
+
+  crtc_state = g_hash_table_lookup (cursor_manager->crtc_states, crtc);
+  if (!crtc_state)
+    {
+      crtc_state = g_new0 (CrtcCursorState, 1);
+      g_hash_table_insert (cursor_manager->crtc_states, crtc, crtc_state);
+    }
+
+  crtc_state->cursor_plane = cursor_plane;
+  if (crtc_state->buffer != buffer)
+    {
+      old_buffer = g_steal_pointer (&crtc_state->buffer);
+      crtc_state->buffer = g_object_ref (buffer);
+      crtc_state->buffer_generation =
+        ++cursor_manager->last_buffer_generation;
+    }
+  crtc_state->placement = *placement;
+
+  g_mutex_unlock (&cursor_manager->mutex);
+}
+
+void
+meta_kms_cursor_manager_unset_crtc (MetaKmsCursorManager *cursor_manager,
+                                    MetaKmsCrtc          *crtc)
+{
+  CrtcCursorState *crtc_state = NULL;
+
+  g_mutex_lock (&cursor_manager->mutex);
+  g_hash_table_steal_extended (cursor_manager->crtc_states, crtc,
+                               NULL, (gpointer *) &crtc_state);
+  g_mutex_unlock (&cursor_manager->mutex);
+
+  g_clear_pointer (&crtc_state, crtc_cursor_state_free);
+}
+
+void
+meta_kms_cursor_manager_reset (MetaKmsCursorManager *cursor_manager)
+{
+  g_autoptr (GHashTable) crtc_states = NULL;
+
+  g_mutex_lock (&cursor_manager->mutex);
+  crtc_states = g_steal_pointer (&cursor_manager->crtc_states);
+  cursor_manager->crtc_states =
+    g_hash_table_new_full (NULL, NULL,
+                           NULL, (GDestroyNotify) crtc_cursor_state_free);
+  g_mutex_unlock (&cursor_manager->mutex);
+}
+
+static gboolean
+calculate_cursor_rect (CrtcCursorState        *crtc_state,
+                       const graphene_point_t *position,
+                       MetaRectangle          *out_rect)
+{
+  const MetaKmsCursorPlacement *placement = &crtc_state->placement;
+  MetaRectangle crtc_rect;
+  MetaRectangle cursor_rect;
+  float crtc_cursor_x, crtc_cursor_y;
+
+  crtc_cursor_x = (position->x + placement->sprite_offset.x -
+                   placement->crtc_origin.x) * placement->scale;
+  crtc_cursor_y = (position->y + placement->sprite_offset.y -
+                   placement->crtc_origin.y) * placement->scale;
+
+  cursor_rect = (MetaRectangle) {
+    .x = floorf (crtc_cursor_x),
+    .y = floorf (crtc_cursor_y),
+    .width = placement->width,
+    .height = placement->height,
+  };
+  meta_rectangle_transform (&cursor_rect,
+                            placement->transform,
+                            placement->crtc_width,
+                            placement->crtc_height,
+                            out_rect);
+
+  crtc_rect = (MetaRectangle) {
+    .width = placement->crtc_width,
+    .height = placement->crtc_height,
+  };
+  return meta_rectangle_overlap (out_rect, &crtc_rect);
+}
+
+static void
+release_buffer (MetaKms  *kms,
+                gpointer  user_data)
+{
+  MetaDrmBuffer *buffer = user_data;
+
+  g_object_unref (buffer);
+}
+
+static void
+move_cursor (MetaKmsCursorManager *cursor_manager)
+{
+  g_autoptr (GList) updates = NULL;
+  GHashTableIter iter;
+  MetaKmsCrtc *crtc;
+  CrtcCursorState *crtc_state;
+  int64_t queued_time_us;
+  GList *l;
+
+  COGL_TRACE_BEGIN_SCOPED (MetaKmsMoveCursor, "KMS (move cursor)");
+
+  g_mutex_lock (&cursor_manager->mutex);
+
+  cursor_manager->is_update_queued = FALSE;
+  queued_time_us = cursor_manager->queued_time_us;
+
+  g_hash_table_iter_init (&iter, cursor_manager->crtc_states);
+  while (g_hash_table_iter_next (&iter,
+                                 (gpointer *) &crtc,
+                                 (gpointer *) &crtc_state))
+    {
+      const MetaKmsCursorPlacement *placement = &crtc_state->placement;
+      MetaKmsDevice *device = meta_kms_crtc_get_device (crtc);
+      MetaKmsImplDevice *impl_device = meta_kms_device_get_impl_device (device);
+      MetaKmsUpdate *update;
+      MetaKmsPlaneAssignment *plane_assignment;
+      MetaKmsAssignPlaneFlag flags;
+      MetaRectangle dst_rect;
+
+      if (meta_kms_impl_device_has_pending_page_flip (impl_device, crtc))
+        {
+          crtc_state->needs_move = TRUE;
+          continue;
+        }
+
+      crtc_state->needs_move = FALSE;
+
+      if (!calculate_cursor_rect (crtc_state,
+                                  &cursor_manager->position,
+                                  &dst_rect))
+        {
+          if (crtc_state->committed_generation == NO_BUFFER_GENERATION)
+            continue;
+
+          update = meta_kms_update_new (device);
+          meta_kms_update_unassign_plane (update,
+                                          crtc,
+                                          crtc_state->cursor_plane);
+          updates = g_list_prepend (updates, update);
+          continue;
+        }
+
+      dst_rect.width = placement->plane_width;
+      dst_rect.height = placement->plane_height;
+
+      flags = META_KMS_ASSIGN_PLANE_FLAG_ALLOW_FAIL;
+      if (crtc_state->buffer_generation == crtc_state->committed_generation)
+        flags |= META_KMS_ASSIGN_PLANE_FLAG_FB_UNCHANGED;
+
+      update = meta_kms_update_new (device);
+      plane_assignment = meta_kms_update_assign_plane (update,
+                                                       crtc,
+                                                       crtc_state->cursor_plane,
+                                                       crtc_state->buffer,
+                                                       placement->src_rect,
+                                                       dst_rect,
+                                                       flags);
+      meta_kms_plane_assignment_set_cursor_hotspot (plane_assignment,
+                                                    placement->hotspot_x,
+                                                    placement->hotspot_y);
+
+      /* Keep the buffer alive until the commit is done, even if the cursor
+       * changes meanwhile; it is released in the main context. */
+      g_object_ref (crtc_state->buffer);
+      updates = g_list_prepend (updates, update);
+    }
+
+  g_mutex_unlock (&cursor_manager->mutex);
+
+  for (l = updates; l; l = l->next)
+    {
+      MetaKmsUpdate *update = l->data;
+      MetaKmsDevice *device = meta_kms_update_get_device (update);
+      MetaKmsImplDevice *impl_device =
+        meta_kms_device_get_impl_device (device);
+      MetaKmsPlaneAssignment *plane_assignment;
+      MetaKmsFeedback *feedback;
+
+      plane_assignment = meta_kms_update_get_plane_assignments (update)->data;
+
+      meta_kms_update_lock (update);
+      feedback = meta_kms_impl_device_process_update (impl_device, update,
+                                                      META_KMS_UPDATE_FLAG_NONE);
+
+      /* Failing is fine; the cursor is then moved with the next frame
+       * instead. */
+      if (meta_kms_feedback_get_result (feedback) == META_KMS_FEEDBACK_PASSED)
+        {
+          g_mutex_lock (&cursor_manager->mutex);
+          cursor_manager->n_commits++;
+          cursor_manager->last_latency_us =
+            g_get_monotonic_time () - queued_time_us;
+          g_mutex_unlock (&cursor_manager->mutex);
+        }
+      else
+        {
+          meta_topic (META_DEBUG_KMS,
+                      "Moving cursor on CRTC %u failed: %s",
+                      meta_kms_crtc_get_id (plane_assignment->crtc),
+                      meta_kms_feedback_get_error (feedback)->message);
+        }
+
+      if (plane_assignment->buffer)
+        {
+          meta_kms_queue_callback (cursor_manager->kms,
+                                   release_buffer,
+                                   plane_assignment->buffer,
+                                   NULL);
+        }
+
+      meta_kms_feedback_free (feedback);
+      meta_kms_update_free (update);
+    }
+}
+
+static gpointer
+move_cursor_in_impl (MetaKmsImpl  *impl,
+                     gpointer      user_data,
+                     GError      **error)
+{
+  MetaKmsCursorManager *cursor_manager = user_data;
+
+  move_cursor (cursor_manager);
+
+  return GINT_TO_POINTER (TRUE);
+}
+
+/*
+ * Called from the input thread with the new pointer position, after any
+ * constraints were applied. @time_us is the time of the input event causing
+ * the motion.
+ */
+void
+meta_kms_cursor_manager_position_changed_in_input_impl (MetaKmsCursorManager   *cursor_manager,
+                                                        int64_t                 time_us,
+                                                        const graphene_point_t *position)
+{
+  gboolean queue_update = FALSE;
+
+  g_mutex_lock (&cursor_manager->mutex);
+
+  cursor_manager->has_position = TRUE;
+  cursor_manager->position = *position;
+
+  /* Coalesce motion until the impl context got to the queued update. */
+  if (!cursor_manager->is_update_queued &&
+      g_hash_table_size (cursor_manager->crtc_states) > 0 &&
+      meta_kms_has_impl_thread (cursor_manager->kms))
+    {
+      cursor_manager->is_update_queued = TRUE;
+      cursor_manager->queued_time_us = time_us;
+      queue_update = TRUE;
+    }
+
+  g_mutex_unlock (&cursor_manager->mutex);
+
+  if (queue_update)
+    {
+      meta_kms_run_impl_task_async (cursor_manager->kms,
+                                    move_cursor_in_impl,
+                                    cursor_manager);
+    }
+}
+
+/*
+ * Called in the impl context before committing @update, to place any cursor
+ * planes assigned by it at the latest known pointer position.
+ */
+void
+meta_kms_cursor_manager_update_in_impl (MetaKmsCursorManager *cursor_manager,
+                                        MetaKmsUpdate        *update)
+{
+  GList *l;
+
+  meta_assert_in_kms_impl (cursor_manager->kms);
+
+  g_mutex_lock (&cursor_manager->mutex);
+
+  for (l = meta_kms_update_get_plane_assignments (update); l; l = l->next)
+    {
+      MetaKmsPlaneAssignment *plane_assignment = l->data;
+      CrtcCursorState *crtc_state;
+      MetaRectangle dst_rect;
+
+      if (meta_kms_plane_get_plane_type (plane_assignment->plane) !=
+          META_KMS_PLANE_TYPE_CURSOR)
+        continue;
+
+      crtc_state = g_hash_table_lookup (cursor_manager->crtc_states,
+                                        plane_assignment->crtc);
+      if (!crtc_state)
+        continue;
+
+      crtc_state->needs_move = FALSE;
+
+      if (!cursor_manager->has_position ||
+          !plane_assignment->buffer ||
+          plane_assignment->buffer != crtc_state->buffer)
+        continue;
+
+      calculate_cursor_rect (crtc_state, &cursor_manager->position, &dst_rect);
+      plane_assignment->dst_rect.x = dst_rect.x;
+      plane_assignment->dst_rect.y = dst_rect.y;
+    }
+
+  g_mutex_unlock (&cursor_manager->mutex);
+}
+
+static gboolean
+did_plane_fail (MetaKmsFeedback *feedback,
+                MetaKmsPlane    *plane)
+{
+  GList *l;
+
+  for (l = meta_kms_feedback_get_failed_planes (feedback); l; l = l->next)
+    {
+      MetaKmsPlaneFeedback *plane_feedback = l->data;
+
+      if (plane_feedback->plane == plane)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/*
+ * Called in the impl context after committing @update, to keep track of the
+ * buffers on the cursor planes. Planes of failed commits keep what they had.
+ */
+void
+meta_kms_cursor_manager_update_committed_in_impl (MetaKmsCursorManager *cursor_manager,
+                                                  MetaKmsUpdate        *update,
+                                                  MetaKmsFeedback      *feedback)
+{
+  GList *l;
+
+  meta_assert_in_kms_impl (cursor_manager->kms);
+
+  if (meta_kms_feedback_get_result (feedback) != META_KMS_FEEDBACK_PASSED)
+    return;
+
+  g_mutex_lock (&cursor_manager->mutex);
+
+  for (l = meta_kms_update_get_plane_assignments (update); l; l = l->next)
+    {
+      MetaKmsPlaneAssignment *plane_assignment = l->data;
+      CrtcCursorState *crtc_state;
+
+      if (meta_kms_plane_get_plane_type (plane_assignment->plane) !=
+          META_KMS_PLANE_TYPE_CURSOR)
+        continue;
+
+      if (did_plane_fail (feedback, plane_assignment->plane))
+        continue;
+
+      crtc_state = g_hash_table_lookup (cursor_manager->crtc_states,
+                                        plane_assignment->crtc);
+      if (!crtc_state)
+        continue;
+
+      /* Buffers are kept alive by the poster of an update until it was
+       * processed, so one still being the current one can't have been
+       * reallocated meanwhile. */
+      if (!plane_assignment->buffer)
+        crtc_state->committed_generation = NO_BUFFER_GENERATION;
+      else if (plane_assignment->buffer == crtc_state->buffer)
+        crtc_state->committed_generation = crtc_state->buffer_generation;
+      else
+        crtc_state->committed_generation = UNKNOWN_BUFFER_GENERATION;
+    }
+
+  g_mutex_unlock (&cursor_manager->mutex);
+}
+
+static gboolean
+move_cursor_idle (gpointer user_data)
+{
+  MetaKmsCursorManager *cursor_manager = user_data;
+
+  move_cursor (cursor_manager);
+
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * Called in the impl context when a page flip on @crtc completed, to commit
+ * any cursor move that was held back while it was pending.
+ */
+void
+meta_kms_cursor_manager_crtc_flipped_in_impl (MetaKmsCursorManager *cursor_manager,
+                                              MetaKmsCrtc          *crtc)
+{
+  CrtcCursorState *crtc_state;
+  gboolean queue_update = FALSE;
+
+  meta_assert_in_kms_impl (cursor_manager->kms);
+
+  g_mutex_lock (&cursor_manager->mutex);
+
+  crtc_state = g_hash_table_lookup (cursor_manager->crtc_states, crtc);
+  if (crtc_state && crtc_state->needs_move &&
+      !cursor_manager->is_update_queued)
+    {
+      cursor_manager->is_update_queued = TRUE;
+      queue_update = TRUE;
+    }
+
+  g_mutex_unlock (&cursor_manager->mutex);
+
+  /* Commit outside of the page flip event dispatching. */
+  if (queue_update)
+    {
+      GSource *source;
+
+      source = meta_kms_add_source_in_impl (cursor_manager->kms,
+                                            move_cursor_idle,
+                                            cursor_manager,
+                                            NULL);
+      g_source_unref (source);
+    }
+}
+
+gboolean
+meta_kms_cursor_manager_has_cursor (MetaKmsCursorManager *cursor_manager)
+{
+  gboolean has_cursor;
+
+  g_mutex_lock (&cursor_manager->mutex);
+  has_cursor = g_hash_table_size (cursor_manager->crtc_states) > 0;
+  g_mutex_unlock (&cursor_manager->mutex);
+
+  return has_cursor;
+}
+
+unsigned int
+meta_kms_cursor_manager_get_n_commits (MetaKmsCursorManager *cursor_manager)
+{
+  unsigned int n_commits;
+
+  g_mutex_lock (&cursor_manager->mutex);
+  n_commits = cursor_manager->n_commits;
+  g_mutex_unlock (&cursor_manager->mutex);
+
+  return n_commits;
+}
+
+/*
+ * Returns the time from the input event to the cursor moving commit for the
+ * last cursor-only update committed.
+ */
+int64_t
+meta_kms_cursor_manager_get_last_latency_us (MetaKmsCursorManager *cursor_manager)
+{
+  int64_t last_latency_us;
+
+  g_mutex_lock (&cursor_manager->mutex);
+  last_latency_us = cursor_manager->last_latency_us;
+  g_mutex_unlock (&cursor_manager->mutex);
+
+  return last_latency_us;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2022 Red Hat
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef META_KMS_CURSOR_MANAGER_H
+#define META_KMS_CURSOR_MANAGER_H
+
+#include <glib.h>
+#include <graphene.h>
+#include <stdint.h>
+
+#include "backends/meta-monitor-transform.h"
+#include "backends/native/meta-backend-native-types.h"
+#include "backends/native/meta-kms-types.h"
+#include "core/util-private.h"
+
+typedef struct _MetaKmsCursorPlacement
+{
+  /* Cursor sprite origin relative to the pointer position, in stage
+   * coordinates. */
+  graphene_point_t sprite_offset;
+
+  /* Where the CRTC is in the stage, and how stage coordinates map to it. */
+  graphene_point_t crtc_origin;
+  float scale;
+  MetaMonitorTransform transform;
+  int crtc_width;
+  int crtc_height;
+
+  /* Size of the cursor sprite on the CRTC, before transforming. */
+  int width;
+  int height;
+
+  MetaFixed16Rectangle src_rect;
+  int plane_width;
+  int plane_height;
+  int hotspot_x;
+  int hotspot_y;
+} MetaKmsCursorPlacement;
+
+MetaKmsCursorManager * meta_kms_cursor_manager_new (MetaKms *kms);
+
+void meta_kms_cursor_manager_free (MetaKmsCursorManager *cursor_manager);
+
+void meta_kms_cursor_manager_update_crtc (MetaKmsCursorManager         *cursor_manager,
+                                          MetaKmsCrtc                  *crtc,
+                                          MetaKmsPlane                 *cursor_plane,
+                                          MetaDrmBuffer                *buffer,
+                                          const MetaKmsCursorPlacement *placement);
+
+void meta_kms_cursor_manager_unset_crtc (MetaKmsCursorManager *cursor_manager,
+                                         MetaKmsCrtc          *crtc);
+
+void meta_kms_cursor_manager_reset (MetaKmsCursorManager *cursor_manager);
+
+void meta_kms_cursor_manager_position_changed_in_input_impl (MetaKmsCursorManager   *cursor_manager,
+                                                             int64_t                 time_us,
+                                                             const graphene_point_t *position);
+
+void meta_kms_cursor_manager_update_in_impl (MetaKmsCursorManager *cursor_manager,
+                                             MetaKmsUpdate        *update);
+
+void meta_kms_cursor_manager_update_committed_in_impl (MetaKmsCursorManager *cursor_manager,
+                                                       MetaKmsUpdate        *update,
+                                                       MetaKmsFeedback      *feedback);
+
+void meta_kms_cursor_manager_crtc_flipped_in_impl (MetaKmsCursorManager *cursor_manager,
+                                                   MetaKmsCrtc          *crtc);
+
+META_EXPORT_TEST
+gboolean meta_kms_cursor_manager_has_cursor (MetaKmsCursorManager *cursor_manager);
+
+META_EXPORT_TEST
+unsigned int meta_kms_cursor_manager_get_n_commits (MetaKmsCursorManager *cursor_manager);
+
+META_EXPORT_TEST
+int64_t meta_kms_cursor_manager_get_last_latency_us (MetaKmsCursorManager *cursor_manager);
+
+#endif /* META_KMS_CURSOR_MANAGER_H */
@@ -130,6 +130,24 @@ meta_kms_device_uses_monotonic_clock (MetaKmsDevice *device)
   return device->caps.uses_monotonic_clock;
 }
 
+int
+meta_kms_device_get_n_avoided_test_commits (MetaKmsDevice *device)
+{
+  return meta_kms_impl_device_get_n_avoided_test_commits (device->impl_device);
+}
+
+int
+meta_kms_device_get_n_commits (MetaKmsDevice *device)
+{
+  return meta_kms_impl_device_get_n_commits (device->impl_device);
+}
+
+int
+meta_kms_device_get_presentation_skew_us (MetaKmsDevice *device)
+{
+  return meta_kms_impl_device_get_presentation_skew_us (device->impl_device);
+}
+
 GList *
 meta_kms_device_get_connectors (MetaKmsDevice *device)
 {
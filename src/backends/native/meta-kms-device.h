@@ -53,6 +53,15 @@ gboolean meta_kms_device_prefers_shadow_buffer (MetaKmsDevice *device);
 META_EXPORT_TEST
 gboolean meta_kms_device_uses_monotonic_clock (MetaKmsDevice *device);
 
+META_EXPORT_TEST
+int meta_kms_device_get_n_avoided_test_commits (MetaKmsDevice *device);
+
+META_EXPORT_TEST
+int meta_kms_device_get_n_commits (MetaKmsDevice *device);
+
+META_EXPORT_TEST
+int meta_kms_device_get_presentation_skew_us (MetaKmsDevice *device);
+
 META_EXPORT_TEST
 GList * meta_kms_device_get_connectors (MetaKmsDevice *device);
 
@@ -635,6 +635,37 @@ process_crtc_gamma (MetaKmsImplDevice  *impl_device,
   return TRUE;
 }
 
+static gboolean
+process_crtc_update (MetaKmsImplDevice  *impl_device,
+                     MetaKmsUpdate      *update,
+                     drmModeAtomicReq   *req,
+                     GArray             *blob_ids,
+                     gpointer            update_entry,
+                     gpointer            user_data,
+                     GError            **error)
+{
+  MetaKmsCrtcUpdate *crtc_update = update_entry;
+  MetaKmsCrtc *crtc = crtc_update->crtc;
+
+  if (crtc_update->vrr.has_update)
+    {
+      meta_topic (META_DEBUG_KMS,
+                  "[atomic] Setting VRR to %d on CRTC %u (%s)",
+                  crtc_update->vrr.is_enabled,
+                  meta_kms_crtc_get_id (crtc),
+                  meta_kms_impl_device_get_path (impl_device));
+
+      if (!add_crtc_property (impl_device,
+                              crtc, req,
+                              META_KMS_CRTC_PROP_VRR_ENABLED,
+                              crtc_update->vrr.is_enabled,
+                              error))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
 static gboolean
 process_page_flip_listener (MetaKmsImplDevice  *impl_device,
                             MetaKmsUpdate      *update,
@@ -978,6 +1009,16 @@ meta_kms_impl_device_atomic_process_update (MetaKmsImplDevice *impl_device,
                         &error))
     goto err;
 
+  if (!process_entries (impl_device,
+                        update,
+                        req,
+                        blob_ids,
+                        meta_kms_update_get_crtc_updates (update),
+                        NULL,
+                        process_crtc_update,
+                        &error))
+    goto err;
+
   if (meta_kms_update_get_mode_sets (update))
     commit_flags |= DRM_MODE_ATOMIC_ALLOW_MODESET;
   else
@@ -1096,6 +1137,18 @@ meta_kms_impl_device_atomic_discard_pending_page_flips (MetaKmsImplDevice *impl_
 {
 }
 
+static gboolean
+meta_kms_impl_device_atomic_has_pending_page_flip (MetaKmsImplDevice *impl_device,
+                                                   MetaKmsCrtc       *crtc)
+{
+  MetaKmsImplDeviceAtomic *impl_device_atomic =
+    META_KMS_IMPL_DEVICE_ATOMIC (impl_device);
+  uint32_t crtc_id = meta_kms_crtc_get_id (crtc);
+
+  return g_hash_table_contains (impl_device_atomic->page_flip_datas,
+                                GUINT_TO_POINTER (crtc_id));
+}
+
 static gboolean
 dispose_page_flip_data (gpointer key,
                         gpointer value,
@@ -1270,6 +1323,8 @@ meta_kms_impl_device_atomic_class_init (MetaKmsImplDeviceAtomicClass *klass)
     meta_kms_impl_device_atomic_handle_page_flip_callback;
   impl_device_class->discard_pending_page_flips =
     meta_kms_impl_device_atomic_discard_pending_page_flips;
+  impl_device_class->has_pending_page_flip =
+    meta_kms_impl_device_atomic_has_pending_page_flip;
   impl_device_class->prepare_shutdown =
     meta_kms_impl_device_atomic_prepare_shutdown;
 }
@@ -253,6 +253,58 @@ process_connector_update (MetaKmsImplDevice  *impl_device,
   return TRUE;
 }
 
+static gboolean
+process_crtc_update (MetaKmsImplDevice  *impl_device,
+                     MetaKmsUpdate      *update,
+                     gpointer            update_entry,
+                     GError            **error)
+{
+  MetaKmsCrtcUpdate *crtc_update = update_entry;
+  MetaKmsCrtc *crtc = crtc_update->crtc;
+  uint32_t prop_id;
+  int fd;
+  int ret;
+
+  if (!crtc_update->vrr.has_update)
+    return TRUE;
+
+  meta_topic (META_DEBUG_KMS,
+              "[simple] Setting VRR to %d on CRTC %u (%s)",
+              crtc_update->vrr.is_enabled,
+              meta_kms_crtc_get_id (crtc),
+              meta_kms_impl_device_get_path (impl_device));
+
+  prop_id = meta_kms_crtc_get_prop_id (crtc, META_KMS_CRTC_PROP_VRR_ENABLED);
+  if (!prop_id)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                   "Property (%s) not found on CRTC %u",
+                   meta_kms_crtc_get_prop_name (crtc,
+                                                META_KMS_CRTC_PROP_VRR_ENABLED),
+                   meta_kms_crtc_get_id (crtc));
+      return FALSE;
+    }
+
+  fd = meta_kms_impl_device_get_fd (impl_device);
+
+  ret = drmModeObjectSetProperty (fd,
+                                  meta_kms_crtc_get_id (crtc),
+                                  DRM_MODE_OBJECT_CRTC,
+                                  prop_id,
+                                  crtc_update->vrr.is_enabled);
+  if (ret != 0)
+    {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (-ret),
+                   "Failed to set CRTC %u property %u: %s",
+                   meta_kms_crtc_get_id (crtc),
+                   prop_id,
+                   g_strerror (-ret));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
 static CachedModeSet *
 cached_mode_set_new (GList                 *connectors,
                      const drmModeModeInfo *drm_mode,
@@ -1423,6 +1475,17 @@ perform_update_test (MetaKmsImplDevice *impl_device,
           !plane_assignment->buffer)
         continue;
 
+      if (meta_kms_plane_get_plane_type (plane) == META_KMS_PLANE_TYPE_OVERLAY)
+        {
+          MetaKmsPlaneFeedback *plane_feedback;
+
+          plane_feedback =
+            meta_kms_plane_feedback_new_failed (plane, crtc,
+                                                "Overlay planes cannot be assigned");
+          failed_planes = g_list_append (failed_planes, plane_feedback);
+          continue;
+        }
+
       cached_mode_set = get_cached_mode_set (impl_device_simple,
                                              plane_assignment->crtc);
       if (!cached_mode_set)
@@ -1503,6 +1566,13 @@ meta_kms_impl_device_simple_process_update (MetaKmsImplDevice *impl_device,
                         &error))
     goto err;
 
+  if (!process_entries (impl_device,
+                        update,
+                        meta_kms_update_get_crtc_updates (update),
+                        process_crtc_update,
+                        &error))
+    goto err;
+
   if (!process_plane_assignments (impl_device, update, &failed_planes, &error))
     goto err;
 
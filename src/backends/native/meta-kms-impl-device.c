@@ -26,16 +26,20 @@
 
 #include "backends/native/meta-backend-native.h"
 #include "backends/native/meta-device-pool.h"
+#include "backends/native/meta-drm-buffer.h"
 #include "backends/native/meta-kms-connector-private.h"
 #include "backends/native/meta-kms-connector.h"
 #include "backends/native/meta-kms-crtc-private.h"
 #include "backends/native/meta-kms-crtc.h"
+#include "backends/native/meta-kms-cursor-manager.h"
 #include "backends/native/meta-kms-impl.h"
 #include "backends/native/meta-kms-mode-private.h"
 #include "backends/native/meta-kms-page-flip-private.h"
 #include "backends/native/meta-kms-plane-private.h"
 #include "backends/native/meta-kms-plane.h"
 #include "backends/native/meta-kms-private.h"
+#include "backends/native/meta-kms-update-private.h"
+#include "backends/native/meta-kms-utils.h"
 
 #include "meta-default-modes.h"
 #include "meta-private-enum-types.h"
@@ -54,6 +58,8 @@ enum
 
 static GParamSpec *obj_props[N_PROPS];
 
+#define MAX_CACHED_TEST_RESULTS_PER_CRTC 64
+
 typedef struct _MetaKmsImplDevicePrivate
 {
   MetaKmsDevice *device;
@@ -76,6 +82,18 @@ typedef struct _MetaKmsImplDevicePrivate
   MetaKmsDeviceCaps caps;
 
   GList *fallback_modes;
+
+  /* MetaKmsCrtc -> (CRTC plane configuration -> MetaKmsTestResult) */
+  GHashTable *test_results;
+  /* MetaKmsPlane -> last committed plane configuration */
+  GHashTable *committed_plane_configurations;
+  int n_avoided_test_commits;
+
+  int n_commits;
+
+  MetaKmsCrtc *last_flip_crtc;
+  int64_t last_flip_time_us;
+  int presentation_skew_us;
 } MetaKmsImplDevicePrivate;
 
 static void
@@ -391,11 +409,13 @@ find_existing_connector (MetaKmsImplDevice *impl_device,
 
 static MetaKmsUpdateChanges
 update_connectors (MetaKmsImplDevice *impl_device,
-                   drmModeRes        *drm_resources)
+                   drmModeRes        *drm_resources,
+                   uint32_t           updated_connector_id)
 {
   MetaKmsImplDevicePrivate *priv =
     meta_kms_impl_device_get_instance_private (impl_device);
   g_autolist (MetaKmsConnector) connectors = NULL;
+  MetaKmsUpdateChanges changes = META_KMS_UPDATE_CHANGE_NONE;
   gboolean added_connector = FALSE;
   unsigned int i;
   int fd;
@@ -404,10 +424,22 @@ update_connectors (MetaKmsImplDevice *impl_device,
 
   for (i = 0; i < drm_resources->count_connectors; i++)
     {
+      uint32_t connector_id = drm_resources->connectors[i];
+      gboolean needs_probe;
       drmModeConnector *drm_connector;
       MetaKmsConnector *connector;
 
-      drm_connector = drmModeGetConnector (fd, drm_resources->connectors[i]);
+      /* Probing a connector may involve slow DDC transfers, so when a hotplug
+       * event names the connector that changed, only that one is probed. The
+       * state of the others is refreshed from what the kernel last probed.
+       */
+      needs_probe = (updated_connector_id == 0 ||
+                     connector_id == updated_connector_id);
+
+      if (needs_probe)
+        drm_connector = drmModeGetConnector (fd, connector_id);
+      else
+        drm_connector = drmModeGetConnectorCurrent (fd, connector_id);
       if (!drm_connector)
         continue;
 
@@ -415,9 +447,20 @@ update_connectors (MetaKmsImplDevice *impl_device,
       if (connector)
         {
           connector = g_object_ref (connector);
+          changes |= meta_kms_connector_update_state (connector,
+                                                      drm_connector,
+                                                      drm_resources);
         }
       else
         {
+          if (!needs_probe)
+            {
+              drmModeFreeConnector (drm_connector);
+              drm_connector = drmModeGetConnector (fd, connector_id);
+              if (!drm_connector)
+                continue;
+            }
+
           connector = meta_kms_connector_new (impl_device, drm_connector,
                                               drm_resources);
           added_connector = TRUE;
@@ -430,7 +473,7 @@ update_connectors (MetaKmsImplDevice *impl_device,
 
   if (!added_connector &&
       g_list_length (connectors) == g_list_length (priv->connectors))
-    return META_KMS_UPDATE_CHANGE_NONE;
+    return changes;
 
   g_list_free_full (priv->connectors, g_object_unref);
   priv->connectors = g_list_reverse (g_steal_pointer (&connectors));
@@ -719,6 +762,10 @@ meta_kms_impl_device_update_states (MetaKmsImplDevice *impl_device,
 
   meta_topic (META_DEBUG_KMS, "Updating device state for %s", priv->path);
 
+  /* Connectors, and thus the scanout constraints, may have changed */
+  g_hash_table_remove_all (priv->test_results);
+  g_hash_table_remove_all (priv->committed_plane_configurations);
+
   if (!ensure_device_file (impl_device, &error))
     {
       g_warning ("Failed to reopen '%s': %s", priv->path, error->message);
@@ -736,7 +783,7 @@ meta_kms_impl_device_update_states (MetaKmsImplDevice *impl_device,
       goto err;
     }
 
-  changes = update_connectors (impl_device, drm_resources);
+  changes = update_connectors (impl_device, drm_resources, connector_id);
 
   for (l = priv->crtcs; l; l = l->next)
     {
@@ -749,17 +796,6 @@ meta_kms_impl_device_update_states (MetaKmsImplDevice *impl_device,
       changes |= meta_kms_crtc_update_state (crtc);
     }
 
-  for (l = priv->connectors; l; l = l->next)
-    {
-      MetaKmsConnector *connector = META_KMS_CONNECTOR (l->data);
-
-      if (connector_id > 0 &&
-          meta_kms_connector_get_id (connector) != connector_id)
-        continue;
-
-      changes |= meta_kms_connector_update_state (connector, drm_resources);
-    }
-
   drmModeFreeResources (drm_resources);
 
   return changes;
@@ -802,12 +838,415 @@ meta_kms_impl_device_get_fd (MetaKmsImplDevice *impl_device)
   return meta_device_file_get_fd (priv->device_file);
 }
 
+typedef struct _MetaKmsTestResult
+{
+  MetaKmsFeedbackResult result;
+  GError *error;
+  GList *failed_planes;
+} MetaKmsTestResult;
+
+static GList *
+copy_failed_planes (GList *failed_planes)
+{
+  GList *copy = NULL;
+  GList *l;
+
+  for (l = failed_planes; l; l = l->next)
+    {
+      MetaKmsPlaneFeedback *plane_feedback = l->data;
+
+      copy = g_list_prepend (copy,
+                             meta_kms_plane_feedback_new_take_error (
+                               plane_feedback->plane,
+                               plane_feedback->crtc,
+                               g_error_copy (plane_feedback->error)));
+    }
+
+  return g_list_reverse (copy);
+}
+
+static MetaKmsTestResult *
+meta_kms_test_result_new (MetaKmsFeedback *feedback)
+{
+  MetaKmsTestResult *test_result;
+  const GError *error;
+
+  error = meta_kms_feedback_get_error (feedback);
+
+  test_result = g_new0 (MetaKmsTestResult, 1);
+  *test_result = (MetaKmsTestResult) {
+    .result = meta_kms_feedback_get_result (feedback),
+    .error = error ? g_error_copy (error) : NULL,
+    .failed_planes =
+      copy_failed_planes (meta_kms_feedback_get_failed_planes (feedback)),
+  };
+
+  return test_result;
+}
+
+static void
+meta_kms_test_result_free (MetaKmsTestResult *test_result)
+{
+  g_list_free_full (test_result->failed_planes,
+                    (GDestroyNotify) meta_kms_plane_feedback_free);
+  g_clear_error (&test_result->error);
+  g_free (test_result);
+}
+
+static MetaKmsFeedback *
+meta_kms_test_result_to_feedback (MetaKmsTestResult *test_result)
+{
+  GList *failed_planes;
+
+  failed_planes = copy_failed_planes (test_result->failed_planes);
+
+  if (test_result->result == META_KMS_FEEDBACK_PASSED)
+    {
+      return meta_kms_feedback_new_passed (failed_planes);
+    }
+  else
+    {
+      return meta_kms_feedback_new_failed (failed_planes,
+                                           g_error_copy (test_result->error));
+    }
+}
+
+static char *
+generate_plane_configuration (MetaKmsPlaneAssignment *plane_assignment)
+{
+  MetaDrmBuffer *buffer = plane_assignment->buffer;
+
+  if (!buffer)
+    return g_strdup ("off");
+
+  return g_strdup_printf ("%u/%x/%" G_GINT64_MODIFIER "x/%dx%d/%d/"
+                          "%d,%d,%d,%d/%d,%d,%d,%d/%" G_GINT64_MODIFIER "x",
+                          meta_kms_crtc_get_id (plane_assignment->crtc),
+                          meta_drm_buffer_get_format (buffer),
+                          meta_drm_buffer_get_modifier (buffer),
+                          meta_drm_buffer_get_width (buffer),
+                          meta_drm_buffer_get_height (buffer),
+                          meta_drm_buffer_get_stride (buffer),
+                          plane_assignment->src_rect.x,
+                          plane_assignment->src_rect.y,
+                          plane_assignment->src_rect.width,
+                          plane_assignment->src_rect.height,
+                          plane_assignment->dst_rect.x,
+                          plane_assignment->dst_rect.y,
+                          plane_assignment->dst_rect.width,
+                          plane_assignment->dst_rect.height,
+                          plane_assignment->rotation);
+}
+
+static MetaKmsPlaneAssignment *
+find_plane_assignment (MetaKmsUpdate *update,
+                       MetaKmsPlane  *plane)
+{
+  GList *l;
+
+  for (l = meta_kms_update_get_plane_assignments (update); l; l = l->next)
+    {
+      MetaKmsPlaneAssignment *plane_assignment = l->data;
+
+      if (plane_assignment->plane == plane)
+        return plane_assignment;
+    }
+
+  return NULL;
+}
+
+/*
+ * Test results are only reused for updates that do nothing but assign planes
+ * of a single CRTC. Such updates are described by the geometry and pixel
+ * layout of their buffers, but not the buffers themselves, so that e.g. every
+ * buffer of a client swap chain maps to the same configuration. Planes of the
+ * CRTC that the update leaves alone are described by what was last committed
+ * to them, as they take part in the test all the same.
+ */
+static char *
+generate_test_configuration (MetaKmsImplDevice  *impl_device,
+                             MetaKmsUpdate      *update,
+                             MetaKmsCrtc       **out_crtc)
+{
+  MetaKmsImplDevicePrivate *priv =
+    meta_kms_impl_device_get_instance_private (impl_device);
+  MetaKmsCrtc *crtc = NULL;
+  GString *configuration;
+  GList *l;
+  int i;
+
+  if (meta_kms_update_get_mode_sets (update) ||
+      meta_kms_update_get_connector_updates (update) ||
+      meta_kms_update_get_crtc_gammas (update) ||
+      meta_kms_update_get_crtc_updates (update))
+    return NULL;
+
+  for (l = meta_kms_update_get_plane_assignments (update); l; l = l->next)
+    {
+      MetaKmsPlaneAssignment *plane_assignment = l->data;
+
+      if (crtc && plane_assignment->crtc != crtc)
+        return NULL;
+      crtc = plane_assignment->crtc;
+    }
+
+  if (!crtc)
+    return NULL;
+
+  configuration = g_string_new (NULL);
+  for (l = priv->planes, i = 0; l; l = l->next, i++)
+    {
+      MetaKmsPlane *plane = l->data;
+      MetaKmsPlaneAssignment *plane_assignment;
+      const char *committed_configuration;
+
+      if (!meta_kms_plane_is_usable_with (plane, crtc))
+        continue;
+
+      g_string_append_printf (configuration, "%d:", i);
+
+      plane_assignment = find_plane_assignment (update, plane);
+      if (plane_assignment)
+        {
+          g_autofree char *plane_configuration = NULL;
+
+          plane_configuration = generate_plane_configuration (plane_assignment);
+          g_string_append_printf (configuration, "%s;", plane_configuration);
+          continue;
+        }
+
+      committed_configuration =
+        g_hash_table_lookup (priv->committed_plane_configurations, plane);
+      g_string_append_printf (configuration, "=%s;",
+                              committed_configuration ? committed_configuration
+                                                      : "?");
+    }
+
+  *out_crtc = crtc;
+  return g_string_free (configuration, FALSE);
+}
+
+static gboolean
+is_test_result_cacheable (MetaKmsFeedback *feedback)
+{
+  const GError *error;
+
+  if (meta_kms_feedback_get_result (feedback) == META_KMS_FEEDBACK_PASSED)
+    return TRUE;
+
+  /* Transient failures say nothing about the configuration itself */
+  error = meta_kms_feedback_get_error (feedback);
+  return !(g_error_matches (error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED) ||
+           g_error_matches (error, G_IO_ERROR, G_IO_ERROR_BUSY));
+}
+
+static MetaKmsFeedback *
+process_test_update (MetaKmsImplDevice *impl_device,
+                     MetaKmsUpdate     *update,
+                     MetaKmsUpdateFlag  flags)
+{
+  MetaKmsImplDevicePrivate *priv =
+    meta_kms_impl_device_get_instance_private (impl_device);
+  MetaKmsImplDeviceClass *klass = META_KMS_IMPL_DEVICE_GET_CLASS (impl_device);
+  g_autofree char *configuration = NULL;
+  MetaKmsCrtc *crtc = NULL;
+  GHashTable *crtc_test_results;
+  MetaKmsTestResult *cached_result = NULL;
+  MetaKmsFeedback *feedback;
+
+  configuration = generate_test_configuration (impl_device, update, &crtc);
+  if (!configuration)
+    return klass->process_update (impl_device, update, flags);
+
+  crtc_test_results = g_hash_table_lookup (priv->test_results, crtc);
+  if (crtc_test_results)
+    cached_result = g_hash_table_lookup (crtc_test_results, configuration);
+
+  if (cached_result)
+    {
+      int n_avoided_test_commits;
+
+      n_avoided_test_commits =
+        g_atomic_int_add (&priv->n_avoided_test_commits, 1) + 1;
+
+      meta_topic (META_DEBUG_KMS,
+                  "Reusing test result for CRTC %u on %s "
+                  "(%d test commits avoided)",
+                  meta_kms_crtc_get_id (crtc), priv->path,
+                  n_avoided_test_commits);
+
+      return meta_kms_test_result_to_feedback (cached_result);
+    }
+
+  feedback = klass->process_update (impl_device, update, flags);
+  if (!is_test_result_cacheable (feedback))
+    return feedback;
+
+  if (!crtc_test_results)
+    {
+      crtc_test_results =
+        g_hash_table_new_full (g_str_hash, g_str_equal,
+                               g_free,
+                               (GDestroyNotify) meta_kms_test_result_free);
+      g_hash_table_insert (priv->test_results, crtc, crtc_test_results);
+    }
+  else if (g_hash_table_size (crtc_test_results) >=
+           MAX_CACHED_TEST_RESULTS_PER_CRTC)
+    {
+      g_hash_table_remove_all (crtc_test_results);
+    }
+
+  g_hash_table_insert (crtc_test_results,
+                       g_steal_pointer (&configuration),
+                       meta_kms_test_result_new (feedback));
+
+  return feedback;
+}
+
+static gboolean
+is_plane_failed (MetaKmsFeedback *feedback,
+                 MetaKmsPlane    *plane)
+{
+  GList *l;
+
+  for (l = meta_kms_feedback_get_failed_planes (feedback); l; l = l->next)
+    {
+      MetaKmsPlaneFeedback *plane_feedback = l->data;
+
+      if (plane_feedback->plane == plane)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+update_committed_plane_configurations (MetaKmsImplDevice *impl_device,
+                                       MetaKmsUpdate     *update,
+                                       MetaKmsFeedback   *feedback)
+{
+  MetaKmsImplDevicePrivate *priv =
+    meta_kms_impl_device_get_instance_private (impl_device);
+  gboolean passed;
+  GList *l;
+
+  passed = meta_kms_feedback_get_result (feedback) == META_KMS_FEEDBACK_PASSED;
+
+  for (l = meta_kms_update_get_plane_assignments (update); l; l = l->next)
+    {
+      MetaKmsPlaneAssignment *plane_assignment = l->data;
+      MetaKmsPlane *plane = plane_assignment->plane;
+      char *configuration;
+
+      /* What is on a plane after a failed commit isn't known for sure */
+      if (!passed || is_plane_failed (feedback, plane))
+        {
+          g_hash_table_remove (priv->committed_plane_configurations, plane);
+          continue;
+        }
+
+      /* The cursor moves all the time, while where it is hardly matters for
+       * whether a configuration works, so only its buffer layout is kept. */
+      if (meta_kms_plane_get_plane_type (plane) == META_KMS_PLANE_TYPE_CURSOR &&
+          plane_assignment->buffer)
+        {
+          MetaDrmBuffer *buffer = plane_assignment->buffer;
+
+          configuration =
+            g_strdup_printf ("%u/%x/%dx%d",
+                             meta_kms_crtc_get_id (plane_assignment->crtc),
+                             meta_drm_buffer_get_format (buffer),
+                             meta_drm_buffer_get_width (buffer),
+                             meta_drm_buffer_get_height (buffer));
+        }
+      else
+        {
+          configuration = generate_plane_configuration (plane_assignment);
+        }
+
+      g_hash_table_insert (priv->committed_plane_configurations,
+                           plane, configuration);
+    }
+}
+
+static void
+invalidate_test_results (MetaKmsImplDevice *impl_device,
+                         MetaKmsUpdate     *update)
+{
+  MetaKmsImplDevicePrivate *priv =
+    meta_kms_impl_device_get_instance_private (impl_device);
+  GList *l;
+
+  for (l = meta_kms_update_get_mode_sets (update); l; l = l->next)
+    {
+      MetaKmsModeSet *mode_set = l->data;
+
+      g_hash_table_remove (priv->test_results, mode_set->crtc);
+    }
+}
+
+/*
+ * A commit failing for a configuration that passed testing means the cached
+ * results of its CRTCs can't be trusted anymore.
+ */
+static void
+maybe_forget_test_results (MetaKmsImplDevice *impl_device,
+                           MetaKmsUpdate     *update,
+                           MetaKmsFeedback   *feedback)
+{
+  MetaKmsImplDevicePrivate *priv =
+    meta_kms_impl_device_get_instance_private (impl_device);
+  GList *l;
+
+  /* Transient failures say nothing about the configuration itself */
+  if (meta_kms_feedback_get_result (feedback) == META_KMS_FEEDBACK_PASSED ||
+      !is_test_result_cacheable (feedback))
+    return;
+
+  for (l = meta_kms_update_get_plane_assignments (update); l; l = l->next)
+    {
+      MetaKmsPlaneAssignment *plane_assignment = l->data;
+
+      g_hash_table_remove (priv->test_results, plane_assignment->crtc);
+    }
+}
+
+int
+meta_kms_impl_device_get_n_avoided_test_commits (MetaKmsImplDevice *impl_device)
+{
+  MetaKmsImplDevicePrivate *priv =
+    meta_kms_impl_device_get_instance_private (impl_device);
+
+  return g_atomic_int_get (&priv->n_avoided_test_commits);
+}
+
+int
+meta_kms_impl_device_get_n_commits (MetaKmsImplDevice *impl_device)
+{
+  MetaKmsImplDevicePrivate *priv =
+    meta_kms_impl_device_get_instance_private (impl_device);
+
+  return g_atomic_int_get (&priv->n_commits);
+}
+
+int
+meta_kms_impl_device_get_presentation_skew_us (MetaKmsImplDevice *impl_device)
+{
+  MetaKmsImplDevicePrivate *priv =
+    meta_kms_impl_device_get_instance_private (impl_device);
+
+  return g_atomic_int_get (&priv->presentation_skew_us);
+}
+
 MetaKmsFeedback *
 meta_kms_impl_device_process_update (MetaKmsImplDevice *impl_device,
                                      MetaKmsUpdate     *update,
                                      MetaKmsUpdateFlag  flags)
 {
+  MetaKmsImplDevicePrivate *priv =
+    meta_kms_impl_device_get_instance_private (impl_device);
   MetaKmsImplDeviceClass *klass = META_KMS_IMPL_DEVICE_GET_CLASS (impl_device);
+  MetaKms *kms = meta_kms_impl_get_kms (priv->impl);
   MetaKmsFeedback *feedback;
   g_autoptr (GError) error = NULL;
 
@@ -815,9 +1254,23 @@ meta_kms_impl_device_process_update (MetaKmsImplDevice *impl_device,
     return meta_kms_feedback_new_failed (NULL, g_steal_pointer (&error));
 
   meta_kms_impl_device_hold_fd (impl_device);
-  feedback = klass->process_update (impl_device, update, flags);
-  if (!(flags & META_KMS_UPDATE_FLAG_TEST_ONLY))
-    meta_kms_impl_device_predict_states (impl_device, update);
+  if (flags & META_KMS_UPDATE_FLAG_TEST_ONLY)
+    {
+      feedback = process_test_update (impl_device, update, flags);
+    }
+  else
+    {
+      g_atomic_int_inc (&priv->n_commits);
+      invalidate_test_results (impl_device, update);
+      meta_kms_cursor_manager_update_in_impl (meta_kms_get_cursor_manager (kms),
+                                              update);
+      feedback = klass->process_update (impl_device, update, flags);
+      meta_kms_cursor_manager_update_committed_in_impl (
+        meta_kms_get_cursor_manager (kms), update, feedback);
+      maybe_forget_test_results (impl_device, update, feedback);
+      update_committed_plane_configurations (impl_device, update, feedback);
+      meta_kms_impl_device_predict_states (impl_device, update);
+    }
   meta_kms_impl_device_unhold_fd (impl_device);
 
   return feedback;
@@ -833,6 +1286,9 @@ meta_kms_impl_device_disable (MetaKmsImplDevice *impl_device)
   if (!priv->device_file)
     return;
 
+  g_hash_table_remove_all (priv->test_results);
+  g_hash_table_remove_all (priv->committed_plane_configurations);
+
   meta_kms_impl_device_hold_fd (impl_device);
   klass->disable (impl_device);
   g_list_foreach (priv->crtcs, (GFunc) meta_kms_crtc_disable, NULL);
@@ -840,13 +1296,68 @@ meta_kms_impl_device_disable (MetaKmsImplDevice *impl_device)
   meta_kms_impl_device_unhold_fd (impl_device);
 }
 
+/*
+ * Keeps track of how far apart in time CRTCs of the device present, within
+ * a refresh cycle, by comparing each flip with the last one on another CRTC.
+ */
+static void
+update_presentation_skew (MetaKmsImplDevice   *impl_device,
+                          MetaKmsPageFlipData *page_flip_data)
+{
+  MetaKmsImplDevicePrivate *priv =
+    meta_kms_impl_device_get_instance_private (impl_device);
+  MetaKmsCrtc *crtc = meta_kms_page_flip_data_get_crtc (page_flip_data);
+  const MetaKmsCrtcState *crtc_state;
+  int64_t time_us;
+
+  time_us = meta_kms_page_flip_data_get_time_us (page_flip_data);
+  if (!time_us)
+    return;
+
+  crtc_state = meta_kms_crtc_get_current_state (crtc);
+  if (priv->last_flip_crtc && priv->last_flip_crtc != crtc &&
+      crtc_state->is_drm_mode_valid)
+    {
+      int64_t refresh_interval_us;
+      int64_t skew_us;
+
+      refresh_interval_us =
+        (int64_t) (G_USEC_PER_SEC /
+                   meta_calculate_drm_mode_refresh_rate (&crtc_state->drm_mode));
+      skew_us = ABS (time_us - priv->last_flip_time_us) % refresh_interval_us;
+      skew_us = MIN (skew_us, refresh_interval_us - skew_us);
+
+      g_atomic_int_set (&priv->presentation_skew_us, (int) skew_us);
+
+      meta_topic (META_DEBUG_KMS,
+                  "CRTC %u presented %" G_GINT64_FORMAT " us apart from "
+                  "CRTC %u on %s",
+                  meta_kms_crtc_get_id (crtc),
+                  skew_us,
+                  meta_kms_crtc_get_id (priv->last_flip_crtc),
+                  priv->path);
+    }
+
+  priv->last_flip_crtc = crtc;
+  priv->last_flip_time_us = time_us;
+}
+
 void
 meta_kms_impl_device_handle_page_flip_callback (MetaKmsImplDevice   *impl_device,
                                                 MetaKmsPageFlipData *page_flip_data)
 {
+  MetaKmsImplDevicePrivate *priv =
+    meta_kms_impl_device_get_instance_private (impl_device);
   MetaKmsImplDeviceClass *klass = META_KMS_IMPL_DEVICE_GET_CLASS (impl_device);
+  MetaKms *kms = meta_kms_impl_get_kms (priv->impl);
+  MetaKmsCrtc *crtc = meta_kms_page_flip_data_get_crtc (page_flip_data);
+
+  update_presentation_skew (impl_device, page_flip_data);
 
   klass->handle_page_flip_callback (impl_device, page_flip_data);
+
+  meta_kms_cursor_manager_crtc_flipped_in_impl (meta_kms_get_cursor_manager (kms),
+                                                crtc);
 }
 
 void
@@ -857,6 +1368,22 @@ meta_kms_impl_device_discard_pending_page_flips (MetaKmsImplDevice *impl_device)
   klass->discard_pending_page_flips (impl_device);
 }
 
+/*
+ * Whether a committed page flip on @crtc has not completed yet, meaning
+ * further non-blocking commits touching the CRTC would fail until it has.
+ */
+gboolean
+meta_kms_impl_device_has_pending_page_flip (MetaKmsImplDevice *impl_device,
+                                            MetaKmsCrtc       *crtc)
+{
+  MetaKmsImplDeviceClass *klass = META_KMS_IMPL_DEVICE_GET_CLASS (impl_device);
+
+  if (!klass->has_pending_page_flip)
+    return FALSE;
+
+  return klass->has_pending_page_flip (impl_device, crtc);
+}
+
 void
 meta_kms_impl_device_hold_fd (MetaKmsImplDevice *impl_device)
 {
@@ -974,6 +1501,8 @@ meta_kms_impl_device_finalize (GObject *object)
   g_list_free_full (priv->connectors, g_object_unref);
   g_list_free_full (priv->fallback_modes,
                     (GDestroyNotify) meta_kms_mode_free);
+  g_hash_table_destroy (priv->test_results);
+  g_hash_table_destroy (priv->committed_plane_configurations);
 
   clear_latched_fd_hold (impl_device);
   g_warn_if_fail (!priv->device_file);
@@ -1012,7 +1541,7 @@ meta_kms_impl_device_init_mode_setting (MetaKmsImplDevice  *impl_device,
 
   init_fallback_modes (impl_device);
 
-  update_connectors (impl_device, drm_resources);
+  update_connectors (impl_device, drm_resources, 0);
 
   drmModeFreeResources (drm_resources);
 
@@ -1081,6 +1610,14 @@ meta_kms_impl_device_initable_init (GInitable     *initable,
 static void
 meta_kms_impl_device_init (MetaKmsImplDevice *impl_device)
 {
+  MetaKmsImplDevicePrivate *priv =
+    meta_kms_impl_device_get_instance_private (impl_device);
+
+  priv->test_results =
+    g_hash_table_new_full (NULL, NULL,
+                           NULL, (GDestroyNotify) g_hash_table_destroy);
+  priv->committed_plane_configurations =
+    g_hash_table_new_full (NULL, NULL, NULL, g_free);
 }
 
 static void
@@ -79,6 +79,8 @@ struct _MetaKmsImplDeviceClass
   void (* handle_page_flip_callback) (MetaKmsImplDevice   *impl_device,
                                       MetaKmsPageFlipData *page_flip_data);
   void (* discard_pending_page_flips) (MetaKmsImplDevice *impl_device);
+  gboolean (* has_pending_page_flip) (MetaKmsImplDevice *impl_device,
+                                      MetaKmsCrtc       *crtc);
   void (* prepare_shutdown) (MetaKmsImplDevice *impl_device);
 };
 
@@ -127,11 +129,19 @@ gboolean meta_kms_impl_device_dispatch (MetaKmsImplDevice  *impl_device,
 
 void meta_kms_impl_device_disable (MetaKmsImplDevice *impl_device);
 
+int meta_kms_impl_device_get_n_avoided_test_commits (MetaKmsImplDevice *impl_device);
+
+int meta_kms_impl_device_get_n_commits (MetaKmsImplDevice *impl_device);
+
+int meta_kms_impl_device_get_presentation_skew_us (MetaKmsImplDevice *impl_device);
+
+META_EXPORT_TEST
 drmModePropertyPtr meta_kms_impl_device_find_property (MetaKmsImplDevice       *impl_device,
                                                        drmModeObjectProperties *props,
                                                        const char              *prop_name,
                                                        int                     *idx);
 
+META_EXPORT_TEST
 int meta_kms_impl_device_get_fd (MetaKmsImplDevice *impl_device);
 
 void meta_kms_impl_device_hold_fd (MetaKmsImplDevice *impl_device);
@@ -172,6 +182,9 @@ void meta_kms_impl_device_handle_page_flip_callback (MetaKmsImplDevice   *impl_d
 
 void meta_kms_impl_device_discard_pending_page_flips (MetaKmsImplDevice *impl_device);
 
+gboolean meta_kms_impl_device_has_pending_page_flip (MetaKmsImplDevice *impl_device,
+                                                     MetaKmsCrtc       *crtc);
+
 gboolean meta_kms_impl_device_init_mode_setting (MetaKmsImplDevice  *impl_device,
                                                  GError            **error);
 
@@ -21,6 +21,7 @@
 #define META_KMS_PAGE_FLIP_H
 
 #include <glib.h>
+#include <stdint.h>
 
 #include "backends/native/meta-kms-types.h"
 
@@ -50,6 +51,8 @@ void meta_kms_page_flip_data_set_timings_in_impl (MetaKmsPageFlipData *page_flip
                                                   unsigned int         sec,
                                                   unsigned int         usec);
 
+int64_t meta_kms_page_flip_data_get_time_us (MetaKmsPageFlipData *page_flip_data);
+
 void meta_kms_page_flip_data_flipped_in_impl (MetaKmsPageFlipData *page_flip_data);
 
 void meta_kms_page_flip_data_mode_set_fallback_in_impl (MetaKmsPageFlipData *page_flip_data);
@@ -192,6 +192,19 @@ meta_kms_page_flip_data_set_timings_in_impl (MetaKmsPageFlipData *page_flip_data
   page_flip_data->usec = usec;
 }
 
+/*
+ * Returns the presentation time set via
+ * meta_kms_page_flip_data_set_timings_in_impl(), or 0 if there is none.
+ */
+int64_t
+meta_kms_page_flip_data_get_time_us (MetaKmsPageFlipData *page_flip_data)
+{
+  if (page_flip_data->is_symbolic)
+    return 0;
+
+  return (int64_t) page_flip_data->sec * G_USEC_PER_SEC + page_flip_data->usec;
+}
+
 void
 meta_kms_page_flip_data_make_symbolic (MetaKmsPageFlipData *page_flip_data)
 {
@@ -42,6 +42,7 @@ typedef enum _MetaKmsPlaneProp
   META_KMS_PLANE_PROP_FB_ID,
   META_KMS_PLANE_PROP_CRTC_ID,
   META_KMS_PLANE_PROP_FB_DAMAGE_CLIPS_ID,
+  META_KMS_PLANE_PROP_ZPOS,
   META_KMS_PLANE_N_PROPS
 } MetaKmsPlaneProp;
 
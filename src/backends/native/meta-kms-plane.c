@@ -49,6 +49,11 @@ struct _MetaKmsPlane
   uint32_t rotation_map[META_MONITOR_N_TRANSFORMS];
   uint32_t all_hw_transforms;
 
+  struct {
+    gboolean is_immutable;
+    uint64_t value;
+  } zpos;
+
   /*
    * primary plane's supported formats and maybe modifiers
    * key: GUINT_TO_POINTER (format)
@@ -188,6 +193,21 @@ meta_kms_plane_is_usable_with (MetaKmsPlane *plane,
   return !!(plane->possible_crtcs & (1 << meta_kms_crtc_get_idx (crtc)));
 }
 
+/*
+ * Returns TRUE and the stacking position of @plane if the driver fixed it,
+ * and FALSE if it can't be relied on.
+ */
+gboolean
+meta_kms_plane_get_immutable_zpos (MetaKmsPlane *plane,
+                                   uint64_t     *out_zpos)
+{
+  if (!plane->zpos.is_immutable)
+    return FALSE;
+
+  *out_zpos = plane->zpos.value;
+  return TRUE;
+}
+
 static void
 parse_rotations (MetaKmsImplDevice  *impl_device,
                  MetaKmsProp        *prop,
@@ -219,6 +239,19 @@ parse_rotations (MetaKmsImplDevice  *impl_device,
     }
 }
 
+static void
+parse_zpos (MetaKmsImplDevice  *impl_device,
+            MetaKmsProp        *prop,
+            drmModePropertyPtr  drm_prop,
+            uint64_t            drm_prop_value,
+            gpointer            user_data)
+{
+  MetaKmsPlane *plane = user_data;
+
+  plane->zpos.is_immutable = !!(drm_prop->flags & DRM_MODE_PROP_IMMUTABLE);
+  plane->zpos.value = drm_prop_value;
+}
+
 static inline uint32_t *
 drm_formats_ptr (struct drm_format_modifier_blob *blob)
 {
@@ -451,6 +484,12 @@ init_properties (MetaKmsPlane            *plane,
           .name = "FB_DAMAGE_CLIPS",
           .type = DRM_MODE_PROP_BLOB,
         },
+      [META_KMS_PLANE_PROP_ZPOS] =
+        {
+          .name = "zpos",
+          .type = DRM_MODE_PROP_RANGE,
+          .parse = parse_zpos,
+        },
     }
   };
 
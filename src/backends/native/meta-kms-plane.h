@@ -41,6 +41,7 @@ G_DECLARE_FINAL_TYPE (MetaKmsPlane, meta_kms_plane,
 META_EXPORT_TEST
 MetaKmsDevice * meta_kms_plane_get_device (MetaKmsPlane *plane);
 
+META_EXPORT_TEST
 uint32_t meta_kms_plane_get_id (MetaKmsPlane *plane);
 
 META_EXPORT_TEST
@@ -54,6 +55,7 @@ GArray * meta_kms_plane_get_modifiers_for_format (MetaKmsPlane *plane,
 
 GArray * meta_kms_plane_copy_drm_format_list (MetaKmsPlane *plane);
 
+META_EXPORT_TEST
 gboolean meta_kms_plane_is_format_supported (MetaKmsPlane *plane,
                                              uint32_t      format);
 
@@ -61,6 +63,9 @@ META_EXPORT_TEST
 gboolean meta_kms_plane_is_usable_with (MetaKmsPlane *plane,
                                         MetaKmsCrtc  *crtc);
 
+gboolean meta_kms_plane_get_immutable_zpos (MetaKmsPlane *plane,
+                                            uint64_t     *out_zpos);
+
 void meta_kms_plane_update_set_rotation (MetaKmsPlane           *plane,
                                          MetaKmsPlaneAssignment *plane_assignment,
                                          MetaMonitorTransform    transform);
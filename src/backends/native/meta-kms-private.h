@@ -38,11 +38,16 @@ void meta_kms_queue_callback (MetaKms         *kms,
                               gpointer         user_data,
                               GDestroyNotify   user_data_destroy);
 
+META_EXPORT_TEST
 gpointer meta_kms_run_impl_task_sync (MetaKms              *kms,
                                       MetaKmsImplTaskFunc   func,
                                       gpointer              user_data,
                                       GError              **error);
 
+void meta_kms_run_impl_task_async (MetaKms             *kms,
+                                   MetaKmsImplTaskFunc  func,
+                                   gpointer             user_data);
+
 GSource * meta_kms_add_source_in_impl (MetaKms        *kms,
                                        GSourceFunc     func,
                                        gpointer        user_data,
@@ -59,6 +64,8 @@ MetaKmsUpdateChanges meta_kms_update_states_sync (MetaKms     *kms,
 
 gboolean meta_kms_in_impl_task (MetaKms *kms);
 
+gboolean meta_kms_has_impl_thread (MetaKms *kms);
+
 gboolean meta_kms_is_waiting_for_impl_task (MetaKms *kms);
 
 #define meta_assert_in_kms_impl(kms) \
@@ -39,6 +39,7 @@ struct _MetaKmsUpdate
   GList *plane_assignments;
   GList *connector_updates;
   GList *crtc_gammas;
+  GList *crtc_updates;
 
   MetaKmsCustomPageFlip *custom_page_flip;
 
@@ -404,6 +405,44 @@ meta_kms_update_set_crtc_gamma (MetaKmsUpdate  *update,
   update->crtc_gammas = g_list_prepend (update->crtc_gammas, gamma);
 }
 
+static MetaKmsCrtcUpdate *
+ensure_crtc_update (MetaKmsUpdate *update,
+                    MetaKmsCrtc   *crtc)
+{
+  GList *l;
+  MetaKmsCrtcUpdate *crtc_update;
+
+  for (l = update->crtc_updates; l; l = l->next)
+    {
+      crtc_update = l->data;
+
+      if (crtc_update->crtc == crtc)
+        return crtc_update;
+    }
+
+  crtc_update = g_new0 (MetaKmsCrtcUpdate, 1);
+  crtc_update->crtc = crtc;
+
+  update->crtc_updates = g_list_prepend (update->crtc_updates, crtc_update);
+
+  return crtc_update;
+}
+
+void
+meta_kms_update_set_vrr (MetaKmsUpdate *update,
+                         MetaKmsCrtc   *crtc,
+                         gboolean       enabled)
+{
+  MetaKmsCrtcUpdate *crtc_update;
+
+  g_assert (!meta_kms_update_is_locked (update));
+  g_assert (meta_kms_crtc_get_device (crtc) == update->device);
+
+  crtc_update = ensure_crtc_update (update, crtc);
+  crtc_update->vrr.has_update = TRUE;
+  crtc_update->vrr.is_enabled = enabled;
+}
+
 void
 meta_kms_update_add_page_flip_listener (MetaKmsUpdate                       *update,
                                         MetaKmsCrtc                         *crtc,
@@ -492,6 +531,7 @@ meta_kms_plane_assignment_set_fb_damage (MetaKmsPlaneAssignment *plane_assignmen
     .n_rects = n_rectangles,
   };
 
+  g_clear_pointer (&plane_assignment->fb_damage, meta_kms_fb_damage_free);
   plane_assignment->fb_damage = fb_damage;
 }
 
@@ -641,6 +681,12 @@ meta_kms_update_get_crtc_gammas (MetaKmsUpdate *update)
   return update->crtc_gammas;
 }
 
+GList *
+meta_kms_update_get_crtc_updates (MetaKmsUpdate *update)
+{
+  return update->crtc_updates;
+}
+
 void
 meta_kms_update_lock (MetaKmsUpdate *update)
 {
@@ -709,6 +755,7 @@ meta_kms_update_free (MetaKmsUpdate *update)
                     (GDestroyNotify) meta_kms_page_flip_listener_free);
   g_list_free_full (update->connector_updates, g_free);
   g_list_free_full (update->crtc_gammas, (GDestroyNotify) meta_kms_crtc_gamma_free);
+  g_list_free_full (update->crtc_updates, g_free);
   g_clear_pointer (&update->custom_page_flip, meta_kms_custom_page_flip_free);
 
   g_free (update);
@@ -81,8 +81,10 @@ typedef struct _MetaKmsPlaneFeedback
 typedef void (* MetaKmsResultListenerFunc) (const MetaKmsFeedback *feedback,
                                             gpointer               user_data);
 
+META_EXPORT_TEST
 void meta_kms_feedback_free (MetaKmsFeedback *feedback);
 
+META_EXPORT_TEST
 MetaKmsFeedbackResult meta_kms_feedback_get_result (const MetaKmsFeedback *feedback);
 
 GList * meta_kms_feedback_get_failed_planes (const MetaKmsFeedback *feedback);
@@ -123,6 +125,12 @@ void meta_kms_update_set_crtc_gamma (MetaKmsUpdate  *update,
                                      const uint16_t *green,
                                      const uint16_t *blue);
 
+META_EXPORT_TEST
+void meta_kms_update_set_vrr (MetaKmsUpdate *update,
+                              MetaKmsCrtc   *crtc,
+                              gboolean       enabled);
+
+META_EXPORT_TEST
 void meta_kms_plane_assignment_set_fb_damage (MetaKmsPlaneAssignment *plane_assignment,
                                               const int              *rectangles,
                                               int                     n_rectangles);
@@ -136,6 +144,7 @@ MetaKmsPlaneAssignment * meta_kms_update_assign_plane (MetaKmsUpdate          *u
                                                        MetaRectangle           dst_rect,
                                                        MetaKmsAssignPlaneFlag  flags);
 
+META_EXPORT_TEST
 MetaKmsPlaneAssignment * meta_kms_update_unassign_plane (MetaKmsUpdate *update,
                                                          MetaKmsCrtc   *crtc,
                                                          MetaKmsPlane  *plane);
@@ -156,6 +165,7 @@ void meta_kms_plane_assignment_set_cursor_hotspot (MetaKmsPlaneAssignment *plane
                                                    int                     x,
                                                    int                     y);
 
+META_EXPORT_TEST
 void meta_kms_update_add_result_listener (MetaKmsUpdate             *update,
                                           MetaKmsResultListenerFunc  func,
                                           gpointer                   user_data);
@@ -22,9 +22,14 @@
 
 #include "backends/native/meta-kms-private.h"
 
+#include <stdlib.h>
+#include <unistd.h>
+
 #include "backends/native/meta-backend-native.h"
+#include "backends/native/meta-kms-cursor-manager.h"
 #include "backends/native/meta-kms-device-private.h"
 #include "backends/native/meta-kms-impl.h"
+#include "backends/native/meta-kms-impl-device.h"
 #include "backends/native/meta-kms-update-private.h"
 #include "backends/native/meta-udev.h"
 #include "cogl/cogl.h"
@@ -45,9 +50,16 @@
  * runs in. It uses the main GLib main loop and main context and always runs in
  * the main thread.
  *
- * The impl context is where all underlying API is being executed. While in the
- * current state, it always runs in the main thread, the aim is to be able to
- * execute the impl context in a dedicated thread.
+ * The impl context is where all underlying API is being executed. It runs in
+ * a dedicated thread, the "KMS impl thread", with its own GLib main context,
+ * which like the main thread is made real-time when the "rt-scheduler"
+ * experimental feature is enabled. This way page flips and cursor updates are processed even while the main thread
+ * is busy. Setting MUTTER_DEBUG_DISABLE_KMS_THREAD=1 makes the impl context
+ * run in the main thread instead.
+ *
+ * Tasks are either run synchronously, i.e. the main context waits for the
+ * impl context to finish, or asynchronously, in which case the result is
+ * passed back to the main context via callbacks.
  *
  * The public facing MetaKms API is always assumed to be executed from the main
  * context.
@@ -99,6 +111,13 @@
  * #MetaKmsImpl), potentially atomically. Each #MetaKmsUpdate deals with
  * updating a single device.
  *
+ * With MUTTER_DEBUG_MERGE_KMS_UPDATES=1, updates for CRTCs on the same device
+ * that are expected to present in the same refresh cycle can be posted via
+ * meta_kms_post_pending_update_merged(). The pending update of the device is
+ * then held back until every expected CRTC has contributed to it, but no
+ * longer than the current main loop iteration, and is committed with a
+ * single atomic commit. Only views whose frame clocks dispatch together end
+ * up merged; no time is spent waiting for frames that are yet to come.
  *
  * There are also these private objects, without public facing API:
  *
@@ -145,6 +164,39 @@ typedef struct _MetaKmsSimpleImplSource
   MetaKms *kms;
 } MetaKmsSimpleImplSource;
 
+typedef struct _MetaKmsImplTask
+{
+  MetaKms *kms;
+
+  MetaKmsImplTaskFunc func;
+  gpointer user_data;
+  GError **error;
+
+  gboolean done;
+  gpointer retval;
+} MetaKmsImplTask;
+
+typedef struct _MetaKmsPostUpdateData
+{
+  MetaKmsUpdate *update;
+  MetaKmsUpdateFlag flags;
+
+  MetaKmsFeedback *feedback;
+  GList *result_listeners;
+} MetaKmsPostUpdateData;
+
+typedef struct _MetaKmsUpdateMerge
+{
+  MetaKms *kms;
+  MetaKmsDevice *device;
+  MetaKmsUpdateFlag flags;
+
+  GList *awaited_crtcs;
+  int n_crtcs;
+
+  GSource *flush_source;
+} MetaKmsUpdateMerge;
+
 typedef struct _MetaKmsFdImplSource
 {
   GSource source;
@@ -171,19 +223,78 @@ struct _MetaKms
   gboolean in_impl_task;
   gboolean waiting_for_impl_task;
 
+  GMainContext *impl_context;
+  GThread *impl_thread;
+  pid_t impl_thread_id;
+  GMainLoop *impl_loop;
+  gboolean impl_thread_initialized;
+  GMutex impl_mutex;
+  GCond impl_cond;
+
   GList *devices;
 
   GList *pending_updates;
 
+  gboolean merge_updates;
+  GList *update_merges;
+
+  MetaKmsCursorManager *cursor_manager;
+
+  GMutex callbacks_mutex;
   GList *pending_callbacks;
   guint callback_source_id;
 };
 
 G_DEFINE_TYPE (MetaKms, meta_kms, G_TYPE_OBJECT)
 
+static void
+meta_kms_update_merge_free (MetaKmsUpdateMerge *update_merge)
+{
+  if (update_merge->flush_source)
+    {
+      g_source_destroy (update_merge->flush_source);
+      g_source_unref (update_merge->flush_source);
+    }
+  g_list_free (update_merge->awaited_crtcs);
+  g_free (update_merge);
+}
+
+static MetaKmsUpdateMerge *
+find_update_merge (MetaKms       *kms,
+                   MetaKmsDevice *device)
+{
+  GList *l;
+
+  for (l = kms->update_merges; l; l = l->next)
+    {
+      MetaKmsUpdateMerge *update_merge = l->data;
+
+      if (update_merge->device == device)
+        return update_merge;
+    }
+
+  return NULL;
+}
+
+static void
+cancel_update_merge (MetaKms       *kms,
+                     MetaKmsDevice *device)
+{
+  MetaKmsUpdateMerge *update_merge;
+
+  update_merge = find_update_merge (kms, device);
+  if (!update_merge)
+    return;
+
+  kms->update_merges = g_list_remove (kms->update_merges, update_merge);
+  meta_kms_update_merge_free (update_merge);
+}
+
 void
 meta_kms_discard_pending_updates (MetaKms *kms)
 {
+  g_clear_list (&kms->update_merges,
+                (GDestroyNotify) meta_kms_update_merge_free);
   g_clear_list (&kms->pending_updates, (GDestroyNotify) meta_kms_update_free);
 }
 
@@ -239,6 +350,9 @@ meta_kms_take_pending_update (MetaKms       *kms,
 
       if (meta_kms_update_get_device (update) == device)
         {
+          /* Whatever was being merged goes out together with this update */
+          cancel_update_merge (kms, device);
+
           kms->pending_updates = g_list_delete_link (kms->pending_updates, l);
           return update;
         }
@@ -322,6 +436,274 @@ meta_kms_post_test_update_sync (MetaKms       *kms,
   return meta_kms_device_process_update_sync (device, update, flags);
 }
 
+static void
+meta_kms_post_update_data_free (MetaKmsPostUpdateData *data)
+{
+  g_list_free_full (data->result_listeners,
+                    (GDestroyNotify) meta_kms_result_listener_free);
+  g_clear_pointer (&data->feedback, meta_kms_feedback_free);
+  meta_kms_update_free (data->update);
+  g_free (data);
+}
+
+static void
+notify_update_result (MetaKms  *kms,
+                      gpointer  user_data)
+{
+  MetaKmsPostUpdateData *data = user_data;
+  GList *l;
+
+  for (l = data->result_listeners; l; l = l->next)
+    {
+      MetaKmsResultListener *listener = l->data;
+
+      meta_kms_result_listener_notify (listener, data->feedback);
+    }
+}
+
+static gpointer
+process_update_in_impl (MetaKmsImpl  *impl,
+                        gpointer      user_data,
+                        GError      **error)
+{
+  MetaKmsPostUpdateData *data = user_data;
+  MetaKms *kms = meta_kms_impl_get_kms (impl);
+  MetaKmsDevice *device = meta_kms_update_get_device (data->update);
+  MetaKmsImplDevice *impl_device = meta_kms_device_get_impl_device (device);
+
+  COGL_TRACE_BEGIN_SCOPED (MetaKmsProcessUpdate,
+                           "KMS (process update)");
+
+  data->feedback = meta_kms_impl_device_process_update (impl_device,
+                                                        data->update,
+                                                        data->flags);
+
+  /* The update, including its buffers, is always released in the main
+   * context, together with notifying the result listeners. */
+  meta_kms_queue_callback (kms,
+                           notify_update_result,
+                           data,
+                           (GDestroyNotify) meta_kms_post_update_data_free);
+
+  return GINT_TO_POINTER (TRUE);
+}
+
+static gboolean
+update_changes_predicted_state (MetaKmsUpdate *update)
+{
+  return (meta_kms_update_get_mode_sets (update) ||
+          meta_kms_update_get_crtc_gammas (update) ||
+          meta_kms_update_get_crtc_updates (update) ||
+          meta_kms_update_get_connector_updates (update));
+}
+
+/**
+ * meta_kms_post_update:
+ * @kms: a #MetaKms
+ * @update: (transfer full): a #MetaKmsUpdate
+ * @flags: the #MetaKmsUpdateFlag flags
+ *
+ * Posts @update without waiting for it to be processed. The result listeners
+ * of @update are notified in the main context once it has been. Updates
+ * that set modes, gamma, or other CRTC or connector state are still
+ * processed before returning.
+ */
+void
+meta_kms_post_update (MetaKms           *kms,
+                      MetaKmsUpdate     *update,
+                      MetaKmsUpdateFlag  flags)
+{
+  MetaKmsPostUpdateData *data;
+
+  g_return_if_fail (!(flags & META_KMS_UPDATE_FLAG_PRESERVE_ON_ERROR));
+
+  meta_kms_update_lock (update);
+
+  data = g_new0 (MetaKmsPostUpdateData, 1);
+  *data = (MetaKmsPostUpdateData) {
+    .update = update,
+    .flags = flags,
+    .result_listeners = meta_kms_update_take_result_listeners (update),
+  };
+
+  if (update_changes_predicted_state (update))
+    {
+      MetaKmsDevice *device = meta_kms_update_get_device (update);
+
+      /* The predicted CRTC and connector states are read from the main thread
+       * without locking, so they must not change while it is running. */
+      data->feedback = meta_kms_device_process_update_sync (device, update,
+                                                            flags);
+      meta_kms_queue_callback (kms,
+                               notify_update_result,
+                               data,
+                               (GDestroyNotify) meta_kms_post_update_data_free);
+      return;
+    }
+
+  meta_kms_run_impl_task_async (kms, process_update_in_impl, data);
+}
+
+void
+meta_kms_post_pending_update (MetaKms           *kms,
+                              MetaKmsDevice     *device,
+                              MetaKmsUpdateFlag  flags)
+{
+  MetaKmsUpdate *update;
+
+  update = meta_kms_take_pending_update (kms, device);
+  if (!update)
+    return;
+
+  meta_kms_post_update (kms, update, flags);
+}
+
+static void
+flush_update_merge (MetaKmsUpdateMerge *update_merge)
+{
+  MetaKms *kms = update_merge->kms;
+  MetaKmsDevice *device = update_merge->device;
+  MetaKmsUpdateFlag flags = update_merge->flags;
+
+  meta_topic (META_DEBUG_KMS,
+              "Posting update merged from %d CRTCs on %s (%d commits)",
+              update_merge->n_crtcs,
+              meta_kms_device_get_path (device),
+              meta_kms_device_get_n_commits (device) + 1);
+
+  cancel_update_merge (kms, device);
+  meta_kms_post_pending_update (kms, device, flags);
+}
+
+static gboolean
+update_merge_source_dispatch (GSource     *source,
+                              GSourceFunc  callback,
+                              gpointer     user_data)
+{
+  g_source_set_ready_time (source, -1);
+
+  return callback (user_data);
+}
+
+static GSourceFuncs update_merge_source_funcs = {
+  NULL,
+  NULL,
+  update_merge_source_dispatch,
+  NULL
+};
+
+static gboolean
+update_merge_flush_cb (gpointer user_data)
+{
+  MetaKmsUpdateMerge *update_merge = user_data;
+
+  meta_topic (META_DEBUG_KMS,
+              "Stopped waiting for %u CRTCs to contribute to update on %s",
+              g_list_length (update_merge->awaited_crtcs),
+              meta_kms_device_get_path (update_merge->device));
+
+  flush_update_merge (update_merge);
+
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * meta_kms_post_pending_update_merged:
+ * @kms: a #MetaKms
+ * @device: the #MetaKmsDevice of the pending update
+ * @crtc: the #MetaKmsCrtc that finished adding to the pending update
+ * @awaited_crtcs: (element-type MetaKmsCrtc): other CRTCs on @device expected
+ *   to add to the pending update for the same refresh cycle
+ * @flags: the #MetaKmsUpdateFlag flags
+ *
+ * Posts the pending update of @device once @crtc and all of @awaited_crtcs
+ * have added to it, or once the current main loop iteration finished,
+ * whatever comes first. Unless update merging is enabled, this is the same as
+ * meta_kms_post_pending_update().
+ */
+void
+meta_kms_post_pending_update_merged (MetaKms           *kms,
+                                     MetaKmsDevice     *device,
+                                     MetaKmsCrtc       *crtc,
+                                     GList             *awaited_crtcs,
+                                     MetaKmsUpdateFlag  flags)
+{
+  MetaKmsUpdateMerge *update_merge;
+  GList *l;
+
+  g_return_if_fail (!(flags & META_KMS_UPDATE_FLAG_PRESERVE_ON_ERROR));
+
+  if (!meta_kms_get_pending_update (kms, device))
+    return;
+
+  update_merge = find_update_merge (kms, device);
+  if (!kms->merge_updates || (!update_merge && !awaited_crtcs))
+    {
+      meta_kms_post_pending_update (kms, device, flags);
+      return;
+    }
+
+  if (!update_merge)
+    {
+      update_merge = g_new0 (MetaKmsUpdateMerge, 1);
+      update_merge->kms = kms;
+      update_merge->device = device;
+      kms->update_merges = g_list_prepend (kms->update_merges, update_merge);
+
+      for (l = awaited_crtcs; l; l = l->next)
+        {
+          if (l->data != crtc)
+            {
+              update_merge->awaited_crtcs =
+                g_list_prepend (update_merge->awaited_crtcs, l->data);
+            }
+        }
+
+      /* Frame clocks are not phase aligned, so only CRTCs whose frames are
+       * dispatched in this main loop iteration can contribute in time. */
+      update_merge->flush_source =
+        g_source_new (&update_merge_source_funcs, sizeof (GSource));
+      g_source_set_name (update_merge->flush_source,
+                         "[mutter] KMS update merge");
+      g_source_set_callback (update_merge->flush_source,
+                             update_merge_flush_cb,
+                             update_merge,
+                             NULL);
+      g_source_set_ready_time (update_merge->flush_source, 0);
+      g_source_attach (update_merge->flush_source, NULL);
+    }
+  else
+    {
+      update_merge->awaited_crtcs =
+        g_list_remove (update_merge->awaited_crtcs, crtc);
+    }
+
+  update_merge->flags |= flags;
+  update_merge->n_crtcs++;
+
+  if (!update_merge->awaited_crtcs)
+    flush_update_merge (update_merge);
+}
+
+void
+meta_kms_set_merge_updates (MetaKms  *kms,
+                            gboolean  merge_updates)
+{
+  kms->merge_updates = merge_updates;
+
+  if (!merge_updates)
+    {
+      while (kms->update_merges)
+        flush_update_merge (kms->update_merges->data);
+    }
+}
+
+gboolean
+meta_kms_is_merging_updates (MetaKms *kms)
+{
+  return kms->merge_updates;
+}
+
 static gpointer
 meta_kms_discard_pending_page_flips_in_impl (MetaKmsImpl  *impl,
                                              gpointer      user_data,
@@ -369,14 +751,18 @@ meta_kms_callback_data_free (MetaKmsCallbackData *callback_data)
 static int
 flush_callbacks (MetaKms *kms)
 {
+  GList *callbacks;
   GList *l;
   int callback_count = 0;
 
   meta_assert_not_in_kms_impl (kms);
 
+  g_mutex_lock (&kms->callbacks_mutex);
   g_clear_handle_id (&kms->callback_source_id, g_source_remove);
+  callbacks = g_steal_pointer (&kms->pending_callbacks);
+  g_mutex_unlock (&kms->callbacks_mutex);
 
-  for (l = kms->pending_callbacks; l; l = l->next)
+  for (l = callbacks; l; l = l->next)
     {
       MetaKmsCallbackData *callback_data = l->data;
 
@@ -385,8 +771,7 @@ flush_callbacks (MetaKms *kms)
       callback_count++;
     }
 
-  g_list_free (kms->pending_callbacks);
-  kms->pending_callbacks = NULL;
+  g_list_free (callbacks);
 
   return callback_count;
 }
@@ -398,7 +783,6 @@ callback_idle (gpointer user_data)
 
   flush_callbacks (kms);
 
-  kms->callback_source_id = 0;
   return G_SOURCE_REMOVE;
 }
 
@@ -416,10 +800,47 @@ meta_kms_queue_callback (MetaKms         *kms,
     .user_data = user_data,
     .user_data_destroy = user_data_destroy,
   };
+
+  g_mutex_lock (&kms->callbacks_mutex);
   kms->pending_callbacks = g_list_append (kms->pending_callbacks,
                                           callback_data);
   if (!kms->callback_source_id)
     kms->callback_source_id = g_idle_add (callback_idle, kms);
+  g_mutex_unlock (&kms->callbacks_mutex);
+}
+
+static gboolean
+impl_task_dispatch (gpointer user_data)
+{
+  MetaKmsImplTask *task = user_data;
+  MetaKms *kms = task->kms;
+  gpointer retval;
+
+  retval = task->func (kms->impl, task->user_data, task->error);
+
+  g_mutex_lock (&kms->impl_mutex);
+  task->retval = retval;
+  task->done = TRUE;
+  g_cond_broadcast (&kms->impl_cond);
+  g_mutex_unlock (&kms->impl_mutex);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+queue_impl_task (MetaKms        *kms,
+                 GSourceFunc     dispatch,
+                 gpointer        user_data,
+                 GDestroyNotify  user_data_destroy)
+{
+  GSource *source;
+
+  source = g_idle_source_new ();
+  g_source_set_name (source, "[mutter] KMS impl task");
+  g_source_set_priority (source, G_PRIORITY_HIGH);
+  g_source_set_callback (source, dispatch, user_data, user_data_destroy);
+  g_source_attach (source, kms->impl_context);
+  g_source_unref (source);
 }
 
 gpointer
@@ -428,15 +849,90 @@ meta_kms_run_impl_task_sync (MetaKms              *kms,
                              gpointer              user_data,
                              GError              **error)
 {
+  MetaKmsImplTask task;
   gpointer ret;
 
-  kms->in_impl_task = TRUE;
+  if (!kms->impl_thread)
+    {
+      kms->in_impl_task = TRUE;
+      kms->waiting_for_impl_task = TRUE;
+      ret = func (kms->impl, user_data, error);
+      kms->waiting_for_impl_task = FALSE;
+      kms->in_impl_task = FALSE;
+
+      return ret;
+    }
+
+  if (meta_kms_in_impl_task (kms))
+    return func (kms->impl, user_data, error);
+
+  task = (MetaKmsImplTask) {
+    .kms = kms,
+    .func = func,
+    .user_data = user_data,
+    .error = error,
+  };
+
   kms->waiting_for_impl_task = TRUE;
-  ret = func (kms->impl, user_data, error);
+  queue_impl_task (kms, impl_task_dispatch, &task, NULL);
+
+  g_mutex_lock (&kms->impl_mutex);
+  while (!task.done)
+    g_cond_wait (&kms->impl_cond, &kms->impl_mutex);
+  g_mutex_unlock (&kms->impl_mutex);
   kms->waiting_for_impl_task = FALSE;
-  kms->in_impl_task = FALSE;
 
-  return ret;
+  return task.retval;
+}
+
+static gboolean
+impl_task_dispatch_async (gpointer user_data)
+{
+  MetaKmsImplTask *task = user_data;
+  MetaKms *kms = task->kms;
+  g_autoptr (GError) error = NULL;
+
+  if (!task->func (kms->impl, task->user_data, &error) && error)
+    g_warning ("KMS impl task failed: %s", error->message);
+
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * Runs @func in the impl context without waiting for it to finish. Tasks are
+ * run in the order they were queued, also relative to synchronous tasks. When
+ * the impl context runs in the main thread, @func is run immediately.
+ */
+void
+meta_kms_run_impl_task_async (MetaKms             *kms,
+                              MetaKmsImplTaskFunc  func,
+                              gpointer             user_data)
+{
+  MetaKmsImplTask *task;
+
+  if (!kms->impl_thread || meta_kms_in_impl_task (kms))
+    {
+      g_autoptr (GError) error = NULL;
+      gpointer ret;
+
+      if (meta_kms_in_impl_task (kms))
+        ret = func (kms->impl, user_data, &error);
+      else
+        ret = meta_kms_run_impl_task_sync (kms, func, user_data, &error);
+
+      if (!ret && error)
+        g_warning ("KMS impl task failed: %s", error->message);
+      return;
+    }
+
+  task = g_new0 (MetaKmsImplTask, 1);
+  *task = (MetaKmsImplTask) {
+    .kms = kms,
+    .func = func,
+    .user_data = user_data,
+  };
+
+  queue_impl_task (kms, impl_task_dispatch_async, task, g_free);
 }
 
 static gboolean
@@ -479,7 +975,7 @@ meta_kms_add_source_in_impl (MetaKms        *kms,
 
   g_source_set_callback (source, func, user_data, user_data_destroy);
   g_source_set_ready_time (source, 0);
-  g_source_attach (source, g_main_context_get_thread_default ());
+  g_source_attach (source, kms->impl_context);
 
   return source;
 }
@@ -543,7 +1039,7 @@ meta_kms_register_fd_in_impl (MetaKms             *kms,
   fd_impl_source->fd_tag = g_source_add_unix_fd (source, fd,
                                                  G_IO_IN | G_IO_ERR);
 
-  g_source_attach (source, g_main_context_get_thread_default ());
+  g_source_attach (source, kms->impl_context);
 
   return source;
 }
@@ -551,7 +1047,16 @@ meta_kms_register_fd_in_impl (MetaKms             *kms,
 gboolean
 meta_kms_in_impl_task (MetaKms *kms)
 {
-  return kms->in_impl_task;
+  if (kms->impl_thread)
+    return g_thread_self () == kms->impl_thread;
+  else
+    return kms->in_impl_task;
+}
+
+gboolean
+meta_kms_has_impl_thread (MetaKms *kms)
+{
+  return !!kms->impl_thread;
 }
 
 gboolean
@@ -682,6 +1187,25 @@ meta_kms_get_backend (MetaKms *kms)
   return kms->backend;
 }
 
+/**
+ * meta_kms_get_impl_thread_id:
+ * @kms: a #MetaKms
+ *
+ * Returns: the thread ID of the KMS impl thread, or 0 if the impl context
+ *   runs in the main thread
+ */
+pid_t
+meta_kms_get_impl_thread_id (MetaKms *kms)
+{
+  return kms->impl_thread_id;
+}
+
+MetaKmsCursorManager *
+meta_kms_get_cursor_manager (MetaKms *kms)
+{
+  return kms->cursor_manager;
+}
+
 GList *
 meta_kms_get_devices (MetaKms *kms)
 {
@@ -708,6 +1232,74 @@ meta_kms_create_device (MetaKms            *kms,
   return device;
 }
 
+static gpointer
+impl_thread_func (MetaKms *kms)
+{
+  g_main_context_push_thread_default (kms->impl_context);
+
+  kms->impl_loop = g_main_loop_new (kms->impl_context, FALSE);
+
+  g_mutex_lock (&kms->impl_mutex);
+  kms->impl_thread_id = gettid ();
+  kms->impl_thread_initialized = TRUE;
+  g_cond_broadcast (&kms->impl_cond);
+  g_mutex_unlock (&kms->impl_mutex);
+
+  g_main_loop_run (kms->impl_loop);
+  g_main_loop_unref (kms->impl_loop);
+
+  g_main_context_pop_thread_default (kms->impl_context);
+
+  return NULL;
+}
+
+static gboolean
+should_use_impl_thread (MetaKms *kms)
+{
+  if (kms->flags & META_KMS_FLAG_NO_MODE_SETTING)
+    return FALSE;
+
+  return g_strcmp0 (getenv ("MUTTER_DEBUG_DISABLE_KMS_THREAD"), "1") != 0;
+}
+
+static gboolean
+start_impl_thread (MetaKms  *kms,
+                   GError  **error)
+{
+  kms->impl_context = g_main_context_new ();
+  kms->impl_thread = g_thread_try_new ("Mutter KMS Impl Thread",
+                                       (GThreadFunc) impl_thread_func,
+                                       kms,
+                                       error);
+  if (!kms->impl_thread)
+    return FALSE;
+
+  g_mutex_lock (&kms->impl_mutex);
+  while (!kms->impl_thread_initialized)
+    g_cond_wait (&kms->impl_cond, &kms->impl_mutex);
+  g_mutex_unlock (&kms->impl_mutex);
+
+  return TRUE;
+}
+
+static gboolean
+stop_impl_thread_in_impl (gpointer user_data)
+{
+  MetaKms *kms = user_data;
+
+  g_main_loop_quit (kms->impl_loop);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+stop_impl_thread (MetaKms *kms)
+{
+  queue_impl_task (kms, stop_impl_thread_in_impl, kms, NULL);
+  g_thread_join (kms->impl_thread);
+  kms->impl_thread = NULL;
+}
+
 MetaKms *
 meta_kms_new (MetaBackend   *backend,
               MetaKmsFlags   flags,
@@ -727,6 +1319,23 @@ meta_kms_new (MetaBackend   *backend,
       return NULL;
     }
 
+  kms->cursor_manager = meta_kms_cursor_manager_new (kms);
+  kms->merge_updates =
+    g_strcmp0 (getenv ("MUTTER_DEBUG_MERGE_KMS_UPDATES"), "1") == 0;
+
+  if (should_use_impl_thread (kms))
+    {
+      if (!start_impl_thread (kms, error))
+        {
+          g_object_unref (kms);
+          return NULL;
+        }
+    }
+  else
+    {
+      kms->impl_context = g_main_context_ref_thread_default ();
+    }
+
   if (!(flags & META_KMS_FLAG_NO_MODE_SETTING))
     {
       kms->hotplug_handler_id =
@@ -764,23 +1373,39 @@ meta_kms_finalize (GObject *object)
   MetaUdev *udev = meta_backend_native_get_udev (backend_native);
   GList *l;
 
+  g_clear_list (&kms->update_merges,
+                (GDestroyNotify) meta_kms_update_merge_free);
+
+  g_list_free_full (kms->devices, g_object_unref);
+
+  if (kms->impl_thread)
+    stop_impl_thread (kms);
+  g_clear_pointer (&kms->impl_context, g_main_context_unref);
+
+  g_clear_pointer (&kms->cursor_manager, meta_kms_cursor_manager_free);
+
   for (l = kms->pending_callbacks; l; l = l->next)
     meta_kms_callback_data_free (l->data);
   g_list_free (kms->pending_callbacks);
 
   g_clear_handle_id (&kms->callback_source_id, g_source_remove);
 
-  g_list_free_full (kms->devices, g_object_unref);
-
   g_clear_signal_handler (&kms->hotplug_handler_id, udev);
   g_clear_signal_handler (&kms->removed_handler_id, udev);
 
+  g_mutex_clear (&kms->callbacks_mutex);
+  g_mutex_clear (&kms->impl_mutex);
+  g_cond_clear (&kms->impl_cond);
+
   G_OBJECT_CLASS (meta_kms_parent_class)->finalize (object);
 }
 
 static void
 meta_kms_init (MetaKms *kms)
 {
+  g_mutex_init (&kms->callbacks_mutex);
+  g_mutex_init (&kms->impl_mutex);
+  g_cond_init (&kms->impl_cond);
 }
 
 static void
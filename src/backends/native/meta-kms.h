@@ -21,6 +21,7 @@
 #define META_KMS_H
 
 #include <glib-object.h>
+#include <sys/types.h>
 
 #include "backends/meta-backend-private.h"
 #include "backends/native/meta-kms-types.h"
@@ -36,9 +37,11 @@ G_DECLARE_FINAL_TYPE (MetaKms, meta_kms, META, KMS, GObject)
 
 void meta_kms_discard_pending_updates (MetaKms *kms);
 
+META_EXPORT_TEST
 MetaKmsUpdate * meta_kms_ensure_pending_update (MetaKms       *kms,
                                                 MetaKmsDevice *device);
 
+META_EXPORT_TEST
 MetaKmsUpdate * meta_kms_get_pending_update (MetaKms       *kms,
                                              MetaKmsDevice *device);
 
@@ -46,9 +49,32 @@ MetaKmsFeedback * meta_kms_post_pending_update_sync (MetaKms           *kms,
                                                      MetaKmsDevice     *device,
                                                      MetaKmsUpdateFlag  flags);
 
+META_EXPORT_TEST
 MetaKmsFeedback * meta_kms_post_test_update_sync (MetaKms       *kms,
                                                   MetaKmsUpdate *update);
 
+META_EXPORT_TEST
+void meta_kms_post_update (MetaKms           *kms,
+                           MetaKmsUpdate     *update,
+                           MetaKmsUpdateFlag  flags);
+
+void meta_kms_post_pending_update (MetaKms           *kms,
+                                   MetaKmsDevice     *device,
+                                   MetaKmsUpdateFlag  flags);
+
+META_EXPORT_TEST
+void meta_kms_post_pending_update_merged (MetaKms           *kms,
+                                          MetaKmsDevice     *device,
+                                          MetaKmsCrtc       *crtc,
+                                          GList             *awaited_crtcs,
+                                          MetaKmsUpdateFlag  flags);
+
+META_EXPORT_TEST
+void meta_kms_set_merge_updates (MetaKms  *kms,
+                                 gboolean  merge_updates);
+
+gboolean meta_kms_is_merging_updates (MetaKms *kms);
+
 void meta_kms_discard_pending_page_flips (MetaKms *kms);
 
 void meta_kms_notify_modes_set (MetaKms *kms);
@@ -56,6 +82,11 @@ void meta_kms_notify_modes_set (MetaKms *kms);
 META_EXPORT_TEST
 MetaBackend * meta_kms_get_backend (MetaKms *kms);
 
+pid_t meta_kms_get_impl_thread_id (MetaKms *kms);
+
+META_EXPORT_TEST
+MetaKmsCursorManager * meta_kms_get_cursor_manager (MetaKms *kms);
+
 META_EXPORT_TEST
 GList * meta_kms_get_devices (MetaKms *kms);
 
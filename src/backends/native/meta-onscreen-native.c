@@ -32,6 +32,7 @@
 #include <drm_fourcc.h>
 
 #include "backends/meta-egl-ext.h"
+#include "backends/meta-framebuffer-readback.h"
 #include "backends/native/meta-cogl-utils.h"
 #include "backends/native/meta-crtc-kms.h"
 #include "backends/native/meta-device-pool.h"
@@ -40,6 +41,7 @@
 #include "backends/native/meta-drm-buffer-import.h"
 #include "backends/native/meta-drm-buffer.h"
 #include "backends/native/meta-kms-device.h"
+#include "backends/native/meta-kms-plane.h"
 #include "backends/native/meta-kms-utils.h"
 #include "backends/native/meta-kms.h"
 #include "backends/native/meta-output-kms.h"
@@ -47,6 +49,7 @@
 #include "backends/native/meta-render-device.h"
 #include "backends/native/meta-renderer-native-gles3.h"
 #include "backends/native/meta-renderer-native-private.h"
+#include "clutter/clutter-mutter.h"
 
 typedef enum _MetaSharedFramebufferImportStatus
 {
@@ -74,6 +77,15 @@ typedef struct _MetaOnscreenNativeSecondaryGpuState
   struct {
     MetaDrmBufferDumb *current_dumb_fb;
     MetaDrmBufferDumb *dumb_fbs[2];
+    /* Areas of each dumb buffer that are out of date; NULL if all of it */
+    cairo_region_t *stale_regions[2];
+
+    MetaFramebufferReadback *readback;
+    MetaDrmBufferDumb *pending_dumb_fb;
+
+    gboolean is_flip_deferred;
+    int *deferred_rectangles;
+    int n_deferred_rectangles;
   } cpu;
 
   gboolean noted_primary_gpu_copy_ok;
@@ -81,6 +93,13 @@ typedef struct _MetaOnscreenNativeSecondaryGpuState
   MetaSharedFramebufferImportStatus import_status;
 } MetaOnscreenNativeSecondaryGpuState;
 
+typedef struct _MetaOnscreenNativeOverlay
+{
+  MetaKmsPlane *kms_plane;
+  MetaDrmBuffer *buffer;
+  MetaRectangle dst_rect;
+} MetaOnscreenNativeOverlay;
+
 struct _MetaOnscreenNative
 {
   CoglOnscreenEgl parent;
@@ -98,6 +117,15 @@ struct _MetaOnscreenNative
     MetaDrmBuffer *next_fb;
   } gbm;
 
+  struct {
+    GList *next;
+    GList *current;
+    GList *retired;
+
+    /* The last update assigning overlays was discarded */
+    gboolean inhibited;
+  } overlays;
+
 #ifdef HAVE_EGL_DEVICE
   struct {
     EGLStreamKHR stream;
@@ -107,6 +135,8 @@ struct _MetaOnscreenNative
 #endif
 
   MetaRendererView *view;
+
+  gboolean is_vrr_enabled;
 };
 
 G_DEFINE_TYPE (MetaOnscreenNative, meta_onscreen_native,
@@ -154,11 +184,59 @@ free_current_bo (CoglOnscreen *onscreen)
   free_current_secondary_bo (onscreen);
 }
 
+static MetaOnscreenNativeOverlay *
+overlay_new (MetaKmsPlane        *kms_plane,
+             MetaDrmBuffer       *buffer,
+             const MetaRectangle *dst_rect)
+{
+  MetaOnscreenNativeOverlay *overlay;
+
+  overlay = g_new0 (MetaOnscreenNativeOverlay, 1);
+  overlay->kms_plane = kms_plane;
+  overlay->buffer = g_object_ref (buffer);
+  overlay->dst_rect = *dst_rect;
+
+  return overlay;
+}
+
+static void
+overlay_free (MetaOnscreenNativeOverlay *overlay)
+{
+  g_object_unref (overlay->buffer);
+  g_free (overlay);
+}
+
+static void
+free_overlays (GList **overlays)
+{
+  g_list_free_full (g_steal_pointer (overlays), (GDestroyNotify) overlay_free);
+}
+
+/*
+ * The update that assigned the current overlays was never applied, thus the
+ * retired ones are still on the planes. Stick to compositing for the next
+ * frame, rather than trying the same configuration again.
+ */
+static void
+restore_overlays (CoglOnscreen *onscreen)
+{
+  MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
+
+  free_overlays (&onscreen_native->overlays.current);
+  onscreen_native->overlays.current =
+    g_steal_pointer (&onscreen_native->overlays.retired);
+  onscreen_native->overlays.inhibited = TRUE;
+}
+
 static void
 meta_onscreen_native_swap_drm_fb (CoglOnscreen *onscreen)
 {
   MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
 
+  /* Buffers of overlays that were replaced or removed are no longer scanned
+   * out once the update replacing them has been presented. */
+  free_overlays (&onscreen_native->overlays.retired);
+
   if (!onscreen_native->gbm.next_fb)
     return;
 
@@ -344,6 +422,8 @@ page_flip_feedback_discarded (MetaKmsCrtc  *kms_crtc,
   frame_info = cogl_onscreen_peek_head_frame_info (onscreen);
   frame_info->flags |= COGL_FRAME_INFO_FLAG_SYMBOLIC;
 
+  restore_overlays (onscreen);
+
   meta_onscreen_native_notify_frame_complete (onscreen);
   meta_onscreen_native_swap_drm_fb (onscreen);
 }
@@ -418,6 +498,73 @@ meta_onscreen_native_dummy_power_save_page_flip (CoglOnscreen *onscreen)
   meta_onscreen_native_notify_frame_complete (onscreen);
 }
 
+static gboolean
+is_overlay_plane_taken (GList        *overlays,
+                        MetaKmsPlane *kms_plane)
+{
+  GList *l;
+
+  for (l = overlays; l; l = l->next)
+    {
+      MetaOnscreenNativeOverlay *overlay = l->data;
+
+      if (overlay->kms_plane == kms_plane)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+assign_overlay_plane (MetaKmsUpdate             *kms_update,
+                      MetaKmsCrtc               *kms_crtc,
+                      MetaOnscreenNativeOverlay *overlay)
+{
+  MetaDrmBuffer *buffer = overlay->buffer;
+  MetaFixed16Rectangle src_rect;
+
+  src_rect = META_FIXED_16_RECTANGLE_INIT_INT (0, 0,
+                                               meta_drm_buffer_get_width (buffer),
+                                               meta_drm_buffer_get_height (buffer));
+  meta_kms_update_assign_plane (kms_update,
+                                kms_crtc,
+                                overlay->kms_plane,
+                                buffer,
+                                src_rect,
+                                overlay->dst_rect,
+                                META_KMS_ASSIGN_PLANE_FLAG_NONE);
+}
+
+static void
+update_overlay_planes (CoglOnscreen  *onscreen,
+                       MetaKmsCrtc   *kms_crtc,
+                       MetaKmsUpdate *kms_update)
+{
+  MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
+  GList *l;
+
+  for (l = onscreen_native->overlays.next; l; l = l->next)
+    assign_overlay_plane (kms_update, kms_crtc, l->data);
+
+  for (l = onscreen_native->overlays.current; l; l = l->next)
+    {
+      MetaOnscreenNativeOverlay *overlay = l->data;
+
+      if (is_overlay_plane_taken (onscreen_native->overlays.next,
+                                  overlay->kms_plane))
+        continue;
+
+      meta_kms_update_unassign_plane (kms_update, kms_crtc, overlay->kms_plane);
+    }
+
+  onscreen_native->overlays.retired =
+    g_list_concat (onscreen_native->overlays.retired,
+                   g_steal_pointer (&onscreen_native->overlays.current));
+  onscreen_native->overlays.current =
+    g_steal_pointer (&onscreen_native->overlays.next);
+  onscreen_native->overlays.inhibited = FALSE;
+}
+
 static void
 meta_onscreen_native_flip_crtc (CoglOnscreen                *onscreen,
                                 MetaRendererView            *view,
@@ -474,6 +621,8 @@ meta_onscreen_native_flip_crtc (CoglOnscreen                *onscreen,
           meta_kms_plane_assignment_set_fb_damage (plane_assignment,
                                                    rectangles, n_rectangles);
         }
+
+      update_overlay_planes (onscreen, kms_crtc, kms_update);
       break;
     case META_RENDERER_NATIVE_MODE_SURFACELESS:
       g_assert_not_reached ();
@@ -533,6 +682,15 @@ meta_onscreen_native_set_crtc_mode (CoglOnscreen              *onscreen,
   meta_crtc_kms_set_mode (crtc_kms, kms_update);
   meta_output_kms_set_underscan (META_OUTPUT_KMS (onscreen_native->output),
                                  kms_update);
+
+  if (meta_kms_crtc_is_vrr_supported (kms_crtc) &&
+      (onscreen_native->is_vrr_enabled ||
+       meta_kms_crtc_get_current_state (kms_crtc)->vrr_enabled))
+    {
+      meta_kms_update_set_vrr (kms_update,
+                               kms_crtc,
+                               onscreen_native->is_vrr_enabled);
+    }
 }
 
 static void
@@ -540,8 +698,18 @@ secondary_gpu_release_dumb (MetaOnscreenNativeSecondaryGpuState *secondary_gpu_s
 {
   unsigned i;
 
+  g_clear_pointer (&secondary_gpu_state->cpu.readback,
+                   meta_framebuffer_readback_free);
+  secondary_gpu_state->cpu.pending_dumb_fb = NULL;
+  secondary_gpu_state->cpu.is_flip_deferred = FALSE;
+  g_clear_pointer (&secondary_gpu_state->cpu.deferred_rectangles, g_free);
+
   for (i = 0; i < G_N_ELEMENTS (secondary_gpu_state->cpu.dumb_fbs); i++)
-    g_clear_object (&secondary_gpu_state->cpu.dumb_fbs[i]);
+    {
+      g_clear_object (&secondary_gpu_state->cpu.dumb_fbs[i]);
+      g_clear_pointer (&secondary_gpu_state->cpu.stale_regions[i],
+                       cairo_region_destroy);
+    }
 }
 
 static void
@@ -733,6 +901,18 @@ secondary_gpu_get_next_dumb_buffer (MetaOnscreenNativeSecondaryGpuState *seconda
     return secondary_gpu_state->cpu.dumb_fbs[0];
 }
 
+static void
+secondary_gpu_invalidate_dumb_buffers (MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state)
+{
+  unsigned i;
+
+  for (i = 0; i < G_N_ELEMENTS (secondary_gpu_state->cpu.stale_regions); i++)
+    {
+      g_clear_pointer (&secondary_gpu_state->cpu.stale_regions[i],
+                       cairo_region_destroy);
+    }
+}
+
 static gboolean
 copy_shared_framebuffer_primary_gpu (CoglOnscreen                        *onscreen,
                                      MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state,
@@ -806,6 +986,8 @@ copy_shared_framebuffer_primary_gpu (CoglOnscreen                        *onscre
     }
   /* Limit the number of individual copies to 16 */
 #define MAX_RECTS 16
+  /* Likewise for rectangles read back by the CPU copy */
+#define MAX_CPU_COPY_RECTS 16
 
   if (n_rectangles == 0 || n_rectangles > MAX_RECTS)
     {
@@ -842,28 +1024,196 @@ copy_shared_framebuffer_primary_gpu (CoglOnscreen                        *onscre
   g_set_object (&secondary_gpu_state->gbm.next_fb, buffer);
   secondary_gpu_state->cpu.current_dumb_fb = buffer_dumb;
 
+  /* Only the damage was blitted, which the CPU copy doesn't keep track of */
+  secondary_gpu_invalidate_dumb_buffers (secondary_gpu_state);
+
   return TRUE;
 }
 
+static void
+secondary_gpu_add_damage (MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state,
+                          const int                           *rectangles,
+                          int                                  n_rectangles)
+{
+  unsigned i;
+
+  if (n_rectangles == 0)
+    {
+      secondary_gpu_invalidate_dumb_buffers (secondary_gpu_state);
+      return;
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (secondary_gpu_state->cpu.stale_regions); i++)
+    {
+      cairo_region_t *stale_region = secondary_gpu_state->cpu.stale_regions[i];
+      int j;
+
+      if (!stale_region)
+        continue;
+
+      for (j = 0; j < n_rectangles; j++)
+        {
+          cairo_rectangle_int_t rect = {
+            .x = rectangles[j * 4],
+            .y = rectangles[j * 4 + 1],
+            .width = rectangles[j * 4 + 2],
+            .height = rectangles[j * 4 + 3],
+          };
+
+          cairo_region_union_rectangle (stale_region, &rect);
+        }
+    }
+}
+
+/*
+ * Returns the area of @buffer_dumb that needs to be copied to bring it up to
+ * date with the current frame, and marks it as up to date.
+ */
+static cairo_region_t *
+secondary_gpu_steal_stale_region (MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state,
+                                  MetaDrmBufferDumb                   *buffer_dumb)
+{
+  MetaDrmBuffer *buffer = META_DRM_BUFFER (buffer_dumb);
+  cairo_rectangle_int_t buffer_rect;
+  cairo_region_t *stale_region;
+  unsigned i;
+
+  for (i = 0; i < G_N_ELEMENTS (secondary_gpu_state->cpu.dumb_fbs); i++)
+    {
+      if (secondary_gpu_state->cpu.dumb_fbs[i] == buffer_dumb)
+        break;
+    }
+  g_assert (i < G_N_ELEMENTS (secondary_gpu_state->cpu.dumb_fbs));
+
+  buffer_rect = (cairo_rectangle_int_t) {
+    .width = meta_drm_buffer_get_width (buffer),
+    .height = meta_drm_buffer_get_height (buffer),
+  };
+
+  stale_region = g_steal_pointer (&secondary_gpu_state->cpu.stale_regions[i]);
+  if (stale_region)
+    cairo_region_intersect_rectangle (stale_region, &buffer_rect);
+  else
+    stale_region = cairo_region_create_rectangle (&buffer_rect);
+
+  secondary_gpu_state->cpu.stale_regions[i] = cairo_region_create ();
+
+  /* Reading back many small rectangles costs more than a few extra pixels */
+  if (cairo_region_num_rectangles (stale_region) > MAX_CPU_COPY_RECTS)
+    {
+      cairo_rectangle_int_t extents;
+
+      cairo_region_get_extents (stale_region, &extents);
+      cairo_region_destroy (stale_region);
+      stale_region = cairo_region_create_rectangle (&extents);
+    }
+
+  return stale_region;
+}
+
+static void
+secondary_gpu_set_next_dumb_buffer (MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state,
+                                    MetaDrmBufferDumb                   *buffer_dumb)
+{
+  MetaRenderDevice *render_device =
+    secondary_gpu_state->renderer_gpu_data->render_device;
+  int64_t cpu_time_us;
+
+  cpu_time_us =
+    meta_framebuffer_readback_get_cpu_time_us (secondary_gpu_state->cpu.readback);
+  meta_topic (META_DEBUG_RENDER,
+              "CPU copy for %s took %" G_GINT64_FORMAT " us of CPU time",
+              meta_render_device_get_name (render_device),
+              cpu_time_us);
+
+  g_set_object (&secondary_gpu_state->gbm.next_fb,
+                META_DRM_BUFFER (buffer_dumb));
+  secondary_gpu_state->cpu.current_dumb_fb = buffer_dumb;
+}
+
+static void
+secondary_gpu_cancel_cpu_copy (CoglOnscreen *onscreen)
+{
+  MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
+  MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state =
+    onscreen_native->secondary_gpu_state;
+
+  if (!secondary_gpu_state || !secondary_gpu_state->cpu.pending_dumb_fb)
+    return;
+
+  meta_framebuffer_readback_cancel (secondary_gpu_state->cpu.readback);
+
+  /* The buffer was only partially brought up to date */
+  secondary_gpu_invalidate_dumb_buffers (secondary_gpu_state);
+  secondary_gpu_state->cpu.pending_dumb_fb = NULL;
+
+  /* The frame was reported as pending presentation, so let it complete
+   * without being flipped, like a discarded page flip. */
+  if (secondary_gpu_state->cpu.is_flip_deferred)
+    {
+      CoglFrameInfo *frame_info;
+
+      secondary_gpu_state->cpu.is_flip_deferred = FALSE;
+      g_clear_pointer (&secondary_gpu_state->cpu.deferred_rectangles, g_free);
+
+      frame_info = cogl_onscreen_peek_head_frame_info (onscreen);
+      frame_info->flags |= COGL_FRAME_INFO_FLAG_SYMBOLIC;
+      meta_onscreen_native_notify_frame_complete (onscreen);
+    }
+}
+
+static void finish_swap_buffers (CoglOnscreen *onscreen,
+                                 const int    *rectangles,
+                                 int           n_rectangles);
+
+static void
+on_shared_framebuffer_read (MetaFramebufferReadback *readback,
+                            gpointer                 user_data)
+{
+  CoglOnscreen *onscreen = user_data;
+  MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
+  MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state =
+    onscreen_native->secondary_gpu_state;
+  g_autofree int *rectangles = NULL;
+  MetaDrmBufferDumb *buffer_dumb;
+
+  buffer_dumb = g_steal_pointer (&secondary_gpu_state->cpu.pending_dumb_fb);
+  secondary_gpu_set_next_dumb_buffer (secondary_gpu_state, buffer_dumb);
+
+  if (!secondary_gpu_state->cpu.is_flip_deferred)
+    return;
+
+  secondary_gpu_state->cpu.is_flip_deferred = FALSE;
+  rectangles = g_steal_pointer (&secondary_gpu_state->cpu.deferred_rectangles);
+  finish_swap_buffers (onscreen,
+                       rectangles,
+                       secondary_gpu_state->cpu.n_deferred_rectangles);
+}
+
 static void
 copy_shared_framebuffer_cpu (CoglOnscreen                        *onscreen,
                              MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state,
-                             MetaRendererNativeGpuData           *renderer_gpu_data)
+                             const int                           *rectangles,
+                             int                                  n_rectangles)
 {
   CoglFramebuffer *framebuffer = COGL_FRAMEBUFFER (onscreen);
-  CoglContext *cogl_context = cogl_framebuffer_get_context (framebuffer);
   MetaDrmBufferDumb *buffer_dumb;
   MetaDrmBuffer *buffer;
   int width, height, stride;
   uint32_t drm_format;
-  void *buffer_data;
-  CoglBitmap *dumb_bitmap;
+  uint8_t *buffer_data;
+  cairo_region_t *stale_region;
   CoglPixelFormat cogl_format;
   gboolean ret;
 
   COGL_TRACE_BEGIN_SCOPED (CopySharedFramebufferCpu,
                            "FB Copy (CPU)");
 
+  /* A frame still waiting for its copy is flipped before starting on the
+   * next one. */
+  if (secondary_gpu_state->cpu.pending_dumb_fb)
+    meta_framebuffer_readback_flush (secondary_gpu_state->cpu.readback);
+
   buffer_dumb = secondary_gpu_get_next_dumb_buffer (secondary_gpu_state);
   buffer = META_DRM_BUFFER (buffer_dumb);
 
@@ -881,24 +1231,39 @@ copy_shared_framebuffer_cpu (CoglOnscreen                        *onscreen,
                                                 NULL);
   g_assert (ret);
 
-  dumb_bitmap = cogl_bitmap_new_for_data (cogl_context,
-                                          width,
-                                          height,
-                                          cogl_format,
-                                          stride,
-                                          buffer_data);
-
-  if (!cogl_framebuffer_read_pixels_into_bitmap (framebuffer,
-                                                 0 /* x */,
-                                                 0 /* y */,
-                                                 COGL_READ_PIXELS_COLOR_BUFFER,
-                                                 dumb_bitmap))
+  if (!secondary_gpu_state->cpu.readback)
+    {
+      secondary_gpu_state->cpu.readback =
+        meta_framebuffer_readback_new (framebuffer, cogl_format);
+    }
+
+  secondary_gpu_add_damage (secondary_gpu_state, rectangles, n_rectangles);
+  stale_region = secondary_gpu_steal_stale_region (secondary_gpu_state,
+                                                   buffer_dumb);
+
+  /* Let the copy overlap with whatever the main loop does until the GPU has
+   * finished rendering; the flip is deferred until the copy is done. */
+  if (meta_framebuffer_readback_read_region_async (secondary_gpu_state->cpu.readback,
+                                                   stale_region,
+                                                   buffer_data,
+                                                   stride,
+                                                   on_shared_framebuffer_read,
+                                                   onscreen))
+    {
+      secondary_gpu_state->cpu.pending_dumb_fb = buffer_dumb;
+      cairo_region_destroy (stale_region);
+      return;
+    }
+
+  if (!meta_framebuffer_readback_read_region (secondary_gpu_state->cpu.readback,
+                                              stale_region,
+                                              buffer_data,
+                                              stride))
     g_warning ("Failed to CPU-copy to a secondary GPU output");
 
-  cogl_object_unref (dumb_bitmap);
+  cairo_region_destroy (stale_region);
 
-  g_set_object (&secondary_gpu_state->gbm.next_fb, buffer);
-  secondary_gpu_state->cpu.current_dumb_fb = buffer_dumb;
+  secondary_gpu_set_next_dumb_buffer (secondary_gpu_state, buffer_dumb);
 }
 
 static void
@@ -948,7 +1313,8 @@ update_secondary_gpu_state_pre_swap_buffers (CoglOnscreen *onscreen,
 
               copy_shared_framebuffer_cpu (onscreen,
                                            secondary_gpu_state,
-                                           renderer_gpu_data);
+                                           rectangles,
+                                           n_rectangles);
             }
           else if (!secondary_gpu_state->noted_primary_gpu_copy_ok)
             {
@@ -1020,6 +1386,191 @@ ensure_crtc_modes (CoglOnscreen *onscreen)
     meta_onscreen_native_set_crtc_mode (onscreen, renderer_gpu_data);
 }
 
+static void
+on_kms_update_result (const MetaKmsFeedback *kms_feedback,
+                      gpointer               user_data)
+{
+  const GError *error;
+
+  if (meta_kms_feedback_get_result (kms_feedback) != META_KMS_FEEDBACK_FAILED)
+    return;
+
+  error = meta_kms_feedback_get_error (kms_feedback);
+  if (!g_error_matches (error,
+                        G_IO_ERROR,
+                        G_IO_ERROR_PERMISSION_DENIED))
+    g_warning ("Failed to post KMS update: %s", error->message);
+}
+
+/*
+ * Other views driven by the same device at the same refresh rate, that have
+ * a frame coming up, and whose updates can thus go into the same commit if
+ * they are dispatched together with this one.
+ */
+static GList *
+get_mergeable_crtcs (CoglOnscreen *onscreen)
+{
+  MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
+  MetaRenderer *renderer = META_RENDERER (onscreen_native->renderer_native);
+  ClutterStageView *stage_view = CLUTTER_STAGE_VIEW (onscreen_native->view);
+  MetaKmsCrtc *kms_crtc =
+    meta_crtc_kms_get_kms_crtc (META_CRTC_KMS (onscreen_native->crtc));
+  MetaKmsDevice *kms_device = meta_kms_crtc_get_device (kms_crtc);
+  float refresh_rate = clutter_stage_view_get_refresh_rate (stage_view);
+  GList *mergeable_crtcs = NULL;
+  GList *l;
+
+  for (l = meta_renderer_get_views (renderer); l; l = l->next)
+    {
+      ClutterStageView *other_view = l->data;
+      CoglFramebuffer *other_framebuffer;
+      MetaOnscreenNative *other_onscreen_native;
+      MetaKmsCrtc *other_kms_crtc;
+
+      if (other_view == stage_view)
+        continue;
+
+      other_framebuffer = clutter_stage_view_get_onscreen (other_view);
+      if (!META_IS_ONSCREEN_NATIVE (other_framebuffer))
+        continue;
+
+      other_onscreen_native = META_ONSCREEN_NATIVE (other_framebuffer);
+      other_kms_crtc =
+        meta_crtc_kms_get_kms_crtc (META_CRTC_KMS (other_onscreen_native->crtc));
+      if (meta_kms_crtc_get_device (other_kms_crtc) != kms_device)
+        continue;
+
+      if (!G_APPROX_VALUE (clutter_stage_view_get_refresh_rate (other_view),
+                           refresh_rate, 0.01f))
+        continue;
+
+      if (!clutter_stage_view_has_redraw_clip (other_view))
+        continue;
+
+      mergeable_crtcs = g_list_prepend (mergeable_crtcs, other_kms_crtc);
+    }
+
+  return mergeable_crtcs;
+}
+
+static void
+post_pending_update (CoglOnscreen *onscreen)
+{
+  MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
+  MetaKmsCrtc *kms_crtc =
+    meta_crtc_kms_get_kms_crtc (META_CRTC_KMS (onscreen_native->crtc));
+  MetaKmsDevice *kms_device = meta_kms_crtc_get_device (kms_crtc);
+  MetaKms *kms = meta_kms_device_get_kms (kms_device);
+  MetaKmsUpdate *kms_update;
+  g_autoptr (GList) mergeable_crtcs = NULL;
+
+  kms_update = meta_kms_get_pending_update (kms, kms_device);
+  g_return_if_fail (kms_update);
+
+  /* Page flip listeners take care of the frame, so only failures need to be
+   * looked at once the update has been processed. */
+  meta_kms_update_add_result_listener (kms_update, on_kms_update_result, NULL);
+
+  if (!meta_kms_is_merging_updates (kms))
+    {
+      meta_kms_post_pending_update (kms, kms_device,
+                                    META_KMS_UPDATE_FLAG_NONE);
+      return;
+    }
+
+  mergeable_crtcs = get_mergeable_crtcs (onscreen);
+  meta_kms_post_pending_update_merged (kms, kms_device, kms_crtc,
+                                       mergeable_crtcs,
+                                       META_KMS_UPDATE_FLAG_NONE);
+}
+
+static void
+finish_swap_buffers (CoglOnscreen *onscreen,
+                     const int    *rectangles,
+                     int           n_rectangles)
+{
+  MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
+  MetaRendererNative *renderer_native = onscreen_native->renderer_native;
+  MetaRenderer *renderer = META_RENDERER (renderer_native);
+  MetaBackend *backend = meta_renderer_get_backend (renderer);
+  MetaMonitorManager *monitor_manager =
+    meta_backend_get_monitor_manager (backend);
+  MetaRendererNativeGpuData *renderer_gpu_data;
+  MetaPowerSave power_save_mode;
+  MetaKmsCrtc *kms_crtc;
+  MetaKmsDevice *kms_device;
+
+  renderer_gpu_data = meta_renderer_native_get_gpu_data (renderer_native,
+                                                         onscreen_native->render_gpu);
+
+  power_save_mode = meta_monitor_manager_get_power_save_mode (monitor_manager);
+  if (power_save_mode == META_POWER_SAVE_ON)
+    {
+      ensure_crtc_modes (onscreen);
+      meta_onscreen_native_flip_crtc (onscreen,
+                                      onscreen_native->view,
+                                      onscreen_native->crtc,
+                                      META_KMS_PAGE_FLIP_LISTENER_FLAG_NONE,
+                                      rectangles,
+                                      n_rectangles);
+    }
+  else
+    {
+      meta_renderer_native_queue_power_save_page_flip (renderer_native,
+                                                       onscreen);
+      return;
+    }
+
+  COGL_TRACE_BEGIN_SCOPED (MetaRendererNativePostKmsUpdate,
+                           "Onscreen (post pending update)");
+  kms_crtc = meta_crtc_kms_get_kms_crtc (META_CRTC_KMS (onscreen_native->crtc));
+  kms_device = meta_kms_crtc_get_device (kms_crtc);
+
+  switch (renderer_gpu_data->mode)
+    {
+    case META_RENDERER_NATIVE_MODE_GBM:
+      if (meta_renderer_native_has_pending_mode_sets (renderer_native))
+        {
+          meta_topic (META_DEBUG_KMS,
+                      "Postponing primary plane composite update for CRTC %u (%s)",
+                      meta_kms_crtc_get_id (kms_crtc),
+                      meta_kms_device_get_path (kms_device));
+
+          return;
+        }
+      else if (meta_renderer_native_has_pending_mode_set (renderer_native))
+        {
+          meta_topic (META_DEBUG_KMS, "Posting global mode set updates on %s",
+                      meta_kms_device_get_path (kms_device));
+
+          meta_renderer_native_notify_mode_sets_reset (renderer_native);
+          meta_renderer_native_post_mode_set_updates (renderer_native);
+          return;
+        }
+      break;
+    case META_RENDERER_NATIVE_MODE_SURFACELESS:
+      g_assert_not_reached ();
+      break;
+#ifdef HAVE_EGL_DEVICE
+    case META_RENDERER_NATIVE_MODE_EGL_DEVICE:
+      if (meta_renderer_native_has_pending_mode_set (renderer_native))
+        {
+          meta_renderer_native_notify_mode_sets_reset (renderer_native);
+          meta_renderer_native_post_mode_set_updates (renderer_native);
+          return;
+        }
+      break;
+#endif
+    }
+
+  meta_topic (META_DEBUG_KMS,
+              "Posting primary plane composite update for CRTC %u (%s)",
+              meta_kms_crtc_get_id (kms_crtc),
+              meta_kms_device_get_path (kms_device));
+
+  post_pending_update (onscreen);
+}
+
 static void
 meta_onscreen_native_swap_buffers_with_damage (CoglOnscreen  *onscreen,
                                                const int     *rectangles,
@@ -1034,27 +1585,16 @@ meta_onscreen_native_swap_buffers_with_damage (CoglOnscreen  *onscreen,
   CoglRendererEGL *cogl_renderer_egl = cogl_renderer->winsys;
   MetaRendererNativeGpuData *renderer_gpu_data = cogl_renderer_egl->platform;
   MetaRendererNative *renderer_native = renderer_gpu_data->renderer_native;
-  MetaRenderer *renderer = META_RENDERER (renderer_native);
-  MetaBackend *backend = meta_renderer_get_backend (renderer);
-  MetaBackendNative *backend_native = META_BACKEND_NATIVE (backend);
-  MetaMonitorManager *monitor_manager =
-    meta_backend_get_monitor_manager (backend);
-  MetaKms *kms = meta_backend_native_get_kms (backend_native);
   MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
+  MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state;
   MetaGpuKms *render_gpu = onscreen_native->render_gpu;
   MetaDeviceFile *render_device_file;
   ClutterFrame *frame = user_data;
   CoglOnscreenClass *parent_class;
   gboolean egl_context_changed = FALSE;
-  MetaPowerSave power_save_mode;
   g_autoptr (GError) error = NULL;
   MetaDrmBufferFlags buffer_flags;
   MetaDrmBufferGbm *buffer_gbm;
-  MetaKmsCrtc *kms_crtc;
-  MetaKmsDevice *kms_device;
-  MetaKmsUpdateFlag flags;
-  g_autoptr (MetaKmsFeedback) kms_feedback = NULL;
-  const GError *feedback_error;
 
   COGL_TRACE_BEGIN_SCOPED (MetaRendererNativeSwapBuffers,
                            "Onscreen (swap-buffers)");
@@ -1120,99 +1660,20 @@ meta_onscreen_native_swap_buffers_with_damage (CoglOnscreen  *onscreen,
   if (egl_context_changed)
     _cogl_winsys_egl_ensure_current (cogl_display);
 
-  power_save_mode = meta_monitor_manager_get_power_save_mode (monitor_manager);
-  if (power_save_mode == META_POWER_SAVE_ON)
-    {
-      ensure_crtc_modes (onscreen);
-      meta_onscreen_native_flip_crtc (onscreen,
-                                      onscreen_native->view,
-                                      onscreen_native->crtc,
-                                      META_KMS_PAGE_FLIP_LISTENER_FLAG_NONE,
-                                      rectangles,
-                                      n_rectangles);
-    }
-  else
+  /* The flip is done once the CPU copy to the secondary GPU has finished */
+  secondary_gpu_state = onscreen_native->secondary_gpu_state;
+  if (secondary_gpu_state && secondary_gpu_state->cpu.pending_dumb_fb)
     {
-      meta_renderer_native_queue_power_save_page_flip (renderer_native,
-                                                       onscreen);
-      clutter_frame_set_result (frame,
-                                CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
+      secondary_gpu_state->cpu.is_flip_deferred = TRUE;
+      secondary_gpu_state->cpu.deferred_rectangles =
+        g_memdup2 (rectangles, sizeof (int) * 4 * n_rectangles);
+      secondary_gpu_state->cpu.n_deferred_rectangles = n_rectangles;
+      clutter_frame_set_result (frame, CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
       return;
     }
 
-  COGL_TRACE_BEGIN_SCOPED (MetaRendererNativePostKmsUpdate,
-                           "Onscreen (post pending update)");
-  kms_crtc = meta_crtc_kms_get_kms_crtc (META_CRTC_KMS (onscreen_native->crtc));
-  kms_device = meta_kms_crtc_get_device (kms_crtc);
-
-  switch (renderer_gpu_data->mode)
-    {
-    case META_RENDERER_NATIVE_MODE_GBM:
-      if (meta_renderer_native_has_pending_mode_sets (renderer_native))
-        {
-          meta_topic (META_DEBUG_KMS,
-                      "Postponing primary plane composite update for CRTC %u (%s)",
-                      meta_kms_crtc_get_id (kms_crtc),
-                      meta_kms_device_get_path (kms_device));
-
-          clutter_frame_set_result (frame,
-                                    CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
-          return;
-        }
-      else if (meta_renderer_native_has_pending_mode_set (renderer_native))
-        {
-          meta_topic (META_DEBUG_KMS, "Posting global mode set updates on %s",
-                      meta_kms_device_get_path (kms_device));
-
-          meta_renderer_native_notify_mode_sets_reset (renderer_native);
-          meta_renderer_native_post_mode_set_updates (renderer_native);
-          clutter_frame_set_result (frame,
-                                    CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
-          return;
-        }
-      break;
-    case META_RENDERER_NATIVE_MODE_SURFACELESS:
-      g_assert_not_reached ();
-      break;
-#ifdef HAVE_EGL_DEVICE
-    case META_RENDERER_NATIVE_MODE_EGL_DEVICE:
-      if (meta_renderer_native_has_pending_mode_set (renderer_native))
-        {
-          meta_renderer_native_notify_mode_sets_reset (renderer_native);
-          meta_renderer_native_post_mode_set_updates (renderer_native);
-          clutter_frame_set_result (frame,
-                                    CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
-          return;
-        }
-      break;
-#endif
-    }
-
-  meta_topic (META_DEBUG_KMS,
-              "Posting primary plane composite update for CRTC %u (%s)",
-              meta_kms_crtc_get_id (kms_crtc),
-              meta_kms_device_get_path (kms_device));
-
-  flags = META_KMS_UPDATE_FLAG_NONE;
-  kms_feedback = meta_kms_post_pending_update_sync (kms, kms_device, flags);
-
-  switch (meta_kms_feedback_get_result (kms_feedback))
-    {
-    case META_KMS_FEEDBACK_PASSED:
-      clutter_frame_set_result (frame,
-                                CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
-      break;
-    case META_KMS_FEEDBACK_FAILED:
-      clutter_frame_set_result (frame,
-                                CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
-
-      feedback_error = meta_kms_feedback_get_error (kms_feedback);
-      if (!g_error_matches (feedback_error,
-                            G_IO_ERROR,
-                            G_IO_ERROR_PERMISSION_DENIED))
-        g_warning ("Failed to post KMS update: %s", feedback_error->message);
-      break;
-    }
+  finish_swap_buffers (onscreen, rectangles, n_rectangles);
+  clutter_frame_set_result (frame, CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
 }
 
 gboolean
@@ -1242,6 +1703,209 @@ meta_onscreen_native_is_buffer_scanout_compatible (CoglOnscreen  *onscreen,
   return result == META_KMS_FEEDBACK_PASSED;
 }
 
+void
+meta_onscreen_native_clear_overlays (CoglOnscreen *onscreen)
+{
+  MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
+
+  free_overlays (&onscreen_native->overlays.next);
+}
+
+static gboolean
+test_overlays (CoglOnscreen              *onscreen,
+               MetaOnscreenNativeOverlay *new_overlay)
+{
+  MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
+  MetaCrtcKms *crtc_kms = META_CRTC_KMS (onscreen_native->crtc);
+  MetaKmsCrtc *kms_crtc = meta_crtc_kms_get_kms_crtc (crtc_kms);
+  MetaKmsDevice *kms_device = meta_kms_crtc_get_device (kms_crtc);
+  MetaKms *kms = meta_kms_device_get_kms (kms_device);
+  MetaKmsUpdate *test_update;
+  g_autoptr (MetaKmsFeedback) kms_feedback = NULL;
+  GList *l;
+
+  /* Test the new overlay together with the ones already picked for the next
+   * frame, as they share the scanout bandwidth of the CRTC. Overlays are
+   * picked anew every frame, but mostly end up the same; the results of such
+   * repeated tests are cached by the KMS device. */
+  test_update = meta_kms_update_new (kms_device);
+  for (l = onscreen_native->overlays.next; l; l = l->next)
+    assign_overlay_plane (test_update, kms_crtc, l->data);
+  assign_overlay_plane (test_update, kms_crtc, new_overlay);
+
+  kms_feedback = meta_kms_post_test_update_sync (kms, test_update);
+  meta_kms_update_free (test_update);
+
+  return meta_kms_feedback_get_result (kms_feedback) ==
+         META_KMS_FEEDBACK_PASSED;
+}
+
+/*
+ * Tries to put @scanout on a free overlay plane of the CRTC, positioned at
+ * @dst_rect in framebuffer coordinates, for the next frame. The buffer is
+ * neither scaled nor cropped. Overlays are picked anew for every frame; see
+ * meta_onscreen_native_clear_overlays().
+ */
+gboolean
+meta_onscreen_native_try_assign_overlay (CoglOnscreen        *onscreen,
+                                         CoglScanout         *scanout,
+                                         const MetaRectangle *dst_rect)
+{
+  MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
+  MetaCrtcKms *crtc_kms = META_CRTC_KMS (onscreen_native->crtc);
+  MetaKmsCrtc *kms_crtc = meta_crtc_kms_get_kms_crtc (crtc_kms);
+  MetaKmsDevice *kms_device = meta_kms_crtc_get_device (kms_crtc);
+  MetaKmsPlane *primary_plane;
+  uint64_t primary_zpos;
+  MetaDrmBuffer *buffer;
+  uint32_t drm_format;
+  GList *l;
+
+  /* Client buffers are imported on the primary GPU, and composited frames
+   * for secondary GPUs are copied, thus there is no way to overlay on top. */
+  if (onscreen_native->secondary_gpu_state)
+    return FALSE;
+
+  if (onscreen_native->overlays.inhibited)
+    return FALSE;
+
+  if (!META_IS_DRM_BUFFER (scanout))
+    return FALSE;
+
+  buffer = META_DRM_BUFFER (scanout);
+  if (meta_drm_buffer_get_width (buffer) != dst_rect->width ||
+      meta_drm_buffer_get_height (buffer) != dst_rect->height)
+    return FALSE;
+
+  /* Overlays must be stacked above the composited frame, which can only be
+   * relied on when the driver fixed the stacking order of the planes. */
+  primary_plane = meta_kms_device_get_primary_plane_for (kms_device, kms_crtc);
+  if (!primary_plane ||
+      !meta_kms_plane_get_immutable_zpos (primary_plane, &primary_zpos))
+    return FALSE;
+
+  drm_format = meta_drm_buffer_get_format (buffer);
+
+  for (l = meta_kms_device_get_planes (kms_device); l; l = l->next)
+    {
+      MetaKmsPlane *kms_plane = l->data;
+      MetaOnscreenNativeOverlay *overlay;
+      uint64_t zpos;
+
+      if (meta_kms_plane_get_plane_type (kms_plane) !=
+          META_KMS_PLANE_TYPE_OVERLAY)
+        continue;
+
+      if (!meta_kms_plane_is_usable_with (kms_plane, kms_crtc))
+        continue;
+
+      if (!meta_kms_plane_get_immutable_zpos (kms_plane, &zpos) ||
+          zpos <= primary_zpos)
+        continue;
+
+      if (!meta_kms_plane_is_format_supported (kms_plane, drm_format))
+        continue;
+
+      if (is_overlay_plane_taken (onscreen_native->overlays.next, kms_plane))
+        continue;
+
+      overlay = overlay_new (kms_plane, buffer, dst_rect);
+      if (!test_overlays (onscreen, overlay))
+        {
+          overlay_free (overlay);
+          continue;
+        }
+
+      meta_topic (META_DEBUG_KMS,
+                  "Assigned overlay plane %u on CRTC %u to %dx%d+%d+%d",
+                  meta_kms_plane_get_id (kms_plane),
+                  meta_kms_crtc_get_id (kms_crtc),
+                  dst_rect->width, dst_rect->height,
+                  dst_rect->x, dst_rect->y);
+
+      onscreen_native->overlays.next =
+        g_list_append (onscreen_native->overlays.next, overlay);
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+/*
+ * The client buffer replaces the previously scanned out one wholesale, but
+ * only the parts of the view that were damaged since then actually differ,
+ * so let the driver know, as it would otherwise have to upload the whole
+ * buffer when it can't scan out from it directly.
+ */
+static int *
+get_direct_scanout_damage (CoglOnscreen *onscreen,
+                           int          *out_n_rectangles)
+{
+  MetaOnscreenNative *onscreen_native = META_ONSCREEN_NATIVE (onscreen);
+  ClutterStageView *stage_view = CLUTTER_STAGE_VIEW (onscreen_native->view);
+  CoglFramebuffer *framebuffer = COGL_FRAMEBUFFER (onscreen);
+  const cairo_region_t *redraw_clip;
+  cairo_region_t *view_damage;
+  cairo_rectangle_int_t view_layout;
+  float view_scale;
+  int width, height;
+  int *rectangles;
+  int n_rectangles, i;
+
+  /* No redraw clip means the whole view was damaged */
+  redraw_clip = clutter_stage_view_peek_redraw_clip (stage_view);
+  if (!redraw_clip)
+    {
+      *out_n_rectangles = 0;
+      return NULL;
+    }
+
+  clutter_stage_view_get_layout (stage_view, &view_layout);
+  view_damage = cairo_region_copy (redraw_clip);
+  cairo_region_intersect_rectangle (view_damage, &view_layout);
+  if (cairo_region_is_empty (view_damage))
+    {
+      cairo_region_destroy (view_damage);
+      *out_n_rectangles = 0;
+      return NULL;
+    }
+
+  view_scale = clutter_stage_view_get_scale (stage_view);
+  width = cogl_framebuffer_get_width (framebuffer);
+  height = cogl_framebuffer_get_height (framebuffer);
+
+  n_rectangles = cairo_region_num_rectangles (view_damage);
+  rectangles = g_new (int, n_rectangles * 4);
+  for (i = 0; i < n_rectangles; i++)
+    {
+      cairo_rectangle_int_t rect;
+      graphene_rect_t tmp;
+
+      cairo_region_get_rectangle (view_damage, i, &rect);
+
+      _clutter_util_rect_from_rectangle (&rect, &tmp);
+      graphene_rect_offset (&tmp, -view_layout.x, -view_layout.y);
+      graphene_rect_scale (&tmp, view_scale, view_scale, &tmp);
+      _clutter_util_rectangle_int_extents (&tmp, &rect);
+
+      clutter_stage_view_transform_rect_to_onscreen (stage_view,
+                                                     &rect,
+                                                     width,
+                                                     height,
+                                                     &rect);
+
+      rectangles[i * 4] = rect.x;
+      rectangles[i * 4 + 1] = rect.y;
+      rectangles[i * 4 + 2] = rect.width;
+      rectangles[i * 4 + 3] = rect.height;
+    }
+
+  cairo_region_destroy (view_damage);
+
+  *out_n_rectangles = n_rectangles;
+  return rectangles;
+}
+
 static gboolean
 meta_onscreen_native_direct_scanout (CoglOnscreen   *onscreen,
                                      CoglScanout    *scanout,
@@ -1272,6 +1936,8 @@ meta_onscreen_native_direct_scanout (CoglOnscreen   *onscreen,
   MetaKmsUpdateFlag flags;
   g_autoptr (MetaKmsFeedback) kms_feedback = NULL;
   const GError *feedback_error;
+  g_autofree int *damage = NULL;
+  int n_damage_rectangles;
 
   power_save_mode = meta_monitor_manager_get_power_save_mode (monitor_manager);
   if (power_save_mode != META_POWER_SAVE_ON)
@@ -1327,13 +1993,15 @@ meta_onscreen_native_direct_scanout (CoglOnscreen   *onscreen,
         }
     }
 
+  damage = get_direct_scanout_damage (onscreen, &n_damage_rectangles);
+
   ensure_crtc_modes (onscreen);
   meta_onscreen_native_flip_crtc (onscreen,
                                   onscreen_native->view,
                                   onscreen_native->crtc,
                                   META_KMS_PAGE_FLIP_LISTENER_FLAG_DROP_ON_ERROR,
-                                  NULL,
-                                  0);
+                                  damage,
+                                  n_damage_rectangles);
 
   kms_crtc = meta_crtc_kms_get_kms_crtc (META_CRTC_KMS (onscreen_native->crtc));
   kms_device = meta_kms_crtc_get_device (kms_crtc);
@@ -1389,10 +2057,7 @@ meta_onscreen_native_finish_frame (CoglOnscreen *onscreen,
   MetaKmsCrtc *kms_crtc = meta_crtc_kms_get_kms_crtc (META_CRTC_KMS (crtc));
   MetaKmsDevice *kms_device = meta_kms_crtc_get_device (kms_crtc);;
   MetaKms *kms = meta_kms_device_get_kms (kms_device);
-  MetaKmsUpdateFlag flags;
   MetaKmsUpdate *kms_update;
-  g_autoptr (MetaKmsFeedback) kms_feedback = NULL;
-  const GError *error;
 
   kms_update = meta_kms_get_pending_update (kms, kms_device);
   if (!kms_update)
@@ -1408,29 +2073,9 @@ meta_onscreen_native_finish_frame (CoglOnscreen *onscreen,
                                           g_object_ref (onscreen_native->view),
                                           g_object_unref);
 
-  flags = META_KMS_UPDATE_FLAG_NONE;
-  kms_feedback = meta_kms_post_pending_update_sync (kms,
-                                                    kms_device,
-                                                    flags);
-  switch (meta_kms_feedback_get_result (kms_feedback))
-    {
-    case META_KMS_FEEDBACK_PASSED:
-      add_onscreen_frame_info (crtc);
-      clutter_frame_set_result (frame,
-                                CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
-      break;
-    case META_KMS_FEEDBACK_FAILED:
-      add_onscreen_frame_info (crtc);
-      clutter_frame_set_result (frame,
-                                CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
-
-      error = meta_kms_feedback_get_error (kms_feedback);
-      if (!g_error_matches (error,
-                            G_IO_ERROR,
-                            G_IO_ERROR_PERMISSION_DENIED))
-        g_warning ("Failed to post KMS update: %s", error->message);
-      break;
-    }
+  add_onscreen_frame_info (crtc);
+  post_pending_update (onscreen);
+  clutter_frame_set_result (frame, CLUTTER_FRAME_RESULT_PENDING_PRESENTED);
 }
 
 static gboolean
@@ -1773,6 +2418,13 @@ meta_onscreen_native_set_view (CoglOnscreen     *onscreen,
   onscreen_native->view = view;
 }
 
+void
+meta_onscreen_native_set_vrr_enabled (MetaOnscreenNative *onscreen_native,
+                                      gboolean            enabled)
+{
+  onscreen_native->is_vrr_enabled = enabled;
+}
+
 static gboolean
 meta_onscreen_native_allocate (CoglFramebuffer  *framebuffer,
                                GError          **error)
@@ -2138,6 +2790,9 @@ meta_onscreen_native_dispose (GObject *object)
     case META_RENDERER_NATIVE_MODE_GBM:
       g_clear_object (&onscreen_native->gbm.next_fb);
       free_current_bo (onscreen);
+      free_overlays (&onscreen_native->overlays.next);
+      free_overlays (&onscreen_native->overlays.current);
+      free_overlays (&onscreen_native->overlays.retired);
       break;
     case META_RENDERER_NATIVE_MODE_SURFACELESS:
       g_assert_not_reached ();
@@ -2163,6 +2818,9 @@ meta_onscreen_native_dispose (GObject *object)
 #endif /* HAVE_EGL_DEVICE */
     }
 
+  /* Pending fences are cancelled when the framebuffer is disposed */
+  secondary_gpu_cancel_cpu_copy (onscreen);
+
   G_OBJECT_CLASS (meta_onscreen_native_parent_class)->dispose (object);
 
   g_clear_pointer (&onscreen_native->gbm.surface, gbm_surface_destroy);
@@ -27,6 +27,7 @@
 #include "backends/native/meta-backend-native-types.h"
 #include "clutter/clutter.h"
 #include "cogl/cogl.h"
+#include "meta/boxes.h"
 
 #define META_TYPE_ONSCREEN_NATIVE (meta_onscreen_native_get_type ())
 G_DECLARE_FINAL_TYPE (MetaOnscreenNative, meta_onscreen_native,
@@ -43,9 +44,18 @@ void meta_onscreen_native_dummy_power_save_page_flip (CoglOnscreen *onscreen);
 gboolean meta_onscreen_native_is_buffer_scanout_compatible (CoglOnscreen  *onscreen,
                                                             MetaDrmBuffer *fb);
 
+gboolean meta_onscreen_native_try_assign_overlay (CoglOnscreen        *onscreen,
+                                                  CoglScanout         *scanout,
+                                                  const MetaRectangle *dst_rect);
+
+void meta_onscreen_native_clear_overlays (CoglOnscreen *onscreen);
+
 void meta_onscreen_native_set_view (CoglOnscreen     *onscreen,
                                     MetaRendererView *view);
 
+void meta_onscreen_native_set_vrr_enabled (MetaOnscreenNative *onscreen_native,
+                                           gboolean            enabled);
+
 MetaOnscreenNative * meta_onscreen_native_new (MetaRendererNative *renderer_native,
                                                MetaGpuKms         *render_gpu,
                                                MetaOutput         *output,
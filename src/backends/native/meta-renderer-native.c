@@ -49,12 +49,14 @@
 #include "backends/meta-cursor-tracker-private.h"
 #include "backends/meta-gles3.h"
 #include "backends/meta-logical-monitor.h"
+#include "backends/meta-settings-private.h"
 #include "backends/native/meta-backend-native-private.h"
 #include "backends/native/meta-cursor-renderer-native.h"
 #include "backends/native/meta-cogl-utils.h"
 #include "backends/native/meta-crtc-kms.h"
 #include "backends/native/meta-crtc-virtual.h"
 #include "backends/native/meta-device-pool.h"
+#include "backends/native/meta-kms-crtc.h"
 #include "backends/native/meta-kms-device.h"
 #include "backends/native/meta-kms.h"
 #include "backends/native/meta-onscreen-native.h"
@@ -1194,6 +1196,27 @@ should_force_shadow_fb (MetaRendererNative *renderer_native,
   return meta_kms_device_prefers_shadow_buffer (kms_device);
 }
 
+static gboolean
+should_use_vrr (MetaRendererNative *renderer_native,
+                MetaOutput         *output,
+                MetaCrtc           *crtc)
+{
+  MetaRenderer *renderer = META_RENDERER (renderer_native);
+  MetaBackend *backend = meta_renderer_get_backend (renderer);
+  MetaSettings *settings = meta_backend_get_settings (backend);
+  const MetaOutputInfo *output_info = meta_output_get_info (output);
+  MetaKmsCrtc *kms_crtc = meta_crtc_kms_get_kms_crtc (META_CRTC_KMS (crtc));
+
+  if (!meta_settings_is_experimental_feature_enabled (
+        settings, META_EXPERIMENTAL_FEATURE_VARIABLE_REFRESH_RATE))
+    return FALSE;
+
+  if (!output_info->supports_vrr)
+    return FALSE;
+
+  return meta_kms_crtc_is_vrr_supported (kms_crtc);
+}
+
 static CoglFramebuffer *
 create_fallback_offscreen (MetaRendererNative *renderer_native,
                            CoglContext        *cogl_context,
@@ -1241,6 +1264,7 @@ meta_renderer_native_create_view (MetaRenderer       *renderer,
   int onscreen_height;
   MetaRectangle view_layout;
   MetaRendererView *view;
+  gboolean use_vrr = FALSE;
   EGLSurface egl_surface;
   GError *error = NULL;
 
@@ -1294,6 +1318,8 @@ meta_renderer_native_create_view (MetaRenderer       *renderer,
             {
               use_shadowfb = should_force_shadow_fb (renderer_native,
                                                      primary_gpu_kms);
+              use_vrr = should_use_vrr (renderer_native, output, crtc);
+              meta_onscreen_native_set_vrr_enabled (onscreen_native, use_vrr);
               framebuffer = COGL_FRAMEBUFFER (onscreen_native);
             }
         }
@@ -1366,6 +1392,25 @@ meta_renderer_native_create_view (MetaRenderer       *renderer,
                        "vblank-duration-us", crtc_mode_info->vblank_duration_us,
                        NULL);
 
+  if (use_vrr)
+    {
+      const MetaOutputInfo *output_info = meta_output_get_info (output);
+      ClutterFrameClock *frame_clock =
+        clutter_stage_view_get_frame_clock (CLUTTER_STAGE_VIEW (view));
+
+      meta_topic (META_DEBUG_KMS,
+                  "Using variable refresh rate on %s (%d - %d Hz)",
+                  meta_output_get_name (output),
+                  output_info->min_refresh_rate,
+                  output_info->max_refresh_rate);
+
+      clutter_frame_clock_set_mode (frame_clock,
+                                    CLUTTER_FRAME_CLOCK_MODE_VARIABLE);
+      clutter_frame_clock_set_variable_refresh_range (frame_clock,
+                                                      output_info->min_refresh_rate,
+                                                      output_info->max_refresh_rate);
+    }
+
   if (META_IS_ONSCREEN_NATIVE (framebuffer))
     {
       CoglDisplayEGL *cogl_display_egl;
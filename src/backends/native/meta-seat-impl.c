@@ -38,6 +38,8 @@
 #include "backends/native/meta-barrier-native.h"
 #include "backends/native/meta-device-pool.h"
 #include "backends/native/meta-input-thread.h"
+#include "backends/native/meta-kms-cursor-manager.h"
+#include "backends/native/meta-kms.h"
 #include "backends/native/meta-virtual-input-device-native.h"
 #include "clutter/clutter-mutter.h"
 #include "core/bell.h"
@@ -271,11 +273,145 @@ keyboard_repeat (gpointer data)
   return G_SOURCE_CONTINUE;
 }
 
+static void
+flush_queued_events (MetaSeatImpl *seat_impl)
+{
+  ClutterEvent **events;
+  gsize n_events;
+
+  if (seat_impl->flush_events_source)
+    {
+      g_source_destroy (seat_impl->flush_events_source);
+      g_clear_pointer (&seat_impl->flush_events_source, g_source_unref);
+    }
+
+  if (seat_impl->queued_events->len == 0)
+    return;
+
+  events = (ClutterEvent **) g_ptr_array_steal (seat_impl->queued_events,
+                                                &n_events);
+  _clutter_event_push_batch (events, n_events);
+  g_free (events);
+}
+
+static gboolean
+flush_queued_events_cb (gpointer user_data)
+{
+  MetaSeatImpl *seat_impl = user_data;
+
+  g_clear_pointer (&seat_impl->flush_events_source, g_source_unref);
+  flush_queued_events (seat_impl);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+can_merge_events (const ClutterEvent *event,
+                  const ClutterEvent *next_event)
+{
+  ClutterEventFlags flags, next_flags;
+
+  if (event->type != next_event->type)
+    return FALSE;
+
+  if (clutter_event_get_device (event) !=
+      clutter_event_get_device (next_event) ||
+      clutter_event_get_source_device (event) !=
+      clutter_event_get_source_device (next_event))
+    return FALSE;
+
+  if (clutter_event_get_state (event) != clutter_event_get_state (next_event))
+    return FALSE;
+
+  flags = clutter_event_get_flags (event) & ~CLUTTER_EVENT_FLAG_RELATIVE_MOTION;
+  next_flags =
+    clutter_event_get_flags (next_event) & ~CLUTTER_EVENT_FLAG_RELATIVE_MOTION;
+  if (flags != next_flags)
+    return FALSE;
+
+  switch (event->type)
+    {
+    case CLUTTER_MOTION:
+      /* Tablet motion carries axes that should not be lost */
+      return !event->motion.axes && !next_event->motion.axes;
+    case CLUTTER_SCROLL:
+      return (event->scroll.direction == CLUTTER_SCROLL_SMOOTH &&
+              next_event->scroll.direction == CLUTTER_SCROLL_SMOOTH &&
+              event->scroll.scroll_source == next_event->scroll.scroll_source &&
+              event->scroll.finish_flags == CLUTTER_SCROLL_FINISHED_NONE &&
+              !clutter_event_is_pointer_emulated (event) &&
+              !clutter_event_is_pointer_emulated (next_event));
+    default:
+      return FALSE;
+    }
+}
+
+static void
+merge_events (ClutterEvent *event,
+              ClutterEvent *to_discard)
+{
+  switch (event->type)
+    {
+    case CLUTTER_MOTION:
+      _clutter_event_merge_motion (event, to_discard);
+      break;
+    case CLUTTER_SCROLL:
+      {
+        double dx, dy;
+        double discarded_dx, discarded_dy;
+
+        clutter_event_get_scroll_delta (event, &dx, &dy);
+        clutter_event_get_scroll_delta (to_discard,
+                                        &discarded_dx, &discarded_dy);
+        clutter_event_set_scroll_delta (event,
+                                        dx + discarded_dx,
+                                        dy + discarded_dy);
+        break;
+      }
+    default:
+      g_assert_not_reached ();
+    }
+}
+
 static void
 queue_event (MetaSeatImpl *seat_impl,
              ClutterEvent *event)
 {
-  _clutter_event_push (event, FALSE);
+  GPtrArray *queued_events = seat_impl->queued_events;
+
+  /* Consecutive motion and smooth scroll events that have not been handed
+   * to the main thread yet are coalesced here already, so that high rate
+   * devices don't flood the main loop. Motion keeps its individual samples
+   * as motion history.
+   */
+  if (queued_events->len > 0)
+    {
+      ClutterEvent *last_event =
+        g_ptr_array_index (queued_events, queued_events->len - 1);
+
+      if (can_merge_events (last_event, event))
+        {
+          merge_events (event, last_event);
+          clutter_event_free (last_event);
+          queued_events->pdata[queued_events->len - 1] = event;
+          return;
+        }
+    }
+
+  g_ptr_array_add (queued_events, event);
+
+  /* Events coming out of libinput are flushed once all currently available
+   * events were processed; anything else is flushed on the next iteration
+   * of the input thread. */
+  if (seat_impl->dispatching_events || seat_impl->flush_events_source)
+    return;
+
+  seat_impl->flush_events_source = g_idle_source_new ();
+  g_source_set_priority (seat_impl->flush_events_source, G_PRIORITY_HIGH);
+  g_source_set_callback (seat_impl->flush_events_source,
+                         flush_queued_events_cb,
+                         seat_impl, NULL);
+  g_source_attach (seat_impl->flush_events_source, seat_impl->input_context);
 }
 
 static int
@@ -489,6 +625,29 @@ meta_seat_impl_notify_key_in_impl (MetaSeatImpl       *seat_impl,
     }
 }
 
+static void
+update_hw_cursor_position (MetaSeatImpl *seat_impl,
+                           uint64_t      time_us,
+                           float         x,
+                           float         y)
+{
+  MetaBackend *backend = meta_seat_native_get_backend (seat_impl->seat_native);
+  MetaKms *kms = meta_backend_native_get_kms (META_BACKEND_NATIVE (backend));
+  MetaKmsCursorManager *cursor_manager;
+  graphene_point_t position;
+
+  if (!kms)
+    return;
+
+  /* Move the hardware cursor right away instead of waiting for the main
+   * thread to handle the event and paint the next frame. */
+  cursor_manager = meta_kms_get_cursor_manager (kms);
+  position = GRAPHENE_POINT_INIT (x, y);
+  meta_kms_cursor_manager_position_changed_in_input_impl (cursor_manager,
+                                                          time_us,
+                                                          &position);
+}
+
 static ClutterEvent *
 new_absolute_motion_event (MetaSeatImpl       *seat_impl,
                            ClutterInputDevice *input_device,
@@ -559,6 +718,9 @@ new_absolute_motion_event (MetaSeatImpl       *seat_impl,
 
   g_rw_lock_writer_unlock (&seat_impl->state_lock);
 
+  if (clutter_input_device_get_device_type (input_device) != CLUTTER_TABLET_DEVICE)
+    update_hw_cursor_position (seat_impl, time_us, x, y);
+
   return event;
 }
 
@@ -2606,11 +2768,17 @@ process_events (MetaSeatImpl *seat_impl)
 {
   struct libinput_event *event;
 
+  seat_impl->dispatching_events = TRUE;
+
   while ((event = libinput_get_event (seat_impl->libinput)))
     {
       process_event(seat_impl, event);
       libinput_event_destroy(event);
     }
+
+  seat_impl->dispatching_events = FALSE;
+
+  flush_queued_events (seat_impl);
 }
 
 static int
@@ -2953,6 +3121,13 @@ destroy_in_impl (GTask *task)
 
   meta_seat_impl_clear_repeat_source (seat_impl);
 
+  if (seat_impl->flush_events_source)
+    {
+      g_source_destroy (seat_impl->flush_events_source);
+      g_clear_pointer (&seat_impl->flush_events_source, g_source_unref);
+    }
+  g_ptr_array_set_size (seat_impl->queued_events, 0);
+
   g_clear_pointer (&priv->device_files, g_hash_table_destroy);
 
   g_main_loop_quit (seat_impl->input_loop);
@@ -2990,6 +3165,7 @@ meta_seat_impl_finalize (GObject *object)
   g_assert (!seat_impl->event_source);
 
   g_free (seat_impl->seat_id);
+  g_ptr_array_unref (seat_impl->queued_events);
 
   g_rw_lock_clear (&seat_impl->state_lock);
 
@@ -3205,6 +3381,9 @@ meta_seat_impl_init (MetaSeatImpl *seat_impl)
   g_mutex_init (&seat_impl->init_mutex);
   g_cond_init (&seat_impl->init_cond);
 
+  seat_impl->queued_events =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) clutter_event_free);
+
   seat_impl->barrier_manager = meta_barrier_manager_native_new ();
 }
 
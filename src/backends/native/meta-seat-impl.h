@@ -120,6 +120,11 @@ struct _MetaSeatImpl
   float accum_scroll_dx;
   float accum_scroll_dy;
 
+  /* Events waiting to be handed to the main thread in one batch */
+  GPtrArray *queued_events;
+  GSource *flush_events_source;
+  gboolean dispatching_events;
+
   gboolean released;
 };
 
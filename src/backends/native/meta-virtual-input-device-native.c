@@ -19,9 +19,17 @@
 
 #include "config.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <glib-object.h>
+#include <glib-unix.h>
 #include <linux/input.h>
+#include <math.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
+#include "backends/meta-remote-desktop-input-ring.h"
 #include "backends/native/meta-input-thread.h"
 #include "backends/native/meta-seat-native.h"
 #include "backends/native/meta-virtual-input-device-native.h"
@@ -40,12 +48,41 @@ enum
 
 static GParamSpec *obj_props[PROP_LAST];
 
+#define INPUT_RING_N_EVENTS 1024
+
+typedef struct _InputRing
+{
+  MetaRemoteDesktopInputRing *ring;
+  size_t size;
+  uint32_t n_events;
+  uint32_t tail;
+
+  int ring_fd;
+  int notify_fd;
+  GSource *source;
+
+  gboolean has_transform;
+  double x_offset;
+  double y_offset;
+  double x_scale;
+  double y_scale;
+} InputRing;
+
+typedef struct
+{
+  double x_offset;
+  double y_offset;
+  double x_scale;
+  double y_scale;
+} InputRingTransform;
+
 typedef struct _ImplState ImplState;
 
 struct _ImplState
 {
   ClutterInputDevice *device;
   int button_count[KEY_CNT];
+  InputRing *input_ring;
 };
 
 struct _MetaVirtualInputDeviceNative
@@ -55,6 +92,7 @@ struct _MetaVirtualInputDeviceNative
   MetaSeatNative *seat;
   guint slot_base;
   ImplState *impl_state;
+  gboolean has_input_ring;
 };
 
 typedef struct
@@ -108,14 +146,14 @@ typedef enum _EvdevButtonType
 } EvdevButtonType;
 
 static int
-update_button_count_in_impl (MetaVirtualInputDeviceNative *virtual_evdev,
-                             uint32_t                      button,
-                             uint32_t                      state)
+update_button_count_in_impl (ImplState *impl_state,
+                             uint32_t   button,
+                             uint32_t   state)
 {
   if (state)
-    return ++virtual_evdev->impl_state->button_count[button];
+    return ++impl_state->button_count[button];
   else
-    return --virtual_evdev->impl_state->button_count[button];
+    return --impl_state->button_count[button];
 }
 
 static EvdevButtonType
@@ -154,6 +192,21 @@ get_button_type (uint16_t code)
   return EVDEV_BUTTON_TYPE_NONE;
 }
 
+static void
+input_ring_free (InputRing *input_ring)
+{
+  if (input_ring->source)
+    {
+      g_source_destroy (input_ring->source);
+      g_source_unref (input_ring->source);
+    }
+
+  munmap (input_ring->ring, input_ring->size);
+  close (input_ring->ring_fd);
+  close (input_ring->notify_fd);
+  g_free (input_ring);
+}
+
 static gboolean
 release_device_in_impl (GTask *task)
 {
@@ -199,6 +252,8 @@ release_device_in_impl (GTask *task)
         }
     }
 
+  g_clear_pointer (&impl_state->input_ring, input_ring_free);
+
   device_event = clutter_event_new (CLUTTER_DEVICE_REMOVED);
   clutter_event_set_device (device_event, impl_state->device);
   _clutter_event_push (device_event, FALSE);
@@ -319,51 +374,63 @@ translate_to_evdev_button (int clutter_button)
     }
 }
 
-static gboolean
-notify_button_in_impl (GTask *task)
+static void
+emit_button_in_impl (ImplState          *impl_state,
+                     MetaSeatImpl       *seat,
+                     uint64_t            time_us,
+                     uint32_t            evdev_button,
+                     ClutterButtonState  button_state)
 {
-  MetaVirtualInputDeviceNative *virtual_evdev =
-    g_task_get_source_object (task);
-  MetaSeatImpl *seat = virtual_evdev->seat->impl;
-  MetaVirtualEventButton *event = g_task_get_task_data (task);
   int button_count;
-  int evdev_button;
-
-  if (event->time_us == CLUTTER_CURRENT_TIME)
-    event->time_us = g_get_monotonic_time ();
-
-  evdev_button = translate_to_evdev_button (event->button);
 
-  if (get_button_type (evdev_button) != EVDEV_BUTTON_TYPE_BUTTON)
+  if (evdev_button > KEY_MAX ||
+      get_button_type (evdev_button) != EVDEV_BUTTON_TYPE_BUTTON)
     {
       g_warning ("Unknown/invalid virtual device button 0x%x pressed",
                  evdev_button);
-      goto out;
+      return;
     }
 
-  button_count = update_button_count_in_impl (virtual_evdev, evdev_button,
-                                              event->button_state);
+  button_count = update_button_count_in_impl (impl_state, evdev_button,
+                                              button_state);
   if (button_count < 0 || button_count > 1)
     {
       g_warning ("Received multiple virtual 0x%x button %s (ignoring)", evdev_button,
-                 event->button_state == CLUTTER_BUTTON_STATE_PRESSED ?
+                 button_state == CLUTTER_BUTTON_STATE_PRESSED ?
                  "presses" : "releases");
-      update_button_count_in_impl (virtual_evdev, evdev_button, 1 - event->button_state);
-      goto out;
+      update_button_count_in_impl (impl_state, evdev_button, 1 - button_state);
+      return;
     }
 
   meta_topic (META_DEBUG_INPUT,
               "Emitting virtual button-%s of button 0x%x (device %p)",
-              event->button_state == CLUTTER_BUTTON_STATE_PRESSED ?
+              button_state == CLUTTER_BUTTON_STATE_PRESSED ?
               "press" : "release",
-              evdev_button, virtual_evdev);
+              evdev_button, impl_state->device);
 
   meta_seat_impl_notify_button_in_impl (seat,
-					virtual_evdev->impl_state->device,
-					event->time_us,
-					evdev_button,
-					event->button_state);
- out:
+                                        impl_state->device,
+                                        time_us,
+                                        evdev_button,
+                                        button_state);
+}
+
+static gboolean
+notify_button_in_impl (GTask *task)
+{
+  MetaVirtualInputDeviceNative *virtual_evdev =
+    g_task_get_source_object (task);
+  MetaSeatImpl *seat = virtual_evdev->seat->impl;
+  MetaVirtualEventButton *event = g_task_get_task_data (task);
+
+  if (event->time_us == CLUTTER_CURRENT_TIME)
+    event->time_us = g_get_monotonic_time ();
+
+  emit_button_in_impl (virtual_evdev->impl_state, seat,
+                       event->time_us,
+                       translate_to_evdev_button (event->button),
+                       event->button_state);
+
   g_task_return_boolean (task, TRUE);
   return G_SOURCE_REMOVE;
 }
@@ -393,47 +460,61 @@ meta_virtual_input_device_native_notify_button (ClutterVirtualInputDevice *virtu
   g_object_unref (task);
 }
 
-static gboolean
-notify_key_in_impl (GTask *task)
+static void
+emit_key_in_impl (ImplState       *impl_state,
+                  MetaSeatImpl    *seat,
+                  uint64_t         time_us,
+                  uint32_t         key,
+                  ClutterKeyState  key_state)
 {
-  MetaVirtualInputDeviceNative *virtual_evdev =
-    g_task_get_source_object (task);
-  MetaSeatImpl *seat = virtual_evdev->seat->impl;
-  MetaVirtualEventKey *event = g_task_get_task_data (task);
   int key_count;
 
-  if (event->time_us == CLUTTER_CURRENT_TIME)
-    event->time_us = g_get_monotonic_time ();
-
-  if (get_button_type (event->key) != EVDEV_BUTTON_TYPE_KEY)
+  if (key > KEY_MAX ||
+      get_button_type (key) != EVDEV_BUTTON_TYPE_KEY)
     {
-      g_warning ("Unknown/invalid virtual device key 0x%x pressed", event->key);
-      goto out;
+      g_warning ("Unknown/invalid virtual device key 0x%x pressed", key);
+      return;
     }
 
-  key_count = update_button_count_in_impl (virtual_evdev, event->key, event->key_state);
+  key_count = update_button_count_in_impl (impl_state, key, key_state);
   if (key_count < 0 || key_count > 1)
     {
-      g_warning ("Received multiple virtual 0x%x key %s (ignoring)", event->key,
-                 event->key_state == CLUTTER_KEY_STATE_PRESSED ?
+      g_warning ("Received multiple virtual 0x%x key %s (ignoring)", key,
+                 key_state == CLUTTER_KEY_STATE_PRESSED ?
                  "presses" : "releases");
-      update_button_count_in_impl (virtual_evdev, event->key, 1 - event->key_state);
-      goto out;
+      update_button_count_in_impl (impl_state, key, 1 - key_state);
+      return;
     }
 
   meta_topic (META_DEBUG_INPUT,
               "Emitting virtual key-%s of key 0x%x (device %p)",
-              event->key_state == CLUTTER_KEY_STATE_PRESSED ? "press" : "release",
-              event->key, virtual_evdev);
+              key_state == CLUTTER_KEY_STATE_PRESSED ? "press" : "release",
+              key, impl_state->device);
 
   meta_seat_impl_notify_key_in_impl (seat,
-				     virtual_evdev->impl_state->device,
-				     event->time_us,
-				     event->key,
-				     event->key_state,
-				     TRUE);
+                                     impl_state->device,
+                                     time_us,
+                                     key,
+                                     key_state,
+                                     TRUE);
+}
+
+static gboolean
+notify_key_in_impl (GTask *task)
+{
+  MetaVirtualInputDeviceNative *virtual_evdev =
+    g_task_get_source_object (task);
+  MetaSeatImpl *seat = virtual_evdev->seat->impl;
+  MetaVirtualEventKey *event = g_task_get_task_data (task);
+
+  if (event->time_us == CLUTTER_CURRENT_TIME)
+    event->time_us = g_get_monotonic_time ();
+
+  emit_key_in_impl (virtual_evdev->impl_state, seat,
+                    event->time_us,
+                    event->key,
+                    event->key_state);
 
- out:
   g_task_return_boolean (task, TRUE);
   return G_SOURCE_REMOVE;
 }
@@ -588,13 +669,13 @@ notify_keyval_in_impl (GTask *task)
       goto out;
     }
 
-  key_count = update_button_count_in_impl (virtual_evdev, evcode, event->key_state);
+  key_count = update_button_count_in_impl (virtual_evdev->impl_state, evcode, event->key_state);
   if (key_count < 0 || key_count > 1)
     {
       g_warning ("Received multiple virtual 0x%x key %s (ignoring)", evcode,
                  event->key_state == CLUTTER_KEY_STATE_PRESSED ?
                  "presses" : "releases");
-      update_button_count_in_impl (virtual_evdev, evcode, 1 - event->key_state);
+      update_button_count_in_impl (virtual_evdev->impl_state, evcode, 1 - event->key_state);
       goto out;
     }
 
@@ -957,6 +1038,324 @@ meta_virtual_input_device_native_notify_touch_up (ClutterVirtualInputDevice *vir
   g_object_unref (task);
 }
 
+static void
+dispatch_input_ring_event_in_impl (ImplState                         *impl_state,
+                                   MetaSeatImpl                      *seat,
+                                   uint64_t                           time_us,
+                                   const MetaRemoteDesktopInputEvent *event)
+{
+  InputRing *input_ring = impl_state->input_ring;
+  double x, y;
+
+  switch (event->type)
+    {
+    case META_REMOTE_DESKTOP_INPUT_EVENT_POINTER_MOTION_RELATIVE:
+      meta_seat_impl_notify_relative_motion_in_impl (seat,
+                                                     impl_state->device,
+                                                     time_us,
+                                                     event->x, event->y,
+                                                     event->x, event->y);
+      break;
+    case META_REMOTE_DESKTOP_INPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+      if (!input_ring->has_transform)
+        {
+          meta_topic (META_DEBUG_INPUT,
+                      "Dropping virtual absolute pointer motion (%f, %f) "
+                      "without a stream transform",
+                      event->x, event->y);
+          break;
+        }
+
+      x = input_ring->x_offset + event->x * input_ring->x_scale;
+      y = input_ring->y_offset + event->y * input_ring->y_scale;
+      meta_seat_impl_notify_absolute_motion_in_impl (seat,
+                                                     impl_state->device,
+                                                     time_us,
+                                                     x, y,
+                                                     NULL);
+      break;
+    case META_REMOTE_DESKTOP_INPUT_EVENT_POINTER_BUTTON:
+      emit_button_in_impl (impl_state, seat, time_us, event->code,
+                           event->pressed ? CLUTTER_BUTTON_STATE_PRESSED :
+                                            CLUTTER_BUTTON_STATE_RELEASED);
+      break;
+    case META_REMOTE_DESKTOP_INPUT_EVENT_KEYBOARD_KEYCODE:
+      emit_key_in_impl (impl_state, seat, time_us, event->code,
+                        event->pressed ? CLUTTER_KEY_STATE_PRESSED :
+                                         CLUTTER_KEY_STATE_RELEASED);
+      break;
+    default:
+      g_warning ("Unknown virtual input ring event type %u", event->type);
+      break;
+    }
+}
+
+static gboolean
+is_input_ring_event_valid (const MetaRemoteDesktopInputEvent *event)
+{
+  switch (event->type)
+    {
+    case META_REMOTE_DESKTOP_INPUT_EVENT_POINTER_MOTION_RELATIVE:
+    case META_REMOTE_DESKTOP_INPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+      return isfinite (event->x) && isfinite (event->y);
+    default:
+      return TRUE;
+    }
+}
+
+static gboolean
+dispatch_input_ring_in_impl (int           fd,
+                             GIOCondition  condition,
+                             gpointer      user_data)
+{
+  ImplState *impl_state = user_data;
+  InputRing *input_ring = impl_state->input_ring;
+  MetaRemoteDesktopInputRing *ring = input_ring->ring;
+  MetaSeatImpl *seat;
+  uint64_t notify_count;
+  uint64_t time_us;
+  uint64_t total_latency_us = 0;
+  uint32_t n_dispatched = 0;
+  uint32_t head, tail;
+
+  if (read (fd, &notify_count, sizeof (notify_count)) < 0 &&
+      errno != EAGAIN)
+    g_warning ("Failed to read virtual input ring notification: %m");
+
+  seat = meta_input_device_native_get_seat_impl (META_INPUT_DEVICE_NATIVE (impl_state->device));
+  time_us = g_get_monotonic_time ();
+
+  /* The tail is only ever written by us, so don't trust the shared copy. */
+  head = (uint32_t) g_atomic_int_get ((int *) &ring->head);
+  tail = input_ring->tail;
+
+  if (head - tail > input_ring->n_events)
+    {
+      g_warning ("Virtual input ring overrun, dropping %u events",
+                 head - tail - input_ring->n_events);
+      tail = head - input_ring->n_events;
+    }
+
+  for (; tail != head; tail++)
+    {
+      MetaRemoteDesktopInputEvent event;
+
+      /* Copy the event out of shared memory before looking at it, so the
+       * client can't change it between validation and use. */
+      event = ring->events[tail & (input_ring->n_events - 1)];
+
+      if (is_input_ring_event_valid (&event))
+        {
+          dispatch_input_ring_event_in_impl (impl_state, seat, time_us, &event);
+        }
+      else
+        {
+          meta_topic (META_DEBUG_INPUT,
+                      "Dropping virtual input ring event with invalid "
+                      "coordinates (%f, %f)",
+                      event.x, event.y);
+        }
+
+      if (event.time_us > 0 && event.time_us <= time_us)
+        total_latency_us += time_us - event.time_us;
+      n_dispatched++;
+    }
+
+  if (n_dispatched == 0)
+    return G_SOURCE_CONTINUE;
+
+  meta_topic (META_DEBUG_INPUT,
+              "Dispatched %u events from virtual input ring (device %p)",
+              n_dispatched, impl_state->device);
+
+  ring->n_dispatched += n_dispatched;
+  ring->total_latency_us += total_latency_us;
+  ring->last_dispatch_time_us = time_us;
+
+  input_ring->tail = tail;
+  g_atomic_int_set ((int *) &ring->tail, (int) tail);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+attach_input_ring_in_impl (GTask *task)
+{
+  MetaVirtualInputDeviceNative *virtual_evdev =
+    g_task_get_source_object (task);
+  MetaSeatImpl *seat = virtual_evdev->seat->impl;
+  ImplState *impl_state = virtual_evdev->impl_state;
+  InputRing *input_ring = g_task_get_task_data (task);
+
+  g_warn_if_fail (!impl_state->input_ring);
+
+  input_ring->source = g_unix_fd_source_new (input_ring->notify_fd, G_IO_IN);
+  g_source_set_callback (input_ring->source,
+                         (GSourceFunc) dispatch_input_ring_in_impl,
+                         impl_state, NULL);
+  g_source_set_name (input_ring->source, "[mutter] Virtual input ring");
+  g_source_attach (input_ring->source, seat->input_context);
+
+  impl_state->input_ring = input_ring;
+
+  g_task_return_boolean (task, TRUE);
+  return G_SOURCE_REMOVE;
+}
+
+gboolean
+meta_virtual_input_device_native_open_input_ring (MetaVirtualInputDeviceNative  *virtual_evdev,
+                                                  int                           *out_ring_fd,
+                                                  int                           *out_notify_fd,
+                                                  GError                       **error)
+{
+  InputRing *input_ring;
+  GTask *task;
+  int client_ring_fd;
+  int client_notify_fd;
+
+  g_return_val_if_fail (virtual_evdev->impl_state->device != NULL, FALSE);
+
+  if (virtual_evdev->has_input_ring)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_EXISTS,
+                   "Input ring already open");
+      return FALSE;
+    }
+
+  input_ring = g_new0 (InputRing, 1);
+  input_ring->n_events = INPUT_RING_N_EVENTS;
+  input_ring->size = sizeof (MetaRemoteDesktopInputRing) +
+                     input_ring->n_events * sizeof (MetaRemoteDesktopInputEvent);
+  input_ring->notify_fd = -1;
+
+  input_ring->ring_fd = memfd_create ("mutter-virtual-input-ring",
+                                      MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (input_ring->ring_fd == -1)
+    {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                   "Can't create memfd: %s", g_strerror (errno));
+      g_free (input_ring);
+      return FALSE;
+    }
+
+  if (ftruncate (input_ring->ring_fd, input_ring->size) < 0)
+    {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                   "Can't truncate to %zu: %s",
+                   input_ring->size, g_strerror (errno));
+      close (input_ring->ring_fd);
+      g_free (input_ring);
+      return FALSE;
+    }
+
+  if (fcntl (input_ring->ring_fd, F_ADD_SEALS,
+             F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_SEAL) == -1)
+    g_warning ("Failed to add seals: %m");
+
+  input_ring->ring = mmap (NULL, input_ring->size,
+                           PROT_READ | PROT_WRITE, MAP_SHARED,
+                           input_ring->ring_fd, 0);
+  if (input_ring->ring == MAP_FAILED)
+    {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                   "Failed to mmap memory: %s", g_strerror (errno));
+      close (input_ring->ring_fd);
+      g_free (input_ring);
+      return FALSE;
+    }
+
+  input_ring->ring->version = META_REMOTE_DESKTOP_INPUT_RING_VERSION;
+  input_ring->ring->n_events = input_ring->n_events;
+
+  input_ring->notify_fd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (input_ring->notify_fd == -1)
+    {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                   "Can't create eventfd: %s", g_strerror (errno));
+      munmap (input_ring->ring, input_ring->size);
+      close (input_ring->ring_fd);
+      g_free (input_ring);
+      return FALSE;
+    }
+
+  client_ring_fd = fcntl (input_ring->ring_fd, F_DUPFD_CLOEXEC, 0);
+  client_notify_fd = fcntl (input_ring->notify_fd, F_DUPFD_CLOEXEC, 0);
+  if (client_ring_fd == -1 || client_notify_fd == -1)
+    {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                   "Can't duplicate file descriptor: %s", g_strerror (errno));
+      if (client_ring_fd != -1)
+        close (client_ring_fd);
+      if (client_notify_fd != -1)
+        close (client_notify_fd);
+      input_ring_free (input_ring);
+      return FALSE;
+    }
+
+  meta_topic (META_DEBUG_INPUT,
+              "Opened virtual input ring with %u events (device %p)",
+              input_ring->n_events, virtual_evdev);
+
+  task = g_task_new (virtual_evdev, NULL, NULL, NULL);
+  g_task_set_task_data (task, input_ring, NULL);
+  meta_seat_impl_run_input_task (virtual_evdev->seat->impl, task,
+                                 (GSourceFunc) attach_input_ring_in_impl);
+  g_object_unref (task);
+
+  virtual_evdev->has_input_ring = TRUE;
+
+  *out_ring_fd = client_ring_fd;
+  *out_notify_fd = client_notify_fd;
+  return TRUE;
+}
+
+static gboolean
+set_input_ring_transform_in_impl (GTask *task)
+{
+  MetaVirtualInputDeviceNative *virtual_evdev =
+    g_task_get_source_object (task);
+  InputRing *input_ring = virtual_evdev->impl_state->input_ring;
+  InputRingTransform *transform = g_task_get_task_data (task);
+
+  if (input_ring)
+    {
+      input_ring->has_transform = TRUE;
+      input_ring->x_offset = transform->x_offset;
+      input_ring->y_offset = transform->y_offset;
+      input_ring->x_scale = transform->x_scale;
+      input_ring->y_scale = transform->y_scale;
+    }
+
+  g_task_return_boolean (task, TRUE);
+  return G_SOURCE_REMOVE;
+}
+
+void
+meta_virtual_input_device_native_set_input_ring_transform (MetaVirtualInputDeviceNative *virtual_evdev,
+                                                           double                        x_offset,
+                                                           double                        y_offset,
+                                                           double                        x_scale,
+                                                           double                        y_scale)
+{
+  InputRingTransform *transform;
+  GTask *task;
+
+  g_return_if_fail (virtual_evdev->impl_state->device != NULL);
+  g_return_if_fail (virtual_evdev->has_input_ring);
+
+  transform = g_new0 (InputRingTransform, 1);
+  transform->x_offset = x_offset;
+  transform->y_offset = y_offset;
+  transform->x_scale = x_scale;
+  transform->y_scale = y_scale;
+
+  task = g_task_new (virtual_evdev, NULL, NULL, NULL);
+  g_task_set_task_data (task, transform, g_free);
+  meta_seat_impl_run_input_task (virtual_evdev->seat->impl, task,
+                                 (GSourceFunc) set_input_ring_transform_in_impl);
+  g_object_unref (task);
+}
+
 static void
 meta_virtual_input_device_native_get_property (GObject    *object,
                                                guint       prop_id,
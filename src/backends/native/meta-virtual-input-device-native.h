@@ -28,4 +28,15 @@ G_DECLARE_FINAL_TYPE (MetaVirtualInputDeviceNative,
                       META, VIRTUAL_INPUT_DEVICE_NATIVE,
                       ClutterVirtualInputDevice)
 
+gboolean meta_virtual_input_device_native_open_input_ring (MetaVirtualInputDeviceNative  *virtual_evdev,
+                                                           int                           *out_ring_fd,
+                                                           int                           *out_notify_fd,
+                                                           GError                       **error);
+
+void meta_virtual_input_device_native_set_input_ring_transform (MetaVirtualInputDeviceNative *virtual_evdev,
+                                                                double                        x_offset,
+                                                                double                        y_offset,
+                                                                double                        x_scale,
+                                                                double                        y_scale);
+
 #endif /* META_VIRTUAL_INPUT_DEVICE_NATIVE_H */
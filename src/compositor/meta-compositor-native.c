@@ -22,15 +22,35 @@
 
 #include "compositor/meta-compositor-native.h"
 
+#include <math.h>
+
 #include "backends/meta-logical-monitor.h"
+#include "backends/meta-stage-private.h"
 #include "backends/native/meta-crtc-kms.h"
+#include "backends/native/meta-onscreen-native.h"
+#include "compositor/clutter-utils.h"
+#include "compositor/meta-shaped-texture-private.h"
 #include "compositor/meta-surface-actor-wayland.h"
+#include "core/boxes-private.h"
+#include "meta/compositor-mutter.h"
+
+/* Limits the number of atomic test commits issued per view and frame */
+#define MAX_OVERLAY_CANDIDATES 4
+
+typedef struct _MetaCompositorNativeOverlay
+{
+  ClutterStageView *view;
+  MetaSurfaceActor *surface_actor;
+  MetaRectangle stage_rect;
+} MetaCompositorNativeOverlay;
 
 struct _MetaCompositorNative
 {
   MetaCompositorServer parent;
 
   MetaWaylandSurface *current_scanout_candidate;
+
+  GList *overlays;
 };
 
 G_DEFINE_TYPE (MetaCompositorNative, meta_compositor_native,
@@ -154,6 +174,324 @@ done:
     }
 }
 
+static void
+overlay_free (MetaCompositorNativeOverlay *overlay)
+{
+  g_clear_weak_pointer (&overlay->view);
+  g_clear_weak_pointer (&overlay->surface_actor);
+  g_free (overlay);
+}
+
+static gboolean
+find_overlay (GList               *overlays,
+              MetaSurfaceActor    *surface_actor,
+              const MetaRectangle *stage_rect)
+{
+  GList *l;
+
+  for (l = overlays; l; l = l->next)
+    {
+      MetaCompositorNativeOverlay *overlay = l->data;
+
+      if (overlay->surface_actor == surface_actor &&
+          meta_rectangle_equal (&overlay->stage_rect, stage_rect))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gboolean
+get_untransformed_stage_rect (ClutterActor  *actor,
+                              MetaRectangle *out_rect)
+{
+  graphene_point3d_t verts[4];
+  float width, height;
+  int x, y;
+
+  clutter_actor_get_size (actor, &width, &height);
+  clutter_actor_get_abs_allocation_vertices (actor, verts);
+  if (!meta_actor_vertices_are_untransformed (verts, width, height, &x, &y))
+    return FALSE;
+
+  *out_rect = (MetaRectangle) {
+    .x = x,
+    .y = y,
+    .width = (int) roundf (width),
+    .height = (int) roundf (height),
+  };
+  return TRUE;
+}
+
+static gboolean
+paint_box_intersects (ClutterActor        *actor,
+                      const MetaRectangle *rect)
+{
+  ClutterActorBox paint_box;
+
+  if (!clutter_actor_is_visible (actor))
+    return FALSE;
+
+  /* Without a paint box the actor could paint anywhere */
+  if (!clutter_actor_get_paint_box (actor, &paint_box))
+    return TRUE;
+
+  return (paint_box.x1 < rect->x + rect->width &&
+          paint_box.x2 > rect->x &&
+          paint_box.y1 < rect->y + rect->height &&
+          paint_box.y2 > rect->y);
+}
+
+/*
+ * Whether anything painted on top of the window group, such as shell chrome
+ * or a cursor drawn by the compositor, overlaps @rect.
+ */
+static gboolean
+is_covered_above_window_group (MetaCompositor      *compositor,
+                               ClutterActor        *window_group,
+                               const MetaRectangle *rect)
+{
+  ClutterStage *stage = meta_compositor_get_stage (compositor);
+  ClutterActor *actor;
+  graphene_rect_t stage_rect;
+
+  for (actor = window_group;
+       actor && actor != CLUTTER_ACTOR (stage);
+       actor = clutter_actor_get_parent (actor))
+    {
+      ClutterActor *sibling;
+
+      for (sibling = clutter_actor_get_next_sibling (actor);
+           sibling;
+           sibling = clutter_actor_get_next_sibling (sibling))
+        {
+          if (paint_box_intersects (sibling, rect))
+            return TRUE;
+        }
+    }
+
+  stage_rect = meta_rectangle_to_graphene_rect ((MetaRectangle *) rect);
+  return meta_stage_has_visible_overlay_in (META_STAGE (stage), &stage_rect);
+}
+
+static MetaSurfaceActor *
+get_overlay_candidate (ClutterActor     *actor,
+                       MetaRendererView *view)
+{
+  MetaWindowActor *window_actor;
+  MetaSurfaceActor *surface_actor;
+  MetaSurfaceActorWayland *surface_actor_wayland;
+  MetaWaylandSurface *surface;
+  int geometry_scale;
+
+  if (!META_IS_WINDOW_ACTOR (actor))
+    return NULL;
+
+  window_actor = META_WINDOW_ACTOR (actor);
+  if (meta_window_actor_effect_in_progress (window_actor) ||
+      clutter_actor_has_transitions (actor))
+    return NULL;
+
+  if (clutter_actor_get_paint_opacity (actor) != 0xff)
+    return NULL;
+
+  /* Subsurfaces would have to be placed on planes of their own */
+  surface_actor = meta_window_actor_get_topmost_surface (window_actor);
+  if (!surface_actor ||
+      clutter_actor_get_n_children (actor) != 1 ||
+      CLUTTER_ACTOR (surface_actor) != clutter_actor_get_first_child (actor))
+    return NULL;
+
+  if (!META_IS_SURFACE_ACTOR_WAYLAND (surface_actor) ||
+      !meta_surface_actor_is_opaque (surface_actor))
+    return NULL;
+
+  surface_actor_wayland = META_SURFACE_ACTOR_WAYLAND (surface_actor);
+  surface = meta_surface_actor_wayland_get_surface (surface_actor_wayland);
+  if (!surface)
+    return NULL;
+
+  if (meta_renderer_view_get_transform (view) != META_MONITOR_TRANSFORM_NORMAL)
+    return NULL;
+
+  geometry_scale = meta_window_actor_get_geometry_scale (window_actor);
+  if (!meta_wayland_surface_can_scanout_untransformed (surface, view,
+                                                       geometry_scale))
+    return NULL;
+
+  return surface_actor;
+}
+
+static gboolean
+try_assign_overlay (CoglOnscreen        *onscreen,
+                    ClutterStageView    *stage_view,
+                    MetaSurfaceActor    *surface_actor,
+                    const MetaRectangle *stage_rect)
+{
+  g_autoptr (CoglScanout) scanout = NULL;
+  MetaRectangle view_layout;
+  MetaRectangle dst_rect;
+  float view_scale;
+
+  clutter_stage_view_get_layout (stage_view, &view_layout);
+  if (!meta_rectangle_contains_rect (&view_layout, stage_rect))
+    return FALSE;
+
+  view_scale = clutter_stage_view_get_scale (stage_view);
+  dst_rect = (MetaRectangle) {
+    .x = (int) roundf ((stage_rect->x - view_layout.x) * view_scale),
+    .y = (int) roundf ((stage_rect->y - view_layout.y) * view_scale),
+    .width = (int) roundf (stage_rect->width * view_scale),
+    .height = (int) roundf (stage_rect->height * view_scale),
+  };
+
+  scanout =
+    meta_surface_actor_wayland_try_acquire_overlay (META_SURFACE_ACTOR_WAYLAND (surface_actor),
+                                                    onscreen,
+                                                    &dst_rect);
+  return scanout != NULL;
+}
+
+/*
+ * Picks the top-most unoccluded surfaces of the view that can be scanned out
+ * directly, and tries putting them on overlay planes. Those that succeed are
+ * left out when compositing the view, while those that were on an overlay
+ * plane in the previous frame but no longer are get repainted.
+ */
+static void
+update_overlay_planes (MetaCompositor   *compositor,
+                       ClutterStageView *stage_view)
+{
+  MetaCompositorNative *compositor_native = META_COMPOSITOR_NATIVE (compositor);
+  MetaDisplay *display = meta_compositor_get_display (compositor);
+  MetaRendererView *view = META_RENDERER_VIEW (stage_view);
+  CoglFramebuffer *framebuffer;
+  CoglOnscreen *onscreen;
+  ClutterStage *stage;
+  ClutterActor *window_group;
+  ClutterActor *child;
+  cairo_region_t *occluded;
+  GList *new_overlays = NULL;
+  int n_candidates = 0;
+  GList *l;
+
+  if (!META_IS_CRTC_KMS (meta_renderer_view_get_crtc (view)))
+    return;
+
+  /* Overlay planes can only be placed on top of the view framebuffer when
+   * it is not an intermediate offscreen or shadow framebuffer. */
+  framebuffer = clutter_stage_view_get_framebuffer (stage_view);
+  if (!META_IS_ONSCREEN_NATIVE (framebuffer))
+    return;
+
+  onscreen = COGL_ONSCREEN (framebuffer);
+  meta_onscreen_native_clear_overlays (onscreen);
+
+  if (meta_compositor_is_unredirect_inhibited (compositor) ||
+      clutter_stage_view_peek_scanout (stage_view))
+    goto done;
+
+  /* Screen casts and the like read back the composited view contents */
+  stage = meta_compositor_get_stage (compositor);
+  if (meta_stage_is_view_watched (META_STAGE (stage), stage_view))
+    goto done;
+
+  window_group = meta_get_window_group_for_display (display);
+  occluded = cairo_region_create ();
+
+  for (child = clutter_actor_get_last_child (window_group);
+       child && n_candidates < MAX_OVERLAY_CANDIDATES;
+       child = clutter_actor_get_previous_sibling (child))
+    {
+      MetaSurfaceActor *surface_actor;
+      MetaRectangle stage_rect;
+      ClutterActorBox paint_box;
+
+      if (!clutter_actor_is_visible (child))
+        continue;
+
+      surface_actor = get_overlay_candidate (child, view);
+      if (surface_actor &&
+          get_untransformed_stage_rect (CLUTTER_ACTOR (surface_actor),
+                                        &stage_rect) &&
+          cairo_region_contains_rectangle (occluded, &stage_rect) ==
+          CAIRO_REGION_OVERLAP_OUT &&
+          !is_covered_above_window_group (compositor, window_group,
+                                          &stage_rect))
+        {
+          MetaCompositorNativeOverlay *overlay;
+
+          n_candidates++;
+
+          if (try_assign_overlay (onscreen, stage_view, surface_actor,
+                                  &stage_rect))
+            {
+              overlay = g_new0 (MetaCompositorNativeOverlay, 1);
+              g_set_weak_pointer (&overlay->view, stage_view);
+              g_set_weak_pointer (&overlay->surface_actor, surface_actor);
+              overlay->stage_rect = stage_rect;
+              new_overlays = g_list_prepend (new_overlays, overlay);
+            }
+        }
+
+      if (!clutter_actor_get_paint_box (child, &paint_box))
+        break;
+
+      cairo_region_union_rectangle (occluded, &(cairo_rectangle_int_t) {
+        .x = (int) floorf (paint_box.x1),
+        .y = (int) floorf (paint_box.y1),
+        .width = (int) ceilf (paint_box.x2) - (int) floorf (paint_box.x1),
+        .height = (int) ceilf (paint_box.y2) - (int) floorf (paint_box.y1),
+      });
+    }
+
+  cairo_region_destroy (occluded);
+
+done:
+  l = compositor_native->overlays;
+  while (l)
+    {
+      MetaCompositorNativeOverlay *overlay = l->data;
+      GList *l_next = l->next;
+
+      if (!overlay->view || overlay->view == stage_view)
+        {
+          if (overlay->surface_actor &&
+              !find_overlay (new_overlays, overlay->surface_actor,
+                             &overlay->stage_rect))
+            {
+              MetaShapedTexture *stex =
+                meta_surface_actor_get_texture (overlay->surface_actor);
+
+              meta_shaped_texture_set_overlay_view (stex, NULL);
+
+              /* The view is being painted right now, so add the area to the
+               * current frame rather than queuing another one. */
+              clutter_stage_view_add_redraw_clip (stage_view,
+                                                  &overlay->stage_rect);
+            }
+
+          overlay_free (overlay);
+          compositor_native->overlays =
+            g_list_delete_link (compositor_native->overlays, l);
+        }
+
+      l = l_next;
+    }
+
+  for (l = new_overlays; l; l = l->next)
+    {
+      MetaCompositorNativeOverlay *overlay = l->data;
+      MetaShapedTexture *stex =
+        meta_surface_actor_get_texture (overlay->surface_actor);
+
+      meta_shaped_texture_set_overlay_view (stex, stage_view);
+    }
+
+  compositor_native->overlays = g_list_concat (compositor_native->overlays,
+                                               new_overlays);
+}
+
 static void
 meta_compositor_native_before_paint (MetaCompositor   *compositor,
                                      ClutterStageView *stage_view)
@@ -161,6 +499,7 @@ meta_compositor_native_before_paint (MetaCompositor   *compositor,
   MetaCompositorClass *parent_class;
 
   maybe_assign_primary_plane (compositor);
+  update_overlay_planes (compositor, stage_view);
 
   parent_class = META_COMPOSITOR_CLASS (meta_compositor_native_parent_class);
   parent_class->before_paint (compositor, stage_view);
@@ -182,6 +521,8 @@ meta_compositor_native_finalize (GObject *object)
   MetaCompositorNative *compositor_native = META_COMPOSITOR_NATIVE (object);
 
   g_clear_weak_pointer (&compositor_native->current_scanout_candidate);
+  g_list_free_full (g_steal_pointer (&compositor_native->overlays),
+                    (GDestroyNotify) overlay_free);
 
   G_OBJECT_CLASS (meta_compositor_native_parent_class)->finalize (object);
 }
@@ -70,9 +70,13 @@ void meta_shaped_texture_set_clip_region (MetaShapedTexture *stex,
                                           cairo_region_t    *clip_region);
 void meta_shaped_texture_set_opaque_region (MetaShapedTexture *stex,
                                             cairo_region_t    *opaque_region);
+void meta_shaped_texture_set_overlay_view (MetaShapedTexture *stex,
+                                           ClutterStageView  *overlay_view);
 
 void meta_shaped_texture_ensure_size_valid (MetaShapedTexture *stex);
 
+gboolean meta_shaped_texture_is_untransformed (MetaShapedTexture *stex);
+
 gboolean meta_shaped_texture_should_get_via_offscreen (MetaShapedTexture *stex);
 
 #endif
@@ -100,6 +100,9 @@ struct _MetaShapedTexture
   /* MetaCullable regions, see that documentation for more details */
   cairo_region_t *clip_region;
 
+  /* The view whose overlay plane currently displays the texture */
+  ClutterStageView *overlay_view;
+
   gboolean size_invalid;
   MetaMonitorTransform transform;
   gboolean has_viewport_src_rect;
@@ -236,6 +239,40 @@ meta_shaped_texture_set_clip_region (MetaShapedTexture *stex,
     stex->clip_region = cairo_region_reference (clip_region);
 }
 
+/*
+ * While an overlay plane of @overlay_view displays the texture, it is left out
+ * when painting that view, as it would be hidden under the plane anyway.
+ * Painting into other framebuffers, e.g. for clones or screenshots, is not
+ * affected.
+ */
+void
+meta_shaped_texture_set_overlay_view (MetaShapedTexture *stex,
+                                      ClutterStageView  *overlay_view)
+{
+  g_set_weak_pointer (&stex->overlay_view, overlay_view);
+}
+
+static gboolean
+is_displayed_on_overlay_plane (MetaShapedTexture   *stex,
+                               ClutterActor        *actor,
+                               ClutterPaintContext *paint_context)
+{
+  ClutterStageView *view;
+
+  if (!stex->overlay_view)
+    return FALSE;
+
+  view = clutter_paint_context_get_stage_view (paint_context);
+  if (view != stex->overlay_view)
+    return FALSE;
+
+  if (clutter_paint_context_get_framebuffer (paint_context) !=
+      clutter_stage_view_get_framebuffer (view))
+    return FALSE;
+
+  return !clutter_actor_is_in_clone_paint (actor);
+}
+
 static void
 meta_shaped_texture_reset_pipelines (MetaShapedTexture *stex)
 {
@@ -262,6 +299,7 @@ meta_shaped_texture_dispose (GObject *object)
 
   g_clear_pointer (&stex->opaque_region, cairo_region_destroy);
   g_clear_pointer (&stex->clip_region, cairo_region_destroy);
+  g_clear_weak_pointer (&stex->overlay_view);
 
   g_clear_pointer (&stex->snippet, cogl_object_unref);
 
@@ -882,6 +920,9 @@ meta_shaped_texture_paint_content (ClutterContent      *content,
   if (stex->clip_region && cairo_region_is_empty (stex->clip_region))
     return;
 
+  if (is_displayed_on_overlay_plane (stex, actor, paint_context))
+    return;
+
   /* The GL EXT_texture_from_pixmap extension does allow for it to be
    * used together with SGIS_generate_mipmap, however this is very
    * rarely supported. Also, even when it is supported there
@@ -1343,17 +1384,18 @@ meta_shaped_texture_reset_viewport_dst_size (MetaShapedTexture *stex)
   invalidate_size (stex);
 }
 
+/*
+ * Whether the texture is shown as is, i.e. without a mask, viewport or buffer
+ * transform, so that its contents can be copied on the GPU without painting.
+ */
 gboolean
-meta_shaped_texture_should_get_via_offscreen (MetaShapedTexture *stex)
+meta_shaped_texture_is_untransformed (MetaShapedTexture *stex)
 {
   if (stex->mask_texture != NULL)
-    return TRUE;
-
-  if (!cogl_texture_is_get_data_supported (stex->texture))
-    return TRUE;
+    return FALSE;
 
   if (stex->has_viewport_src_rect || stex->has_viewport_dst_size)
-    return TRUE;
+    return FALSE;
 
   switch (stex->transform)
     {
@@ -1364,12 +1406,21 @@ meta_shaped_texture_should_get_via_offscreen (MetaShapedTexture *stex)
     case META_MONITOR_TRANSFORM_FLIPPED_90:
     case META_MONITOR_TRANSFORM_FLIPPED_180:
     case META_MONITOR_TRANSFORM_FLIPPED_270:
-      return TRUE;
+      return FALSE;
     case META_MONITOR_TRANSFORM_NORMAL:
       break;
     }
 
-  return FALSE;
+  return TRUE;
+}
+
+gboolean
+meta_shaped_texture_should_get_via_offscreen (MetaShapedTexture *stex)
+{
+  if (!cogl_texture_is_get_data_supported (stex->texture))
+    return TRUE;
+
+  return !meta_shaped_texture_is_untransformed (stex);
 }
 
 /**
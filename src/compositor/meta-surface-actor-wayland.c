@@ -88,6 +88,19 @@ meta_surface_actor_wayland_try_acquire_scanout (MetaSurfaceActorWayland *self,
   return scanout;
 }
 
+CoglScanout *
+meta_surface_actor_wayland_try_acquire_overlay (MetaSurfaceActorWayland *self,
+                                                CoglOnscreen            *onscreen,
+                                                const MetaRectangle     *dst_rect)
+{
+  MetaWaylandSurface *surface;
+
+  surface = meta_surface_actor_wayland_get_surface (self);
+  g_return_val_if_fail (surface, NULL);
+
+  return meta_wayland_surface_try_acquire_overlay (surface, onscreen, dst_rect);
+}
+
 #define UNOBSCURED_TRESHOLD 0.1
 
 ClutterStageView *
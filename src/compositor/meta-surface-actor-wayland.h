@@ -53,6 +53,10 @@ void meta_surface_actor_wayland_add_frame_callbacks (MetaSurfaceActorWayland *se
 CoglScanout * meta_surface_actor_wayland_try_acquire_scanout (MetaSurfaceActorWayland *self,
                                                               CoglOnscreen            *onscreen);
 
+CoglScanout * meta_surface_actor_wayland_try_acquire_overlay (MetaSurfaceActorWayland *self,
+                                                              CoglOnscreen            *onscreen,
+                                                              const MetaRectangle     *dst_rect);
+
 ClutterStageView * meta_surface_actor_wayland_get_current_primary_view (MetaSurfaceActor *actor,
                                                                         ClutterStage     *stage);
 
@@ -6,6 +6,7 @@
 #include "config.h"
 
 #include "backends/meta-backend-types.h"
+#include "core/util-private.h"
 #include "meta/meta-shaped-texture.h"
 #include "meta/window.h"
 
@@ -35,7 +36,9 @@ void meta_surface_actor_update_area (MetaSurfaceActor *self,
                                      int               width,
                                      int               height);
 
+META_EXPORT_TEST
 gboolean meta_surface_actor_is_obscured (MetaSurfaceActor *self);
+
 gboolean meta_surface_actor_is_obscured_on_stage_view (MetaSurfaceActor *self,
                                                        ClutterStageView *stage_view,
                                                        float            *unobscurred_fraction);
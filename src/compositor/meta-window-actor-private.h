@@ -78,6 +78,7 @@ void     meta_window_actor_queue_frame_drawn   (MetaWindowActor *self,
 void meta_window_actor_effect_completed (MetaWindowActor  *actor,
                                          MetaPluginEffect  event);
 
+META_EXPORT_TEST
 MetaSurfaceActor *meta_window_actor_get_surface (MetaWindowActor *self);
 
 MetaSurfaceActor * meta_window_actor_get_topmost_surface (MetaWindowActor *self);
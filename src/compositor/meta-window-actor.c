@@ -1691,6 +1691,91 @@ meta_window_actor_capture_into (MetaScreenCastWindow *screen_cast_window,
   cairo_surface_destroy (image);
 }
 
+static gboolean
+can_blit_surface_texture (MetaWindowActor *window_actor)
+{
+  MetaWindowActorPrivate *priv =
+    meta_window_actor_get_instance_private (window_actor);
+  MetaShapedTexture *stex;
+
+  if (!priv->surface)
+    return FALSE;
+
+  if (clutter_actor_get_n_children (CLUTTER_ACTOR (window_actor)) != 1)
+    return FALSE;
+
+  stex = meta_surface_actor_get_texture (priv->surface);
+  if (!meta_shaped_texture_get_texture (stex))
+    return FALSE;
+
+  return meta_shaped_texture_is_untransformed (stex);
+}
+
+/*
+ * Windows made up of a single surface whose buffer is shown as is can be
+ * copied straight from its texture, instead of painting the window actor.
+ */
+static void
+blit_surface_texture_to_framebuffer (MetaWindowActor *window_actor,
+                                     MetaRectangle   *bounds,
+                                     CoglFramebuffer *framebuffer)
+{
+  MetaWindowActorPrivate *priv =
+    meta_window_actor_get_instance_private (window_actor);
+  CoglContext *cogl_context = cogl_framebuffer_get_context (framebuffer);
+  MetaShapedTexture *stex;
+  CoglTexture *texture;
+  CoglPipeline *pipeline;
+  CoglColor clear_color;
+  MetaRectangle texture_rect;
+  MetaRectangle clip;
+  int framebuffer_width, framebuffer_height;
+
+  stex = meta_surface_actor_get_texture (priv->surface);
+  texture = meta_shaped_texture_get_texture (stex);
+
+  framebuffer_width = cogl_framebuffer_get_width (framebuffer);
+  framebuffer_height = cogl_framebuffer_get_height (framebuffer);
+
+  cogl_color_init_from_4ub (&clear_color, 0, 0, 0, 0);
+  cogl_framebuffer_clear (framebuffer, COGL_BUFFER_BIT_COLOR, &clear_color);
+  cogl_framebuffer_orthographic (framebuffer,
+                                 0, 0,
+                                 framebuffer_width, framebuffer_height,
+                                 0, 1.0);
+  cogl_framebuffer_set_viewport (framebuffer,
+                                 0, 0,
+                                 framebuffer_width, framebuffer_height);
+
+  texture_rect = (MetaRectangle) {
+    .width = cogl_texture_get_width (texture),
+    .height = cogl_texture_get_height (texture),
+  };
+  if (!meta_rectangle_intersect (bounds, &texture_rect, &clip))
+    return;
+
+  pipeline = cogl_pipeline_new (cogl_context);
+  cogl_pipeline_set_layer_texture (pipeline, 0, texture);
+  cogl_pipeline_set_layer_filters (pipeline, 0,
+                                   COGL_PIPELINE_FILTER_NEAREST,
+                                   COGL_PIPELINE_FILTER_NEAREST);
+  cogl_pipeline_set_blend (pipeline, "RGBA = ADD (SRC_COLOR, 0)", NULL);
+
+  cogl_framebuffer_draw_textured_rectangle (framebuffer,
+                                            pipeline,
+                                            clip.x, clip.y,
+                                            clip.x + clip.width,
+                                            clip.y + clip.height,
+                                            (float) clip.x / texture_rect.width,
+                                            (float) clip.y / texture_rect.height,
+                                            ((float) (clip.x + clip.width) /
+                                             texture_rect.width),
+                                            ((float) (clip.y + clip.height) /
+                                             texture_rect.height));
+
+  cogl_object_unref (pipeline);
+}
+
 static gboolean
 meta_window_actor_blit_to_framebuffer (MetaScreenCastWindow *screen_cast_window,
                                        MetaRectangle        *bounds,
@@ -1708,6 +1793,12 @@ meta_window_actor_blit_to_framebuffer (MetaScreenCastWindow *screen_cast_window,
   if (meta_window_actor_is_destroyed (window_actor))
     return FALSE;
 
+  if (can_blit_surface_texture (window_actor))
+    {
+      blit_surface_texture_to_framebuffer (window_actor, bounds, framebuffer);
+      return TRUE;
+    }
+
   clutter_actor_get_size (actor, &width, &height);
 
   if (width == 0 || height == 0)
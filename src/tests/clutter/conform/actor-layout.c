@@ -1,7 +1,10 @@
 #include <clutter/clutter.h>
+#include <clutter/clutter-mutter.h>
 
 #include "tests/clutter-test-utils.h"
 
+#define N_PRUNE_CHILDREN 50
+
 static void
 actor_basic_layout (void)
 {
@@ -92,7 +95,71 @@ actor_margin_layout (void)
   clutter_actor_destroy (vase);
 }
 
+static void
+wait_for_update (ClutterActor       *stage,
+                 ClutterLayoutStats *stats)
+{
+  GMainLoop *main_loop = g_main_loop_new (NULL, FALSE);
+  gulong update_handler;
+
+  update_handler = g_signal_connect_swapped (stage, "after-update",
+                                             G_CALLBACK (g_main_loop_quit),
+                                             main_loop);
+  g_main_loop_run (main_loop);
+  g_clear_signal_handler (&update_handler, stage);
+  g_main_loop_unref (main_loop);
+
+  clutter_stage_get_layout_stats (CLUTTER_STAGE (stage), stats);
+}
+
+static void
+actor_pruned_layout (void)
+{
+  ClutterActor *stage = clutter_test_get_stage ();
+  ClutterActor *vase;
+  ClutterActor *flower[N_PRUNE_CHILDREN];
+  ClutterLayoutStats stats;
+  graphene_point_t p;
+  int i;
+
+  vase = clutter_actor_new ();
+  clutter_actor_set_name (vase, "Vase");
+  clutter_actor_set_layout_manager (vase, clutter_box_layout_new ());
+  clutter_actor_add_child (stage, vase);
+
+  for (i = 0; i < N_PRUNE_CHILDREN; i++)
+    {
+      flower[i] = clutter_actor_new ();
+      clutter_actor_set_background_color (flower[i], CLUTTER_COLOR_Red);
+      clutter_actor_set_size (flower[i], 10, 10);
+      clutter_actor_add_child (vase, flower[i]);
+    }
+
+  clutter_actor_show (stage);
+  wait_for_update (stage, &stats);
+
+  /* The size request doesn't change, so only the flower is reallocated */
+  clutter_actor_queue_relayout (flower[0]);
+  wait_for_update (stage, &stats);
+
+  g_assert_cmpuint (stats.n_pruned_relayouts, ==, 1);
+  g_assert_cmpuint (stats.n_allocate, ==, 1);
+
+  /* A changed size request must reach the layout manager of the parent */
+  clutter_actor_set_width (flower[0], 20);
+  wait_for_update (stage, &stats);
+
+  g_assert_cmpuint (stats.n_pruned_relayouts, ==, 0);
+  g_assert_cmpuint (stats.n_allocate, >, N_PRUNE_CHILDREN);
+
+  graphene_point_init (&p, 25, 5);
+  clutter_test_assert_actor_at_point (stage, &p, flower[1]);
+
+  clutter_actor_destroy (vase);
+}
+
 CLUTTER_TEST_SUITE (
   CLUTTER_TEST_UNIT ("/actor/layout/basic", actor_basic_layout)
   CLUTTER_TEST_UNIT ("/actor/layout/margin", actor_margin_layout)
+  CLUTTER_TEST_UNIT ("/actor/layout/pruned", actor_pruned_layout)
 )
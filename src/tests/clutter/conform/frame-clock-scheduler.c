@@ -0,0 +1,403 @@
+#include "clutter/clutter.h"
+#include "tests/clutter-test-utils.h"
+
+static const float refresh_rate = 60.0;
+static const int64_t refresh_interval_us = (int64_t) (0.5 + G_USEC_PER_SEC /
+                                                      refresh_rate);
+
+#define N_FRAMES 120
+#define SWAP_TO_FLIP_US 100
+
+typedef struct _RenderTime
+{
+  int64_t cpu_us;
+  int64_t gpu_us;
+
+  /* Time without updates before this frame */
+  unsigned int idle_ms;
+} RenderTime;
+
+typedef struct _FakePresentSource
+{
+  GSource source;
+
+  ClutterFrameClock *frame_clock;
+  ClutterFrameInfo frame_info;
+} FakePresentSource;
+
+typedef struct _SchedulerTest
+{
+  GMainLoop *main_loop;
+  FakePresentSource *present_source;
+
+  const RenderTime *trace;
+  int n_frames;
+  int frame;
+
+  ClutterFrameClockMode mode;
+
+  /* With a fixed refresh rate, vertical blanks happen at
+   * vblank_base_us + n * refresh_interval_us.
+   */
+  int64_t vblank_base_us;
+  int64_t last_presentation_time_us;
+
+  int64_t schedule_time_us;
+
+  int64_t latency_us[N_FRAMES];
+  int64_t update_latency_us[N_FRAMES];
+  int64_t presentation_time_us[N_FRAMES];
+  int64_t max_render_time_us[N_FRAMES];
+} SchedulerTest;
+
+static gboolean
+fake_present_source_dispatch (GSource     *source,
+                              GSourceFunc  callback,
+                              gpointer     user_data)
+{
+  FakePresentSource *present_source = (FakePresentSource *) source;
+
+  g_source_set_ready_time (source, -1);
+
+  clutter_frame_clock_notify_presented (present_source->frame_clock,
+                                        &present_source->frame_info);
+  if (callback)
+    callback (user_data);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs fake_present_source_funcs = {
+  NULL,
+  NULL,
+  fake_present_source_dispatch,
+  NULL
+};
+
+static int64_t
+get_next_vblank_time_us (SchedulerTest *test,
+                         int64_t        time_us)
+{
+  int64_t n_intervals;
+
+  n_intervals = (time_us - test->vblank_base_us + refresh_interval_us - 1) /
+                refresh_interval_us;
+
+  return test->vblank_base_us + n_intervals * refresh_interval_us;
+}
+
+static int64_t
+get_presentation_time_us (SchedulerTest *test,
+                          int64_t        ready_time_us)
+{
+  switch (test->mode)
+    {
+    case CLUTTER_FRAME_CLOCK_MODE_FIXED:
+      return get_next_vblank_time_us (test, ready_time_us);
+    case CLUTTER_FRAME_CLOCK_MODE_VARIABLE:
+      /* Presented right away, unless faster than the display can go */
+      if (test->last_presentation_time_us == 0)
+        return ready_time_us;
+      return MAX (ready_time_us,
+                  test->last_presentation_time_us + refresh_interval_us);
+    }
+
+  g_assert_not_reached ();
+}
+
+static ClutterFrameResult
+scheduler_test_frame (ClutterFrameClock *frame_clock,
+                      int64_t            frame_count,
+                      gpointer           user_data)
+{
+  SchedulerTest *test = user_data;
+  const RenderTime *render_time = &test->trace[test->frame];
+  FakePresentSource *present_source = test->present_source;
+  int64_t dispatch_time_us;
+  int64_t swap_time_us;
+  int64_t presentation_time_us;
+
+  /* Use the time the frame clock itself sees as the dispatch time, so that
+   * the measured render times are exactly the ones of the trace.
+   */
+  dispatch_time_us = g_source_get_time (g_main_current_source ());
+  swap_time_us = dispatch_time_us + render_time->cpu_us;
+
+  /* The frame can be presented once both the CPU and the GPU are done */
+  presentation_time_us =
+    get_presentation_time_us (test,
+                              swap_time_us + MAX (render_time->gpu_us,
+                                                  SWAP_TO_FLIP_US));
+  test->last_presentation_time_us = presentation_time_us;
+
+  clutter_frame_clock_record_flip_time (frame_clock,
+                                        swap_time_us + SWAP_TO_FLIP_US);
+
+  present_source->frame_info = (ClutterFrameInfo) {
+    .presentation_time = presentation_time_us,
+    .refresh_rate = refresh_rate,
+    .flags = CLUTTER_FRAME_INFO_FLAG_NONE,
+    .sequence = 0,
+    .gpu_rendering_duration_ns = render_time->gpu_us * 1000,
+    .cpu_time_before_buffer_swap_us = swap_time_us,
+  };
+  g_source_set_ready_time (&present_source->source, presentation_time_us);
+
+  test->latency_us[test->frame] = presentation_time_us - dispatch_time_us;
+  test->update_latency_us[test->frame] =
+    presentation_time_us - test->schedule_time_us;
+  test->presentation_time_us[test->frame] = presentation_time_us;
+
+  return CLUTTER_FRAME_RESULT_PENDING_PRESENTED;
+}
+
+static const ClutterFrameListenerIface frame_listener_iface = {
+  .frame = scheduler_test_frame,
+};
+
+static gboolean
+schedule_update (gpointer user_data)
+{
+  SchedulerTest *test = user_data;
+
+  test->schedule_time_us = g_get_monotonic_time ();
+  clutter_frame_clock_schedule_update (test->present_source->frame_clock);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+on_presented (gpointer user_data)
+{
+  SchedulerTest *test = user_data;
+  ClutterFrameClock *frame_clock = test->present_source->frame_clock;
+  unsigned int idle_ms;
+
+  test->max_render_time_us[test->frame] =
+    clutter_frame_clock_get_max_render_time_us (frame_clock);
+  /* The frame clock counts from the start of the dispatch */
+  g_assert_cmpint (clutter_frame_clock_get_frame_latency_us (frame_clock), >=,
+                   test->latency_us[test->frame]);
+
+  test->frame++;
+  if (test->frame == test->n_frames)
+    {
+      g_main_loop_quit (test->main_loop);
+      return G_SOURCE_CONTINUE;
+    }
+
+  idle_ms = test->trace[test->frame].idle_ms;
+  if (idle_ms > 0)
+    g_timeout_add (idle_ms, schedule_update, test);
+  else
+    schedule_update (test);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+run_variable_trace (SchedulerTest              *test,
+                    const RenderTime           *trace,
+                    int                         n_frames,
+                    ClutterFrameClockScheduler  scheduler,
+                    ClutterFrameClockMode       mode,
+                    float                       max_refresh_rate)
+{
+  ClutterFrameClock *frame_clock;
+  GSource *source;
+
+  g_assert_cmpint (n_frames, <=, N_FRAMES);
+
+  *test = (SchedulerTest) {
+    .main_loop = g_main_loop_new (NULL, FALSE),
+    .trace = trace,
+    .n_frames = n_frames,
+    .mode = mode,
+    .vblank_base_us = g_get_monotonic_time (),
+  };
+
+  frame_clock = clutter_frame_clock_new (refresh_rate,
+                                         0,
+                                         &frame_listener_iface,
+                                         test);
+  clutter_frame_clock_set_scheduler (frame_clock, scheduler);
+  clutter_frame_clock_set_mode (frame_clock, mode);
+  clutter_frame_clock_set_variable_refresh_range (frame_clock,
+                                                  0, max_refresh_rate);
+
+  source = g_source_new (&fake_present_source_funcs,
+                         sizeof (FakePresentSource));
+  test->present_source = (FakePresentSource *) source;
+  test->present_source->frame_clock = frame_clock;
+  g_source_set_callback (source, on_presented, test, NULL);
+  g_source_attach (source, NULL);
+
+  schedule_update (test);
+  g_main_loop_run (test->main_loop);
+
+  g_main_loop_unref (test->main_loop);
+
+  clutter_frame_clock_destroy (frame_clock);
+  g_source_destroy (source);
+  g_source_unref (source);
+}
+
+static void
+run_trace (SchedulerTest              *test,
+           const RenderTime           *trace,
+           ClutterFrameClockScheduler  scheduler)
+{
+  run_variable_trace (test, trace, N_FRAMES, scheduler,
+                      CLUTTER_FRAME_CLOCK_MODE_FIXED, 0);
+}
+
+static int64_t
+get_average (const int64_t *values,
+             int            first,
+             int            last)
+{
+  int64_t sum = 0;
+  int i;
+
+  for (i = first; i <= last; i++)
+    sum += values[i];
+
+  return sum / (last - first + 1);
+}
+
+static void
+frame_clock_scheduler_single_spike (void)
+{
+  RenderTime trace[N_FRAMES];
+  SchedulerTest max_test;
+  SchedulerTest histogram_test;
+  int i;
+
+  for (i = 0; i < N_FRAMES; i++)
+    trace[i] = (RenderTime) { .cpu_us = 2000, .gpu_us = 2000 };
+
+  /* A single slow frame, e.g. compiling a shader */
+  trace[60].cpu_us = 12000;
+
+  run_trace (&max_test, trace, CLUTTER_FRAME_CLOCK_SCHEDULER_MAX_RENDER_TIME);
+  run_trace (&histogram_test, trace, CLUTTER_FRAME_CLOCK_SCHEDULER_HISTOGRAM);
+
+  g_test_message ("Render time after spike: max %ld µs, histogram %ld µs",
+                  max_test.max_render_time_us[62],
+                  histogram_test.max_render_time_us[62]);
+
+  /* The slow frame stays in the estimate of the maximum based scheduler for
+   * a while, but doesn't affect the percentile.
+   */
+  for (i = 60; i < 75; i++)
+    {
+      g_assert_cmpint (max_test.max_render_time_us[i], >,
+                       max_test.max_render_time_us[59]);
+      g_assert_cmpint (histogram_test.max_render_time_us[i], ==,
+                       histogram_test.max_render_time_us[59]);
+    }
+
+  g_assert_cmpint (histogram_test.max_render_time_us[59], <,
+                   refresh_interval_us / 2);
+}
+
+static void
+frame_clock_scheduler_alternating (void)
+{
+  RenderTime trace[N_FRAMES];
+  SchedulerTest test;
+  int i;
+
+  /* Every other frame is heavy, e.g. updating a blur */
+  for (i = 0; i < N_FRAMES; i++)
+    {
+      trace[i] = (RenderTime) {
+        .cpu_us = i % 2 ? 9000 : 2000,
+        .gpu_us = 2000,
+      };
+    }
+
+  run_trace (&test, trace, CLUTTER_FRAME_CLOCK_SCHEDULER_HISTOGRAM);
+
+  /* Once the pattern is learned, light frames are dispatched early enough
+   * for the heavy ones too.
+   */
+  for (i = 30; i < N_FRAMES; i++)
+    {
+      g_assert_cmpint (test.max_render_time_us[i], >=, 9000 + 2000);
+      g_assert_cmpint (test.max_render_time_us[i], <, refresh_interval_us);
+    }
+}
+
+#define N_SPORADIC_FRAMES 30
+
+static void
+frame_clock_scheduler_variable_refresh_rate (void)
+{
+  RenderTime trace[N_SPORADIC_FRAMES];
+  SchedulerTest fixed_test;
+  SchedulerTest variable_test;
+  int64_t fixed_latency_us;
+  int64_t variable_latency_us;
+  int i;
+
+  /* Sporadic updates, e.g. a cursor or a video surface */
+  for (i = 0; i < N_SPORADIC_FRAMES; i++)
+    {
+      trace[i] = (RenderTime) {
+        .cpu_us = 1000,
+        .gpu_us = 1000,
+        .idle_ms = 20 + (i % 3) * 7,
+      };
+    }
+
+  run_variable_trace (&fixed_test, trace, N_SPORADIC_FRAMES,
+                      CLUTTER_FRAME_CLOCK_SCHEDULER_HISTOGRAM,
+                      CLUTTER_FRAME_CLOCK_MODE_FIXED, 0);
+  run_variable_trace (&variable_test, trace, N_SPORADIC_FRAMES,
+                      CLUTTER_FRAME_CLOCK_SCHEDULER_HISTOGRAM,
+                      CLUTTER_FRAME_CLOCK_MODE_VARIABLE, 0);
+
+  /* Time from scheduling an update until it is on screen */
+  fixed_latency_us = get_average (fixed_test.update_latency_us,
+                                  5, N_SPORADIC_FRAMES - 1);
+  variable_latency_us = get_average (variable_test.update_latency_us,
+                                     5, N_SPORADIC_FRAMES - 1);
+
+  g_test_message ("Update latency: fixed %ld µs, variable %ld µs",
+                  fixed_latency_us, variable_latency_us);
+
+  g_assert_cmpint (variable_latency_us, <, fixed_latency_us);
+  g_assert_cmpint (variable_latency_us, <, refresh_interval_us / 3);
+}
+
+static void
+frame_clock_scheduler_variable_refresh_rate_range (void)
+{
+  RenderTime trace[N_SPORADIC_FRAMES];
+  SchedulerTest test;
+  int i;
+
+  for (i = 0; i < N_SPORADIC_FRAMES; i++)
+    trace[i] = (RenderTime) { .cpu_us = 1000, .gpu_us = 1000 };
+
+  /* Continuous rendering limited to half the refresh rate of the mode */
+  run_variable_trace (&test, trace, N_SPORADIC_FRAMES,
+                      CLUTTER_FRAME_CLOCK_SCHEDULER_HISTOGRAM,
+                      CLUTTER_FRAME_CLOCK_MODE_VARIABLE,
+                      refresh_rate / 2);
+
+  for (i = 5; i < N_SPORADIC_FRAMES; i++)
+    {
+      g_assert_cmpint (test.presentation_time_us[i] -
+                       test.presentation_time_us[i - 1],
+                       >, refresh_interval_us * 3 / 2);
+    }
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/frame-clock/scheduler/single-spike", frame_clock_scheduler_single_spike)
+  CLUTTER_TEST_UNIT ("/frame-clock/scheduler/alternating", frame_clock_scheduler_alternating)
+  CLUTTER_TEST_UNIT ("/frame-clock/scheduler/variable-refresh-rate", frame_clock_scheduler_variable_refresh_rate)
+  CLUTTER_TEST_UNIT ("/frame-clock/scheduler/variable-refresh-rate-range", frame_clock_scheduler_variable_refresh_rate_range)
+)
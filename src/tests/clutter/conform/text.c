@@ -547,6 +547,73 @@ text_idempotent_use_markup (void)
   clutter_actor_destroy (CLUTTER_ACTOR (text));
 }
 
+static void
+on_queue_relayout (ClutterActor *actor,
+                   gboolean     *relayout_queued)
+{
+  *relayout_queued = TRUE;
+}
+
+static void
+text_async_layout (void)
+{
+  ClutterActor *stage = clutter_test_get_stage ();
+  ClutterText *sync_text, *async_text;
+  float sync_width, sync_height;
+  float width, height;
+  gboolean relayout_queued = FALSE;
+  GString *contents;
+  int i;
+
+  contents = g_string_new (NULL);
+  for (i = 0; i < 200; i++)
+    g_string_append (contents, "The quick brown fox jumps over the lazy dog. ");
+
+  sync_text = CLUTTER_TEXT (clutter_text_new_with_text ("Sans 10",
+                                                        contents->str));
+  clutter_actor_add_child (stage, CLUTTER_ACTOR (sync_text));
+  clutter_actor_get_preferred_size (CLUTTER_ACTOR (sync_text),
+                                    NULL, NULL,
+                                    &sync_width, &sync_height);
+
+  async_text = CLUTTER_TEXT (clutter_text_new ());
+  clutter_text_set_async_layout (async_text, TRUE);
+  g_assert_true (clutter_text_get_async_layout (async_text));
+  clutter_text_set_font_name (async_text, "Sans 10");
+  clutter_text_set_text (async_text, contents->str);
+  clutter_actor_add_child (stage, CLUTTER_ACTOR (async_text));
+
+  /* Until shaping has finished, the size of an empty layout is reported */
+  clutter_actor_get_preferred_size (CLUTTER_ACTOR (async_text),
+                                    NULL, NULL,
+                                    &width, &height);
+  g_assert_cmpfloat (width, <, sync_width);
+
+  g_signal_connect (async_text, "queue-relayout",
+                    G_CALLBACK (on_queue_relayout), &relayout_queued);
+
+  while (!relayout_queued)
+    g_main_context_iteration (NULL, TRUE);
+
+  clutter_actor_get_preferred_size (CLUTTER_ACTOR (async_text),
+                                    NULL, NULL,
+                                    &width, &height);
+  g_assert_cmpfloat (width, ==, sync_width);
+  g_assert_cmpfloat (height, ==, sync_height);
+
+  /* Editable text is always shaped synchronously */
+  clutter_text_set_editable (async_text, TRUE);
+  clutter_text_set_text (async_text, "abc");
+  clutter_actor_get_preferred_size (CLUTTER_ACTOR (async_text),
+                                    NULL, NULL,
+                                    &width, &height);
+  g_assert_cmpfloat (width, >, 0);
+
+  clutter_actor_destroy (CLUTTER_ACTOR (async_text));
+  clutter_actor_destroy (CLUTTER_ACTOR (sync_text));
+  g_string_free (contents, TRUE);
+}
+
 CLUTTER_TEST_SUITE (
   CLUTTER_TEST_UNIT ("/text/utf8-validation", text_utf8_validation)
   CLUTTER_TEST_UNIT ("/text/set-empty", text_set_empty)
@@ -561,4 +628,5 @@ CLUTTER_TEST_SUITE (
   CLUTTER_TEST_UNIT ("/text/cursor", text_cursor)
   CLUTTER_TEST_UNIT ("/text/event", text_event)
   CLUTTER_TEST_UNIT ("/text/idempotent-use-markup", text_idempotent_use_markup)
+  CLUTTER_TEST_UNIT ("/text/async-layout", text_async_layout)
 )
@@ -0,0 +1,128 @@
+#include <clutter/clutter.h>
+
+#include "tests/clutter-test-utils.h"
+
+static const char *transition_names[] = {
+  "x",
+  "opacity",
+  "background-color",
+};
+
+typedef struct
+{
+  ClutterActor *batched;
+  ClutterActor *unbatched;
+  int n_compared_frames;
+  gboolean completed;
+} TransitionBatchData;
+
+static void
+on_new_frame (ClutterTimeline *timeline,
+              int              elapsed_msecs,
+              gpointer         user_data)
+{
+}
+
+static void
+on_after_update (ClutterStage        *stage,
+                 ClutterStageView    *view,
+                 TransitionBatchData *data)
+{
+  ClutterColor batched_color, unbatched_color;
+
+  g_assert_cmpfloat (clutter_actor_get_x (data->batched), ==,
+                     clutter_actor_get_x (data->unbatched));
+  g_assert_cmpint (clutter_actor_get_opacity (data->batched), ==,
+                   clutter_actor_get_opacity (data->unbatched));
+
+  clutter_actor_get_background_color (data->batched, &batched_color);
+  clutter_actor_get_background_color (data->unbatched, &unbatched_color);
+  g_assert_true (clutter_color_equal (&batched_color, &unbatched_color));
+
+  data->n_compared_frames++;
+}
+
+static void
+on_transitions_completed (ClutterActor        *actor,
+                          TransitionBatchData *data)
+{
+  data->completed = TRUE;
+}
+
+static void
+start_transitions (ClutterActor         *actor,
+                   ClutterAnimationMode  mode)
+{
+  clutter_actor_save_easing_state (actor);
+  clutter_actor_set_easing_mode (actor, mode);
+  clutter_actor_set_easing_duration (actor, 250);
+  clutter_actor_set_x (actor, 200.f);
+  clutter_actor_set_opacity (actor, 0);
+  clutter_actor_set_background_color (actor, CLUTTER_COLOR_Blue);
+  clutter_actor_restore_easing_state (actor);
+}
+
+static void
+transition_batch_matches_unbatched (void)
+{
+  ClutterAnimationMode modes[] = {
+    CLUTTER_LINEAR,
+    CLUTTER_EASE_OUT_CUBIC,
+    CLUTTER_EASE_IN_OUT_BOUNCE,
+    CLUTTER_STEPS,
+  };
+  ClutterActor *stage = clutter_test_get_stage ();
+  unsigned int i, j;
+
+  clutter_actor_show (stage);
+
+  for (i = 0; i < G_N_ELEMENTS (modes); i++)
+    {
+      TransitionBatchData data = { 0, };
+      gulong after_update_id;
+
+      data.batched = clutter_actor_new ();
+      data.unbatched = clutter_actor_new ();
+      clutter_actor_set_background_color (data.batched, CLUTTER_COLOR_Red);
+      clutter_actor_set_background_color (data.unbatched, CLUTTER_COLOR_Red);
+      clutter_actor_add_child (stage, data.batched);
+      clutter_actor_add_child (stage, data.unbatched);
+
+      start_transitions (data.batched, modes[i]);
+      start_transitions (data.unbatched, modes[i]);
+
+      /* A ::new-frame handler makes the transition take the regular path */
+      for (j = 0; j < G_N_ELEMENTS (transition_names); j++)
+        {
+          ClutterTransition *transition;
+
+          transition = clutter_actor_get_transition (data.unbatched,
+                                                     transition_names[j]);
+          g_assert_nonnull (transition);
+          g_signal_connect (transition, "new-frame",
+                            G_CALLBACK (on_new_frame), NULL);
+        }
+
+      g_signal_connect (data.batched, "transitions-completed",
+                        G_CALLBACK (on_transitions_completed), &data);
+      after_update_id = g_signal_connect (stage, "after-update",
+                                          G_CALLBACK (on_after_update),
+                                          &data);
+
+      while (!data.completed)
+        g_main_context_iteration (NULL, TRUE);
+
+      g_signal_handler_disconnect (stage, after_update_id);
+
+      g_assert_cmpint (data.n_compared_frames, >, 0);
+      g_assert_cmpfloat (clutter_actor_get_x (data.batched), ==, 200.f);
+      g_assert_cmpint (clutter_actor_get_opacity (data.batched), ==, 0);
+
+      clutter_actor_destroy (data.batched);
+      clutter_actor_destroy (data.unbatched);
+    }
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/transition-batch/matches-unbatched", transition_batch_matches_unbatched)
+)
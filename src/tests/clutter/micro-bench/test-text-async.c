@@ -0,0 +1,139 @@
+#include <clutter/clutter.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tests/clutter-test-utils.h"
+
+#define STAGE_WIDTH  800
+#define STAGE_HEIGHT 600
+
+#define BLOB_SIZE (100 * 1024)
+#define N_RUNS 10
+
+typedef struct
+{
+  int64_t blocked_us;
+  int64_t ready_us;
+} Sample;
+
+static char *
+create_blob (int run)
+{
+  GString *str;
+
+  str = g_string_sized_new (BLOB_SIZE);
+
+  /* Vary the contents so that no run hits a cache of the previous one */
+  while (str->len < BLOB_SIZE)
+    g_string_append_printf (str,
+                            "%d: Lorem ipsum dolor sit amet, consectetur "
+                            "adipiscing elit, sed do eiusmod tempor. ",
+                            run);
+
+  return g_string_free (str, FALSE);
+}
+
+static void
+on_queue_relayout (ClutterActor *actor,
+                   gboolean     *relayout_queued)
+{
+  *relayout_queued = TRUE;
+}
+
+static Sample
+measure_layout (ClutterActor *stage,
+                const char   *blob,
+                gboolean      async_layout)
+{
+  ClutterActor *label;
+  gboolean relayout_queued = FALSE;
+  int64_t start_us;
+  Sample sample;
+
+  label = clutter_text_new ();
+  clutter_text_set_font_name (CLUTTER_TEXT (label), "Sans 10");
+  clutter_text_set_line_wrap (CLUTTER_TEXT (label), TRUE);
+  clutter_text_set_async_layout (CLUTTER_TEXT (label), async_layout);
+  clutter_text_set_text (CLUTTER_TEXT (label), blob);
+  clutter_actor_set_width (label, STAGE_WIDTH);
+  clutter_actor_add_child (stage, label);
+
+  g_signal_connect (label, "queue-relayout",
+                    G_CALLBACK (on_queue_relayout), &relayout_queued);
+
+  /* Time spent blocking the main thread in the size request */
+  start_us = g_get_monotonic_time ();
+  clutter_actor_get_preferred_height (label, STAGE_WIDTH, NULL, NULL);
+  sample.blocked_us = g_get_monotonic_time () - start_us;
+
+  /* Time until the shaped layout is available */
+  if (async_layout)
+    {
+      while (!relayout_queued)
+        g_main_context_iteration (NULL, TRUE);
+    }
+  sample.ready_us = g_get_monotonic_time () - start_us;
+
+  clutter_actor_destroy (label);
+
+  return sample;
+}
+
+static void
+print_samples (const char   *mode,
+               const Sample *samples)
+{
+  int64_t blocked_max_us = 0;
+  int64_t blocked_sum_us = 0;
+  int64_t ready_max_us = 0;
+  int64_t ready_sum_us = 0;
+  int i;
+
+  for (i = 0; i < N_RUNS; i++)
+    {
+      blocked_max_us = MAX (blocked_max_us, samples[i].blocked_us);
+      blocked_sum_us += samples[i].blocked_us;
+      ready_max_us = MAX (ready_max_us, samples[i].ready_us);
+      ready_sum_us += samples[i].ready_us;
+    }
+
+  g_print ("%-5s: main thread blocked avg %6.2f ms, max %6.2f ms; "
+           "layout ready avg %6.2f ms, max %6.2f ms\n",
+           mode,
+           blocked_sum_us / (N_RUNS * 1000.0),
+           blocked_max_us / 1000.0,
+           ready_sum_us / (N_RUNS * 1000.0),
+           ready_max_us / 1000.0);
+}
+
+int
+main (int argc, char *argv[])
+{
+  ClutterActor *stage;
+  Sample sync_samples[N_RUNS];
+  Sample async_samples[N_RUNS];
+  int i;
+
+  clutter_test_init (&argc, &argv);
+
+  stage = clutter_test_get_stage ();
+  clutter_actor_set_size (stage, STAGE_WIDTH, STAGE_HEIGHT);
+  clutter_stage_set_title (CLUTTER_STAGE (stage), "Async Text Layout");
+
+  g_print ("Shaping %d KB of wrapped text, %d runs\n",
+           BLOB_SIZE / 1024, N_RUNS);
+
+  for (i = 0; i < N_RUNS; i++)
+    {
+      g_autofree char *blob = create_blob (i);
+
+      sync_samples[i] = measure_layout (stage, blob, FALSE);
+      async_samples[i] = measure_layout (stage, blob, TRUE);
+    }
+
+  print_samples ("sync", sync_samples);
+  print_samples ("async", async_samples);
+
+  return EXIT_SUCCESS;
+}
@@ -23,6 +23,7 @@ virtme-run \
   --rw \
   --pwd \
   --kimg "$IMAGE" \
+  --kopt "vkms.enable_overlay=1" \
   --script-sh "sh -c \"env $VIRTME_ENV $DIRNAME/run-kvm-test.sh \\\"$WRAPPER\\\" \\\"$WRAPPER_ARGS\\\" \\\"$TEST_EXECUTABLE\\\" \\\"$TEST_RESULT_FILE\\\"\""
 
 TEST_RESULT="$(cat "$TEST_RESULT_FILE")"
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2022 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ */
+
+#include "config.h"
+
+#include "tests/native-framebuffer-readback.h"
+
+#include "backends/meta-backend-private.h"
+#include "backends/meta-framebuffer-readback.h"
+
+#define FB_WIDTH 64
+#define FB_HEIGHT 48
+#define FB_STRIDE (FB_WIDTH * 4)
+
+#define UNTOUCHED_PIXEL 0x12345678
+
+static const MetaRectangle green_rect = { 4, 4, 24, 24 };
+
+static const MetaRectangle damage_rects[] = {
+  { 8, 8, 16, 16 },
+  { 20, 30, 30, 10 },
+};
+
+static CoglFramebuffer *
+create_test_framebuffer (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  ClutterBackend *clutter_backend = meta_backend_get_clutter_backend (backend);
+  CoglContext *cogl_context = clutter_backend_get_cogl_context (clutter_backend);
+  CoglTexture2D *texture;
+  CoglOffscreen *offscreen;
+  CoglFramebuffer *framebuffer;
+  g_autoptr (GError) error = NULL;
+
+  texture = cogl_texture_2d_new_with_size (cogl_context, FB_WIDTH, FB_HEIGHT);
+  offscreen = cogl_offscreen_new_with_texture (COGL_TEXTURE (texture));
+  cogl_object_unref (texture);
+
+  framebuffer = COGL_FRAMEBUFFER (offscreen);
+  if (!cogl_framebuffer_allocate (framebuffer, &error))
+    g_error ("Failed to allocate framebuffer: %s", error->message);
+
+  cogl_framebuffer_clear4f (framebuffer, COGL_BUFFER_BIT_COLOR,
+                            1.0, 0.0, 0.0, 1.0);
+  cogl_framebuffer_push_scissor_clip (framebuffer,
+                                      green_rect.x, green_rect.y,
+                                      green_rect.width, green_rect.height);
+  cogl_framebuffer_clear4f (framebuffer, COGL_BUFFER_BIT_COLOR,
+                            0.0, 1.0, 0.0, 1.0);
+  cogl_framebuffer_pop_clip (framebuffer);
+
+  return framebuffer;
+}
+
+static cairo_region_t *
+create_damage_region (void)
+{
+  return cairo_region_create_rectangles (damage_rects,
+                                         G_N_ELEMENTS (damage_rects));
+}
+
+static uint32_t *
+create_destination (void)
+{
+  uint32_t *dst;
+  int i;
+
+  dst = g_new (uint32_t, FB_WIDTH * FB_HEIGHT);
+  for (i = 0; i < FB_WIDTH * FB_HEIGHT; i++)
+    dst[i] = UNTOUCHED_PIXEL;
+
+  return dst;
+}
+
+static void
+assert_destination (const uint32_t       *dst,
+                    const cairo_region_t *damage_region)
+{
+  int x, y;
+
+  for (y = 0; y < FB_HEIGHT; y++)
+    {
+      for (x = 0; x < FB_WIDTH; x++)
+        {
+          const uint8_t *pixel = (const uint8_t *) &dst[y * FB_WIDTH + x];
+
+          if (!cairo_region_contains_point (damage_region, x, y))
+            {
+              g_assert_cmphex (dst[y * FB_WIDTH + x], ==, UNTOUCHED_PIXEL);
+            }
+          else if (x >= green_rect.x &&
+                   x < green_rect.x + green_rect.width &&
+                   y >= green_rect.y &&
+                   y < green_rect.y + green_rect.height)
+            {
+              g_assert_cmphex (pixel[0], ==, 0x00);
+              g_assert_cmphex (pixel[1], ==, 0xff);
+              g_assert_cmphex (pixel[2], ==, 0x00);
+              g_assert_cmphex (pixel[3], ==, 0xff);
+            }
+          else
+            {
+              g_assert_cmphex (pixel[0], ==, 0xff);
+              g_assert_cmphex (pixel[1], ==, 0x00);
+              g_assert_cmphex (pixel[2], ==, 0x00);
+              g_assert_cmphex (pixel[3], ==, 0xff);
+            }
+        }
+    }
+}
+
+static void
+meta_test_framebuffer_readback_sync (void)
+{
+  CoglFramebuffer *framebuffer;
+  MetaFramebufferReadback *readback;
+  cairo_region_t *damage_region;
+  g_autofree uint32_t *dst = NULL;
+
+  framebuffer = create_test_framebuffer ();
+  readback = meta_framebuffer_readback_new (framebuffer,
+                                            COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+  damage_region = create_damage_region ();
+  dst = create_destination ();
+
+  g_assert_true (meta_framebuffer_readback_read_region (readback,
+                                                        damage_region,
+                                                        (uint8_t *) dst,
+                                                        FB_STRIDE));
+  assert_destination (dst, damage_region);
+  g_assert_cmpint (meta_framebuffer_readback_get_cpu_time_us (readback),
+                   >=,
+                   0);
+
+  cairo_region_destroy (damage_region);
+  meta_framebuffer_readback_free (readback);
+  g_object_unref (framebuffer);
+}
+
+static void
+on_read (MetaFramebufferReadback *readback,
+         gpointer                 user_data)
+{
+  gboolean *done = user_data;
+
+  g_assert_false (meta_framebuffer_readback_is_pending (readback));
+
+  *done = TRUE;
+}
+
+static void
+meta_test_framebuffer_readback_async (void)
+{
+  CoglFramebuffer *framebuffer;
+  MetaFramebufferReadback *readback;
+  cairo_region_t *damage_region;
+  g_autofree uint32_t *dst = NULL;
+  gboolean done = FALSE;
+
+  framebuffer = create_test_framebuffer ();
+  readback = meta_framebuffer_readback_new (framebuffer,
+                                            COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+  damage_region = create_damage_region ();
+  dst = create_destination ();
+
+  if (!meta_framebuffer_readback_read_region_async (readback,
+                                                    damage_region,
+                                                    (uint8_t *) dst,
+                                                    FB_STRIDE,
+                                                    on_read,
+                                                    &done))
+    {
+      g_test_skip ("Asynchronous read back not supported");
+      goto out;
+    }
+
+  g_assert_true (meta_framebuffer_readback_is_pending (readback));
+
+  /* Nothing is written before the fence has signalled */
+  g_assert_cmphex (dst[damage_rects[0].y * FB_WIDTH + damage_rects[0].x],
+                   ==,
+                   UNTOUCHED_PIXEL);
+
+  while (!done)
+    g_main_context_iteration (NULL, TRUE);
+
+  assert_destination (dst, damage_region);
+
+out:
+  cairo_region_destroy (damage_region);
+  meta_framebuffer_readback_free (readback);
+  g_object_unref (framebuffer);
+}
+
+void
+init_framebuffer_readback_tests (void)
+{
+  g_test_add_func ("/backends/native/framebuffer-readback/sync",
+                   meta_test_framebuffer_readback_sync);
+  g_test_add_func ("/backends/native/framebuffer-readback/async",
+                   meta_test_framebuffer_readback_async);
+}
@@ -21,7 +21,10 @@
 #include "config.h"
 
 #include "meta-test/meta-context-test.h"
+#include "tests/native-framebuffer-readback.h"
+#include "tests/native-input-batching.h"
 #include "tests/native-screen-cast.h"
+#include "tests/native-stage-capture.h"
 #include "tests/native-virtual-monitor.h"
 
 static void
@@ -29,6 +32,9 @@ init_tests (void)
 {
   init_virtual_monitor_tests ();
   init_screen_cast_tests ();
+  init_framebuffer_readback_tests ();
+  init_input_batching_tests ();
+  init_stage_capture_tests ();
 }
 
 int
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2022 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ */
+
+#include "config.h"
+
+#include "tests/native-input-batching.h"
+
+#include "backends/meta-backend-private.h"
+#include "backends/meta-virtual-monitor.h"
+
+#define N_MOTION_EVENTS 400
+#define MOTION_INTERVAL_US 125 /* 8 kHz */
+
+typedef struct
+{
+  int n_events;
+  int n_samples;
+  double dx_unaccel;
+  int64_t last_time_us;
+  gboolean samples_in_order;
+} MotionCounter;
+
+static gboolean
+count_motion (const ClutterEvent *event,
+              gpointer            user_data)
+{
+  MotionCounter *counter = user_data;
+  const ClutterMotionHistoryEntry *history;
+  size_t n_history_entries;
+  double dx_unaccel;
+  size_t i;
+
+  if (event->type != CLUTTER_MOTION ||
+      !clutter_event_get_relative_motion (event, NULL, NULL,
+                                          &dx_unaccel, NULL))
+    return CLUTTER_EVENT_PROPAGATE;
+
+  counter->n_events++;
+
+  history = clutter_event_get_motion_history (event, &n_history_entries);
+  if (!history)
+    {
+      counter->n_samples++;
+      counter->dx_unaccel += dx_unaccel;
+      counter->last_time_us = clutter_event_get_time_us (event);
+      return CLUTTER_EVENT_PROPAGATE;
+    }
+
+  for (i = 0; i < n_history_entries; i++)
+    {
+      if (!history[i].has_relative_motion)
+        continue;
+
+      if (history[i].time_us <= counter->last_time_us)
+        counter->samples_in_order = FALSE;
+
+      counter->n_samples++;
+      counter->dx_unaccel += history[i].dx_unaccel;
+      counter->last_time_us = history[i].time_us;
+    }
+
+  return CLUTTER_EVENT_PROPAGATE;
+}
+
+static void
+meta_test_input_batching_motion (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaMonitorManager *monitor_manager =
+    meta_backend_get_monitor_manager (backend);
+  ClutterActor *stage = meta_backend_get_stage (backend);
+  ClutterSeat *seat = meta_backend_get_default_seat (backend);
+  g_autoptr (MetaVirtualMonitorInfo) monitor_info = NULL;
+  g_autoptr (ClutterVirtualInputDevice) virtual_pointer = NULL;
+  MetaVirtualMonitor *virtual_monitor;
+  MotionCounter counter = { 0 };
+  GError *error = NULL;
+  int64_t start_time_us;
+  int64_t time_us;
+  int64_t elapsed_us;
+  int n_iterations = 0;
+  unsigned int filter_id;
+  int i;
+
+  monitor_info = meta_virtual_monitor_info_new (800, 600, 60.0,
+                                                "MetaTestVendor",
+                                                "MetaVirtualMonitor",
+                                                "0x1234");
+  virtual_monitor = meta_monitor_manager_create_virtual_monitor (monitor_manager,
+                                                                 monitor_info,
+                                                                 &error);
+  if (!virtual_monitor)
+    g_error ("Failed to create virtual monitor: %s", error->message);
+  meta_monitor_manager_reload (monitor_manager);
+
+  virtual_pointer = clutter_seat_create_virtual_device (seat,
+                                                        CLUTTER_POINTER_DEVICE);
+  clutter_virtual_input_device_notify_absolute_motion (virtual_pointer,
+                                                       g_get_monotonic_time (),
+                                                       100, 100);
+
+  counter.samples_in_order = TRUE;
+  filter_id = clutter_event_add_filter (CLUTTER_STAGE (stage),
+                                        count_motion, NULL, &counter);
+
+  /* Emulate a burst of motion from an 8 kHz device */
+  start_time_us = g_get_monotonic_time ();
+  time_us = start_time_us;
+  for (i = 0; i < N_MOTION_EVENTS; i++)
+    {
+      clutter_virtual_input_device_notify_relative_motion (virtual_pointer,
+                                                           time_us,
+                                                           1.0, 0.0);
+      time_us += MOTION_INTERVAL_US;
+    }
+
+  while (counter.n_samples < N_MOTION_EVENTS)
+    {
+      g_assert_cmpint (g_get_monotonic_time () - start_time_us,
+                       <, 10 * G_USEC_PER_SEC);
+      g_main_context_iteration (NULL, TRUE);
+      n_iterations++;
+    }
+  elapsed_us = MAX (g_get_monotonic_time () - start_time_us, 1);
+
+  /* Every sample must still be available, in order, even though it was
+   * delivered in fewer events. */
+  g_assert_cmpint (counter.n_samples, ==, N_MOTION_EVENTS);
+  g_assert_cmpfloat (counter.dx_unaccel, ==, N_MOTION_EVENTS);
+  g_assert_true (counter.samples_in_order);
+  g_assert_cmpint (counter.n_events, <=, N_MOTION_EVENTS);
+
+  g_test_message ("%d motion samples delivered in %d events, "
+                  "%d main loop iterations (%.0f per second)",
+                  N_MOTION_EVENTS, counter.n_events, n_iterations,
+                  n_iterations * (double) G_USEC_PER_SEC / elapsed_us);
+
+  clutter_event_remove_filter (filter_id);
+
+  g_clear_object (&virtual_pointer);
+  g_object_unref (virtual_monitor);
+  meta_monitor_manager_reload (monitor_manager);
+}
+
+void
+init_input_batching_tests (void)
+{
+  g_test_add_func ("/backends/native/input-batching/motion",
+                   meta_test_input_batching_motion);
+}
@@ -48,6 +48,7 @@ meta_test_kms_device_sanity (void)
   GList *planes;
   MetaKmsPlane *primary_plane;
   MetaKmsPlane *cursor_plane;
+  MetaKmsPlane *overlay_plane;
 
   devices = meta_kms_get_devices (kms);
   g_assert_cmpuint (g_list_length (devices), ==, 1);
@@ -68,8 +69,9 @@ meta_test_kms_device_sanity (void)
   crtc = META_KMS_CRTC (crtcs->data);
   g_assert (meta_kms_crtc_get_device (crtc) == device);
 
+  /* The kvm tests run with vkms.enable_overlay=1 */
   planes = meta_kms_device_get_planes (device);
-  g_assert_cmpuint (g_list_length (planes), ==, 2);
+  g_assert_cmpuint (g_list_length (planes), ==, 3);
   primary_plane = meta_kms_device_get_primary_plane_for (device, crtc);
   g_assert_nonnull (primary_plane);
   cursor_plane = meta_kms_device_get_cursor_plane_for (device, crtc);
@@ -87,6 +89,18 @@ meta_test_kms_device_sanity (void)
   g_assert_cmpint (meta_kms_plane_get_plane_type (cursor_plane),
                    ==,
                    META_KMS_PLANE_TYPE_CURSOR);
+
+  planes = g_list_copy (planes);
+  planes = g_list_remove (planes, primary_plane);
+  planes = g_list_remove (planes, cursor_plane);
+  g_assert_cmpuint (g_list_length (planes), ==, 1);
+  overlay_plane = planes->data;
+  g_list_free (planes);
+  g_assert (meta_kms_plane_get_device (overlay_plane) == device);
+  g_assert_true (meta_kms_plane_is_usable_with (overlay_plane, crtc));
+  g_assert_cmpint (meta_kms_plane_get_plane_type (overlay_plane),
+                   ==,
+                   META_KMS_PLANE_TYPE_OVERLAY);
 }
 
 static void
@@ -20,8 +20,15 @@
 
 #include "config.h"
 
+#include "backends/meta-backend-private.h"
+#include "backends/native/meta-backend-native.h"
+#include "backends/native/meta-cursor-renderer-native.h"
+#include "backends/native/meta-kms-cursor-manager.h"
+#include "backends/native/meta-kms.h"
+#include "meta/display.h"
 #include "meta/meta-backend.h"
 #include "meta-test/meta-context-test.h"
+#include "tests/native-stage-capture.h"
 
 typedef struct
 {
@@ -61,11 +68,151 @@ meta_test_kms_render_basic (void)
   g_assert_cmpint (test.number_of_frames_left, ==, 0);
 }
 
+static void
+run_frames (int n_frames)
+{
+  MetaBackend *backend = meta_get_backend ();
+  ClutterActor *stage = meta_backend_get_stage (backend);
+  KmsRenderingTest test;
+  gulong handler_id;
+
+  test = (KmsRenderingTest) {
+    .number_of_frames_left = n_frames,
+    .loop = g_main_loop_new (NULL, FALSE),
+  };
+  handler_id = g_signal_connect (stage, "after-update",
+                                 G_CALLBACK (on_after_update), &test);
+
+  clutter_actor_queue_redraw (stage);
+  g_main_loop_run (test.loop);
+  g_main_loop_unref (test.loop);
+
+  g_signal_handler_disconnect (stage, handler_id);
+}
+
+static void
+meta_test_kms_render_cursor_latency (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaKms *kms = meta_backend_native_get_kms (META_BACKEND_NATIVE (backend));
+  MetaKmsCursorManager *cursor_manager = meta_kms_get_cursor_manager (kms);
+  ClutterSeat *seat = meta_backend_get_default_seat (backend);
+  g_autoptr (ClutterVirtualInputDevice) virtual_pointer = NULL;
+  unsigned int n_commits;
+  int64_t timeout_us;
+
+  virtual_pointer = clutter_seat_create_virtual_device (seat,
+                                                        CLUTTER_POINTER_DEVICE);
+  clutter_virtual_input_device_notify_absolute_motion (virtual_pointer,
+                                                       g_get_monotonic_time (),
+                                                       100, 100);
+  run_frames (3);
+
+  if (!meta_kms_cursor_manager_has_cursor (cursor_manager))
+    {
+      g_test_skip ("No hardware cursor");
+      return;
+    }
+
+  /* The main context is not iterated while waiting, so the cursor can only
+   * have been moved directly from the input thread. */
+  n_commits = meta_kms_cursor_manager_get_n_commits (cursor_manager);
+  clutter_virtual_input_device_notify_relative_motion (virtual_pointer,
+                                                       g_get_monotonic_time (),
+                                                       10, 10);
+
+  timeout_us = g_get_monotonic_time () + G_USEC_PER_SEC;
+  while (meta_kms_cursor_manager_get_n_commits (cursor_manager) == n_commits)
+    {
+      g_assert_cmpint (g_get_monotonic_time (), <, timeout_us);
+      g_usleep (100);
+    }
+
+  g_assert_cmpint (meta_kms_cursor_manager_get_last_latency_us (cursor_manager),
+                   >, 0);
+  g_assert_cmpint (meta_kms_cursor_manager_get_last_latency_us (cursor_manager),
+                   <, G_USEC_PER_SEC);
+  g_test_message ("Input to cursor commit latency: %" G_GINT64_FORMAT " us",
+                  meta_kms_cursor_manager_get_last_latency_us (cursor_manager));
+
+  run_frames (1);
+}
+
+static void
+meta_test_kms_render_cursor_cache (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaDisplay *display = meta_get_display ();
+  MetaKms *kms = meta_backend_native_get_kms (META_BACKEND_NATIVE (backend));
+  MetaKmsCursorManager *cursor_manager = meta_kms_get_cursor_manager (kms);
+  MetaCursorRendererNative *cursor_renderer_native =
+    META_CURSOR_RENDERER_NATIVE (meta_backend_get_cursor_renderer (backend));
+  ClutterSeat *seat = meta_backend_get_default_seat (backend);
+  g_autoptr (ClutterVirtualInputDevice) virtual_pointer = NULL;
+  MetaCursor cursors[] = {
+    META_CURSOR_DEFAULT,
+    META_CURSOR_POINTING_HAND,
+    META_CURSOR_IBEAM,
+    META_CURSOR_MOVE_OR_RESIZE_WINDOW,
+  };
+  int n_uploads;
+  int i, j;
+
+  virtual_pointer = clutter_seat_create_virtual_device (seat,
+                                                        CLUTTER_POINTER_DEVICE);
+  clutter_virtual_input_device_notify_absolute_motion (virtual_pointer,
+                                                       g_get_monotonic_time (),
+                                                       100, 100);
+  run_frames (3);
+
+  if (!meta_kms_cursor_manager_has_cursor (cursor_manager))
+    {
+      g_test_skip ("No hardware cursor");
+      return;
+    }
+
+  /* Realize each sprite once */
+  for (i = 0; i < G_N_ELEMENTS (cursors); i++)
+    {
+      meta_display_set_cursor (display, cursors[i]);
+      run_frames (2);
+    }
+
+  n_uploads =
+    meta_cursor_renderer_native_get_n_buffer_uploads (cursor_renderer_native);
+  g_assert_cmpint (n_uploads, >, 0);
+
+  /* Switching back and forth and moving around reuses the realized buffers */
+  for (j = 0; j < 3; j++)
+    {
+      for (i = 0; i < G_N_ELEMENTS (cursors); i++)
+        {
+          meta_display_set_cursor (display, cursors[i]);
+          clutter_virtual_input_device_notify_relative_motion (virtual_pointer,
+                                                               g_get_monotonic_time (),
+                                                               10, 10);
+          run_frames (2);
+        }
+    }
+
+  g_assert_cmpint (meta_cursor_renderer_native_get_n_buffer_uploads (cursor_renderer_native),
+                   ==, n_uploads);
+
+  meta_display_set_cursor (display, META_CURSOR_DEFAULT);
+  run_frames (1);
+}
+
 static void
 init_tests (void)
 {
   g_test_add_func ("/backends/native/kms/render/basic",
                    meta_test_kms_render_basic);
+  g_test_add_func ("/backends/native/kms/render/cursor-latency",
+                   meta_test_kms_render_cursor_latency);
+  g_test_add_func ("/backends/native/kms/render/cursor-cache",
+                   meta_test_kms_render_cursor_cache);
+
+  init_stage_capture_onscreen_tests ();
 }
 
 int
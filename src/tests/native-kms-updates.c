@@ -20,10 +20,15 @@
 
 #include "config.h"
 
+#include "backends/native/meta-kms-connector-private.h"
 #include "backends/native/meta-kms-connector.h"
 #include "backends/native/meta-kms-crtc.h"
+#include "backends/native/meta-kms-device-private.h"
 #include "backends/native/meta-kms-device.h"
+#include "backends/native/meta-kms-impl-device.h"
 #include "backends/native/meta-kms-mode.h"
+#include "backends/native/meta-kms-plane.h"
+#include "backends/native/meta-kms-private.h"
 #include "backends/native/meta-kms-update-private.h"
 #include "backends/native/meta-kms.h"
 #include "meta-test/meta-context-test.h"
@@ -50,6 +55,7 @@ meta_test_kms_update_sanity (void)
   g_assert_null (meta_kms_update_get_page_flip_listeners (update));
   g_assert_null (meta_kms_update_get_connector_updates (update));
   g_assert_null (meta_kms_update_get_crtc_gammas (update));
+  g_assert_null (meta_kms_update_get_crtc_updates (update));
   meta_kms_update_free (update);
 }
 
@@ -217,6 +223,765 @@ meta_test_kms_update_mode_sets (void)
   meta_kms_update_free (update);
 }
 
+static void
+meta_test_kms_update_vrr (void)
+{
+  MetaKmsDevice *device;
+  MetaKmsUpdate *update;
+  MetaKmsCrtc *crtc;
+  GList *crtc_updates;
+  MetaKmsCrtcUpdate *crtc_update;
+
+  device = meta_get_test_kms_device (test_context);
+  update = meta_kms_update_new (device);
+  crtc = meta_get_test_kms_crtc (device);
+
+  meta_kms_update_set_vrr (update, crtc, TRUE);
+  meta_kms_update_set_vrr (update, crtc, FALSE);
+
+  crtc_updates = meta_kms_update_get_crtc_updates (update);
+  g_assert_cmpuint (g_list_length (crtc_updates), ==, 1);
+  crtc_update = crtc_updates->data;
+
+  g_assert (crtc_update->crtc == crtc);
+  g_assert_true (crtc_update->vrr.has_update);
+  g_assert_false (crtc_update->vrr.is_enabled);
+
+  meta_kms_update_free (update);
+}
+
+typedef struct
+{
+  MetaKmsPlane *plane;
+  int crtc_x;
+  int crtc_y;
+  int fb_id;
+  int crtc_id;
+} PlanePositionData;
+
+static int
+read_plane_property_in_impl (MetaKmsImplDevice       *impl_device,
+                             drmModeObjectProperties *drm_props,
+                             const char              *prop_name)
+{
+  drmModePropertyPtr prop;
+  int idx;
+
+  prop = meta_kms_impl_device_find_property (impl_device, drm_props,
+                                             prop_name, &idx);
+  if (!prop)
+    return -1;
+
+  drmModeFreeProperty (prop);
+  return (int) drm_props->prop_values[idx];
+}
+
+static gpointer
+read_plane_position_in_impl (MetaKmsImpl  *impl,
+                             gpointer      user_data,
+                             GError      **error)
+{
+  PlanePositionData *data = user_data;
+  MetaKmsDevice *device = meta_kms_plane_get_device (data->plane);
+  MetaKmsImplDevice *impl_device = meta_kms_device_get_impl_device (device);
+  drmModeObjectProperties *drm_props;
+
+  drm_props =
+    drmModeObjectGetProperties (meta_kms_impl_device_get_fd (impl_device),
+                                meta_kms_plane_get_id (data->plane),
+                                DRM_MODE_OBJECT_PLANE);
+  if (!drm_props)
+    return GINT_TO_POINTER (FALSE);
+
+  data->crtc_x = read_plane_property_in_impl (impl_device, drm_props,
+                                              "CRTC_X");
+  data->crtc_y = read_plane_property_in_impl (impl_device, drm_props,
+                                              "CRTC_Y");
+  data->fb_id = read_plane_property_in_impl (impl_device, drm_props,
+                                             "FB_ID");
+  data->crtc_id = read_plane_property_in_impl (impl_device, drm_props,
+                                               "CRTC_ID");
+  drmModeFreeObjectProperties (drm_props);
+
+  return GINT_TO_POINTER (TRUE);
+}
+
+typedef struct
+{
+  int n_results;
+  int n_failed;
+} CursorUpdateResults;
+
+static void
+on_cursor_update_result (const MetaKmsFeedback *kms_feedback,
+                         gpointer               user_data)
+{
+  CursorUpdateResults *results = user_data;
+
+  results->n_results++;
+  if (meta_kms_feedback_get_result (kms_feedback) != META_KMS_FEEDBACK_PASSED)
+    results->n_failed++;
+}
+
+static void
+meta_test_kms_update_blocked_main_loop (void)
+{
+  MetaKmsDevice *device;
+  MetaKms *kms;
+  MetaKmsUpdate *update;
+  MetaKmsCrtc *crtc;
+  MetaKmsConnector *connector;
+  MetaKmsMode *mode;
+  MetaKmsPlane *primary_plane;
+  MetaKmsPlane *cursor_plane;
+  g_autoptr (MetaDrmBuffer) primary_buffer = NULL;
+  g_autoptr (MetaDrmBuffer) cursor_buffer = NULL;
+  g_autoptr (MetaKmsFeedback) feedback = NULL;
+  CursorUpdateResults results = { 0 };
+  PlanePositionData position_data;
+  const int n_updates = 10;
+  int i;
+
+  device = meta_get_test_kms_device (test_context);
+  kms = meta_kms_device_get_kms (device);
+  crtc = meta_get_test_kms_crtc (device);
+  connector = meta_get_test_kms_connector (device);
+  mode = meta_kms_connector_get_preferred_mode (connector);
+  primary_plane = meta_kms_device_get_primary_plane_for (device, crtc);
+  cursor_plane = meta_kms_device_get_cursor_plane_for (device, crtc);
+  g_assert_nonnull (cursor_plane);
+
+  primary_buffer = meta_create_test_mode_dumb_buffer (device, mode);
+  cursor_buffer = meta_create_test_dumb_buffer (device, 64, 64);
+
+  update = meta_kms_update_new (device);
+  meta_kms_update_mode_set (update, crtc,
+                            g_list_append (NULL, connector),
+                            mode);
+  meta_kms_update_assign_plane (update,
+                                crtc,
+                                primary_plane,
+                                primary_buffer,
+                                meta_get_mode_fixed_rect_16 (mode),
+                                meta_get_mode_rect (mode),
+                                META_KMS_ASSIGN_PLANE_FLAG_NONE);
+  feedback = meta_kms_device_process_update_sync (device, update,
+                                                  META_KMS_UPDATE_FLAG_NONE);
+  meta_kms_update_free (update);
+  g_assert_cmpint (meta_kms_feedback_get_result (feedback),
+                   ==,
+                   META_KMS_FEEDBACK_PASSED);
+
+  /*
+   * Post cursor updates without ever dispatching the main loop, sleeping
+   * more than a refresh cycle between each to not run into busy CRTCs.
+   */
+
+  for (i = 1; i <= n_updates; i++)
+    {
+      update = meta_kms_update_new (device);
+      meta_kms_update_assign_plane (update,
+                                    crtc,
+                                    cursor_plane,
+                                    cursor_buffer,
+                                    META_FIXED_16_RECTANGLE_INIT_INT (0, 0,
+                                                                      64, 64),
+                                    META_RECTANGLE_INIT (i * 8, i * 4, 64, 64),
+                                    META_KMS_ASSIGN_PLANE_FLAG_NONE);
+      meta_kms_update_add_result_listener (update,
+                                           on_cursor_update_result,
+                                           &results);
+      meta_kms_post_update (kms, update, META_KMS_UPDATE_FLAG_NONE);
+
+      g_usleep (G_USEC_PER_SEC / 25);
+    }
+
+  g_assert_cmpint (results.n_results, ==, 0);
+
+  position_data = (PlanePositionData) {
+    .plane = cursor_plane,
+  };
+  if (!meta_kms_run_impl_task_sync (kms, read_plane_position_in_impl,
+                                    &position_data, NULL) ||
+      position_data.crtc_x < 0)
+    {
+      g_test_skip ("Cursor plane position not readable");
+      return;
+    }
+
+  g_assert_cmpint (position_data.crtc_x, ==, n_updates * 8);
+  g_assert_cmpint (position_data.crtc_y, ==, n_updates * 4);
+
+  /* Results are only delivered once the main loop runs again */
+  while (results.n_results < n_updates)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpint (results.n_failed, ==, 0);
+}
+
+static MetaKmsPlane *
+find_overlay_plane (MetaKmsDevice *device,
+                    MetaKmsCrtc   *crtc,
+                    uint32_t       drm_format)
+{
+  GList *l;
+
+  for (l = meta_kms_device_get_planes (device); l; l = l->next)
+    {
+      MetaKmsPlane *plane = l->data;
+
+      if (meta_kms_plane_get_plane_type (plane) == META_KMS_PLANE_TYPE_OVERLAY &&
+          meta_kms_plane_is_usable_with (plane, crtc) &&
+          meta_kms_plane_is_format_supported (plane, drm_format))
+        return plane;
+    }
+
+  return NULL;
+}
+
+static MetaKmsUpdate *
+create_overlay_update (MetaKmsDevice *device,
+                       MetaKmsCrtc   *crtc,
+                       MetaKmsPlane  *overlay_plane,
+                       MetaDrmBuffer *overlay_buffer)
+{
+  MetaKmsUpdate *update;
+
+  update = meta_kms_update_new (device);
+  meta_kms_update_assign_plane (update,
+                                crtc,
+                                overlay_plane,
+                                overlay_buffer,
+                                META_FIXED_16_RECTANGLE_INIT_INT (0, 0,
+                                                                  128, 96),
+                                META_RECTANGLE_INIT (32, 48, 128, 96),
+                                META_KMS_ASSIGN_PLANE_FLAG_NONE);
+
+  return update;
+}
+
+static void
+assert_primary_plane_assigned (MetaKms       *kms,
+                               MetaKmsCrtc   *crtc,
+                               MetaKmsPlane  *primary_plane,
+                               MetaDrmBuffer *primary_buffer)
+{
+  PlanePositionData position_data;
+
+  position_data = (PlanePositionData) {
+    .plane = primary_plane,
+  };
+  g_assert_true (meta_kms_run_impl_task_sync (kms, read_plane_position_in_impl,
+                                              &position_data, NULL));
+  g_assert_cmpint (position_data.crtc_id, ==, meta_kms_crtc_get_id (crtc));
+  g_assert_cmpint (position_data.fb_id,
+                   ==,
+                   meta_drm_buffer_get_fb_id (primary_buffer));
+  g_assert_cmpint (position_data.crtc_x, ==, 0);
+  g_assert_cmpint (position_data.crtc_y, ==, 0);
+}
+
+static void
+meta_test_kms_update_overlay_plane (void)
+{
+  MetaKmsDevice *device;
+  MetaKms *kms;
+  MetaKmsUpdate *update;
+  MetaKmsCrtc *crtc;
+  MetaKmsConnector *connector;
+  MetaKmsMode *mode;
+  MetaKmsPlane *primary_plane;
+  MetaKmsPlane *overlay_plane;
+  g_autoptr (MetaDrmBuffer) primary_buffer = NULL;
+  g_autoptr (MetaDrmBuffer) overlay_buffer = NULL;
+  g_autoptr (MetaKmsFeedback) feedback = NULL;
+  g_autoptr (MetaKmsFeedback) test_feedback = NULL;
+  g_autoptr (MetaKmsFeedback) overlay_feedback = NULL;
+  PlanePositionData position_data;
+
+  device = meta_get_test_kms_device (test_context);
+  kms = meta_kms_device_get_kms (device);
+  crtc = meta_get_test_kms_crtc (device);
+  connector = meta_get_test_kms_connector (device);
+  mode = meta_kms_connector_get_preferred_mode (connector);
+  primary_plane = meta_kms_device_get_primary_plane_for (device, crtc);
+
+  primary_buffer = meta_create_test_mode_dumb_buffer (device, mode);
+  overlay_buffer = meta_create_test_dumb_buffer (device, 128, 96);
+
+  overlay_plane =
+    find_overlay_plane (device, crtc,
+                        meta_drm_buffer_get_format (overlay_buffer));
+  if (!overlay_plane)
+    {
+      g_test_skip ("No overlay plane available");
+      return;
+    }
+
+  update = meta_kms_update_new (device);
+  meta_kms_update_mode_set (update, crtc,
+                            g_list_append (NULL, connector),
+                            mode);
+  meta_kms_update_assign_plane (update,
+                                crtc,
+                                primary_plane,
+                                primary_buffer,
+                                meta_get_mode_fixed_rect_16 (mode),
+                                meta_get_mode_rect (mode),
+                                META_KMS_ASSIGN_PLANE_FLAG_NONE);
+  feedback = meta_kms_device_process_update_sync (device, update,
+                                                  META_KMS_UPDATE_FLAG_NONE);
+  meta_kms_update_free (update);
+  g_assert_cmpint (meta_kms_feedback_get_result (feedback),
+                   ==,
+                   META_KMS_FEEDBACK_PASSED);
+
+  /* Testing the overlay assignment must not change what is on screen */
+  update = create_overlay_update (device, crtc, overlay_plane, overlay_buffer);
+  test_feedback = meta_kms_post_test_update_sync (kms, update);
+  meta_kms_update_free (update);
+  g_assert_cmpint (meta_kms_feedback_get_result (test_feedback),
+                   ==,
+                   META_KMS_FEEDBACK_PASSED);
+
+  position_data = (PlanePositionData) {
+    .plane = overlay_plane,
+  };
+  g_assert_true (meta_kms_run_impl_task_sync (kms, read_plane_position_in_impl,
+                                              &position_data, NULL));
+  g_assert_cmpint (position_data.crtc_x, ==, 0);
+  g_assert_cmpint (position_data.crtc_y, ==, 0);
+  assert_primary_plane_assigned (kms, crtc, primary_plane, primary_buffer);
+
+  update = create_overlay_update (device, crtc, overlay_plane, overlay_buffer);
+  overlay_feedback =
+    meta_kms_device_process_update_sync (device, update,
+                                         META_KMS_UPDATE_FLAG_NONE);
+  meta_kms_update_free (update);
+  g_assert_cmpint (meta_kms_feedback_get_result (overlay_feedback),
+                   ==,
+                   META_KMS_FEEDBACK_PASSED);
+
+  g_assert_true (meta_kms_run_impl_task_sync (kms, read_plane_position_in_impl,
+                                              &position_data, NULL));
+  g_assert_cmpint (position_data.crtc_x, ==, 32);
+  g_assert_cmpint (position_data.crtc_y, ==, 48);
+
+  /* Overlay only updates leave the primary plane as it is */
+  assert_primary_plane_assigned (kms, crtc, primary_plane, primary_buffer);
+
+  g_clear_pointer (&overlay_feedback, meta_kms_feedback_free);
+  update = meta_kms_update_new (device);
+  meta_kms_update_unassign_plane (update, crtc, overlay_plane);
+  overlay_feedback =
+    meta_kms_device_process_update_sync (device, update,
+                                         META_KMS_UPDATE_FLAG_NONE);
+  meta_kms_update_free (update);
+  g_assert_cmpint (meta_kms_feedback_get_result (overlay_feedback),
+                   ==,
+                   META_KMS_FEEDBACK_PASSED);
+  assert_primary_plane_assigned (kms, crtc, primary_plane, primary_buffer);
+}
+
+static MetaKmsFeedbackResult
+post_cursor_test_update (MetaKmsDevice *device,
+                         MetaKmsCrtc   *crtc,
+                         MetaKmsPlane  *cursor_plane,
+                         MetaDrmBuffer *cursor_buffer)
+{
+  MetaKms *kms = meta_kms_device_get_kms (device);
+  MetaKmsUpdate *update;
+  g_autoptr (MetaKmsFeedback) feedback = NULL;
+
+  update = meta_kms_update_new (device);
+  meta_kms_update_assign_plane (update,
+                                crtc,
+                                cursor_plane,
+                                cursor_buffer,
+                                META_FIXED_16_RECTANGLE_INIT_INT (0, 0, 64, 64),
+                                META_RECTANGLE_INIT (24, 24, 64, 64),
+                                META_KMS_ASSIGN_PLANE_FLAG_NONE);
+  feedback = meta_kms_post_test_update_sync (kms, update);
+  meta_kms_update_free (update);
+
+  return meta_kms_feedback_get_result (feedback);
+}
+
+static void
+mode_set_primary_plane (MetaKmsDevice *device,
+                        MetaKmsCrtc   *crtc,
+                        MetaDrmBuffer *primary_buffer)
+{
+  MetaKmsConnector *connector;
+  MetaKmsMode *mode;
+  MetaKmsUpdate *update;
+  g_autoptr (MetaKmsFeedback) feedback = NULL;
+
+  connector = meta_get_test_kms_connector (device);
+  mode = meta_kms_connector_get_preferred_mode (connector);
+
+  update = meta_kms_update_new (device);
+  meta_kms_update_mode_set (update, crtc,
+                            g_list_append (NULL, connector),
+                            mode);
+  meta_kms_update_assign_plane (update,
+                                crtc,
+                                meta_kms_device_get_primary_plane_for (device,
+                                                                       crtc),
+                                primary_buffer,
+                                meta_get_mode_fixed_rect_16 (mode),
+                                meta_get_mode_rect (mode),
+                                META_KMS_ASSIGN_PLANE_FLAG_NONE);
+  feedback = meta_kms_device_process_update_sync (device, update,
+                                                  META_KMS_UPDATE_FLAG_NONE);
+  meta_kms_update_free (update);
+  g_assert_cmpint (meta_kms_feedback_get_result (feedback),
+                   ==,
+                   META_KMS_FEEDBACK_PASSED);
+}
+
+static void
+meta_test_kms_update_test_result_cache (void)
+{
+  MetaKmsDevice *device;
+  MetaKmsCrtc *crtc;
+  MetaKmsConnector *connector;
+  MetaKmsMode *mode;
+  MetaKmsPlane *cursor_plane;
+  g_autoptr (MetaDrmBuffer) primary_buffer = NULL;
+  g_autoptr (MetaDrmBuffer) cursor_buffer1 = NULL;
+  g_autoptr (MetaDrmBuffer) cursor_buffer2 = NULL;
+  g_autoptr (MetaDrmBuffer) overlay_buffer = NULL;
+  g_autoptr (MetaKmsFeedback) feedback = NULL;
+  MetaKmsPlane *overlay_plane;
+  MetaKmsUpdate *update;
+  int n_avoided;
+
+  device = meta_get_test_kms_device (test_context);
+  crtc = meta_get_test_kms_crtc (device);
+  connector = meta_get_test_kms_connector (device);
+  mode = meta_kms_connector_get_preferred_mode (connector);
+  cursor_plane = meta_kms_device_get_cursor_plane_for (device, crtc);
+  g_assert_nonnull (cursor_plane);
+
+  primary_buffer = meta_create_test_mode_dumb_buffer (device, mode);
+  cursor_buffer1 = meta_create_test_dumb_buffer (device, 64, 64);
+  cursor_buffer2 = meta_create_test_dumb_buffer (device, 64, 64);
+
+  /* A mode set drops earlier results for the CRTC */
+  mode_set_primary_plane (device, crtc, primary_buffer);
+  n_avoided = meta_kms_device_get_n_avoided_test_commits (device);
+
+  g_assert_cmpint (post_cursor_test_update (device, crtc, cursor_plane,
+                                            cursor_buffer1),
+                   ==,
+                   META_KMS_FEEDBACK_PASSED);
+  g_assert_cmpint (meta_kms_device_get_n_avoided_test_commits (device),
+                   ==,
+                   n_avoided);
+
+  /* A different buffer with the same layout reuses the result */
+  g_assert_cmpint (post_cursor_test_update (device, crtc, cursor_plane,
+                                            cursor_buffer2),
+                   ==,
+                   META_KMS_FEEDBACK_PASSED);
+  g_assert_cmpint (meta_kms_device_get_n_avoided_test_commits (device),
+                   ==,
+                   n_avoided + 1);
+
+  mode_set_primary_plane (device, crtc, primary_buffer);
+
+  g_assert_cmpint (post_cursor_test_update (device, crtc, cursor_plane,
+                                            cursor_buffer1),
+                   ==,
+                   META_KMS_FEEDBACK_PASSED);
+  g_assert_cmpint (meta_kms_device_get_n_avoided_test_commits (device),
+                   ==,
+                   n_avoided + 1);
+  g_assert_cmpint (post_cursor_test_update (device, crtc, cursor_plane,
+                                            cursor_buffer1),
+                   ==,
+                   META_KMS_FEEDBACK_PASSED);
+  g_assert_cmpint (meta_kms_device_get_n_avoided_test_commits (device),
+                   ==,
+                   n_avoided + 2);
+
+  /* Results depend on the other planes of the CRTC as well */
+  overlay_buffer = meta_create_test_dumb_buffer (device, 128, 96);
+  overlay_plane =
+    find_overlay_plane (device, crtc,
+                        meta_drm_buffer_get_format (overlay_buffer));
+  if (!overlay_plane)
+    return;
+
+  update = create_overlay_update (device, crtc, overlay_plane, overlay_buffer);
+  feedback = meta_kms_device_process_update_sync (device, update,
+                                                  META_KMS_UPDATE_FLAG_NONE);
+  meta_kms_update_free (update);
+  g_assert_cmpint (meta_kms_feedback_get_result (feedback),
+                   ==,
+                   META_KMS_FEEDBACK_PASSED);
+
+  g_assert_cmpint (post_cursor_test_update (device, crtc, cursor_plane,
+                                            cursor_buffer1),
+                   ==,
+                   META_KMS_FEEDBACK_PASSED);
+  g_assert_cmpint (meta_kms_device_get_n_avoided_test_commits (device),
+                   ==,
+                   n_avoided + 2);
+  g_assert_cmpint (post_cursor_test_update (device, crtc, cursor_plane,
+                                            cursor_buffer1),
+                   ==,
+                   META_KMS_FEEDBACK_PASSED);
+  g_assert_cmpint (meta_kms_device_get_n_avoided_test_commits (device),
+                   ==,
+                   n_avoided + 3);
+
+  g_clear_pointer (&feedback, meta_kms_feedback_free);
+  update = meta_kms_update_new (device);
+  meta_kms_update_unassign_plane (update, crtc, overlay_plane);
+  feedback = meta_kms_device_process_update_sync (device, update,
+                                                  META_KMS_UPDATE_FLAG_NONE);
+  meta_kms_update_free (update);
+  g_assert_cmpint (meta_kms_feedback_get_result (feedback),
+                   ==,
+                   META_KMS_FEEDBACK_PASSED);
+}
+
+static void
+meta_test_kms_update_fb_damage (void)
+{
+  MetaKmsDevice *device;
+  MetaKmsUpdate *update;
+  MetaKmsCrtc *crtc;
+  MetaKmsConnector *connector;
+  MetaKmsMode *mode;
+  MetaKmsPlane *primary_plane;
+  MetaKmsPlaneAssignment *plane_assignment;
+  g_autoptr (MetaDrmBuffer) primary_buffer = NULL;
+  g_autoptr (MetaKmsFeedback) feedback = NULL;
+  const int frame_damage[] = {
+    0, 0, 16, 16,
+    32, 48, 100, 20,
+  };
+  const int scanout_damage[] = {
+    8, 4, 64, 32,
+  };
+
+  device = meta_get_test_kms_device (test_context);
+  crtc = meta_get_test_kms_crtc (device);
+  connector = meta_get_test_kms_connector (device);
+  mode = meta_kms_connector_get_preferred_mode (connector);
+  primary_plane = meta_kms_device_get_primary_plane_for (device, crtc);
+
+  primary_buffer = meta_create_test_mode_dumb_buffer (device, mode);
+  mode_set_primary_plane (device, crtc, primary_buffer);
+
+  update = meta_kms_update_new (device);
+  plane_assignment =
+    meta_kms_update_assign_plane (update,
+                                  crtc,
+                                  primary_plane,
+                                  primary_buffer,
+                                  meta_get_mode_fixed_rect_16 (mode),
+                                  meta_get_mode_rect (mode),
+                                  META_KMS_ASSIGN_PLANE_FLAG_NONE);
+  g_assert_null (plane_assignment->fb_damage);
+
+  meta_kms_plane_assignment_set_fb_damage (plane_assignment,
+                                           frame_damage,
+                                           G_N_ELEMENTS (frame_damage) / 4);
+  g_assert_nonnull (plane_assignment->fb_damage);
+  g_assert_cmpint (plane_assignment->fb_damage->n_rects, ==, 2);
+  g_assert_cmpint (plane_assignment->fb_damage->rects[0].x1, ==, 0);
+  g_assert_cmpint (plane_assignment->fb_damage->rects[0].y1, ==, 0);
+  g_assert_cmpint (plane_assignment->fb_damage->rects[0].x2, ==, 16);
+  g_assert_cmpint (plane_assignment->fb_damage->rects[0].y2, ==, 16);
+  g_assert_cmpint (plane_assignment->fb_damage->rects[1].x1, ==, 32);
+  g_assert_cmpint (plane_assignment->fb_damage->rects[1].y1, ==, 48);
+  g_assert_cmpint (plane_assignment->fb_damage->rects[1].x2, ==, 132);
+  g_assert_cmpint (plane_assignment->fb_damage->rects[1].y2, ==, 68);
+
+  /* Later damage for the same assignment replaces the earlier one */
+  meta_kms_plane_assignment_set_fb_damage (plane_assignment,
+                                           scanout_damage,
+                                           G_N_ELEMENTS (scanout_damage) / 4);
+  g_assert_cmpint (plane_assignment->fb_damage->n_rects, ==, 1);
+  g_assert_cmpint (plane_assignment->fb_damage->rects[0].x1, ==, 8);
+  g_assert_cmpint (plane_assignment->fb_damage->rects[0].y1, ==, 4);
+  g_assert_cmpint (plane_assignment->fb_damage->rects[0].x2, ==, 72);
+  g_assert_cmpint (plane_assignment->fb_damage->rects[0].y2, ==, 36);
+
+  feedback = meta_kms_device_process_update_sync (device, update,
+                                                  META_KMS_UPDATE_FLAG_NONE);
+  meta_kms_update_free (update);
+  g_assert_cmpint (meta_kms_feedback_get_result (feedback),
+                   ==,
+                   META_KMS_FEEDBACK_PASSED);
+}
+
+static void
+on_merged_update_result (const MetaKmsFeedback *kms_feedback,
+                         gpointer               user_data)
+{
+  int *n_results = user_data;
+
+  g_assert_cmpint (meta_kms_feedback_get_result (kms_feedback),
+                   ==,
+                   META_KMS_FEEDBACK_PASSED);
+  (*n_results)++;
+}
+
+static void
+add_pending_primary_plane_update (MetaKmsDevice *device,
+                                  MetaKmsCrtc   *crtc,
+                                  MetaDrmBuffer *primary_buffer,
+                                  int           *n_results)
+{
+  MetaKms *kms = meta_kms_device_get_kms (device);
+  MetaKmsConnector *connector;
+  MetaKmsMode *mode;
+  MetaKmsUpdate *update;
+
+  connector = meta_get_test_kms_connector (device);
+  mode = meta_kms_connector_get_preferred_mode (connector);
+
+  update = meta_kms_ensure_pending_update (kms, device);
+  meta_kms_update_assign_plane (update,
+                                crtc,
+                                meta_kms_device_get_primary_plane_for (device,
+                                                                       crtc),
+                                primary_buffer,
+                                meta_get_mode_fixed_rect_16 (mode),
+                                meta_get_mode_rect (mode),
+                                META_KMS_ASSIGN_PLANE_FLAG_NONE);
+  meta_kms_update_add_result_listener (update,
+                                       on_merged_update_result,
+                                       n_results);
+}
+
+static void
+meta_test_kms_update_merged (void)
+{
+  MetaKmsDevice *device;
+  MetaKms *kms;
+  MetaKmsCrtc *crtc;
+  MetaKmsCrtc *other_crtc = NULL;
+  MetaKmsConnector *connector;
+  MetaKmsMode *mode;
+  g_autoptr (MetaDrmBuffer) primary_buffer = NULL;
+  g_autoptr (GList) self = NULL;
+  g_autoptr (GList) others = NULL;
+  int n_results = 0;
+  int n_commits;
+  GList *l;
+
+  device = meta_get_test_kms_device (test_context);
+  kms = meta_kms_device_get_kms (device);
+  crtc = meta_get_test_kms_crtc (device);
+  connector = meta_get_test_kms_connector (device);
+  mode = meta_kms_connector_get_preferred_mode (connector);
+
+  primary_buffer = meta_create_test_mode_dumb_buffer (device, mode);
+  mode_set_primary_plane (device, crtc, primary_buffer);
+  n_commits = meta_kms_device_get_n_commits (device);
+
+  for (l = meta_kms_device_get_crtcs (device); l; l = l->next)
+    {
+      if (l->data != crtc)
+        {
+          other_crtc = l->data;
+          break;
+        }
+    }
+
+  self = g_list_append (NULL, crtc);
+  if (other_crtc)
+    others = g_list_append (NULL, other_crtc);
+
+  /* Without merging, the update is posted right away */
+  add_pending_primary_plane_update (device, crtc, primary_buffer, &n_results);
+  meta_kms_post_pending_update_merged (kms, device, crtc, others,
+                                       META_KMS_UPDATE_FLAG_NONE);
+  g_assert_null (meta_kms_get_pending_update (kms, device));
+  while (n_results < 1)
+    g_main_context_iteration (NULL, TRUE);
+
+  meta_kms_set_merge_updates (kms, TRUE);
+
+  /* Nothing to wait for when no other CRTC is expected */
+  add_pending_primary_plane_update (device, crtc, primary_buffer, &n_results);
+  meta_kms_post_pending_update_merged (kms, device, crtc, self,
+                                       META_KMS_UPDATE_FLAG_NONE);
+  g_assert_null (meta_kms_get_pending_update (kms, device));
+  while (n_results < 2)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpint (meta_kms_device_get_n_commits (device), >=, n_commits + 2);
+
+  if (!other_crtc)
+    {
+      meta_kms_set_merge_updates (kms, FALSE);
+      g_test_skip ("Device has only one CRTC");
+      return;
+    }
+
+  /* The update is held back until the other CRTC contributed */
+  add_pending_primary_plane_update (device, crtc, primary_buffer, &n_results);
+  meta_kms_post_pending_update_merged (kms, device, crtc, others,
+                                       META_KMS_UPDATE_FLAG_NONE);
+  g_assert_nonnull (meta_kms_get_pending_update (kms, device));
+  meta_kms_post_pending_update_merged (kms, device, other_crtc, self,
+                                       META_KMS_UPDATE_FLAG_NONE);
+  g_assert_null (meta_kms_get_pending_update (kms, device));
+  while (n_results < 3)
+    g_main_context_iteration (NULL, TRUE);
+
+  /* ... or until the main loop iteration finished */
+  add_pending_primary_plane_update (device, crtc, primary_buffer, &n_results);
+  meta_kms_post_pending_update_merged (kms, device, crtc, others,
+                                       META_KMS_UPDATE_FLAG_NONE);
+  g_assert_nonnull (meta_kms_get_pending_update (kms, device));
+  while (n_results < 4)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_null (meta_kms_get_pending_update (kms, device));
+
+  g_assert_cmpint (meta_kms_device_get_n_commits (device), >=, n_commits + 4);
+
+  meta_kms_set_merge_updates (kms, FALSE);
+}
+
+static void
+meta_test_kms_update_connector_states (void)
+{
+  MetaKmsDevice *device;
+  MetaKms *kms;
+  MetaKmsConnector *connector;
+  const MetaKmsConnectorState *state;
+  MetaKmsUpdateChanges changes;
+
+  device = meta_get_test_kms_device (test_context);
+  kms = meta_kms_device_get_kms (device);
+  connector = meta_get_test_kms_connector (device);
+
+  g_assert_cmpuint (meta_kms_connector_get_prop_id (connector,
+                                                    META_KMS_CONNECTOR_PROP_EDID),
+                    !=, 0);
+  g_assert_cmpuint (meta_kms_connector_get_prop_id (connector,
+                                                    META_KMS_CONNECTOR_PROP_NON_DESKTOP),
+                    !=, 0);
+
+  meta_kms_update_states_sync (kms, NULL);
+  state = meta_kms_connector_get_current_state (connector);
+  g_assert_nonnull (state);
+
+  /* Re-reading an unchanged connector must neither report changes nor
+   * rebuild its state. */
+  changes = meta_kms_update_states_sync (kms, NULL);
+  g_assert_cmpuint (changes, ==, META_KMS_UPDATE_CHANGE_NONE);
+  g_assert (meta_kms_connector_get_current_state (connector) == state);
+}
+
 static void
 init_tests (void)
 {
@@ -228,6 +993,20 @@ init_tests (void)
                    meta_test_kms_update_plane_assignments);
   g_test_add_func ("/backends/native/kms/update/mode-sets",
                    meta_test_kms_update_mode_sets);
+  g_test_add_func ("/backends/native/kms/update/vrr",
+                   meta_test_kms_update_vrr);
+  g_test_add_func ("/backends/native/kms/update/blocked-main-loop",
+                   meta_test_kms_update_blocked_main_loop);
+  g_test_add_func ("/backends/native/kms/update/overlay-plane",
+                   meta_test_kms_update_overlay_plane);
+  g_test_add_func ("/backends/native/kms/update/test-result-cache",
+                   meta_test_kms_update_test_result_cache);
+  g_test_add_func ("/backends/native/kms/update/fb-damage",
+                   meta_test_kms_update_fb_damage);
+  g_test_add_func ("/backends/native/kms/update/merged",
+                   meta_test_kms_update_merged);
+  g_test_add_func ("/backends/native/kms/update/connector-states",
+                   meta_test_kms_update_connector_states);
 }
 
 int
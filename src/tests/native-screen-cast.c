@@ -24,8 +24,127 @@
 
 #include <errno.h>
 #include <gio/gio.h>
+#include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
+#include "backends/meta-backend-private.h"
+#include "backends/meta-renderer.h"
+#include "backends/meta-screen-cast.h"
+
+static ClutterActor *fill_actor;
+static gulong fill_painted_handler_id;
+
+static void
+on_fill_painted (ClutterStage     *stage,
+                 ClutterStageView *view,
+                 GSubprocess      *subprocess)
+{
+  GOutputStream *stdin_pipe = g_subprocess_get_stdin_pipe (subprocess);
+  const char *reply = "filled\n";
+  GError *error = NULL;
+
+  g_clear_signal_handler (&fill_painted_handler_id, stage);
+
+  if (!g_output_stream_write_all (stdin_pipe, reply, strlen (reply),
+                                  NULL, NULL, &error) ||
+      !g_output_stream_flush (stdin_pipe, NULL, &error))
+    g_error ("Failed to reply to screen cast test client: %s", error->message);
+}
+
+static void
+fill_stage (const ClutterColor *color,
+            GSubprocess        *subprocess)
+{
+  MetaBackend *backend = meta_get_backend ();
+  ClutterActor *stage = meta_backend_get_stage (backend);
+
+  if (!fill_actor)
+    {
+      fill_actor = clutter_actor_new ();
+      clutter_actor_add_constraint (fill_actor,
+                                    clutter_bind_constraint_new (stage,
+                                                                 CLUTTER_BIND_SIZE,
+                                                                 0));
+      clutter_actor_add_child (stage, fill_actor);
+    }
+
+  clutter_actor_set_background_color (fill_actor, color);
+
+  /* Reply once the fill made it to the screen, so that any frame recorded
+   * after that is known to contain it. */
+  g_clear_signal_handler (&fill_painted_handler_id, stage);
+  fill_painted_handler_id = g_signal_connect (stage, "after-paint",
+                                              G_CALLBACK (on_fill_painted),
+                                              subprocess);
+}
+
+static void
+damage_views (MetaRectangle *rect)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaRenderer *renderer = meta_backend_get_renderer (backend);
+  ClutterActor *stage = meta_backend_get_stage (backend);
+  GList *l;
+
+  for (l = meta_renderer_get_views (renderer); l; l = l->next)
+    {
+      ClutterStageView *view = l->data;
+      cairo_rectangle_int_t view_layout;
+      cairo_rectangle_int_t clip;
+
+      clutter_stage_view_get_layout (view, &view_layout);
+      clip = (cairo_rectangle_int_t) {
+        .x = view_layout.x + rect->x,
+        .y = view_layout.y + rect->y,
+        .width = rect->width,
+        .height = rect->height,
+      };
+      clutter_actor_queue_redraw_with_clip (stage, &clip);
+    }
+}
+
+static void
+on_test_client_line_read (GObject      *source_object,
+                          GAsyncResult *result,
+                          gpointer      user_data)
+{
+  GDataInputStream *data_stream = G_DATA_INPUT_STREAM (source_object);
+  GSubprocess *subprocess = user_data;
+  g_autofree char *line = NULL;
+  MetaRectangle rect;
+  unsigned int red, green, blue;
+
+  line = g_data_input_stream_read_line_finish (data_stream, result,
+                                               NULL, NULL);
+  if (!line)
+    {
+      g_object_unref (subprocess);
+      return;
+    }
+
+  /* The test client asks for damage at a view relative rectangle, to check
+   * that it is passed on to the stream as is, and for the stage to be filled
+   * with a solid color, to check the contents of the stream. */
+  if (sscanf (line, "damage %d %d %d %d",
+              &rect.x, &rect.y, &rect.width, &rect.height) == 4)
+    {
+      damage_views (&rect);
+    }
+  else if (sscanf (line, "fill %u %u %u", &red, &green, &blue) == 3)
+    {
+      ClutterColor color = { red, green, blue, 255 };
+
+      fill_stage (&color, subprocess);
+    }
+
+  g_data_input_stream_read_line_async (data_stream,
+                                       G_PRIORITY_DEFAULT,
+                                       NULL,
+                                       on_test_client_line_read,
+                                       subprocess);
+}
+
 static void
 test_client_exited (GObject      *source_object,
                     GAsyncResult *result,
@@ -44,10 +163,14 @@ test_client_exited (GObject      *source_object,
 static void
 meta_test_screen_cast_record_virtual (void)
 {
+  MetaBackend *backend = meta_get_backend ();
+  MetaScreenCast *screen_cast = meta_backend_get_screen_cast (backend);
+  int n_paints, n_read_backs, n_frames;
   GSubprocessLauncher *launcher;
   g_autofree char *test_client_path = NULL;
   GError *error = NULL;
   GSubprocess *subprocess;
+  GDataInputStream *data_stream;
   GMainLoop *loop;
 
   launcher =  g_subprocess_launcher_new ((G_SUBPROCESS_FLAGS_STDIN_PIPE |
@@ -68,6 +191,15 @@ meta_test_screen_cast_record_virtual (void)
   if (!subprocess)
     g_error ("Failed to launch screen cast test client: %s", error->message);
 
+  data_stream =
+    g_data_input_stream_new (g_subprocess_get_stdout_pipe (subprocess));
+  g_data_input_stream_read_line_async (data_stream,
+                                       G_PRIORITY_DEFAULT,
+                                       NULL,
+                                       on_test_client_line_read,
+                                       g_object_ref (subprocess));
+  g_object_unref (data_stream);
+
   loop = g_main_loop_new (NULL, FALSE);
   g_subprocess_wait_check_async (subprocess,
                                  NULL,
@@ -75,7 +207,26 @@ meta_test_screen_cast_record_virtual (void)
                                  loop);
   g_main_loop_run (loop);
   g_assert_true (g_subprocess_get_successful (subprocess));
+
+  g_clear_signal_handler (&fill_painted_handler_id,
+                          meta_backend_get_stage (backend));
+  g_clear_pointer (&fill_actor, clutter_actor_destroy);
   g_object_unref (subprocess);
+
+  meta_screen_cast_get_monitor_capture_stats (screen_cast,
+                                              &n_paints, &n_read_backs,
+                                              &n_frames);
+  g_test_message ("Monitor capture paints and read backs per recorded frame: "
+                  "%d, %d / %d",
+                  n_paints, n_read_backs, n_frames);
+  g_assert_cmpint (n_frames, >, 0);
+
+  /* The client records the same monitor with several streams at a time, so
+   * each paint of the capture should be shared by about two frames, leaving
+   * some room for streams starting and stopping out of step. */
+  g_assert_cmpint (n_paints, <, n_frames);
+  g_assert_cmpint (n_paints * 3, <=, n_frames * 2);
+  g_assert_cmpint (n_read_backs, <, n_frames);
 }
 
 void
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2022 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ */
+
+#include "config.h"
+
+#include "tests/native-stage-capture.h"
+
+#include "backends/meta-backend-private.h"
+#include "backends/meta-renderer.h"
+#include "backends/meta-stage-capture.h"
+#include "backends/meta-virtual-monitor.h"
+#include "tests/meta-test-utils.h"
+
+#define N_ITERATIONS 20
+
+static const ClutterColor actor_color = { 0x72, 0x9f, 0xcf, 0xff };
+
+static const MetaRectangle capture_rect = { 20, 20, 100, 50 };
+
+static void
+assert_capture (const uint8_t *data,
+                int            width,
+                int            height,
+                int            stride)
+{
+  int x, y;
+
+  g_assert_cmpint (width, ==, capture_rect.width);
+  g_assert_cmpint (height, ==, capture_rect.height);
+
+  for (y = 0; y < height; y++)
+    {
+      for (x = 0; x < width; x++)
+        {
+          const uint8_t *pixel = data + y * stride + x * 4;
+
+          g_assert_cmphex (pixel[0], ==, actor_color.red);
+          g_assert_cmphex (pixel[1], ==, actor_color.green);
+          g_assert_cmphex (pixel[2], ==, actor_color.blue);
+          g_assert_cmphex (pixel[3], ==, actor_color.alpha);
+        }
+    }
+}
+
+static void
+on_captured (GObject      *source_object,
+             GAsyncResult *result,
+             gpointer      user_data)
+{
+  GAsyncResult **out_result = user_data;
+
+  *out_result = g_object_ref (result);
+}
+
+static void
+capture_and_compare (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaContext *context = meta_backend_get_context (backend);
+  ClutterActor *stage = meta_backend_get_stage (backend);
+  ClutterActor *actor;
+  cairo_rectangle_int_t paint_rect = {
+    .x = capture_rect.x,
+    .y = capture_rect.y,
+    .width = capture_rect.width,
+    .height = capture_rect.height,
+  };
+  g_autofree uint8_t *paint_data = NULL;
+  int64_t paint_time_us = 0;
+  int64_t capture_time_us = 0;
+  int64_t capture_latency_us = 0;
+  int i;
+
+  actor = clutter_actor_new ();
+  clutter_actor_set_position (actor, 10, 10);
+  clutter_actor_set_size (actor, 200, 100);
+  clutter_actor_set_background_color (actor, &actor_color);
+  clutter_actor_add_child (stage, actor);
+
+  meta_wait_for_paint (context);
+
+  paint_data = g_malloc0 (capture_rect.width * capture_rect.height * 4);
+
+  for (i = 0; i < N_ITERATIONS; i++)
+    {
+      g_autoptr (GAsyncResult) result = NULL;
+      g_autoptr (GError) error = NULL;
+      g_autofree uint8_t *data = NULL;
+      int64_t start_time_us;
+      int width, height, stride;
+
+      start_time_us = g_get_monotonic_time ();
+      if (!clutter_stage_paint_to_buffer (CLUTTER_STAGE (stage),
+                                          &paint_rect, 1.0,
+                                          paint_data,
+                                          capture_rect.width * 4,
+                                          COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                          CLUTTER_PAINT_FLAG_NONE,
+                                          &error))
+        g_error ("Failed to paint stage to buffer: %s", error->message);
+      paint_time_us += g_get_monotonic_time () - start_time_us;
+
+      assert_capture (paint_data,
+                      capture_rect.width, capture_rect.height,
+                      capture_rect.width * 4);
+
+      start_time_us = g_get_monotonic_time ();
+      meta_stage_capture_region_async (backend,
+                                       &capture_rect,
+                                       COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                       NULL,
+                                       on_captured,
+                                       &result);
+      capture_time_us += g_get_monotonic_time () - start_time_us;
+
+      while (!result)
+        g_main_context_iteration (NULL, TRUE);
+      capture_latency_us += g_get_monotonic_time () - start_time_us;
+
+      data = meta_stage_capture_region_finish (backend, result,
+                                               &width, &height, &stride,
+                                               NULL, &error);
+      if (!data)
+        g_error ("Failed to capture stage region: %s", error->message);
+
+      assert_capture (data, width, height, stride);
+    }
+
+  g_test_message ("Painting to buffer: %" G_GINT64_FORMAT " us per capture",
+                  paint_time_us / N_ITERATIONS);
+  g_test_message ("Region capture: %" G_GINT64_FORMAT " us per capture "
+                  "blocking, %" G_GINT64_FORMAT " us until done",
+                  capture_time_us / N_ITERATIONS,
+                  capture_latency_us / N_ITERATIONS);
+
+  clutter_actor_destroy (actor);
+}
+
+static void
+meta_test_stage_capture_region (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaContext *context = meta_backend_get_context (backend);
+  MetaVirtualMonitor *virtual_monitor;
+
+  virtual_monitor = meta_create_test_monitor (context, 640, 480, 60.0);
+
+  capture_and_compare ();
+
+  g_object_unref (virtual_monitor);
+  meta_monitor_manager_reload (meta_backend_get_monitor_manager (backend));
+}
+
+/*
+ * Views of KMS monitors without a shadow framebuffer are onscreens, whose
+ * contents can't be blitted from after being swapped, so the stage is painted
+ * instead.
+ */
+static void
+meta_test_stage_capture_onscreen (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaRenderer *renderer = meta_backend_get_renderer (backend);
+  GList *views;
+  CoglFramebuffer *framebuffer;
+
+  views = meta_renderer_get_views (renderer);
+  g_assert_nonnull (views);
+
+  framebuffer = clutter_stage_view_get_framebuffer (views->data);
+  g_test_message ("Capturing from %s view",
+                  COGL_IS_ONSCREEN (framebuffer) ? "an onscreen" :
+                                                   "a shadowed or offscreen");
+
+  capture_and_compare ();
+}
+
+static void
+meta_test_stage_capture_outside (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaContext *context = meta_backend_get_context (backend);
+  MetaVirtualMonitor *virtual_monitor;
+  MetaRectangle rect = { 1000, 1000, 10, 10 };
+  g_autoptr (GAsyncResult) result = NULL;
+  g_autoptr (GError) error = NULL;
+  uint8_t *data;
+
+  virtual_monitor = meta_create_test_monitor (context, 640, 480, 60.0);
+
+  meta_stage_capture_region_async (backend,
+                                   &rect,
+                                   COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                   NULL,
+                                   on_captured,
+                                   &result);
+  while (!result)
+    g_main_context_iteration (NULL, TRUE);
+
+  data = meta_stage_capture_region_finish (backend, result,
+                                           NULL, NULL, NULL, NULL,
+                                           &error);
+  g_assert_null (data);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT);
+
+  g_object_unref (virtual_monitor);
+  meta_monitor_manager_reload (meta_backend_get_monitor_manager (backend));
+}
+
+void
+init_stage_capture_onscreen_tests (void)
+{
+  g_test_add_func ("/backends/native/kms/stage-capture/onscreen",
+                   meta_test_stage_capture_onscreen);
+}
+
+void
+init_stage_capture_tests (void)
+{
+  g_test_add_func ("/backends/native/stage-capture/region",
+                   meta_test_stage_capture_region);
+  g_test_add_func ("/backends/native/stage-capture/outside",
+                   meta_test_stage_capture_outside);
+}
@@ -20,14 +20,19 @@
 
 #include "config.h"
 
+#include <errno.h>
+#include <gio/gunixfdlist.h>
 #include <pipewire/pipewire.h>
 #include <spa/param/format-utils.h>
 #include <spa/param/props.h>
 #include <spa/param/video/format-utils.h>
 #include <spa/utils/result.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <sys/mman.h>
+#include <unistd.h>
 
+#include "backends/meta-remote-desktop-input-ring.h"
 #include "meta-dbus-remote-desktop.h"
 #include "meta-dbus-screen-cast.h"
 
@@ -37,10 +42,25 @@
   g_assert_cmpint (stream->cursor_y, ==, (y)); \
 }
 
+#define assert_damage_extents(stream, x, y, width, height) \
+{ \
+  g_assert_cmpint (stream->damage_extents.position.x, ==, (x)); \
+  g_assert_cmpint (stream->damage_extents.position.y, ==, (y)); \
+  g_assert_cmpint (stream->damage_extents.size.width, ==, (width)); \
+  g_assert_cmpint (stream->damage_extents.size.height, ==, (height)); \
+}
+
 #define CURSOR_META_SIZE(width, height) \
  (sizeof(struct spa_meta_cursor) + \
   sizeof(struct spa_meta_bitmap) + width * height * 4)
 
+#define MAX_DAMAGE_RECTS 16
+
+#define N_SHARED_CAPTURE_FRAMES 10
+
+#define INPUT_CHANNEL_N_BATCHES 100
+#define INPUT_CHANNEL_BATCH_SIZE 100
+
 enum
   {
     CURSOR_MODE_HIDDEN = 0,
@@ -60,9 +80,18 @@ typedef struct _Stream
 
   int target_width;
   int target_height;
+  uint32_t target_format;
 
   int cursor_x;
   int cursor_y;
+
+  /* Union of the damage of all frames since the last format change. */
+  struct spa_region damage_extents;
+
+  /* YUV values of the bottom right pixel of the last YUV frame */
+  uint8_t sample_y;
+  uint8_t sample_u;
+  uint8_t sample_v;
 } Stream;
 
 typedef struct _Session
@@ -71,6 +100,13 @@ typedef struct _Session
   MetaDBusRemoteDesktopSession *remote_desktop_session_proxy;
 } Session;
 
+typedef struct _InputChannel
+{
+  MetaRemoteDesktopInputRing *ring;
+  size_t size;
+  int notify_fd;
+} InputChannel;
+
 typedef struct _RemoteDesktop
 {
   MetaDBusRemoteDesktop *proxy;
@@ -229,12 +265,13 @@ on_stream_param_changed (void                 *user_data,
   Stream *stream = user_data;
   uint8_t params_buffer[1024];
   struct spa_pod_builder pod_builder;
-  const struct spa_pod *params[3];
+  const struct spa_pod *params[4];
 
   if (!format || id != SPA_PARAM_Format)
     return;
 
   spa_format_video_raw_parse (format, &stream->spa_format);
+  stream->damage_extents = SPA_REGION (0, 0, 0, 0);
 
   pod_builder = SPA_POD_BUILDER_INIT (params_buffer, sizeof (params_buffer));
 
@@ -262,10 +299,63 @@ on_stream_param_changed (void                 *user_data,
                                                    CURSOR_META_SIZE (384, 384)),
     0);
 
+  params[3] = spa_pod_builder_add_object (
+    &pod_builder,
+    SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta,
+    SPA_PARAM_META_type, SPA_POD_Id (SPA_META_VideoDamage),
+    SPA_PARAM_META_size, SPA_POD_CHOICE_RANGE_Int (
+      sizeof (struct spa_meta_region) * MAX_DAMAGE_RECTS,
+      sizeof (struct spa_meta_region) * 1,
+      sizeof (struct spa_meta_region) * MAX_DAMAGE_RECTS),
+    0);
+
   pw_stream_update_params (stream->pipewire_stream,
                            params, G_N_ELEMENTS (params));
 }
 
+static void
+process_buffer_damage (Stream            *stream,
+                       struct spa_buffer *buffer)
+{
+  struct spa_meta *spa_meta_video_damage;
+  struct spa_meta_region *spa_meta_region;
+  struct spa_region *extents = &stream->damage_extents;
+
+  spa_meta_video_damage = spa_buffer_find_meta (buffer, SPA_META_VideoDamage);
+  if (!spa_meta_video_damage)
+    return;
+
+  spa_meta_for_each (spa_meta_region, spa_meta_video_damage)
+    {
+      struct spa_region *region = &spa_meta_region->region;
+      int x1, y1, x2, y2;
+
+      if (!spa_meta_region_is_valid (spa_meta_region))
+        break;
+
+      g_assert_cmpint (region->position.x, >=, 0);
+      g_assert_cmpint (region->position.y, >=, 0);
+      g_assert_cmpint (region->position.x + region->size.width, <=,
+                       stream->spa_format.size.width);
+      g_assert_cmpint (region->position.y + region->size.height, <=,
+                       stream->spa_format.size.height);
+
+      if (extents->size.width == 0 || extents->size.height == 0)
+        {
+          *extents = *region;
+          continue;
+        }
+
+      x1 = MIN (extents->position.x, region->position.x);
+      y1 = MIN (extents->position.y, region->position.y);
+      x2 = MAX (extents->position.x + (int) extents->size.width,
+                region->position.x + (int) region->size.width);
+      y2 = MAX (extents->position.y + (int) extents->size.height,
+                region->position.y + (int) region->size.height);
+      *extents = SPA_REGION (x1, y1, x2 - x1, y2 - y1);
+    }
+}
+
 static void
 process_buffer_metadata (Stream            *stream,
                          struct spa_buffer *buffer)
@@ -308,12 +398,74 @@ sanity_check_memptr (struct spa_buffer *buffer)
   g_assert_nonnull (buffer->datas[0].data);
 }
 
+static void
+sample_yuv_memfd (Stream            *stream,
+                  struct spa_buffer *buffer)
+{
+  struct spa_data *datas = buffer->datas;
+  int x = stream->spa_format.size.width - 1;
+  int y = stream->spa_format.size.height - 1;
+  size_t size;
+  uint8_t *map;
+
+  g_assert_cmpint (datas[0].type, ==, SPA_DATA_MemFd);
+
+  size = datas[0].maxsize + datas[0].mapoffset;
+  map = mmap (NULL, size, PROT_READ, MAP_PRIVATE, datas[0].fd, 0);
+  g_assert (map != MAP_FAILED);
+
+  g_assert_cmpint (datas[0].chunk->stride, >=, stream->spa_format.size.width);
+  g_assert_cmpint (datas[0].chunk->size, >=,
+                   datas[0].chunk->stride * stream->spa_format.size.height);
+  stream->sample_y = map[datas[0].chunk->offset +
+                         y * datas[0].chunk->stride + x];
+
+  switch (stream->spa_format.format)
+    {
+    case SPA_VIDEO_FORMAT_NV12:
+      {
+        uint8_t *uv;
+
+        g_assert_cmpuint (buffer->n_datas, ==, 2);
+        g_assert_cmpint (datas[1].chunk->size, >=,
+                         datas[1].chunk->stride * (y / 2 + 1));
+        uv = &map[datas[1].chunk->offset +
+                  (y / 2) * datas[1].chunk->stride + (x / 2) * 2];
+        stream->sample_u = uv[0];
+        stream->sample_v = uv[1];
+        break;
+      }
+    case SPA_VIDEO_FORMAT_I420:
+      g_assert_cmpuint (buffer->n_datas, ==, 3);
+      g_assert_cmpint (datas[1].chunk->size, >=,
+                       datas[1].chunk->stride * (y / 2 + 1));
+      g_assert_cmpint (datas[2].chunk->size, >=,
+                       datas[2].chunk->stride * (y / 2 + 1));
+      stream->sample_u = map[datas[1].chunk->offset +
+                             (y / 2) * datas[1].chunk->stride + x / 2];
+      stream->sample_v = map[datas[2].chunk->offset +
+                             (y / 2) * datas[2].chunk->stride + x / 2];
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+
+  munmap (map, size);
+}
+
 static void
 process_buffer (Stream            *stream,
                 struct spa_buffer *buffer)
 {
   process_buffer_metadata (stream, buffer);
 
+  if (stream->spa_format.format == SPA_VIDEO_FORMAT_NV12 ||
+      stream->spa_format.format == SPA_VIDEO_FORMAT_I420)
+    {
+      sample_yuv_memfd (stream, buffer);
+      return;
+    }
+
   if (buffer->datas[0].chunk->size == 0)
     g_assert_not_reached ();
   else if (buffer->datas[0].type == SPA_DATA_MemFd)
@@ -339,6 +491,9 @@ on_stream_process (void *user_data)
       buffer = next_buffer;
       next_buffer = pw_stream_dequeue_buffer (stream->pipewire_stream);
 
+      if (buffer->buffer->datas[0].chunk->size != 0)
+        process_buffer_damage (stream, buffer->buffer);
+
       if (next_buffer)
         pw_stream_queue_buffer (stream->pipewire_stream, buffer);
     }
@@ -384,7 +539,7 @@ stream_connect (Stream *stream)
     SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat,
     SPA_FORMAT_mediaType, SPA_POD_Id (SPA_MEDIA_TYPE_video),
     SPA_FORMAT_mediaSubtype, SPA_POD_Id (SPA_MEDIA_SUBTYPE_raw),
-    SPA_FORMAT_VIDEO_format, SPA_POD_Id (SPA_VIDEO_FORMAT_BGRx),
+    SPA_FORMAT_VIDEO_format, SPA_POD_Id (stream->target_format),
     SPA_FORMAT_VIDEO_size, SPA_POD_Rectangle (&rect),
     SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction (&SPA_FRACTION(0, 1)),
     SPA_FORMAT_VIDEO_maxFramerate, SPA_POD_CHOICE_RANGE_Fraction (&min_framerate,
@@ -441,6 +596,65 @@ stream_wait_for_render (Stream *stream)
     g_main_context_iteration (NULL, TRUE);
 }
 
+static void
+stream_reset_damage (Stream *stream)
+{
+  stream->damage_extents = SPA_REGION (0, 0, 0, 0);
+}
+
+static gboolean
+stream_has_damage (Stream *stream,
+                   int     x,
+                   int     y,
+                   int     width,
+                   int     height)
+{
+  struct spa_region *extents = &stream->damage_extents;
+
+  return (extents->position.x <= x &&
+          extents->position.y <= y &&
+          extents->position.x + (int) extents->size.width >= x + width &&
+          extents->position.y + (int) extents->size.height >= y + height);
+}
+
+static void
+stream_wait_for_damage (Stream *stream,
+                        int     x,
+                        int     y,
+                        int     width,
+                        int     height)
+{
+  while (!stream_has_damage (stream, x, y, width, height))
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+request_damage (int x,
+                int y,
+                int width,
+                int height)
+{
+  /* Read by the test case, which damages every view at the given view
+   * relative rectangle. */
+  fprintf (stdout, "damage %d %d %d %d\n", x, y, width, height);
+  fflush (stdout);
+}
+
+static void
+request_fill (uint8_t red,
+              uint8_t green,
+              uint8_t blue)
+{
+  char reply[32];
+
+  fprintf (stdout, "fill %u %u %u\n", red, green, blue);
+  fflush (stdout);
+
+  if (!fgets (reply, sizeof (reply), stdin))
+    g_error ("Failed to read fill reply: %s", g_strerror (errno));
+  g_assert_cmpstr (reply, ==, "filled\n");
+}
+
 static void
 stream_resize (Stream *stream,
                int     width,
@@ -453,6 +667,7 @@ stream_resize (Stream *stream,
 
   stream->target_width = width;
   stream->target_height = height;
+  stream->target_format = SPA_VIDEO_FORMAT_BGRx;
 
   rect = SPA_RECTANGLE (width, height);
 
@@ -488,6 +703,7 @@ stream_new (const char *path,
   stream = g_new0 (Stream, 1);
   stream->target_width = width;
   stream->target_height = height;
+  stream->target_format = SPA_VIDEO_FORMAT_BGRx;
 
   stream->proxy = meta_dbus_screen_cast_stream_proxy_new_for_bus_sync (
     G_BUS_TYPE_SESSION,
@@ -529,6 +745,129 @@ session_notify_absolute_pointer (Session *session,
     g_error ("Failed to send absolute pointer motion event: %s", error->message);
 }
 
+static InputChannel *
+session_open_input_channel (Session *session,
+                            Stream  *stream)
+{
+  GVariantBuilder options_builder;
+  GVariant *ring_fd_variant = NULL;
+  GVariant *notify_fd_variant = NULL;
+  g_autoptr (GUnixFDList) fd_list = NULL;
+  GError *error = NULL;
+  InputChannel *input_channel;
+  int ring_fd;
+
+  g_variant_builder_init (&options_builder, G_VARIANT_TYPE ("a{sv}"));
+  g_variant_builder_add (&options_builder, "{sv}",
+                         "stream",
+                         g_variant_new_string (
+                           g_dbus_proxy_get_object_path (G_DBUS_PROXY (stream->proxy))));
+
+  if (!meta_dbus_remote_desktop_session_call_open_input_channel_sync (
+        session->remote_desktop_session_proxy,
+        g_variant_builder_end (&options_builder),
+        NULL,
+        &ring_fd_variant,
+        &notify_fd_variant,
+        &fd_list,
+        NULL,
+        &error))
+    g_error ("Failed to open input channel: %s", error->message);
+
+  input_channel = g_new0 (InputChannel, 1);
+
+  ring_fd = g_unix_fd_list_get (fd_list,
+                                g_variant_get_handle (ring_fd_variant),
+                                &error);
+  if (ring_fd == -1)
+    g_error ("Failed to get input ring fd: %s", error->message);
+
+  input_channel->notify_fd =
+    g_unix_fd_list_get (fd_list,
+                        g_variant_get_handle (notify_fd_variant),
+                        &error);
+  if (input_channel->notify_fd == -1)
+    g_error ("Failed to get input notify fd: %s", error->message);
+
+  g_variant_unref (ring_fd_variant);
+  g_variant_unref (notify_fd_variant);
+
+  /* Map the header first to find out the size of the ring */
+  input_channel->ring = mmap (NULL, sizeof (MetaRemoteDesktopInputRing),
+                              PROT_READ, MAP_SHARED, ring_fd, 0);
+  g_assert (input_channel->ring != MAP_FAILED);
+  g_assert_cmpuint (input_channel->ring->version,
+                    ==,
+                    META_REMOTE_DESKTOP_INPUT_RING_VERSION);
+  input_channel->size = sizeof (MetaRemoteDesktopInputRing) +
+                        input_channel->ring->n_events *
+                        sizeof (MetaRemoteDesktopInputEvent);
+  munmap (input_channel->ring, sizeof (MetaRemoteDesktopInputRing));
+
+  input_channel->ring = mmap (NULL, input_channel->size,
+                              PROT_READ | PROT_WRITE, MAP_SHARED, ring_fd, 0);
+  g_assert (input_channel->ring != MAP_FAILED);
+  close (ring_fd);
+
+  return input_channel;
+}
+
+static void
+input_channel_free (InputChannel *input_channel)
+{
+  munmap (input_channel->ring, input_channel->size);
+  close (input_channel->notify_fd);
+  g_free (input_channel);
+}
+
+static uint32_t
+input_channel_get_tail (InputChannel *input_channel)
+{
+  return (uint32_t) g_atomic_int_get ((int *) &input_channel->ring->tail);
+}
+
+static void
+input_channel_push (InputChannel                    *input_channel,
+                    MetaRemoteDesktopInputEventType  type,
+                    double                           x,
+                    double                           y)
+{
+  MetaRemoteDesktopInputRing *ring = input_channel->ring;
+  uint32_t head = ring->head;
+  MetaRemoteDesktopInputEvent *event;
+
+  /* Wait for the display server to make room */
+  while (head - input_channel_get_tail (input_channel) == ring->n_events)
+    g_usleep (100);
+
+  event = &ring->events[head & (ring->n_events - 1)];
+  *event = (MetaRemoteDesktopInputEvent) {
+    .type = type,
+    .time_us = g_get_monotonic_time (),
+    .x = x,
+    .y = y,
+  };
+
+  g_atomic_int_set ((int *) &ring->head, (int) (head + 1));
+}
+
+static void
+input_channel_notify (InputChannel *input_channel)
+{
+  uint64_t count = 1;
+
+  if (write (input_channel->notify_fd, &count, sizeof (count)) !=
+      sizeof (count))
+    g_error ("Failed to notify input channel: %s", g_strerror (errno));
+}
+
+static void
+input_channel_wait_for_dispatch (InputChannel *input_channel)
+{
+  while (input_channel_get_tail (input_channel) != input_channel->ring->head)
+    g_usleep (100);
+}
+
 static void
 session_start (Session *session)
 {
@@ -583,6 +922,38 @@ session_record_virtual (Session *session,
   return stream;
 }
 
+static Stream *
+session_record_monitor (Session    *session,
+                        const char *connector,
+                        int         width,
+                        int         height)
+{
+  GVariantBuilder properties_builder;
+  GVariant *properties_variant;
+  GError *error = NULL;
+  g_autofree char *stream_path = NULL;
+  Stream *stream;
+
+  g_variant_builder_init (&properties_builder, G_VARIANT_TYPE ("a{sv}"));
+  g_variant_builder_add (&properties_builder, "{sv}",
+                         "cursor-mode",
+                         g_variant_new_uint32 (CURSOR_MODE_METADATA));
+  properties_variant = g_variant_builder_end (&properties_builder);
+
+  if (!meta_dbus_screen_cast_session_call_record_monitor_sync (
+        session->screen_cast_session_proxy,
+        connector,
+        properties_variant,
+        &stream_path,
+        NULL,
+        &error))
+    g_error ("Failed to record monitor: %s", error->message);
+
+  stream = stream_new (stream_path, width, height);
+  g_assert_nonnull (stream);
+  return stream;
+}
+
 static Session *
 session_new (MetaDBusRemoteDesktopSession *remote_desktop_session_proxy,
              MetaDBusScreenCastSession    *screen_cast_session_proxy)
@@ -731,6 +1102,16 @@ main (int    argc,
   ScreenCast *screen_cast;
   Session *session;
   Stream *stream;
+  Session *monitor_session;
+  Stream *monitor_streams[3];
+  Session *damage_session;
+  Stream *damage_stream;
+  Session *yuv_session;
+  Stream *yuv_streams[2];
+  InputChannel *input_channel;
+  int64_t start_time_us;
+  int64_t elapsed_us;
+  size_t i;
 
   init_pipewire ();
 
@@ -756,6 +1137,9 @@ main (int    argc,
   g_assert_cmpint (stream->spa_format.size.width, ==, 50);
   g_assert_cmpint (stream->spa_format.size.height, ==, 40);
 
+  /* Check that the initial frame is fully damaged */
+  assert_damage_extents (stream, 0, 0, 50, 40);
+
   /* Check that resizing works */
   stream_resize (stream, 70, 60);
   while (TRUE)
@@ -764,12 +1148,185 @@ main (int    argc,
 
       if (stream->spa_format.size.width == 70 &&
           stream->spa_format.size.height == 60)
-        break;
+        {
+          /* A renegotiated stream starts over with a full frame */
+          assert_damage_extents (stream, 0, 0, 70, 60);
+          break;
+        }
 
       g_assert_cmpint (stream->spa_format.size.width, ==, 50);
       g_assert_cmpint (stream->spa_format.size.height, ==, 40);
     }
 
+  /* Check that events sent through the input channel reach the stream, and
+   * measure how fast batches of them are dispatched */
+  input_channel = session_open_input_channel (session, stream);
+
+  input_channel_push (input_channel,
+                      META_REMOTE_DESKTOP_INPUT_EVENT_POINTER_MOTION_ABSOLUTE,
+                      10, 12);
+  input_channel_notify (input_channel);
+  stream_wait_for_cursor_position (stream, 10, 12);
+
+  start_time_us = g_get_monotonic_time ();
+  for (i = 0; i < INPUT_CHANNEL_N_BATCHES; i++)
+    {
+      size_t j;
+
+      for (j = 0; j < INPUT_CHANNEL_BATCH_SIZE; j++)
+        {
+          input_channel_push (input_channel,
+                              META_REMOTE_DESKTOP_INPUT_EVENT_POINTER_MOTION_RELATIVE,
+                              j % 2 ? -1 : 1, 0);
+        }
+      input_channel_notify (input_channel);
+    }
+  input_channel_wait_for_dispatch (input_channel);
+  elapsed_us = g_get_monotonic_time () - start_time_us;
+
+  g_assert_cmpuint (input_channel->ring->n_dispatched,
+                    ==,
+                    INPUT_CHANNEL_N_BATCHES * INPUT_CHANNEL_BATCH_SIZE + 1);
+  g_message ("Input channel: %.0f events/s, %.1f us average latency",
+             (INPUT_CHANNEL_N_BATCHES * INPUT_CHANNEL_BATCH_SIZE) /
+             (MAX (elapsed_us, 1) / (double) G_USEC_PER_SEC),
+             input_channel->ring->total_latency_us /
+             (double) input_channel->ring->n_dispatched);
+
+  input_channel_push (input_channel,
+                      META_REMOTE_DESKTOP_INPUT_EVENT_POINTER_MOTION_ABSOLUTE,
+                      20, 15);
+  input_channel_notify (input_channel);
+  stream_wait_for_cursor_position (stream, 20, 15);
+
+  input_channel_free (input_channel);
+
+  /* Check that consumers of the virtual monitor share its capture, two of them
+   * reading it back as is, and one scaling it down */
+  monitor_session = screen_cast_create_session (remote_desktop, screen_cast);
+  monitor_streams[0] = session_record_monitor (monitor_session, "Meta-0",
+                                               70, 60);
+  monitor_streams[1] = session_record_monitor (monitor_session, "Meta-0",
+                                               70, 60);
+  monitor_streams[2] = session_record_monitor (monitor_session, "Meta-0",
+                                               35, 30);
+
+  session_start (monitor_session);
+
+  for (i = 0; i < G_N_ELEMENTS (monitor_streams); i++)
+    {
+      stream_wait_for_node (monitor_streams[i]);
+      stream_wait_for_streaming (monitor_streams[i]);
+      stream_wait_for_render (monitor_streams[i]);
+    }
+
+  g_assert_cmpint (monitor_streams[0]->spa_format.size.width, ==, 70);
+  g_assert_cmpint (monitor_streams[0]->spa_format.size.height, ==, 60);
+  g_assert_cmpint (monitor_streams[1]->spa_format.size.width, ==, 70);
+  g_assert_cmpint (monitor_streams[1]->spa_format.size.height, ==, 60);
+  g_assert_cmpint (monitor_streams[2]->spa_format.size.width, ==, 35);
+  g_assert_cmpint (monitor_streams[2]->spa_format.size.height, ==, 30);
+
+  /* Record a number of frames with all streams running, for the compositor to
+   * check how often the capture was painted per frame */
+  for (i = 0; i < N_SHARED_CAPTURE_FRAMES; i++)
+    {
+      int buffer_counts[G_N_ELEMENTS (monitor_streams)];
+      size_t j;
+
+      for (j = 0; j < G_N_ELEMENTS (monitor_streams); j++)
+        buffer_counts[j] = monitor_streams[j]->buffer_count;
+
+      request_damage (0, 0, 10, 10);
+
+      for (j = 0; j < G_N_ELEMENTS (monitor_streams); j++)
+        {
+          while (monitor_streams[j]->buffer_count == buffer_counts[j])
+            g_main_context_iteration (NULL, TRUE);
+        }
+    }
+
+  session_stop (monitor_session);
+
+  for (i = 0; i < G_N_ELEMENTS (monitor_streams); i++)
+    stream_free (monitor_streams[i]);
+  session_free (monitor_session);
+
+  /* Check that partial damage is passed on as is. The virtual monitor of this
+   * stream is placed next to the first one, so the cursor never damages it. */
+  damage_session = screen_cast_create_session (remote_desktop, screen_cast);
+  damage_stream = session_record_virtual (damage_session, 80, 60);
+
+  session_start (damage_session);
+
+  stream_wait_for_node (damage_stream);
+  stream_wait_for_streaming (damage_stream);
+  stream_wait_for_render (damage_stream);
+  stream_wait_for_damage (damage_stream, 0, 0, 80, 60);
+  assert_damage_extents (damage_stream, 0, 0, 80, 60);
+
+  /* The rectangles include the origin, which is where frames held back by the
+   * frame rate limit are damaged when they are finally recorded. */
+  stream_reset_damage (damage_stream);
+  request_damage (0, 0, 10, 10);
+  stream_wait_for_damage (damage_stream, 0, 0, 10, 10);
+  assert_damage_extents (damage_stream, 0, 0, 10, 10);
+
+  /* Check that damage accumulates across frames skipped due to the frame rate
+   * limit; the second request comes well within 1/30 s of the first frame. */
+  request_damage (40, 30, 20, 20);
+  stream_wait_for_damage (damage_stream, 40, 30, 20, 20);
+  assert_damage_extents (damage_stream, 0, 0, 60, 50);
+
+  session_stop (damage_session);
+
+  stream_free (damage_stream);
+  session_free (damage_session);
+
+  /* Check that streams scaled down and converted to YUV on the GPU have the
+   * negotiated size, and BT.709 limited range values. The bottom right pixel
+   * sampled is well clear of the cursor. */
+  request_fill (255, 0, 0);
+
+  yuv_session = screen_cast_create_session (remote_desktop, screen_cast);
+  yuv_streams[0] = session_record_monitor (yuv_session, "Meta-0", 48, 40);
+  yuv_streams[0]->target_format = SPA_VIDEO_FORMAT_NV12;
+  yuv_streams[1] = session_record_monitor (yuv_session, "Meta-0", 48, 40);
+  yuv_streams[1]->target_format = SPA_VIDEO_FORMAT_I420;
+
+  session_start (yuv_session);
+
+  for (i = 0; i < G_N_ELEMENTS (yuv_streams); i++)
+    {
+      stream_wait_for_node (yuv_streams[i]);
+      stream_wait_for_streaming (yuv_streams[i]);
+      stream_wait_for_render (yuv_streams[i]);
+    }
+
+  g_assert_cmpint (yuv_streams[0]->spa_format.format,
+                   ==,
+                   SPA_VIDEO_FORMAT_NV12);
+  g_assert_cmpint (yuv_streams[1]->spa_format.format,
+                   ==,
+                   SPA_VIDEO_FORMAT_I420);
+
+  for (i = 0; i < G_N_ELEMENTS (yuv_streams); i++)
+    {
+      g_assert_cmpint (yuv_streams[i]->spa_format.size.width, ==, 48);
+      g_assert_cmpint (yuv_streams[i]->spa_format.size.height, ==, 40);
+
+      /* Pure red is Y'CbCr (63, 102, 240) */
+      g_assert_cmpint (ABS (yuv_streams[i]->sample_y - 63), <=, 1);
+      g_assert_cmpint (ABS (yuv_streams[i]->sample_u - 102), <=, 1);
+      g_assert_cmpint (ABS (yuv_streams[i]->sample_v - 240), <=, 1);
+    }
+
+  session_stop (yuv_session);
+
+  for (i = 0; i < G_N_ELEMENTS (yuv_streams); i++)
+    stream_free (yuv_streams[i]);
+  session_free (yuv_session);
+
   /* Check that resizing works */
   stream_resize (stream, 60, 60);
 
@@ -0,0 +1,452 @@
+/*
+ * Copyright (C) 2022 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Attaches a dma-buf whose implicit write fence is only signalled after a
+ * delay, simulating a client whose rendering hasn't finished yet, and checks
+ * that the commit doesn't take effect until the fence has signalled.
+ *
+ * The dma-buf is created with udmabuf and the fence with sw_sync; if either
+ * or the compositor's dma-buf support isn't available, the test is skipped.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <linux/dma-buf.h>
+#include <linux/udmabuf.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wayland-client.h>
+
+#include "wayland-test-client-utils.h"
+
+#include "linux-dmabuf-unstable-v1-client-protocol.h"
+#include "xdg-shell-client-protocol.h"
+
+#ifndef DRM_FORMAT_XRGB8888
+#define DRM_FORMAT_XRGB8888 0x34325258
+#endif
+
+#ifndef DRM_FORMAT_MOD_LINEAR
+#define DRM_FORMAT_MOD_LINEAR 0
+#endif
+
+/* From the kernel's sw_sync debugfs interface, which has no uapi header */
+struct sw_sync_create_fence_data
+{
+  uint32_t value;
+  char name[32];
+  int32_t fence;
+};
+
+#define SW_SYNC_IOC_MAGIC 'W'
+#define SW_SYNC_IOC_CREATE_FENCE \
+  _IOWR (SW_SYNC_IOC_MAGIC, 0, struct sw_sync_create_fence_data)
+#define SW_SYNC_IOC_INC _IOW (SW_SYNC_IOC_MAGIC, 1, uint32_t)
+
+#define WIDTH 64
+#define HEIGHT 64
+#define FENCE_DELAY_MS 100
+
+static struct wl_display *display;
+static struct wl_registry *registry;
+static struct wl_compositor *compositor;
+static struct xdg_wm_base *xdg_wm_base;
+static struct zwp_linux_dmabuf_v1 *linux_dmabuf;
+
+static struct wl_surface *surface;
+static struct xdg_surface *xdg_surface;
+static struct xdg_toplevel *xdg_toplevel;
+
+static gboolean waiting_for_configure;
+static gboolean buffer_failed;
+static struct wl_buffer *dma_buf_buffer;
+static gboolean frame_callback_done;
+
+static int
+create_udmabuf (void)
+{
+  struct udmabuf_create create = { 0 };
+  int page_size = getpagesize ();
+  int size = WIDTH * HEIGHT * 4;
+  int udmabuf_fd;
+  int memfd;
+  int dma_buf_fd;
+  uint32_t *pixels;
+  int i;
+
+  size = (size + page_size - 1) / page_size * page_size;
+
+  udmabuf_fd = open ("/dev/udmabuf", O_RDWR | O_CLOEXEC);
+  if (udmabuf_fd < 0)
+    return -1;
+
+  memfd = memfd_create ("dma-buf-delayed-fence", MFD_ALLOW_SEALING);
+  if (memfd < 0 ||
+      ftruncate (memfd, size) < 0 ||
+      fcntl (memfd, F_ADD_SEALS, F_SEAL_SHRINK) < 0)
+    {
+      fprintf (stderr, "Failed to create memfd: %m\n");
+      close (udmabuf_fd);
+      if (memfd >= 0)
+        close (memfd);
+      return -1;
+    }
+
+  pixels = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+  if (pixels == MAP_FAILED)
+    g_error ("mmap failed: %m");
+  for (i = 0; i < WIDTH * HEIGHT; i++)
+    pixels[i] = 0xff00ff00;
+  munmap (pixels, size);
+
+  create.memfd = memfd;
+  create.flags = UDMABUF_FLAGS_CLOEXEC;
+  create.offset = 0;
+  create.size = size;
+  dma_buf_fd = ioctl (udmabuf_fd, UDMABUF_CREATE, &create);
+
+  close (memfd);
+  close (udmabuf_fd);
+
+  return dma_buf_fd;
+}
+
+static int
+create_sw_sync_fence (int *out_timeline_fd)
+{
+  struct sw_sync_create_fence_data data = { 0 };
+  int timeline_fd;
+
+  timeline_fd = open ("/sys/kernel/debug/sync/sw_sync", O_RDWR | O_CLOEXEC);
+  if (timeline_fd < 0)
+    return -1;
+
+  data.value = 1;
+  strcpy (data.name, "delayed-fence");
+  if (ioctl (timeline_fd, SW_SYNC_IOC_CREATE_FENCE, &data) < 0)
+    {
+      close (timeline_fd);
+      return -1;
+    }
+
+  *out_timeline_fd = timeline_fd;
+  return data.fence;
+}
+
+static gboolean
+attach_write_fence (int dma_buf_fd,
+                    int fence_fd)
+{
+#ifdef DMA_BUF_IOCTL_IMPORT_SYNC_FILE
+  struct dma_buf_import_sync_file import = { 0 };
+
+  import.flags = DMA_BUF_SYNC_WRITE;
+  import.fd = fence_fd;
+
+  return ioctl (dma_buf_fd, DMA_BUF_IOCTL_IMPORT_SYNC_FILE, &import) == 0;
+#else
+  errno = ENOTTY;
+  return FALSE;
+#endif
+}
+
+static void
+handle_params_created (void                              *data,
+                       struct zwp_linux_buffer_params_v1 *params,
+                       struct wl_buffer                  *buffer)
+{
+  dma_buf_buffer = buffer;
+}
+
+static void
+handle_params_failed (void                              *data,
+                      struct zwp_linux_buffer_params_v1 *params)
+{
+  buffer_failed = TRUE;
+}
+
+static const struct zwp_linux_buffer_params_v1_listener params_listener = {
+  handle_params_created,
+  handle_params_failed,
+};
+
+static void
+frame_callback_handle_done (void               *data,
+                            struct wl_callback *callback,
+                            uint32_t            time)
+{
+  wl_callback_destroy (callback);
+  frame_callback_done = TRUE;
+}
+
+static const struct wl_callback_listener frame_listener = {
+  frame_callback_handle_done,
+};
+
+static void
+handle_xdg_toplevel_configure (void                *data,
+                               struct xdg_toplevel *xdg_toplevel,
+                               int32_t              width,
+                               int32_t              height,
+                               struct wl_array     *state)
+{
+}
+
+static void
+handle_xdg_toplevel_close (void                *data,
+                           struct xdg_toplevel *xdg_toplevel)
+{
+  g_assert_not_reached ();
+}
+
+static const struct xdg_toplevel_listener xdg_toplevel_listener = {
+  handle_xdg_toplevel_configure,
+  handle_xdg_toplevel_close,
+};
+
+static void
+handle_xdg_surface_configure (void               *data,
+                              struct xdg_surface *xdg_surface,
+                              uint32_t            serial)
+{
+  xdg_surface_ack_configure (xdg_surface, serial);
+  waiting_for_configure = FALSE;
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+  handle_xdg_surface_configure,
+};
+
+static void
+handle_xdg_wm_base_ping (void               *data,
+                         struct xdg_wm_base *xdg_wm_base,
+                         uint32_t            serial)
+{
+  xdg_wm_base_pong (xdg_wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener xdg_wm_base_listener = {
+  handle_xdg_wm_base_ping,
+};
+
+static void
+handle_registry_global (void               *data,
+                        struct wl_registry *registry,
+                        uint32_t            id,
+                        const char         *interface,
+                        uint32_t            version)
+{
+  if (strcmp (interface, "wl_compositor") == 0)
+    {
+      compositor = wl_registry_bind (registry, id, &wl_compositor_interface, 1);
+    }
+  else if (strcmp (interface, "xdg_wm_base") == 0)
+    {
+      xdg_wm_base = wl_registry_bind (registry, id,
+                                      &xdg_wm_base_interface, 1);
+      xdg_wm_base_add_listener (xdg_wm_base, &xdg_wm_base_listener, NULL);
+    }
+  else if (strcmp (interface, "zwp_linux_dmabuf_v1") == 0)
+    {
+      linux_dmabuf = wl_registry_bind (registry, id,
+                                       &zwp_linux_dmabuf_v1_interface,
+                                       MIN (version, 3));
+    }
+}
+
+static void
+handle_registry_global_remove (void               *data,
+                               struct wl_registry *registry,
+                               uint32_t            name)
+{
+}
+
+static const struct wl_registry_listener registry_listener = {
+  handle_registry_global,
+  handle_registry_global_remove
+};
+
+static struct wl_buffer *
+create_dma_buf_buffer (int dma_buf_fd)
+{
+  struct zwp_linux_buffer_params_v1 *params;
+
+  params = zwp_linux_dmabuf_v1_create_params (linux_dmabuf);
+  zwp_linux_buffer_params_v1_add_listener (params, &params_listener, NULL);
+  zwp_linux_buffer_params_v1_add (params, dma_buf_fd, 0, 0, WIDTH * 4,
+                                  DRM_FORMAT_MOD_LINEAR >> 32,
+                                  DRM_FORMAT_MOD_LINEAR & 0xffffffff);
+  zwp_linux_buffer_params_v1_create (params, WIDTH, HEIGHT,
+                                     DRM_FORMAT_XRGB8888, 0);
+
+  while (!dma_buf_buffer && !buffer_failed)
+    {
+      if (wl_display_dispatch (display) == -1)
+        g_error ("Lost connection to the compositor");
+    }
+
+  zwp_linux_buffer_params_v1_destroy (params);
+
+  return dma_buf_buffer;
+}
+
+static void
+dispatch_for (int timeout_ms)
+{
+  int64_t end_time_us = g_get_monotonic_time () + timeout_ms * 1000;
+
+  while (!frame_callback_done && g_get_monotonic_time () < end_time_us)
+    {
+      GPollFD poll_fd = {
+        .fd = wl_display_get_fd (display),
+        .events = G_IO_IN,
+      };
+
+      wl_display_flush (display);
+      if (g_poll (&poll_fd, 1,
+                  (end_time_us - g_get_monotonic_time ()) / 1000 + 1) > 0)
+        {
+          if (wl_display_dispatch (display) == -1)
+            g_error ("Lost connection to the compositor");
+        }
+      else
+        {
+          wl_display_dispatch_pending (display);
+        }
+    }
+}
+
+static int
+test_delayed_fence (void)
+{
+  struct wl_callback *callback;
+  struct wl_buffer *buffer;
+  int dma_buf_fd;
+  int fence_fd;
+  int timeline_fd;
+  uint32_t inc = 1;
+
+  display = wl_display_connect (NULL);
+  registry = wl_display_get_registry (display);
+  wl_registry_add_listener (registry, &registry_listener, NULL);
+  wl_display_roundtrip (display);
+
+  g_assert_nonnull (compositor);
+  g_assert_nonnull (xdg_wm_base);
+
+  if (!linux_dmabuf)
+    {
+      fprintf (stderr, "No linux-dmabuf support, skipping\n");
+      return EXIT_SUCCESS;
+    }
+
+  dma_buf_fd = create_udmabuf ();
+  if (dma_buf_fd < 0)
+    {
+      fprintf (stderr, "Can't create udmabuf (%m), skipping\n");
+      return EXIT_SUCCESS;
+    }
+
+  buffer = create_dma_buf_buffer (dma_buf_fd);
+  if (!buffer)
+    {
+      fprintf (stderr, "Compositor can't import udmabuf, skipping\n");
+      close (dma_buf_fd);
+      return EXIT_SUCCESS;
+    }
+
+  fence_fd = create_sw_sync_fence (&timeline_fd);
+  if (fence_fd < 0)
+    {
+      fprintf (stderr, "Can't create sw_sync fence (%m), skipping\n");
+      close (dma_buf_fd);
+      return EXIT_SUCCESS;
+    }
+
+  if (!attach_write_fence (dma_buf_fd, fence_fd))
+    {
+      fprintf (stderr, "Can't attach fence to dma-buf (%m), skipping\n");
+      close (fence_fd);
+      close (timeline_fd);
+      close (dma_buf_fd);
+      return EXIT_SUCCESS;
+    }
+  close (fence_fd);
+
+  surface = wl_compositor_create_surface (compositor);
+  xdg_surface = xdg_wm_base_get_xdg_surface (xdg_wm_base, surface);
+  xdg_surface_add_listener (xdg_surface, &xdg_surface_listener, NULL);
+  xdg_toplevel = xdg_surface_get_toplevel (xdg_surface);
+  xdg_toplevel_add_listener (xdg_toplevel, &xdg_toplevel_listener, NULL);
+  xdg_toplevel_set_title (xdg_toplevel, "dma-buf-delayed-fence");
+
+  waiting_for_configure = TRUE;
+  wl_surface_commit (surface);
+  while (waiting_for_configure)
+    {
+      if (wl_display_dispatch (display) == -1)
+        g_error ("Lost connection to the compositor");
+    }
+
+  callback = wl_surface_frame (surface);
+  wl_callback_add_listener (callback, &frame_listener, NULL);
+  wl_surface_attach (surface, buffer, 0, 0);
+  wl_surface_damage_buffer (surface, 0, 0, WIDTH, HEIGHT);
+  wl_surface_commit (surface);
+
+  /* Nothing may be presented while the client is still "rendering" */
+  dispatch_for (FENCE_DELAY_MS);
+  g_assert_false (frame_callback_done);
+
+  if (ioctl (timeline_fd, SW_SYNC_IOC_INC, &inc) < 0)
+    g_error ("Failed to signal fence: %m");
+
+  while (!frame_callback_done)
+    {
+      if (wl_display_dispatch (display) == -1)
+        g_error ("Lost connection to the compositor");
+    }
+
+  close (timeline_fd);
+  close (dma_buf_fd);
+
+  g_clear_pointer (&xdg_toplevel, xdg_toplevel_destroy);
+  g_clear_pointer (&xdg_surface, xdg_surface_destroy);
+  g_clear_pointer (&surface, wl_surface_destroy);
+  g_clear_pointer (&dma_buf_buffer, wl_buffer_destroy);
+  g_clear_pointer (&xdg_wm_base, xdg_wm_base_destroy);
+  g_clear_pointer (&linux_dmabuf, zwp_linux_dmabuf_v1_destroy);
+  g_clear_pointer (&compositor, wl_compositor_destroy);
+  g_clear_pointer (&registry, wl_registry_destroy);
+  g_clear_pointer (&display, wl_display_disconnect);
+
+  return EXIT_SUCCESS;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  return test_delayed_fence ();
+}
@@ -0,0 +1,399 @@
+/*
+ * Copyright (C) 2022 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Continuously requests frame callbacks, first while visible, then while the
+ * compositor keeps the window minimized, and finally while the window is
+ * covered by an opaque fullscreen window, and counts how many are delivered
+ * in each case.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wayland-client.h>
+
+#include "wayland-test-client-utils.h"
+
+#include "test-driver-client-protocol.h"
+#include "xdg-shell-client-protocol.h"
+
+#define WIDTH 100
+#define HEIGHT 100
+
+#define N_VISIBLE_FRAMES 10
+#define HIDDEN_DURATION_MS 3000
+#define MAX_HIDDEN_FRAMES 5
+
+static struct wl_display *display;
+static struct wl_registry *registry;
+static struct wl_compositor *compositor;
+static struct xdg_wm_base *xdg_wm_base;
+static struct wl_shm *shm;
+static struct test_driver *test_driver;
+
+static struct wl_surface *surface;
+static struct xdg_surface *xdg_surface;
+static struct xdg_toplevel *xdg_toplevel;
+
+static struct wl_surface *cover_surface;
+static struct xdg_surface *cover_xdg_surface;
+static struct xdg_toplevel *cover_xdg_toplevel;
+static int cover_width;
+static int cover_height;
+
+static gboolean waiting_for_configure;
+static gboolean waiting_for_cover_configure;
+static int n_frame_callbacks;
+static int last_sync_event = -1;
+
+static void
+handle_buffer_release (void             *data,
+                       struct wl_buffer *buffer)
+{
+  wl_buffer_destroy (buffer);
+}
+
+static const struct wl_buffer_listener buffer_listener = {
+  handle_buffer_release
+};
+
+static void
+draw (struct wl_surface *target,
+      int                width,
+      int                height)
+{
+  struct wl_shm_pool *pool;
+  struct wl_buffer *buffer;
+  uint32_t *pixels;
+  int stride = width * 4;
+  int size = stride * height;
+  int fd;
+  int i;
+
+  fd = create_anonymous_file (size);
+  if (fd < 0)
+    g_error ("Creating a buffer file for %d B failed: %m", size);
+
+  pixels = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (pixels == MAP_FAILED)
+    g_error ("mmap failed: %m");
+
+  for (i = 0; i < width * height; i++)
+    pixels[i] = 0xff00ff00;
+  munmap (pixels, size);
+
+  pool = wl_shm_create_pool (shm, fd, size);
+  buffer = wl_shm_pool_create_buffer (pool, 0,
+                                      width, height,
+                                      stride,
+                                      WL_SHM_FORMAT_XRGB8888);
+  wl_buffer_add_listener (buffer, &buffer_listener, buffer);
+  wl_shm_pool_destroy (pool);
+  close (fd);
+
+  wl_surface_attach (target, buffer, 0, 0);
+  wl_surface_damage_buffer (target, 0, 0, width, height);
+}
+
+static void request_frame (void);
+
+static void
+handle_frame_callback (void               *data,
+                       struct wl_callback *callback,
+                       uint32_t            time)
+{
+  wl_callback_destroy (callback);
+  n_frame_callbacks++;
+
+  request_frame ();
+}
+
+static const struct wl_callback_listener frame_listener = {
+  handle_frame_callback,
+};
+
+static void
+request_frame (void)
+{
+  struct wl_callback *callback;
+
+  callback = wl_surface_frame (surface);
+  wl_callback_add_listener (callback, &frame_listener, NULL);
+  wl_surface_commit (surface);
+}
+
+static void
+handle_xdg_toplevel_configure (void                *data,
+                               struct xdg_toplevel *xdg_toplevel,
+                               int32_t              width,
+                               int32_t              height,
+                               struct wl_array     *state)
+{
+}
+
+static void
+handle_xdg_toplevel_close (void                *data,
+                           struct xdg_toplevel *xdg_toplevel)
+{
+  g_assert_not_reached ();
+}
+
+static const struct xdg_toplevel_listener xdg_toplevel_listener = {
+  handle_xdg_toplevel_configure,
+  handle_xdg_toplevel_close,
+};
+
+static void
+handle_xdg_surface_configure (void               *data,
+                              struct xdg_surface *xdg_surface,
+                              uint32_t            serial)
+{
+  xdg_surface_ack_configure (xdg_surface, serial);
+  waiting_for_configure = FALSE;
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+  handle_xdg_surface_configure,
+};
+
+static void
+handle_cover_xdg_toplevel_configure (void                *data,
+                                     struct xdg_toplevel *xdg_toplevel,
+                                     int32_t              width,
+                                     int32_t              height,
+                                     struct wl_array     *state)
+{
+  cover_width = width;
+  cover_height = height;
+}
+
+static const struct xdg_toplevel_listener cover_xdg_toplevel_listener = {
+  handle_cover_xdg_toplevel_configure,
+  handle_xdg_toplevel_close,
+};
+
+static void
+handle_cover_xdg_surface_configure (void               *data,
+                                    struct xdg_surface *xdg_surface,
+                                    uint32_t            serial)
+{
+  xdg_surface_ack_configure (xdg_surface, serial);
+  waiting_for_cover_configure = FALSE;
+}
+
+static const struct xdg_surface_listener cover_xdg_surface_listener = {
+  handle_cover_xdg_surface_configure,
+};
+
+static void
+handle_xdg_wm_base_ping (void               *data,
+                         struct xdg_wm_base *xdg_wm_base,
+                         uint32_t            serial)
+{
+  xdg_wm_base_pong (xdg_wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener xdg_wm_base_listener = {
+  handle_xdg_wm_base_ping,
+};
+
+static void
+test_driver_handle_sync_event (void               *data,
+                               struct test_driver *test_driver,
+                               uint32_t            serial)
+{
+  last_sync_event = serial;
+}
+
+static const struct test_driver_listener test_driver_listener = {
+  test_driver_handle_sync_event,
+};
+
+static void
+handle_registry_global (void               *data,
+                        struct wl_registry *registry,
+                        uint32_t            id,
+                        const char         *interface,
+                        uint32_t            version)
+{
+  if (strcmp (interface, "wl_compositor") == 0)
+    {
+      compositor = wl_registry_bind (registry, id, &wl_compositor_interface, 1);
+    }
+  else if (strcmp (interface, "xdg_wm_base") == 0)
+    {
+      xdg_wm_base = wl_registry_bind (registry, id,
+                                      &xdg_wm_base_interface, 1);
+      xdg_wm_base_add_listener (xdg_wm_base, &xdg_wm_base_listener, NULL);
+    }
+  else if (strcmp (interface, "wl_shm") == 0)
+    {
+      shm = wl_registry_bind (registry,
+                              id, &wl_shm_interface, 1);
+    }
+  else if (strcmp (interface, "test_driver") == 0)
+    {
+      test_driver = wl_registry_bind (registry, id, &test_driver_interface, 1);
+      test_driver_add_listener (test_driver, &test_driver_listener, NULL);
+    }
+}
+
+static void
+handle_registry_global_remove (void               *data,
+                               struct wl_registry *registry,
+                               uint32_t            name)
+{
+}
+
+static const struct wl_registry_listener registry_listener = {
+  handle_registry_global,
+  handle_registry_global_remove
+};
+
+static void
+dispatch (void)
+{
+  if (wl_display_dispatch (display) == -1)
+    g_error ("Lost connection to the compositor");
+}
+
+static void
+dispatch_for (int timeout_ms)
+{
+  int64_t end_time_us = g_get_monotonic_time () + timeout_ms * 1000;
+  int64_t now_us;
+
+  while ((now_us = g_get_monotonic_time ()) < end_time_us)
+    {
+      GPollFD poll_fd = {
+        .fd = wl_display_get_fd (display),
+        .events = G_IO_IN,
+      };
+
+      wl_display_flush (display);
+      if (g_poll (&poll_fd, 1, (end_time_us - now_us) / 1000 + 1) > 0)
+        dispatch ();
+    }
+}
+
+static void
+wait_for_sync_event (int sequence)
+{
+  test_driver_sync_point (test_driver, sequence, NULL);
+  while (last_sync_event != sequence)
+    dispatch ();
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  display = wl_display_connect (NULL);
+  registry = wl_display_get_registry (display);
+  wl_registry_add_listener (registry, &registry_listener, NULL);
+  wl_display_roundtrip (display);
+
+  g_assert_nonnull (compositor);
+  g_assert_nonnull (xdg_wm_base);
+  g_assert_nonnull (shm);
+  g_assert_nonnull (test_driver);
+
+  surface = wl_compositor_create_surface (compositor);
+  xdg_surface = xdg_wm_base_get_xdg_surface (xdg_wm_base, surface);
+  xdg_surface_add_listener (xdg_surface, &xdg_surface_listener, NULL);
+  xdg_toplevel = xdg_surface_get_toplevel (xdg_surface);
+  xdg_toplevel_add_listener (xdg_toplevel, &xdg_toplevel_listener, NULL);
+  xdg_toplevel_set_title (xdg_toplevel, "frame-callbacks-hidden");
+
+  waiting_for_configure = TRUE;
+  wl_surface_commit (surface);
+  while (waiting_for_configure)
+    dispatch ();
+
+  draw (surface, WIDTH, HEIGHT);
+  request_frame ();
+
+  while (n_frame_callbacks < N_VISIBLE_FRAMES)
+    dispatch ();
+
+  /* The compositor hides the window before answering */
+  wait_for_sync_event (0);
+
+  n_frame_callbacks = 0;
+  dispatch_for (HIDDEN_DURATION_MS);
+
+  fprintf (stderr, "Got %d frame callbacks in %d ms while hidden\n",
+           n_frame_callbacks, HIDDEN_DURATION_MS);
+  g_assert_cmpint (n_frame_callbacks, >, 0);
+  g_assert_cmpint (n_frame_callbacks, <=, MAX_HIDDEN_FRAMES);
+
+  /* The compositor shows the window again before answering */
+  wait_for_sync_event (1);
+
+  /* Cover the window with an opaque fullscreen one */
+  cover_surface = wl_compositor_create_surface (compositor);
+  cover_xdg_surface = xdg_wm_base_get_xdg_surface (xdg_wm_base, cover_surface);
+  xdg_surface_add_listener (cover_xdg_surface, &cover_xdg_surface_listener,
+                            NULL);
+  cover_xdg_toplevel = xdg_surface_get_toplevel (cover_xdg_surface);
+  xdg_toplevel_add_listener (cover_xdg_toplevel, &cover_xdg_toplevel_listener,
+                             NULL);
+  xdg_toplevel_set_title (cover_xdg_toplevel, "frame-callbacks-hidden-cover");
+  xdg_toplevel_set_fullscreen (cover_xdg_toplevel, NULL);
+
+  waiting_for_cover_configure = TRUE;
+  wl_surface_commit (cover_surface);
+  while (waiting_for_cover_configure || cover_width == 0 || cover_height == 0)
+    dispatch ();
+
+  draw (cover_surface, cover_width, cover_height);
+  wl_surface_commit (cover_surface);
+
+  /* The compositor waits for the window to be obscured before answering */
+  wait_for_sync_event (2);
+
+  n_frame_callbacks = 0;
+  dispatch_for (HIDDEN_DURATION_MS);
+
+  fprintf (stderr, "Got %d frame callbacks in %d ms while obscured\n",
+           n_frame_callbacks, HIDDEN_DURATION_MS);
+  g_assert_cmpint (n_frame_callbacks, >, 0);
+  g_assert_cmpint (n_frame_callbacks, <=, MAX_HIDDEN_FRAMES);
+
+  wait_for_sync_event (3);
+
+  g_clear_pointer (&cover_xdg_toplevel, xdg_toplevel_destroy);
+  g_clear_pointer (&cover_xdg_surface, xdg_surface_destroy);
+  g_clear_pointer (&cover_surface, wl_surface_destroy);
+
+  g_clear_pointer (&xdg_toplevel, xdg_toplevel_destroy);
+  g_clear_pointer (&xdg_surface, xdg_surface_destroy);
+  g_clear_pointer (&surface, wl_surface_destroy);
+  g_clear_pointer (&test_driver, test_driver_destroy);
+  g_clear_pointer (&xdg_wm_base, xdg_wm_base_destroy);
+  g_clear_pointer (&shm, wl_shm_destroy);
+  g_clear_pointer (&compositor, wl_compositor_destroy);
+  g_clear_pointer (&registry, wl_registry_destroy);
+  g_clear_pointer (&display, wl_display_disconnect);
+
+  return EXIT_SUCCESS;
+}
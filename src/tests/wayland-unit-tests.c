@@ -635,6 +635,62 @@ toplevel_bounds_monitors (void)
   meta_wayland_test_client_finish (wayland_test_client);
 }
 
+static void
+dma_buf_delayed_fence (void)
+{
+  MetaWaylandTestClient *wayland_test_client;
+
+  wayland_test_client =
+    meta_wayland_test_client_new ("dma-buf-delayed-fence");
+  meta_wayland_test_client_finish (wayland_test_client);
+}
+
+static void
+frame_callbacks_hidden (void)
+{
+  MetaWaylandTestClient *wayland_test_client;
+  MetaWindowActor *window_actor;
+  MetaSurfaceActor *surface_actor;
+  MetaWindow *window;
+
+  wayland_test_client =
+    meta_wayland_test_client_new ("frame-callbacks-hidden");
+
+  wait_for_sync_point (0);
+
+  window = find_client_window ("frame-callbacks-hidden");
+  g_assert_nonnull (window);
+  window_actor = meta_window_actor_from_window (window);
+
+  meta_window_minimize (window);
+  while (clutter_actor_is_mapped (CLUTTER_ACTOR (window_actor)))
+    g_main_context_iteration (NULL, TRUE);
+
+  meta_wayland_test_driver_emit_sync_event (test_driver, 0);
+
+  wait_for_sync_point (1);
+
+  meta_window_unminimize (window);
+  while (!clutter_actor_is_mapped (CLUTTER_ACTOR (window_actor)))
+    g_main_context_iteration (NULL, TRUE);
+
+  meta_wayland_test_driver_emit_sync_event (test_driver, 1);
+
+  /* The client covers the window with an opaque fullscreen one */
+  wait_for_sync_point (2);
+
+  surface_actor = meta_window_actor_get_surface (window_actor);
+  while (!meta_surface_actor_is_obscured (surface_actor))
+    g_main_context_iteration (NULL, TRUE);
+
+  meta_wayland_test_driver_emit_sync_event (test_driver, 2);
+
+  wait_for_sync_point (3);
+  meta_wayland_test_driver_emit_sync_event (test_driver, 3);
+
+  meta_wayland_test_client_finish (wayland_test_client);
+}
+
 static void
 on_before_tests (void)
 {
@@ -674,6 +730,10 @@ init_tests (void)
                    toplevel_bounds_struts);
   g_test_add_func ("/wayland/toplevel/bounds/monitors",
                    toplevel_bounds_monitors);
+  g_test_add_func ("/wayland/dma-buf/delayed-fence",
+                   dma_buf_delayed_fence);
+  g_test_add_func ("/wayland/frame-callbacks/hidden",
+                   frame_callbacks_hidden);
 }
 
 int
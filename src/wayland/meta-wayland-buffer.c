@@ -763,6 +763,26 @@ meta_wayland_buffer_try_acquire_scanout (MetaWaylandBuffer *buffer,
   return NULL;
 }
 
+CoglScanout *
+meta_wayland_buffer_try_acquire_overlay (MetaWaylandBuffer   *buffer,
+                                         CoglOnscreen        *onscreen,
+                                         const MetaRectangle *dst_rect)
+{
+  MetaWaylandDmaBufBuffer *dma_buf;
+
+  COGL_TRACE_BEGIN_SCOPED (MetaWaylandBufferTryOverlay,
+                           "WaylandBuffer (try overlay)");
+
+  if (buffer->type != META_WAYLAND_BUFFER_TYPE_DMA_BUF)
+    return NULL;
+
+  dma_buf = meta_wayland_dma_buf_from_buffer (buffer);
+  if (!dma_buf)
+    return NULL;
+
+  return meta_wayland_dma_buf_try_acquire_overlay (dma_buf, onscreen, dst_rect);
+}
+
 static void
 meta_wayland_buffer_finalize (GObject *object)
 {
@@ -90,6 +90,9 @@ void                    meta_wayland_buffer_process_damage      (MetaWaylandBuff
                                                                  cairo_region_t        *region);
 CoglScanout *           meta_wayland_buffer_try_acquire_scanout (MetaWaylandBuffer     *buffer,
                                                                  CoglOnscreen          *onscreen);
+CoglScanout *           meta_wayland_buffer_try_acquire_overlay (MetaWaylandBuffer     *buffer,
+                                                                 CoglOnscreen          *onscreen,
+                                                                 const MetaRectangle   *dst_rect);
 
 void meta_wayland_init_shm (MetaWaylandCompositor *compositor);
 
@@ -40,6 +40,10 @@
 #include "wayland/meta-wayland-dma-buf.h"
 
 #include <drm_fourcc.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/dma-buf.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -543,11 +547,10 @@ import_scanout_gbm_bo (MetaWaylandDmaBufBuffer  *dma_buf,
 }
 #endif
 
-CoglScanout *
-meta_wayland_dma_buf_try_acquire_scanout (MetaWaylandDmaBufBuffer *dma_buf,
-                                          CoglOnscreen            *onscreen)
-{
 #ifdef HAVE_NATIVE_BACKEND
+static MetaDrmBufferGbm *
+import_scanout_buffer (MetaWaylandDmaBufBuffer *dma_buf)
+{
   MetaBackend *backend = meta_get_backend ();
   MetaRenderer *renderer = meta_backend_get_renderer (backend);
   MetaRendererNative *renderer_native = META_RENDERER_NATIVE (renderer);
@@ -558,7 +561,7 @@ meta_wayland_dma_buf_try_acquire_scanout (MetaWaylandDmaBufBuffer *dma_buf,
   gboolean use_modifier;
   g_autoptr (GError) error = NULL;
   MetaDrmBufferFlags flags;
-  g_autoptr (MetaDrmBufferGbm) fb = NULL;
+  MetaDrmBufferGbm *fb;
 
   for (n_planes = 0; n_planes < META_WAYLAND_DMA_BUF_MAX_FDS; n_planes++)
     {
@@ -590,6 +593,21 @@ meta_wayland_dma_buf_try_acquire_scanout (MetaWaylandDmaBufBuffer *dma_buf,
       return NULL;
     }
 
+  return fb;
+}
+#endif
+
+CoglScanout *
+meta_wayland_dma_buf_try_acquire_scanout (MetaWaylandDmaBufBuffer *dma_buf,
+                                          CoglOnscreen            *onscreen)
+{
+#ifdef HAVE_NATIVE_BACKEND
+  g_autoptr (MetaDrmBufferGbm) fb = NULL;
+
+  fb = import_scanout_buffer (dma_buf);
+  if (!fb)
+    return NULL;
+
   if (!meta_onscreen_native_is_buffer_scanout_compatible (onscreen,
                                                           META_DRM_BUFFER (fb)))
     return NULL;
@@ -600,6 +618,29 @@ meta_wayland_dma_buf_try_acquire_scanout (MetaWaylandDmaBufBuffer *dma_buf,
 #endif
 }
 
+CoglScanout *
+meta_wayland_dma_buf_try_acquire_overlay (MetaWaylandDmaBufBuffer *dma_buf,
+                                          CoglOnscreen            *onscreen,
+                                          const MetaRectangle     *dst_rect)
+{
+#ifdef HAVE_NATIVE_BACKEND
+  g_autoptr (MetaDrmBufferGbm) fb = NULL;
+
+  fb = import_scanout_buffer (dma_buf);
+  if (!fb)
+    return NULL;
+
+  if (!meta_onscreen_native_try_assign_overlay (onscreen,
+                                                COGL_SCANOUT (fb),
+                                                dst_rect))
+    return NULL;
+
+  return COGL_SCANOUT (g_steal_pointer (&fb));
+#else
+  return NULL;
+#endif
+}
+
 static void
 buffer_params_add (struct wl_client   *client,
                    struct wl_resource *resource,
@@ -714,6 +755,181 @@ meta_wayland_dma_buf_from_buffer (MetaWaylandBuffer *buffer)
   return NULL;
 }
 
+typedef struct _MetaWaylandDmaBufSource
+{
+  GSource base;
+
+  MetaWaylandBuffer *buffer;
+  MetaWaylandDmaBufSourceDispatch dispatch;
+  gpointer user_data;
+
+  int fence_fds[META_WAYLAND_DMA_BUF_MAX_FDS];
+  gpointer fd_tags[META_WAYLAND_DMA_BUF_MAX_FDS];
+} MetaWaylandDmaBufSource;
+
+static gboolean
+is_fd_readable (int fd)
+{
+  GPollFD poll_fd;
+
+  poll_fd.fd = fd;
+  poll_fd.events = G_IO_IN;
+  poll_fd.revents = 0;
+
+  if (!g_poll (&poll_fd, 1, 0))
+    return FALSE;
+
+  return (poll_fd.revents & (G_IO_IN | G_IO_NVAL)) != 0;
+}
+
+static gboolean
+meta_wayland_dma_buf_source_dispatch (GSource     *base,
+                                      GSourceFunc  callback,
+                                      gpointer     user_data)
+{
+  MetaWaylandDmaBufSource *source = (MetaWaylandDmaBufSource *) base;
+  gboolean ready = TRUE;
+  int i;
+
+  for (i = 0; i < META_WAYLAND_DMA_BUF_MAX_FDS; i++)
+    {
+      if (!source->fd_tags[i])
+        continue;
+
+      if (!is_fd_readable (source->fence_fds[i]))
+        {
+          ready = FALSE;
+          continue;
+        }
+
+      g_source_remove_unix_fd (&source->base, source->fd_tags[i]);
+      source->fd_tags[i] = NULL;
+    }
+
+  if (!ready)
+    return G_SOURCE_CONTINUE;
+
+  source->dispatch (source->buffer, source->user_data);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+meta_wayland_dma_buf_source_finalize (GSource *base)
+{
+  MetaWaylandDmaBufSource *source = (MetaWaylandDmaBufSource *) base;
+  int i;
+
+  for (i = 0; i < META_WAYLAND_DMA_BUF_MAX_FDS; i++)
+    {
+      if (source->fence_fds[i] != -1)
+        close (source->fence_fds[i]);
+    }
+
+  g_clear_object (&source->buffer);
+}
+
+static GSourceFuncs meta_wayland_dma_buf_source_funcs = {
+  .dispatch = meta_wayland_dma_buf_source_dispatch,
+  .finalize = meta_wayland_dma_buf_source_finalize,
+};
+
+/*
+ * Returns a new fd that becomes readable once all writes to the dma-buf that
+ * were queued so far have finished. A sync_file exported from the dma-buf is
+ * preferred, as it doesn't pick up fences attached after the commit, e.g. by
+ * our own rendering; older kernels only allow polling the dma-buf itself.
+ */
+static int
+get_write_fence_fd (int dma_buf_fd)
+{
+#ifdef DMA_BUF_IOCTL_EXPORT_SYNC_FILE
+  struct dma_buf_export_sync_file export_sync_file = {
+    .flags = DMA_BUF_SYNC_READ,
+    .fd = -1,
+  };
+
+  if (ioctl (dma_buf_fd, DMA_BUF_IOCTL_EXPORT_SYNC_FILE,
+             &export_sync_file) == 0)
+    return export_sync_file.fd;
+
+  if (errno != ENOTTY)
+    {
+      meta_topic (META_DEBUG_WAYLAND,
+                  "Failed to export dma-buf sync_file: %s",
+                  g_strerror (errno));
+    }
+#endif
+
+  return fcntl (dma_buf_fd, F_DUPFD_CLOEXEC, 0);
+}
+
+/*
+ * Creates a source that calls @dispatch once the client's rendering into
+ * @buffer has finished, or returns %NULL if it already has, or if @buffer
+ * isn't a dma-buf.
+ */
+GSource *
+meta_wayland_dma_buf_create_source (MetaWaylandBuffer               *buffer,
+                                    MetaWaylandDmaBufSourceDispatch  dispatch,
+                                    gpointer                         user_data)
+{
+  MetaWaylandDmaBufBuffer *dma_buf;
+  MetaWaylandDmaBufSource *source = NULL;
+  int i;
+
+  dma_buf = meta_wayland_dma_buf_from_buffer (buffer);
+  if (!dma_buf)
+    return NULL;
+
+  for (i = 0; i < META_WAYLAND_DMA_BUF_MAX_FDS; i++)
+    {
+      int fence_fd;
+
+      if (dma_buf->fds[i] < 0)
+        break;
+
+      fence_fd = get_write_fence_fd (dma_buf->fds[i]);
+      if (fence_fd < 0)
+        {
+          meta_topic (META_DEBUG_WAYLAND,
+                      "Failed to get dma-buf fence: %s", g_strerror (errno));
+          continue;
+        }
+
+      if (is_fd_readable (fence_fd))
+        {
+          close (fence_fd);
+          continue;
+        }
+
+      if (!source)
+        {
+          int j;
+
+          source = (MetaWaylandDmaBufSource *)
+            g_source_new (&meta_wayland_dma_buf_source_funcs,
+                          sizeof (MetaWaylandDmaBufSource));
+          g_source_set_name (&source->base, "[mutter] DMA-BUF fence");
+          source->buffer = g_object_ref (buffer);
+          source->dispatch = dispatch;
+          source->user_data = user_data;
+
+          for (j = 0; j < META_WAYLAND_DMA_BUF_MAX_FDS; j++)
+            source->fence_fds[j] = -1;
+        }
+
+      source->fence_fds[i] = fence_fd;
+      source->fd_tags[i] = g_source_add_unix_fd (&source->base,
+                                                 fence_fd, G_IO_IN);
+    }
+
+  if (!source)
+    return NULL;
+
+  return &source->base;
+}
+
 static void
 buffer_params_create_common (struct wl_client   *client,
                              struct wl_resource *params_resource,
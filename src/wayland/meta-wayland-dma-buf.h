@@ -31,6 +31,7 @@
 #include <glib-object.h>
 
 #include "cogl/cogl.h"
+#include "meta/boxes.h"
 #include "wayland/meta-wayland-types.h"
 
 #define META_TYPE_WAYLAND_DMA_BUF_BUFFER (meta_wayland_dma_buf_buffer_get_type ())
@@ -43,6 +44,9 @@ G_DECLARE_FINAL_TYPE (MetaWaylandDmaBufManager, meta_wayland_dma_buf_manager,
 
 typedef struct _MetaWaylandDmaBufBuffer MetaWaylandDmaBufBuffer;
 
+typedef void (* MetaWaylandDmaBufSourceDispatch) (MetaWaylandBuffer *buffer,
+                                                  gpointer           user_data);
+
 MetaWaylandDmaBufManager * meta_wayland_dma_buf_manager_new (MetaWaylandCompositor  *compositor,
                                                              GError                **error);
 
@@ -54,8 +58,18 @@ meta_wayland_dma_buf_buffer_attach (MetaWaylandBuffer  *buffer,
 MetaWaylandDmaBufBuffer *
 meta_wayland_dma_buf_from_buffer (MetaWaylandBuffer *buffer);
 
+GSource *
+meta_wayland_dma_buf_create_source (MetaWaylandBuffer               *buffer,
+                                    MetaWaylandDmaBufSourceDispatch  dispatch,
+                                    gpointer                         user_data);
+
 CoglScanout *
 meta_wayland_dma_buf_try_acquire_scanout (MetaWaylandDmaBufBuffer *dma_buf,
                                           CoglOnscreen            *onscreen);
 
+CoglScanout *
+meta_wayland_dma_buf_try_acquire_overlay (MetaWaylandDmaBufBuffer *dma_buf,
+                                          CoglOnscreen            *onscreen,
+                                          const MetaRectangle     *dst_rect);
+
 #endif /* META_WAYLAND_DMA_BUF_H */
@@ -323,30 +323,20 @@ meta_wayland_pointer_broadcast_frame (MetaWaylandPointer *pointer)
     }
 }
 
-void
-meta_wayland_pointer_send_relative_motion (MetaWaylandPointer *pointer,
-                                           const ClutterEvent *event)
+static void
+send_relative_motion (MetaWaylandPointer *pointer,
+                      uint64_t            time_us,
+                      double              dx,
+                      double              dy,
+                      double              dx_unaccel,
+                      double              dy_unaccel)
 {
   struct wl_resource *resource;
-  double dx, dy;
-  double dx_unaccel, dy_unaccel;
-  uint64_t time_us;
   uint32_t time_us_hi;
   uint32_t time_us_lo;
   wl_fixed_t dxf, dyf;
   wl_fixed_t dx_unaccelf, dy_unaccelf;
 
-  if (!pointer->focus_client)
-    return;
-
-  if (!clutter_event_get_relative_motion (event,
-                                          &dx, &dy,
-                                          &dx_unaccel, &dy_unaccel))
-    return;
-
-  time_us = clutter_event_get_time_us (event);
-  if (time_us == 0)
-    time_us = clutter_event_get_time (event) * 1000ULL;
   time_us_hi = (uint32_t) (time_us >> 32);
   time_us_lo = (uint32_t) time_us;
   dxf = wl_fixed_from_double (dx);
@@ -367,6 +357,53 @@ meta_wayland_pointer_send_relative_motion (MetaWaylandPointer *pointer,
     }
 }
 
+void
+meta_wayland_pointer_send_relative_motion (MetaWaylandPointer *pointer,
+                                           const ClutterEvent *event)
+{
+  const ClutterMotionHistoryEntry *history;
+  size_t n_history_entries;
+  double dx, dy;
+  double dx_unaccel, dy_unaccel;
+  uint64_t time_us;
+
+  if (!pointer->focus_client)
+    return;
+
+  if (!clutter_event_get_relative_motion (event,
+                                          &dx, &dy,
+                                          &dx_unaccel, &dy_unaccel))
+    return;
+
+  /* Relative pointer clients get every sample that was compressed into the
+   * event, with its own timestamp. */
+  history = clutter_event_get_motion_history (event, &n_history_entries);
+  if (history)
+    {
+      size_t i;
+
+      for (i = 0; i < n_history_entries; i++)
+        {
+          if (!history[i].has_relative_motion)
+            continue;
+
+          send_relative_motion (pointer,
+                                history[i].time_us,
+                                history[i].dx,
+                                history[i].dy,
+                                history[i].dx_unaccel,
+                                history[i].dy_unaccel);
+        }
+      return;
+    }
+
+  time_us = clutter_event_get_time_us (event);
+  if (time_us == 0)
+    time_us = clutter_event_get_time (event) * 1000ULL;
+
+  send_relative_motion (pointer, time_us, dx, dy, dx_unaccel, dy_unaccel);
+}
+
 void
 meta_wayland_pointer_send_motion (MetaWaylandPointer *pointer,
                                   const ClutterEvent *event)
@@ -86,7 +86,16 @@ struct _MetaWaylandCompositor
   GSource *source;
 
   GHashTable *outputs;
-  GList *frame_callback_surfaces;
+
+  struct {
+    /* Surfaces not yet sorted into a stage view queue. */
+    GQueue unsorted_surfaces;
+    /* ClutterStageView -> GQueue of surfaces */
+    GHashTable *view_surfaces;
+    /* Surfaces not visible on any stage view, emitted at a low rate. */
+    GQueue hidden_surfaces;
+    guint hidden_timeout_id;
+  } frame_callbacks;
 
   MetaXWaylandManager xwayland_manager;
 
@@ -39,6 +39,7 @@
 #include "wayland/meta-wayland-actor-surface.h"
 #include "wayland/meta-wayland-buffer.h"
 #include "wayland/meta-wayland-data-device.h"
+#include "wayland/meta-wayland-dma-buf.h"
 #include "wayland/meta-wayland-gtk-shell.h"
 #include "wayland/meta-wayland-keyboard.h"
 #include "wayland/meta-wayland-legacy-xdg-shell.h"
@@ -76,6 +77,13 @@ typedef struct _MetaWaylandSurfaceRolePrivate
   MetaWaylandSurface *surface;
 } MetaWaylandSurfaceRolePrivate;
 
+typedef struct _MetaWaylandPendingCommit
+{
+  MetaWaylandSurface *surface;
+  MetaWaylandSurfaceState *state;
+  GSource *fence_source;
+} MetaWaylandPendingCommit;
+
 enum
 {
   PROP_0,
@@ -975,17 +983,129 @@ ensure_cached_state (MetaWaylandSurface *surface)
                                           NULL);
 }
 
+MetaWaylandSurfaceState *
+meta_wayland_surface_get_pending_state (MetaWaylandSurface *surface)
+{
+  return surface->pending_state;
+}
+
+static void
+pending_commit_free (MetaWaylandPendingCommit *commit)
+{
+  if (commit->fence_source)
+    {
+      g_source_destroy (commit->fence_source);
+      g_source_unref (commit->fence_source);
+    }
+
+  g_clear_object (&commit->state);
+  g_free (commit);
+}
+
+static void
+apply_ready_commits (MetaWaylandSurface *surface)
+{
+  MetaWaylandPendingCommit *commit;
+
+  while ((commit = g_queue_peek_head (&surface->pending_commits)) &&
+         !commit->fence_source)
+    {
+      g_queue_pop_head (&surface->pending_commits);
+      meta_wayland_surface_apply_state (surface, commit->state);
+      pending_commit_free (commit);
+    }
+}
+
+static void
+on_commit_fence_signalled (MetaWaylandBuffer *buffer,
+                           gpointer           user_data)
+{
+  MetaWaylandPendingCommit *commit = user_data;
+
+  meta_topic (META_DEBUG_WAYLAND,
+              "Buffer %p of surface %p is ready, applying deferred commits",
+              buffer, commit->surface);
+
+  /* The source is destroyed once this returns */
+  g_clear_pointer (&commit->fence_source, g_source_unref);
+
+  apply_ready_commits (commit->surface);
+}
+
+/*
+ * Commits attaching a dma-buf the client is still rendering into are held
+ * back until its rendering has finished, so that painting the next frame
+ * doesn't have to wait for it, and the previous buffer stays on screen
+ * meanwhile. Later commits queue up behind held back ones to keep them in
+ * order.
+ */
+static gboolean
+maybe_defer_commit (MetaWaylandSurface      *surface,
+                    MetaWaylandSurfaceState *pending)
+{
+  MetaWaylandPendingCommit *commit;
+
+  commit = g_new0 (MetaWaylandPendingCommit, 1);
+  commit->surface = surface;
+
+  if (pending->newly_attached && pending->buffer)
+    {
+      commit->fence_source =
+        meta_wayland_dma_buf_create_source (pending->buffer,
+                                            on_commit_fence_signalled,
+                                            commit);
+    }
+
+  if (!commit->fence_source &&
+      g_queue_is_empty (&surface->pending_commits))
+    {
+      g_free (commit);
+      return FALSE;
+    }
+
+  meta_topic (META_DEBUG_WAYLAND,
+              "Deferring commit of surface %p (%s)",
+              surface,
+              commit->fence_source ? "buffer not ready" : "queued");
+
+  commit->state = g_object_new (META_TYPE_WAYLAND_SURFACE_STATE, NULL);
+  meta_wayland_surface_state_merge_into (pending, commit->state);
+
+  if (commit->fence_source)
+    g_source_attach (commit->fence_source, NULL);
+
+  g_queue_push_tail (&surface->pending_commits, commit);
+
+  return TRUE;
+}
+
 void
 meta_wayland_surface_apply_cached_state (MetaWaylandSurface *surface)
 {
   ensure_cached_state (surface);
-  meta_wayland_surface_apply_state (surface, surface->cached_state);
-}
 
-MetaWaylandSurfaceState *
-meta_wayland_surface_get_pending_state (MetaWaylandSurface *surface)
-{
-  return surface->pending_state;
+  /*
+   * Commits made before the surface became synchronized may still be held
+   * back; queue the cached state behind them so it is applied in order.
+   */
+  if (!g_queue_is_empty (&surface->pending_commits))
+    {
+      MetaWaylandPendingCommit *commit;
+
+      meta_topic (META_DEBUG_WAYLAND,
+                  "Deferring cached state of surface %p (queued)",
+                  surface);
+
+      commit = g_new0 (MetaWaylandPendingCommit, 1);
+      commit->surface = surface;
+      commit->state = g_object_new (META_TYPE_WAYLAND_SURFACE_STATE, NULL);
+      meta_wayland_surface_state_merge_into (surface->cached_state,
+                                             commit->state);
+      g_queue_push_tail (&surface->pending_commits, commit);
+      return;
+    }
+
+  meta_wayland_surface_apply_state (surface, surface->cached_state);
 }
 
 static void
@@ -1020,7 +1140,7 @@ meta_wayland_surface_commit (MetaWaylandSurface *surface)
 
       meta_wayland_surface_state_merge_into (pending, surface->cached_state);
     }
-  else
+  else if (!maybe_defer_commit (surface, pending))
     {
       meta_wayland_surface_apply_state (surface, surface->pending_state);
     }
@@ -1453,6 +1573,9 @@ wl_surface_destructor (struct wl_resource *resource)
 
   g_signal_emit (surface, surface_signals[SURFACE_DESTROY], 0);
 
+  g_queue_clear_full (&surface->pending_commits,
+                      (GDestroyNotify) pending_commit_free);
+
   g_clear_object (&surface->scanout_candidate);
   g_clear_object (&surface->role);
 
@@ -1525,6 +1648,8 @@ meta_wayland_surface_create (MetaWaylandCompositor *compositor,
 
   wl_list_init (&surface->unassigned.pending_frame_callback_list);
 
+  surface->frame_callback.link.data = surface;
+
   surface->outputs = g_hash_table_new (NULL, NULL);
   surface->shortcut_inhibited_seats = g_hash_table_new (NULL, NULL);
 
@@ -2147,12 +2272,22 @@ scanout_destroyed (gpointer  data,
   meta_wayland_buffer_ref_unref (buffer_ref);
 }
 
+static void
+hold_buffer_for_scanout (MetaWaylandSurface *surface,
+                         CoglScanout        *scanout)
+{
+  MetaWaylandBufferRef *buffer_ref;
+
+  buffer_ref = meta_wayland_buffer_ref_ref (surface->buffer_ref);
+  meta_wayland_buffer_ref_inc_use_count (buffer_ref);
+  g_object_weak_ref (G_OBJECT (scanout), scanout_destroyed, buffer_ref);
+}
+
 CoglScanout *
 meta_wayland_surface_try_acquire_scanout (MetaWaylandSurface *surface,
                                           CoglOnscreen       *onscreen)
 {
   CoglScanout *scanout;
-  MetaWaylandBufferRef *buffer_ref;
 
   if (!surface->buffer_ref->buffer)
     return NULL;
@@ -2165,9 +2300,31 @@ meta_wayland_surface_try_acquire_scanout (MetaWaylandSurface *surface,
   if (!scanout)
     return NULL;
 
-  buffer_ref = meta_wayland_buffer_ref_ref (surface->buffer_ref);
-  meta_wayland_buffer_ref_inc_use_count (buffer_ref);
-  g_object_weak_ref (G_OBJECT (scanout), scanout_destroyed, buffer_ref);
+  hold_buffer_for_scanout (surface, scanout);
+
+  return scanout;
+}
+
+CoglScanout *
+meta_wayland_surface_try_acquire_overlay (MetaWaylandSurface  *surface,
+                                          CoglOnscreen        *onscreen,
+                                          const MetaRectangle *dst_rect)
+{
+  CoglScanout *scanout;
+
+  if (!surface->buffer_ref->buffer)
+    return NULL;
+
+  if (surface->buffer_ref->use_count == 0)
+    return NULL;
+
+  scanout = meta_wayland_buffer_try_acquire_overlay (surface->buffer_ref->buffer,
+                                                     onscreen,
+                                                     dst_rect);
+  if (!scanout)
+    return NULL;
+
+  hold_buffer_for_scanout (surface, scanout);
 
   return scanout;
 }
@@ -189,6 +189,14 @@ struct _MetaWaylandSurface
   MetaWaylandSurfaceState *pending_state;
   /* State cached due to inter-surface synchronization such. */
   MetaWaylandSurfaceState *cached_state;
+  /* Committed states waiting for client rendering to finish. */
+  GQueue pending_commits;
+
+  /* Link in the compositor's frame callback queue the surface is in. */
+  struct {
+    GList link;
+    GQueue *queue;
+  } frame_callback;
 
   /* Extension resources. */
   struct wl_resource *wl_subsurface;
@@ -363,6 +371,10 @@ int                 meta_wayland_surface_get_height (MetaWaylandSurface *surface
 CoglScanout *       meta_wayland_surface_try_acquire_scanout (MetaWaylandSurface *surface,
                                                               CoglOnscreen       *onscreen);
 
+CoglScanout *       meta_wayland_surface_try_acquire_overlay (MetaWaylandSurface  *surface,
+                                                              CoglOnscreen        *onscreen,
+                                                              const MetaRectangle *dst_rect);
+
 MetaCrtc * meta_wayland_surface_get_scanout_candidate (MetaWaylandSurface *surface);
 
 void meta_wayland_surface_set_scanout_candidate (MetaWaylandSurface *surface,
@@ -201,23 +201,186 @@ meta_wayland_compositor_update (MetaWaylandCompositor *compositor,
     meta_wayland_seat_update (compositor->seat, event);
 }
 
+/*
+ * Surfaces waiting for frame callbacks are kept in one queue per stage view,
+ * and have their callbacks emitted after that view has been updated. Newly
+ * queued surfaces are sorted into the queue of their primary view after the
+ * next update of any view, so that their primary view is looked up once per
+ * commit rather than once per view update.
+ *
+ * Surfaces that aren't visible on any view, e.g. because they are fully
+ * obscured or on another workspace, are kept in a separate queue that is
+ * emitted at a low rate, so that their clients stop rendering without being
+ * completely stalled.
+ */
+#define HIDDEN_FRAME_CALLBACK_INTERVAL_MS 1000
+
 static void
-on_after_update (ClutterStage          *stage,
-                 ClutterStageView      *stage_view,
-                 MetaWaylandCompositor *compositor)
+emit_frame_callbacks (MetaWaylandSurface *surface,
+                      int64_t             now_us)
 {
-  GList *l;
+  MetaWaylandActorSurface *actor_surface =
+    META_WAYLAND_ACTOR_SURFACE (surface->role);
+
+  meta_wayland_actor_surface_emit_frame_callbacks (actor_surface,
+                                                   now_us / 1000);
+}
+
+static gboolean
+is_surface_hidden (MetaWaylandSurface *surface)
+{
+  MetaSurfaceActor *actor;
+
+  actor = meta_wayland_surface_get_actor (surface);
+  if (!actor)
+    return FALSE;
+
+  if (clutter_actor_has_mapped_clones (CLUTTER_ACTOR (actor)))
+    return FALSE;
+
+  return (!clutter_actor_is_mapped (CLUTTER_ACTOR (actor)) ||
+          meta_surface_actor_is_obscured (actor));
+}
+
+static void
+move_frame_callback_surface (MetaWaylandSurface *surface,
+                             GQueue             *queue)
+{
+  if (surface->frame_callback.queue)
+    g_queue_unlink (surface->frame_callback.queue,
+                    &surface->frame_callback.link);
+
+  g_queue_push_tail_link (queue, &surface->frame_callback.link);
+  surface->frame_callback.queue = queue;
+}
+
+static void on_view_finalized (gpointer  user_data,
+                               GObject  *where_the_object_was);
+
+static GQueue *
+ensure_view_frame_callback_surfaces (MetaWaylandCompositor *compositor,
+                                     ClutterStageView      *stage_view)
+{
+  GQueue *surfaces;
+
+  surfaces = g_hash_table_lookup (compositor->frame_callbacks.view_surfaces,
+                                  stage_view);
+  if (!surfaces)
+    {
+      surfaces = g_queue_new ();
+      g_hash_table_insert (compositor->frame_callbacks.view_surfaces,
+                           stage_view, surfaces);
+      g_object_weak_ref (G_OBJECT (stage_view), on_view_finalized, compositor);
+    }
+
+  return surfaces;
+}
+
+static void
+unsort_view_frame_callback_surfaces (MetaWaylandCompositor *compositor,
+                                     GQueue                *view_surfaces)
+{
+  while (!g_queue_is_empty (view_surfaces))
+    {
+      MetaWaylandSurface *surface = g_queue_peek_head (view_surfaces);
+
+      move_frame_callback_surface (surface,
+                                   &compositor->frame_callbacks.unsorted_surfaces);
+    }
+}
+
+static void
+on_view_finalized (gpointer  user_data,
+                   GObject  *where_the_object_was)
+{
+  MetaWaylandCompositor *compositor = user_data;
+  GQueue *view_surfaces;
+
+  view_surfaces = g_hash_table_lookup (compositor->frame_callbacks.view_surfaces,
+                                       where_the_object_was);
+  if (!view_surfaces)
+    return;
+
+  unsort_view_frame_callback_surfaces (compositor, view_surfaces);
+  g_hash_table_remove (compositor->frame_callbacks.view_surfaces,
+                       where_the_object_was);
+}
+
+static gboolean
+emit_hidden_frame_callbacks (gpointer user_data)
+{
+  MetaWaylandCompositor *compositor = user_data;
+  GQueue *hidden_surfaces = &compositor->frame_callbacks.hidden_surfaces;
+  gboolean needs_update = FALSE;
   int64_t now_us;
 
   now_us = g_get_monotonic_time ();
 
-  l = compositor->frame_callback_surfaces;
+  while (!g_queue_is_empty (hidden_surfaces))
+    {
+      MetaWaylandSurface *surface = g_queue_peek_head (hidden_surfaces);
+
+      if (!is_surface_hidden (surface))
+        {
+          move_frame_callback_surface (surface,
+                                       &compositor->frame_callbacks.unsorted_surfaces);
+          needs_update = TRUE;
+          continue;
+        }
+
+      emit_frame_callbacks (surface, now_us);
+
+      g_queue_unlink (hidden_surfaces, &surface->frame_callback.link);
+      surface->frame_callback.queue = NULL;
+    }
+
+  if (needs_update)
+    {
+      MetaBackend *backend = meta_context_get_backend (compositor->context);
+      ClutterActor *stage = meta_backend_get_stage (backend);
+
+      clutter_stage_schedule_update (CLUTTER_STAGE (stage));
+    }
+
+  compositor->frame_callbacks.hidden_timeout_id = 0;
+  return G_SOURCE_REMOVE;
+}
+
+static void
+queue_hidden_frame_callback_surface (MetaWaylandCompositor *compositor,
+                                     MetaWaylandSurface    *surface)
+{
+  move_frame_callback_surface (surface,
+                               &compositor->frame_callbacks.hidden_surfaces);
+
+  if (compositor->frame_callbacks.hidden_timeout_id)
+    return;
+
+  compositor->frame_callbacks.hidden_timeout_id =
+    g_timeout_add (HIDDEN_FRAME_CALLBACK_INTERVAL_MS,
+                   emit_hidden_frame_callbacks,
+                   compositor);
+  g_source_set_name_by_id (compositor->frame_callbacks.hidden_timeout_id,
+                           "[mutter] Hidden surface frame callbacks");
+}
+
+/*
+ * Sorts newly queued surfaces into the queue of their primary view, or the
+ * hidden queue, whichever view is updated first. Hidden surfaces that became
+ * visible again are only moved back by the hidden queue's own timeout.
+ */
+static void
+sort_frame_callback_surfaces (MetaWaylandCompositor *compositor,
+                              ClutterStage          *stage)
+{
+  GQueue *unsorted_surfaces = &compositor->frame_callbacks.unsorted_surfaces;
+  GList *l;
+
+  l = unsorted_surfaces->head;
   while (l)
     {
-      GList *l_cur = l;
       MetaWaylandSurface *surface = l->data;
       MetaSurfaceActor *actor;
-      MetaWaylandActorSurface *actor_surface;
       ClutterStageView *surface_primary_view;
 
       l = l->next;
@@ -228,15 +391,67 @@ on_after_update (ClutterStage          *stage,
 
       surface_primary_view =
         meta_surface_actor_wayland_get_current_primary_view (actor, stage);
-      if (stage_view != surface_primary_view)
-        continue;
+      if (surface_primary_view && !is_surface_hidden (surface))
+        {
+          GQueue *view_surfaces;
 
-      actor_surface = META_WAYLAND_ACTOR_SURFACE (surface->role);
-      meta_wayland_actor_surface_emit_frame_callbacks (actor_surface,
-                                                       now_us / 1000);
+          view_surfaces =
+            ensure_view_frame_callback_surfaces (compositor,
+                                                 surface_primary_view);
+          move_frame_callback_surface (surface, view_surfaces);
+        }
+      else
+        {
+          queue_hidden_frame_callback_surface (compositor, surface);
+        }
+    }
+}
 
-      compositor->frame_callback_surfaces =
-        g_list_delete_link (compositor->frame_callback_surfaces, l_cur);
+static void
+on_after_update (ClutterStage          *stage,
+                 ClutterStageView      *stage_view,
+                 MetaWaylandCompositor *compositor)
+{
+  GQueue *view_surfaces;
+  int64_t now_us;
+
+  sort_frame_callback_surfaces (compositor, stage);
+
+  view_surfaces = g_hash_table_lookup (compositor->frame_callbacks.view_surfaces,
+                                       stage_view);
+  if (!view_surfaces)
+    return;
+
+  now_us = g_get_monotonic_time ();
+
+  while (!g_queue_is_empty (view_surfaces))
+    {
+      MetaWaylandSurface *surface = g_queue_peek_head (view_surfaces);
+
+      emit_frame_callbacks (surface, now_us);
+
+      g_queue_unlink (view_surfaces, &surface->frame_callback.link);
+      surface->frame_callback.queue = NULL;
+    }
+}
+
+static void
+on_monitors_changed (MetaMonitorManager    *monitor_manager,
+                     MetaWaylandCompositor *compositor)
+{
+  GHashTableIter iter;
+  ClutterStageView *stage_view;
+  GQueue *view_surfaces;
+
+  /* All stage views were re-created, so sort their surfaces anew. */
+  g_hash_table_iter_init (&iter, compositor->frame_callbacks.view_surfaces);
+  while (g_hash_table_iter_next (&iter,
+                                 (gpointer *) &stage_view,
+                                 (gpointer *) &view_surfaces))
+    {
+      unsort_view_frame_callback_surfaces (compositor, view_surfaces);
+      g_object_weak_unref (G_OBJECT (stage_view), on_view_finalized, compositor);
+      g_hash_table_iter_remove (&iter);
     }
 }
 
@@ -331,19 +546,31 @@ void
 meta_wayland_compositor_add_frame_callback_surface (MetaWaylandCompositor *compositor,
                                                     MetaWaylandSurface    *surface)
 {
-  if (g_list_find (compositor->frame_callback_surfaces, surface))
+  if (surface->frame_callback.queue)
     return;
 
-  compositor->frame_callback_surfaces =
-    g_list_prepend (compositor->frame_callback_surfaces, surface);
+  /*
+   * Hidden surfaces might not cause any stage update that would sort them,
+   * so throttle them right away. Should they be about to become visible,
+   * they are picked up again after the stage update that shows them.
+   */
+  if (is_surface_hidden (surface))
+    queue_hidden_frame_callback_surface (compositor, surface);
+  else
+    move_frame_callback_surface (surface,
+                                 &compositor->frame_callbacks.unsorted_surfaces);
 }
 
 void
 meta_wayland_compositor_remove_frame_callback_surface (MetaWaylandCompositor *compositor,
                                                        MetaWaylandSurface    *surface)
 {
-  compositor->frame_callback_surfaces =
-    g_list_remove (compositor->frame_callback_surfaces, surface);
+  if (!surface->frame_callback.queue)
+    return;
+
+  g_queue_unlink (surface->frame_callback.queue,
+                  &surface->frame_callback.link);
+  surface->frame_callback.queue = NULL;
 }
 
 void
@@ -439,9 +666,19 @@ static void
 meta_wayland_compositor_finalize (GObject *object)
 {
   MetaWaylandCompositor *compositor = META_WAYLAND_COMPOSITOR (object);
+  GHashTableIter iter;
+  ClutterStageView *stage_view;
 
   g_clear_object (&compositor->dma_buf_manager);
 
+  g_clear_handle_id (&compositor->frame_callbacks.hidden_timeout_id,
+                     g_source_remove);
+  g_hash_table_iter_init (&iter, compositor->frame_callbacks.view_surfaces);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &stage_view, NULL))
+    g_object_weak_unref (G_OBJECT (stage_view), on_view_finalized, compositor);
+  g_clear_pointer (&compositor->frame_callbacks.view_surfaces,
+                   g_hash_table_unref);
+
   g_clear_pointer (&compositor->seat, meta_wayland_seat_free);
 
   g_clear_pointer (&compositor->display_name, g_free);
@@ -456,6 +693,11 @@ meta_wayland_compositor_init (MetaWaylandCompositor *compositor)
 {
   compositor->scheduled_surface_associations = g_hash_table_new (NULL, NULL);
 
+  g_queue_init (&compositor->frame_callbacks.unsorted_surfaces);
+  g_queue_init (&compositor->frame_callbacks.hidden_surfaces);
+  compositor->frame_callbacks.view_surfaces =
+    g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_queue_free);
+
   wl_log_set_handler_server (meta_wayland_log_func);
 
   compositor->wayland_display = wl_display_create ();
@@ -581,6 +823,9 @@ meta_wayland_compositor_new (MetaContext *context)
 
   g_signal_connect (stage, "after-update",
                     G_CALLBACK (on_after_update), compositor);
+  g_signal_connect (meta_backend_get_monitor_manager (backend),
+                    "monitors-changed-internal",
+                    G_CALLBACK (on_monitors_changed), compositor);
   g_signal_connect (stage, "presented",
                     G_CALLBACK (on_presented), compositor);
 